@@ -0,0 +1,599 @@
+// Filesystem benchmark suite shared by the BenchSuite sketch and the
+// Linux host build in extras/host.
+//
+// Each test prints operation count, rate, p50/p99/max latency in
+// microseconds, and the block device read commands, write commands and
+// sectors transferred.  Commands are counted when FsBlockDevice is
+// FsBlockDeviceInterface, that is for SDIO boards or when
+// USE_BLOCK_DEVICE_INTERFACE is nonzero.
+//
+// The suite creates and removes files and directories in the root of
+// the volume.  Run it on a card or image with no valuable data.
+#ifndef BenchSuite_h
+#define BenchSuite_h
+#include "FsLib/FsLib.h"
+
+#if HAS_SDIO_CLASS || USE_BLOCK_DEVICE_INTERFACE
+/** Block device commands can be counted. */
+#define BENCH_COUNT_COMMANDS 1
+#else  // HAS_SDIO_CLASS || USE_BLOCK_DEVICE_INTERFACE
+#define BENCH_COUNT_COMMANDS 0
+#endif  // HAS_SDIO_CLASS || USE_BLOCK_DEVICE_INTERFACE
+//------------------------------------------------------------------------------
+/**
+ * \class BenchHistogram
+ * \brief Latency histogram with four buckets per power of two.
+ *
+ * Percentiles are the upper bound of a bucket so they are within 25%
+ * of the true value.
+ */
+class BenchHistogram {
+ public:
+  BenchHistogram() { clear(); }
+  /** Add a sample. \param[in] us Latency in microseconds. */
+  void add(uint32_t us) {
+    m_bucket[index(us)]++;
+    m_count++;
+    if (us > m_max) {
+      m_max = us;
+    }
+  }
+  /** Remove all samples. */
+  void clear() {
+    memset(m_bucket, 0, sizeof(m_bucket));
+    m_count = 0;
+    m_max = 0;
+  }
+  /** \return Number of samples. */
+  uint32_t count() const { return m_count; }
+  /** \return Largest sample. */
+  uint32_t max() const { return m_max; }
+  /** Find a percentile.
+   * \param[in] pct Percentile in the range 1 to 100.
+   * \return Upper bound of the bucket that holds the percentile.
+   */
+  uint32_t percentile(uint8_t pct) const {
+    uint32_t rank = ((uint64_t)m_count * pct + 99) / 100;
+    uint32_t n = 0;
+    for (uint8_t i = 0; i < BUCKET_COUNT; i++) {
+      n += m_bucket[i];
+      if (n >= rank && n) {
+        uint32_t ub = upper(i);
+        return ub < m_max ? ub : m_max;
+      }
+    }
+    return m_max;
+  }
+
+ private:
+  static const uint8_t BUCKET_COUNT = 124;
+  static uint8_t index(uint32_t us) {
+    if (us < 4) {
+      return us;
+    }
+    uint8_t bits = 31 - __builtin_clz(us);
+    return 4 * (bits - 1) + ((us >> (bits - 2)) & 3);
+  }
+  static uint32_t upper(uint8_t i) {
+    if (i < 4) {
+      return i;
+    }
+    uint8_t shift = i / 4 - 1;
+    return ((uint32_t)(4 + i % 4) << shift) + ((uint32_t)1 << shift) - 1;
+  }
+  uint32_t m_bucket[BUCKET_COUNT];
+  uint32_t m_count;
+  uint32_t m_max;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class BenchCounter
+ * \brief Block device wrapper that counts commands and sectors.
+ */
+class BenchCounter : public FsBlockDeviceInterface {
+ public:
+  /** Reset the counts. */
+  void clear() {
+    readCmds = 0;
+    readCount = 0;
+    writeCmds = 0;
+    writeCount = 0;
+    syncCmds = 0;
+  }
+  /** \param[in] dev Device to count. */
+  void setDevice(FsBlockDeviceInterface* dev) { m_dev = dev; }
+
+  void end() override { m_dev->end(); }
+  bool erase(Sector_t firstSector, Sector_t lastSector) override {
+    return m_dev->erase(firstSector, lastSector);
+  }
+  bool eraseHint(Sector_t firstSector, Sector_t lastSector) override {
+    return m_dev->eraseHint(firstSector, lastSector);
+  }
+  bool isBusy() override { return m_dev->isBusy(); }
+#if USE_ASYNC_IO
+  uint8_t poll() override { return m_dev->poll(); }
+#endif  // USE_ASYNC_IO
+  bool readSector(Sector_t sector, uint8_t* dst) override {
+    readCmds++;
+    readCount++;
+    return m_dev->readSector(sector, dst);
+  }
+  bool readSectors(Sector_t sector, uint8_t* dst, size_t ns) override {
+    readCmds++;
+    readCount += ns;
+    return m_dev->readSectors(sector, dst, ns);
+  }
+  Sector_t sectorCount() override { return m_dev->sectorCount(); }
+#if USE_ASYNC_IO
+  bool submit(FsIoRequest* req) override {
+    if (req->op == FS_IO_WRITE) {
+      writeCmds++;
+      writeCount += req->count;
+    } else {
+      readCmds++;
+      readCount += req->count;
+    }
+    return m_dev->submit(req);
+  }
+#endif  // USE_ASYNC_IO
+  bool syncDevice() override {
+    syncCmds++;
+    return m_dev->syncDevice();
+  }
+  bool writeSector(Sector_t sector, const uint8_t* src) override {
+    writeCmds++;
+    writeCount++;
+    return m_dev->writeSector(sector, src);
+  }
+  bool writeSectors(Sector_t sector, const uint8_t* src, size_t ns) override {
+    writeCmds++;
+    writeCount += ns;
+    return m_dev->writeSectors(sector, src, ns);
+  }
+
+  /** Read commands. */
+  uint32_t readCmds = 0;
+  /** Sectors read. */
+  uint32_t readCount = 0;
+  /** Write commands. */
+  uint32_t writeCmds = 0;
+  /** Sectors written. */
+  uint32_t writeCount = 0;
+  /** Device sync calls. */
+  uint32_t syncCmds = 0;
+
+ private:
+  FsBlockDeviceInterface* m_dev = nullptr;
+};
+//------------------------------------------------------------------------------
+/**
+ * \struct BenchConfig
+ * \brief Size of each test.  A zero count skips the test.
+ */
+struct BenchConfig {
+  /** Volume mounts. */
+  uint16_t mounts = 10;
+  /** Size of the sequential and random I/O file. */
+  uint32_t fileSize = 4UL << 20;
+  /** Random reads and random writes for each transfer size. */
+  uint16_t randomOps = 1000;
+  /** Small files created then removed. */
+  uint16_t smallFiles = 200;
+  /** Entries in the lookup test directories. */
+  uint16_t dirEntries[2] = {100, 1000};
+  /** Lookups in each directory. */
+  uint16_t lookups = 200;
+  /** Append and sync cycles. */
+  uint16_t appendSyncs = 500;
+  /** Free space queries. */
+  uint16_t freeQueries = 5;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class BenchSuite
+ * \brief Run and report filesystem benchmarks.
+ */
+class BenchSuite {
+ public:
+  /** Prepare the suite.
+   *
+   * \param[in] dev Formatted block device.
+   * \param[in] buf I/O buffer - largest sequential transfer size.
+   * \param[in] size Size of buf, at least 512 bytes.
+   * \param[in] pr Print stream for results.
+   * \return true for success or false for failure.
+   */
+  bool begin(FsBlockDevice* dev, uint8_t* buf, size_t size, print_t* pr) {
+#if BENCH_COUNT_COMMANDS
+    m_counter.setDevice(dev);
+    m_dev = &m_counter;
+#else   // BENCH_COUNT_COMMANDS
+    m_dev = dev;
+#endif  // BENCH_COUNT_COMMANDS
+    m_buf = buf;
+    m_bufSize = size;
+    m_pr = pr;
+    m_rand = 1;
+    return size >= 512 && m_vol.begin(m_dev, false);
+  }
+  /** Run all tests with nonzero counts.
+   * \param[in] cfg Test sizes.
+   * \return true for success or false for failure.
+   */
+  bool run(const BenchConfig& cfg) {
+    header();
+    return mount(cfg.mounts) && sequential(cfg.fileSize) &&
+           random(cfg.fileSize, cfg.randomOps) && smallFiles(cfg.smallFiles) &&
+           lookup(cfg.dirEntries[0], cfg.lookups) &&
+           lookup(cfg.dirEntries[1], cfg.lookups) &&
+           appendSync(cfg.appendSyncs) && freeSpace(cfg.freeQueries);
+  }
+  /** Print the column headings. */
+  void header() {
+    m_pr->print("test           ops     rate unit   p50us   p99us   maxus");
+#if BENCH_COUNT_COMMANDS
+    m_pr->print("    rdCmd    wrCmd     sect");
+#endif  // BENCH_COUNT_COMMANDS
+    m_pr->println();
+  }
+  //----------------------------------------------------------------------------
+  /** Time append and sync cycles of 64 bytes.
+   * \param[in] n Number of cycles.
+   * \return true for success or false for failure.
+   */
+  bool appendSync(uint16_t n) {
+    FsFile file;
+    if (!n) {
+      return true;
+    }
+    if (!file.open(&m_vol, "bench_a.log", O_WRONLY | O_CREAT | O_TRUNC)) {
+      return fail("open bench_a.log");
+    }
+    fill(64);
+    start();
+    for (uint16_t i = 0; i < n; i++) {
+      uint32_t t = micros();
+      if (file.write(m_buf, 64) != 64 || !file.sync()) {
+        return fail("append");
+      }
+      m_hist.add(micros() - t);
+    }
+    report("append+sync", 0);
+    file.close();
+    return m_vol.remove("bench_a.log") || fail("remove bench_a.log");
+  }
+  //----------------------------------------------------------------------------
+  /** Time free cluster count queries.
+   * \param[in] n Number of queries.
+   * \return true for success or false for failure.
+   */
+  bool freeSpace(uint16_t n) {
+    start();
+    for (uint16_t i = 0; i < n; i++) {
+      uint32_t t = micros();
+      if (m_vol.freeClusterCount() < 0) {
+        return fail("freeClusterCount");
+      }
+      m_hist.add(micros() - t);
+    }
+    if (n) {
+      report("freeSpace", 0);
+    }
+    return true;
+  }
+  //----------------------------------------------------------------------------
+  /** Time open of existing and missing names in a directory.
+   * \param[in] entries Number of files in the directory.
+   * \param[in] n Number of lookups of each kind.
+   * \return true for success or false for failure.
+   */
+  bool lookup(uint16_t entries, uint16_t n) {
+    FsFile dir;
+    FsFile file;
+    char path[32];
+    if (!entries || !n) {
+      return true;
+    }
+    char name[24];
+    if (!m_vol.mkdir("bench_d") || !dir.open(&m_vol, "bench_d", O_RDONLY)) {
+      return fail("mkdir bench_d");
+    }
+    for (uint16_t i = 0; i < entries; i++) {
+      entryName(path, i);
+      if (!file.open(&dir, path, O_WRONLY | O_CREAT) || !file.close()) {
+        return fail("create entry");
+      }
+    }
+    start();
+    for (uint16_t i = 0; i < n; i++) {
+      entryName(path, next() % entries);
+      uint32_t t = micros();
+      if (!file.open(&dir, path, O_RDONLY)) {
+        return fail("lookup");
+      }
+      m_hist.add(micros() - t);
+      file.close();
+    }
+    report(label(name, "lookup", entries), 0);
+    start();
+    for (uint16_t i = 0; i < n; i++) {
+      entryName(path, entries + next() % entries);
+      uint32_t t = micros();
+      if (file.open(&dir, path, O_RDONLY)) {
+        return fail("lookup miss");
+      }
+      m_hist.add(micros() - t);
+    }
+    report(label(name, "miss", entries), 0);
+    return removeAll(&dir);
+  }
+  //----------------------------------------------------------------------------
+  /** Time volume mounts.
+   * \param[in] n Number of mounts.
+   * \return true for success or false for failure.
+   */
+  bool mount(uint16_t n) {
+    start();
+    for (uint16_t i = 0; i < n; i++) {
+      uint32_t t = micros();
+      if (!m_vol.begin(m_dev, false)) {
+        return fail("mount");
+      }
+      m_hist.add(micros() - t);
+    }
+    if (n) {
+      report("mount", 0);
+    }
+    return true;
+  }
+  //----------------------------------------------------------------------------
+  /** Time random reads then random writes of 512 bytes and 4 KiB.
+   * \param[in] fileSize Size of the test file.
+   * \param[in] n Number of transfers of each kind.
+   * \return true for success or false for failure.
+   */
+  bool random(uint32_t fileSize, uint16_t n) {
+    FsFile file;
+    if (!n || fileSize < 4096) {
+      return true;
+    }
+    if (!file.open(&m_vol, "bench.dat", O_RDWR)) {
+      return fail("open bench.dat");
+    }
+    for (size_t size = 512; size <= 4096 && size <= m_bufSize; size *= 8) {
+      uint32_t count = fileSize / size;
+      start();
+      for (uint16_t i = 0; i < n; i++) {
+        uint32_t t = micros();
+        if (!file.seekSet((uint64_t)size * (next() % count)) ||
+            file.read(m_buf, size) != (int)size) {
+          return fail("random read");
+        }
+        m_hist.add(micros() - t);
+      }
+      report(size == 512 ? "randRead512" : "randRead4k", (uint64_t)n * size);
+      start();
+      for (uint16_t i = 0; i < n; i++) {
+        uint32_t t = micros();
+        if (!file.seekSet((uint64_t)size * (next() % count)) ||
+            file.write(m_buf, size) != size) {
+          return fail("random write");
+        }
+        m_hist.add(micros() - t);
+      }
+      if (!file.sync()) {
+        return fail("sync");
+      }
+      report(size == 512 ? "randWrite512" : "randWrite4k",
+             (uint64_t)n * size);
+    }
+    file.close();
+    return m_vol.remove("bench.dat") || fail("remove bench.dat");
+  }
+  //----------------------------------------------------------------------------
+  /** Time sequential write and read for transfer sizes from 64 bytes to
+   * the buffer size.  The file is kept for random().
+   *
+   * \param[in] fileSize Size of the test file.
+   * \return true for success or false for failure.
+   */
+  bool sequential(uint32_t fileSize) {
+    FsFile file;
+    char name[24];
+    if (!fileSize) {
+      return true;
+    }
+    for (size_t size = 64;; size *= 8) {
+      if (size > m_bufSize) {
+        size = m_bufSize;
+      }
+      size_t n = fileSize / size;
+      if (!file.open(&m_vol, "bench.dat", O_RDWR | O_CREAT | O_TRUNC)) {
+        return fail("open bench.dat");
+      }
+      fill(size);
+      start();
+      for (size_t i = 0; i < n; i++) {
+        uint32_t t = micros();
+        if (file.write(m_buf, size) != size) {
+          return fail("write");
+        }
+        m_hist.add(micros() - t);
+      }
+      if (!file.sync()) {
+        return fail("sync");
+      }
+      report(label(name, "write", size), (uint64_t)n * size);
+      file.rewind();
+      start();
+      for (size_t i = 0; i < n; i++) {
+        uint32_t t = micros();
+        if (file.read(m_buf, size) != (int)size) {
+          return fail("read");
+        }
+        m_hist.add(micros() - t);
+      }
+      report(label(name, "read", size), (uint64_t)n * size);
+      file.close();
+      if (size == m_bufSize) {
+        break;
+      }
+    }
+    return true;
+  }
+  //----------------------------------------------------------------------------
+  /** Time create of files with 100 bytes then time remove of the files.
+   * \param[in] n Number of files.
+   * \return true for success or false for failure.
+   */
+  bool smallFiles(uint16_t n) {
+    FsFile dir;
+    FsFile file;
+    char path[32];
+    if (!n) {
+      return true;
+    }
+    if (!m_vol.mkdir("bench_s") || !dir.open(&m_vol, "bench_s", O_RDONLY)) {
+      return fail("mkdir bench_s");
+    }
+    fill(100);
+    start();
+    for (uint16_t i = 0; i < n; i++) {
+      entryName(path, i);
+      uint32_t t = micros();
+      if (!file.open(&dir, path, O_WRONLY | O_CREAT | O_EXCL) ||
+          file.write(m_buf, 100) != 100 || !file.close()) {
+        return fail("create");
+      }
+      m_hist.add(micros() - t);
+    }
+    report("create", 0);
+    start();
+    for (uint16_t i = 0; i < n; i++) {
+      entryName(path, i);
+      uint32_t t = micros();
+      if (!dir.remove(path)) {
+        return fail("remove");
+      }
+      m_hist.add(micros() - t);
+    }
+    report("remove", 0);
+    return dir.rmdir() || fail("rmdir bench_s");
+  }
+
+ private:
+  static void entryName(char* path, uint32_t i) {
+    memcpy(path, "entry-", 6);
+    for (uint8_t k = 10; k > 5; k--) {
+      path[k] = '0' + i % 10;
+      i /= 10;
+    }
+    memcpy(path + 11, ".txt", 5);
+  }
+  bool fail(const char* msg) {
+    m_pr->print("FAIL: ");
+    m_pr->println(msg);
+    return false;
+  }
+  void fill(size_t n) {
+    for (size_t i = 0; i < n; i++) {
+      m_buf[i] = i % 64 == 63 ? '\n' : 'A' + i % 26;
+    }
+  }
+  uint32_t next() {
+    // xorshift32
+    m_rand ^= m_rand << 13;
+    m_rand ^= m_rand >> 17;
+    m_rand ^= m_rand << 5;
+    return m_rand;
+  }
+  void printField(uint32_t v, uint8_t width) {
+    char buf[11];
+    char* str = buf + sizeof(buf);
+    *--str = 0;
+    do {
+      *--str = '0' + v % 10;
+      v /= 10;
+    } while (v);
+    for (uint8_t n = buf + sizeof(buf) - 1 - str; n < width; n++) {
+      m_pr->write(' ');
+    }
+    m_pr->print(str);
+  }
+  bool removeAll(FsFile* dir) {
+    FsFile file;
+    dir->rewind();
+    while (file.openNext(dir, O_WRONLY)) {
+      if (!file.remove()) {
+        return fail("remove entry");
+      }
+    }
+    return dir->rmdir() || fail("rmdir bench_d");
+  }
+  void report(const char* name, uint64_t bytes) {
+    uint32_t us = micros() - m_start;
+    uint32_t n = m_hist.count();
+    size_t len = strlen(name);
+    m_pr->print(name);
+    for (; len < 12; len++) {
+      m_pr->write(' ');
+    }
+    printField(n, 6);
+    if (us == 0) {
+      us = 1;
+    }
+    if (bytes) {
+      printField((bytes * 1000) / us, 9);
+      m_pr->print(" KB/s");
+    } else {
+      printField(((uint64_t)n * 1000000) / us, 9);
+      m_pr->print(" op/s");
+    }
+    printField(m_hist.percentile(50), 8);
+    printField(m_hist.percentile(99), 8);
+    printField(m_hist.max(), 8);
+#if BENCH_COUNT_COMMANDS
+    printField(m_counter.readCmds, 9);
+    printField(m_counter.writeCmds, 9);
+    printField(m_counter.readCount + m_counter.writeCount, 9);
+#endif  // BENCH_COUNT_COMMANDS
+    m_pr->println();
+  }
+  static const char* label(char* name, const char* prefix, uint32_t v) {
+    char num[12];
+    char* str = num + sizeof(num);
+    *--str = 0;
+    if (v >= 1024 && v % 1024 == 0) {
+      *--str = 'k';
+      v /= 1024;
+    }
+    do {
+      *--str = '0' + v % 10;
+      v /= 10;
+    } while (v);
+    strcpy(name, prefix);
+    strcat(name, str);
+    return name;
+  }
+  void start() {
+    m_hist.clear();
+#if BENCH_COUNT_COMMANDS
+    m_counter.clear();
+#endif  // BENCH_COUNT_COMMANDS
+    m_start = micros();
+  }
+
+#if BENCH_COUNT_COMMANDS
+  BenchCounter m_counter;
+#endif  // BENCH_COUNT_COMMANDS
+  BenchHistogram m_hist;
+  FsVolume m_vol;
+  FsBlockDevice* m_dev = nullptr;
+  uint8_t* m_buf = nullptr;
+  size_t m_bufSize = 0;
+  print_t* m_pr = nullptr;
+  uint32_t m_rand = 1;
+  uint32_t m_start = 0;
+};
+#endif  // BenchSuite_h
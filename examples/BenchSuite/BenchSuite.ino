@@ -0,0 +1,96 @@
+// Filesystem benchmark suite.
+//
+// Runs sequential and random I/O over a sweep of transfer sizes, small
+// file create and remove, directory lookups, append+sync cycles, free
+// space queries and mount time.  Each test reports p50/p99/max latency
+// and, when FsBlockDevice is FsBlockDeviceInterface, the number of block
+// device commands.  Set USE_BLOCK_DEVICE_INTERFACE nonzero in
+// SdFatConfig.h to count commands for SPI cards.
+//
+// The same suite runs on a Linux host with extras/host/BenchSuite.
+//
+// Warning: the suite creates and removes files in the root directory.
+// Use a card with no valuable data.  Not for boards with less than 8 KB
+// of RAM.
+#ifndef DISABLE_FS_H_WARNING
+#define DISABLE_FS_H_WARNING  // Disable warning for type File not defined.
+#endif                        // DISABLE_FS_H_WARNING
+#include "SdFat.h"
+#include "BenchSuite.h"
+
+// SDCARD_SS_PIN is defined for the built-in SD on some boards.
+#ifndef SDCARD_SS_PIN
+const uint8_t SD_CS_PIN = SS;
+#else   // SDCARD_SS_PIN
+// Assume built-in SD is used.
+const uint8_t SD_CS_PIN = SDCARD_SS_PIN;
+#endif  // SDCARD_SS_PIN
+
+// Try max SPI clock for an SD. Reduce SPI_CLOCK if errors occur.
+#define SPI_CLOCK SD_SCK_MHZ(50)
+
+// Try to select the best SD card configuration.
+#if defined(HAS_TEENSY_SDIO)
+#define SD_CONFIG SdioConfig(FIFO_SDIO)
+#elif defined(HAS_BUILTIN_PIO_SDIO)
+// See the Rp2040SdioSetup example for boards without a builtin SDIO socket.
+#define SD_CONFIG SdioConfig(PIN_SD_CLK, PIN_SD_CMD_MOSI, PIN_SD_DAT0_MISO)
+#elif ENABLE_DEDICATED_SPI
+#define SD_CONFIG SdSpiConfig(SD_CS_PIN, DEDICATED_SPI, SPI_CLOCK)
+#else  // HAS_TEENSY_SDIO
+#define SD_CONFIG SdSpiConfig(SD_CS_PIN, SHARED_SPI, SPI_CLOCK)
+#endif  // HAS_TEENSY_SDIO
+
+// Largest sequential transfer size.
+const size_t BUF_SIZE = 4096;
+
+// Size of the sequential and random I/O file.
+const uint32_t FILE_SIZE = 4UL << 20;
+
+SdFs sd;
+BenchSuite suite;
+BenchConfig cfg;
+uint8_t buf[BUF_SIZE];
+//------------------------------------------------------------------------------
+void clearSerialInput() {
+  uint32_t m = micros();
+  do {
+    if (Serial.read() >= 0) {
+      m = micros();
+    }
+  } while (micros() - m < 10000);
+}
+//------------------------------------------------------------------------------
+void setup() {
+  Serial.begin(9600);
+
+  // Wait for USB Serial
+  while (!Serial) {
+    yield();
+  }
+  delay(1000);
+  Serial.println(F("\nUse a freshly formatted SD for repeatable results."));
+  if (!BENCH_COUNT_COMMANDS) {
+    Serial.println(F("Block device commands are not counted."));
+  }
+  cfg.fileSize = FILE_SIZE;
+}
+//------------------------------------------------------------------------------
+void loop() {
+  clearSerialInput();
+  Serial.println(F("\nType any character to start"));
+  while (!Serial.available()) {
+    yield();
+  }
+  if (!sd.cardBegin(SD_CONFIG)) {
+    sd.initErrorHalt(&Serial);
+  }
+  if (!suite.begin(sd.card(), buf, sizeof(buf), &Serial)) {
+    Serial.println(F("Mount failed - format the card."));
+    return;
+  }
+  if (!suite.run(cfg)) {
+    Serial.println(F("Benchmark failed."));
+  }
+  Serial.println(F("Done"));
+}
@@ -0,0 +1,115 @@
+/*
+ * Compare bit at a time and word at a time exFAT bitmap functions.
+ *
+ * No SD card is required.  Bitmaps are synthetic 512 byte sectors.
+ */
+#ifndef DISABLE_FS_H_WARNING
+#define DISABLE_FS_H_WARNING  // Disable warning for type File not defined.
+#endif                        // DISABLE_FS_H_WARNING
+#include "SdFat.h"
+#include "common/FsBitmap.h"
+
+// Number of passes over each bitmap.
+const uint16_t PASS_COUNT = 200;
+
+// Bits in a 512 byte sector.
+const size_t SECTOR_BITS = 4096;
+
+uint8_t bitmap[512] __attribute__((aligned(4)));
+//------------------------------------------------------------------------------
+// Free count loop from the original exFAT freeClusterCount().
+size_t oldCount(const uint8_t* map) {
+  size_t usedCount = 0;
+  for (size_t i = 0; i < 512; i++) {
+    if (map[i] == 0XFF) {
+      usedCount += 8;
+    } else if (map[i]) {
+      for (uint8_t mask = 1; mask; mask <<= 1) {
+        if ((mask & map[i])) {
+          usedCount++;
+        }
+      }
+    }
+  }
+  return usedCount;
+}
+//------------------------------------------------------------------------------
+// Bit at a time search from the original exFAT bitmapFind().
+size_t oldFind(const uint8_t* map, size_t bgn) {
+  for (size_t n = bgn; n < SECTOR_BITS; n++) {
+    if (!(map[n >> 3] & (1 << (n & 7)))) {
+      return n;
+    }
+  }
+  return SECTOR_BITS;
+}
+//------------------------------------------------------------------------------
+// Fill bitmap with pattern. The free fraction is about percentFree / 100.
+void makeBitmap(uint8_t percentFree) {
+  for (size_t n = 0; n < SECTOR_BITS; n++) {
+    bool used = (uint8_t)random(100) >= percentFree;
+    fsBitmapFill(bitmap, n, n + 1, used);
+  }
+}
+//------------------------------------------------------------------------------
+void runTest(const char* label, uint8_t percentFree) {
+  uint32_t m;
+  uint32_t oldUs;
+  uint32_t newUs;
+  size_t nOld = 0;
+  size_t nNew = 0;
+  makeBitmap(percentFree);
+  Serial.print(label);
+
+  m = micros();
+  for (uint16_t i = 0; i < PASS_COUNT; i++) {
+    nOld += oldCount(bitmap);
+  }
+  oldUs = micros() - m;
+  m = micros();
+  for (uint16_t i = 0; i < PASS_COUNT; i++) {
+    nNew += fsBitmapCount(bitmap, 0, SECTOR_BITS);
+  }
+  newUs = micros() - m;
+  Serial.print(nOld == nNew ? F(" count ") : F(" count ERROR "));
+  Serial.print(oldUs);
+  Serial.print(F(" / "));
+  Serial.print(newUs);
+
+  // Find first free bit after each of eight start points.
+  nOld = nNew = 0;
+  m = micros();
+  for (uint16_t i = 0; i < PASS_COUNT; i++) {
+    for (size_t n = 0; n < SECTOR_BITS; n += SECTOR_BITS / 8) {
+      nOld += oldFind(bitmap, n);
+    }
+  }
+  oldUs = micros() - m;
+  m = micros();
+  for (uint16_t i = 0; i < PASS_COUNT; i++) {
+    for (size_t n = 0; n < SECTOR_BITS; n += SECTOR_BITS / 8) {
+      nNew += fsBitmapFind(bitmap, n, SECTOR_BITS, false);
+    }
+  }
+  newUs = micros() - m;
+  Serial.print(nOld == nNew ? F(", find ") : F(", find ERROR "));
+  Serial.print(oldUs);
+  Serial.print(F(" / "));
+  Serial.println(newUs);
+}
+//------------------------------------------------------------------------------
+void setup() {
+  Serial.begin(9600);
+  while (!Serial) {
+    yield();
+  }
+  Serial.println(F("Times are old / new micros for all passes."));
+  runTest("empty", 100);
+  runTest("random", 50);
+  runTest("90% full", 10);
+  runTest("99% full", 1);
+  runTest("full", 0);
+  Serial.println(F("Done"));
+}
+//------------------------------------------------------------------------------
+void loop() {}
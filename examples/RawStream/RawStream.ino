@@ -0,0 +1,123 @@
+// This example uses RawStream to write and read a preallocated contiguous
+// file directly with the block device.
+//
+// Whole sectors go from the buffer to the card with multi-sector writes
+// and no FAT or directory access.  The file's valid length is set by one
+// directory entry write when the stream is closed.
+//
+#ifndef DISABLE_FS_H_WARNING
+#define DISABLE_FS_H_WARNING  // Disable warning for type File not defined.
+#endif                        // DISABLE_FS_H_WARNING
+#include "SdFat.h"
+#include "RawStream.h"
+
+// SD_FAT_TYPE = 0 for SdFat/File as defined in SdFatConfig.h,
+// 1 for FAT16/FAT32, 2 for exFAT, 3 for FAT16/FAT32 and exFAT.
+#define SD_FAT_TYPE 3
+
+// SDCARD_SS_PIN is defined for the built-in SD on some boards.
+#ifndef SDCARD_SS_PIN
+const uint8_t SD_CS_PIN = SS;
+#else   // SDCARD_SS_PIN
+// Assume built-in SD is used.
+const uint8_t SD_CS_PIN = SDCARD_SS_PIN;
+#endif  // SDCARD_SS_PIN
+
+// Try max SPI clock for an SD. Reduce SPI_CLOCK if errors occur.
+#define SPI_CLOCK SD_SCK_MHZ(50)
+
+// Try to select the best SD card configuration.
+#if defined(HAS_TEENSY_SDIO)
+#define SD_CONFIG SdioConfig(FIFO_SDIO)
+#elif defined(HAS_BUILTIN_PIO_SDIO)
+// See the Rp2040SdioSetup example for boards without a builtin SDIO socket.
+#define SD_CONFIG SdioConfig(PIN_SD_CLK, PIN_SD_CMD_MOSI, PIN_SD_DAT0_MISO)
+#elif ENABLE_DEDICATED_SPI
+#define SD_CONFIG SdSpiConfig(SD_CS_PIN, DEDICATED_SPI, SPI_CLOCK)
+#else  // HAS_TEENSY_SDIO
+#define SD_CONFIG SdSpiConfig(SD_CS_PIN, SHARED_SPI, SPI_CLOCK)
+#endif  // HAS_TEENSY_SDIO
+
+// Preallocated file size and total bytes written.
+#define FILE_SIZE (32UL * 1024 * 1024)
+
+// Size of each write.  Use a multiple of 512 for the best rate.
+#define BUF_SIZE 4096
+
+#if SD_FAT_TYPE == 0
+SdFat sd;
+typedef File file_t;
+#elif SD_FAT_TYPE == 1
+SdFat32 sd;
+typedef File32 file_t;
+#elif SD_FAT_TYPE == 2
+SdExFat sd;
+typedef ExFile file_t;
+#elif SD_FAT_TYPE == 3
+SdFs sd;
+typedef FsFile file_t;
+#else  // SD_FAT_TYPE
+#error Invalid SD_FAT_TYPE
+#endif  // SD_FAT_TYPE
+
+file_t file;
+RawStream<file_t> stream;
+
+uint8_t buf[BUF_SIZE];
+//------------------------------------------------------------------------------
+void printRate(const char* label, uint32_t us) {
+  Serial.print(label);
+  Serial.print(FILE_SIZE / us);
+  Serial.println(" MB/sec");
+}
+//------------------------------------------------------------------------------
+void setup() {
+  uint32_t m;
+  Serial.begin(9600);
+  while (!Serial) {
+  }
+  Serial.println("Type any character to start");
+  while (!Serial.available()) {
+  }
+  if (!sd.begin(SD_CONFIG)) {
+    sd.initErrorHalt(&Serial);
+  }
+  sd.remove("RawStream.bin");
+  if (!file.open("RawStream.bin", O_RDWR | O_CREAT)) {
+    sd.errorHalt(&Serial, "open failed");
+  }
+  if (!file.preAllocate(FILE_SIZE)) {
+    sd.errorHalt(&Serial, "preAllocate failed");
+  }
+  if (!stream.openWrite(&file)) {
+    sd.errorHalt(&Serial, "openWrite failed");
+  }
+  m = micros();
+  for (uint32_t i = 0; i < FILE_SIZE / BUF_SIZE; i++) {
+    memset(buf, 'A' + i % 26, BUF_SIZE);
+    if (stream.write(buf, BUF_SIZE) != BUF_SIZE) {
+      sd.errorHalt(&Serial, "write failed");
+    }
+  }
+  if (!stream.close()) {
+    sd.errorHalt(&Serial, "close failed");
+  }
+  printRate("Write ", micros() - m);
+
+  if (!stream.openRead(&file)) {
+    sd.errorHalt(&Serial, "openRead failed");
+  }
+  m = micros();
+  for (uint32_t i = 0; i < FILE_SIZE / BUF_SIZE; i++) {
+    if (stream.read(buf, BUF_SIZE) != BUF_SIZE || buf[0] != 'A' + i % 26 ||
+        buf[BUF_SIZE - 1] != buf[0]) {
+      sd.errorHalt(&Serial, "read failed");
+    }
+  }
+  printRate("Read ", micros() - m);
+  stream.close();
+  file.close();
+  Serial.println("Done");
+}
+//------------------------------------------------------------------------------
+void loop() {}
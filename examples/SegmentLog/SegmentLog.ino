@@ -0,0 +1,151 @@
+// This example uses SegmentLog to keep the newest data in a ring of
+// preallocated files.
+//
+// The log is in the directory /SEGLOG as SEGMENT_COUNT files of
+// SEGMENT_SIZE bytes.  When all segments are full the oldest segment is
+// reused so the log can run for months with no new allocation.  Records
+// are saved by sync() once a second and by each segment rotation.
+//
+// Type 'p' to print the log, 'd' to discard the oldest segment or any
+// other character to stop.
+//
+#ifndef DISABLE_FS_H_WARNING
+#define DISABLE_FS_H_WARNING  // Disable warning for type File not defined.
+#endif                        // DISABLE_FS_H_WARNING
+#include "SdFat.h"
+#include "SegmentLog.h"
+
+// SD_FAT_TYPE = 0 for SdFat/File as defined in SdFatConfig.h,
+// 1 for FAT16/FAT32, 2 for exFAT, 3 for FAT16/FAT32 and exFAT.
+#define SD_FAT_TYPE 3
+
+// SDCARD_SS_PIN is defined for the built-in SD on some boards.
+#ifndef SDCARD_SS_PIN
+const uint8_t SD_CS_PIN = SS;
+#else   // SDCARD_SS_PIN
+// Assume built-in SD is used.
+const uint8_t SD_CS_PIN = SDCARD_SS_PIN;
+#endif  // SDCARD_SS_PIN
+
+// Try max SPI clock for an SD. Reduce SPI_CLOCK if errors occur.
+#define SPI_CLOCK SD_SCK_MHZ(50)
+
+// Try to select the best SD card configuration.
+#if defined(HAS_TEENSY_SDIO)
+#define SD_CONFIG SdioConfig(FIFO_SDIO)
+#elif defined(HAS_BUILTIN_PIO_SDIO)
+// See the Rp2040SdioSetup example for boards without a builtin SDIO socket.
+#define SD_CONFIG SdioConfig(PIN_SD_CLK, PIN_SD_CMD_MOSI, PIN_SD_DAT0_MISO)
+#elif ENABLE_DEDICATED_SPI
+#define SD_CONFIG SdSpiConfig(SD_CS_PIN, DEDICATED_SPI, SPI_CLOCK)
+#else  // HAS_TEENSY_SDIO
+#define SD_CONFIG SdSpiConfig(SD_CS_PIN, SHARED_SPI, SPI_CLOCK)
+#endif  // HAS_TEENSY_SDIO
+
+// Eight segments of 64 KiB.
+#define SEGMENT_COUNT 8
+#define SEGMENT_SIZE 65536UL
+
+// Time between records in ms.
+#define LOG_INTERVAL_MS 100
+
+#if SD_FAT_TYPE == 0
+SdFat sd;
+typedef File file_t;
+#elif SD_FAT_TYPE == 1
+SdFat32 sd;
+typedef File32 file_t;
+#elif SD_FAT_TYPE == 2
+SdExFat sd;
+typedef ExFile file_t;
+#elif SD_FAT_TYPE == 3
+SdFs sd;
+typedef FsFile file_t;
+#else  // SD_FAT_TYPE
+#error Invalid SD_FAT_TYPE
+#endif  // SD_FAT_TYPE
+
+file_t dir;
+SegmentLog<file_t> logger;
+
+// Record with a time and an analog value.
+struct Record {
+  uint32_t ms;
+  uint16_t adc;
+};
+//------------------------------------------------------------------------------
+void printLog() {
+  Record rec;
+  if (!logger.readBegin()) {
+    Serial.println("readBegin failed");
+    return;
+  }
+  Serial.print("segments ");
+  Serial.print(logger.tail());
+  Serial.print(" to ");
+  Serial.println(logger.head());
+  while (logger.readNext(&rec, sizeof(rec)) == sizeof(rec)) {
+    Serial.print(rec.ms);
+    Serial.write(',');
+    Serial.println(rec.adc);
+  }
+}
+//------------------------------------------------------------------------------
+void setup() {
+  Serial.begin(9600);
+  while (!Serial) {
+  }
+  Serial.println("Type any character to start");
+  while (!Serial.available()) {
+  }
+  if (!sd.begin(SD_CONFIG)) {
+    sd.initErrorHalt(&Serial);
+  }
+  if (!sd.exists("/SEGLOG") && !sd.mkdir("/SEGLOG")) {
+    sd.errorHalt(&Serial, "mkdir failed");
+  }
+  if (!dir.open("/SEGLOG")) {
+    sd.errorHalt(&Serial, "open failed");
+  }
+  // Segments are only allocated the first time.
+  if (!logger.begin(&dir, SEGMENT_COUNT, SEGMENT_SIZE)) {
+    sd.errorHalt(&Serial, "logger.begin failed");
+  }
+  Serial.print("head segment ");
+  Serial.println(logger.head());
+  Serial.println("Type 'p' to print, 'd' to discard or other to stop");
+}
+//------------------------------------------------------------------------------
+void loop() {
+  static uint32_t logTime = millis();
+  static uint32_t syncTime = logTime;
+  if (Serial.available()) {
+    char c = Serial.read();
+    if (c == 'p') {
+      printLog();
+    } else if (c == 'd') {
+      Serial.println(logger.discard() ? "discarded" : "discard failed");
+    } else if (c >= ' ') {
+      logger.end();
+      Serial.println("Done");
+      while (true) {
+      }
+    }
+  }
+  if (millis() - logTime < LOG_INTERVAL_MS) {
+    return;
+  }
+  logTime += LOG_INTERVAL_MS;
+  Record rec;
+  rec.ms = logTime;
+  rec.adc = analogRead(A0);
+  if (!logger.append(&rec, sizeof(rec))) {
+    sd.errorHalt(&Serial, "append failed");
+  }
+  if (millis() - syncTime >= 1000) {
+    syncTime = millis();
+    if (!logger.sync()) {
+      sd.errorHalt(&Serial, "sync failed");
+    }
+  }
+}
@@ -0,0 +1,137 @@
+// This example uses StreamLogger to log at high sample rates.
+//
+// StreamLogger keeps data in a ring of 512 byte sectors.  Its task()
+// function writes all whole sectors with a multi-sector write when the
+// SD is not busy so data acquisition overlaps SD programming.
+//
+// The file is preallocated so writes go to a contiguous file.  The worst
+// write latency, buffer use and overruns are reported at the end.
+//
+#ifndef DISABLE_FS_H_WARNING
+#define DISABLE_FS_H_WARNING  // Disable warning for type File not defined.
+#endif                        // DISABLE_FS_H_WARNING
+#include "SdFat.h"
+#include "StreamLogger.h"
+
+// Try to select the best SD card configuration.
+#if defined(HAS_TEENSY_SDIO)
+#define LOG_INTERVAL_USEC 50
+#define SD_CONFIG SdioConfig(FIFO_SDIO)
+#elif defined(HAS_BUILTIN_PIO_SDIO)
+#define LOG_INTERVAL_USEC 200
+// See the Rp2040SdioSetup example for boards without a builtin SDIO socket.
+#define SD_CONFIG SdioConfig(PIN_SD_CLK, PIN_SD_CMD_MOSI, PIN_SD_DAT0_MISO)
+#elif ENABLE_DEDICATED_SPI
+// Use Dedicated SPI. Edit settings for your setup.
+#define SPI_CLOCK SD_SCK_MHZ(50)
+#define SD_CS_PIN SS
+#define SD_CONFIG SdSpiConfig(SD_CS_PIN, DEDICATED_SPI, SPI_CLOCK)
+#define LOG_INTERVAL_USEC 1000
+#else  // defined(HAS_TEENSY_SDIO)
+#error "Shared SPI is not supported"
+#endif  // defined(HAS_TEENSY_SDIO)
+
+// Sample rate.
+#define SAMPLES_PER_SECOND (1000000 / LOG_INTERVAL_USEC)
+
+// Sectors to hold 10 byte lines for 1/5 second.
+#define BUF_SECTORS ((10 * SAMPLES_PER_SECOND) / 5 + 511) / 512
+
+// Size to log 10 byte lines for more than ten minutes.
+#define LOG_FILE_SIZE 10 * SAMPLES_PER_SECOND * 600
+
+#define LOG_FILENAME "StreamLog.csv"
+
+SdFs sd;
+FsFile file;
+
+StreamLogger<FsFile, BUF_SECTORS> logger;
+
+void logData() {
+  // Initialize the SD.
+  if (!sd.begin(SD_CONFIG)) {
+    sd.initErrorHalt(&Serial);
+  }
+  // Open or create file - truncate existing file.
+  if (!file.open(LOG_FILENAME, O_RDWR | O_CREAT | O_TRUNC)) {
+    Serial.println("open failed\n");
+    return;
+  }
+  // Preallocate the file and initialize the logger.
+  if (!logger.begin(&file, LOG_FILE_SIZE)) {
+    Serial.println("logger.begin failed\n");
+    file.close();
+    return;
+  }
+  Serial.println("Type any character to stop");
+
+  // Start time.
+  uint32_t logTime = micros();
+  // Log data until Serial input or file full.
+  while (!Serial.available()) {
+    if (logger.isFull()) {
+      Serial.println("File full - quitting.");
+      break;
+    }
+    // Write whole sectors if the SD is not busy.
+    if (!logger.task()) {
+      Serial.println("write failed");
+      break;
+    }
+    // Time for next point.
+    logTime += LOG_INTERVAL_USEC;
+    int32_t spareMicros = logTime - micros();
+    // Wait until time to log data.
+    while ((int32_t)(logTime - micros()) > 0) {
+    }
+    // Read ADC0
+    uint16_t adc = analogRead(A0);
+    // Log spareMicros as test data.
+    logger.print(spareMicros);
+    logger.write(',');
+    logger.println(adc);
+  }
+  // Write remaining data and remove unused preallocated space.
+  if (!logger.end()) {
+    Serial.println("logger.end failed");
+  }
+  Serial.print("fileSize: ");
+  Serial.println((uint32_t)file.fileSize());
+  Serial.print("maxBytesUsed: ");
+  Serial.println(logger.maxBytesUsed());
+  Serial.print("maxWriteMicros: ");
+  Serial.println(logger.maxWriteMicros());
+  Serial.print("writeCount: ");
+  Serial.println(logger.writeCount());
+  Serial.print("overrunCount: ");
+  Serial.println(logger.overrunCount());
+  file.close();
+  sd.end();
+}
+void clearSerialInput() {
+  for (uint32_t m = micros(); micros() - m < 10000;) {
+    if (Serial.read() >= 0) {
+      m = micros();
+    }
+  }
+}
+void setup() {
+  Serial.begin(9600);
+  while (!Serial) {
+  }
+  Serial.print("\nSAMPLES_PER_SECOND: ");
+  Serial.println(SAMPLES_PER_SECOND);
+  Serial.print("BUF_SECTORS: ");
+  Serial.println(BUF_SECTORS);
+  Serial.print("LOG_FILE_SIZE: ");
+  Serial.println(LOG_FILE_SIZE);
+}
+
+void loop() {
+  clearSerialInput();
+  Serial.println("\nType any character to log data");
+  while (!Serial.available()) {
+  }
+  clearSerialInput();
+  logData();
+}
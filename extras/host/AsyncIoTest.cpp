@@ -0,0 +1,304 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief Check asynchronous requests with a RAM disk.
+ *
+ * FsRamDisk moves one sector per poll() so queued requests stay pending
+ * like requests on a slow card.  The queue must reject a push when full
+ * and return requests in order.  Requests on the disk must complete in
+ * submit order with one callback each, and bad requests must fail.
+ * FAT16 and exFAT volumes are formatted on the disk and files are read
+ * and written with readAsync() and writeAsync().  Reads must see data
+ * in dirty cache sectors and read() must see data from async writes.
+ * FsFile is run on exFAT to check that it forwards the calls.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FsLib/FsLib.h"
+#include "common/FsRamDisk.h"
+static int failCount = 0;
+#if USE_ASYNC_IO
+//------------------------------------------------------------------------------
+// The smallest size ExFatFormatter accepts.  Only used pages are touched.
+static const uint32_t DISK_MIB = 512;
+static const Sector_t DISK_SECTORS = 2048 * DISK_MIB;
+static const uint8_t REQ_COUNT = 2 * FsIoQueue::SIZE + 1;
+static const size_t FILE_SIZE = 64 * 1024;
+static FsRamDisk ram;
+static FatVolume fatVol;
+static ExFatVolume exFatVol;
+static FsVolume fsVol;
+static uint8_t secBuf[512];
+static uint8_t data[FILE_SIZE];
+static uint8_t buf[FILE_SIZE];
+// Requests in the order their callbacks were called.
+static FsIoRequest* doneOrder[2 * REQ_COUNT];
+static uint8_t doneCount;
+//------------------------------------------------------------------------------
+static void check(bool ok, const char* msg) {
+  if (!ok) {
+    printf("FAIL: %s\n", msg);
+    failCount++;
+  }
+}
+//------------------------------------------------------------------------------
+// The request context counts calls.
+static void callback(FsIoRequest* req) {
+  (*reinterpret_cast<uint8_t*>(req->context))++;
+  if (doneCount < sizeof(doneOrder) / sizeof(doneOrder[0])) {
+    doneOrder[doneCount] = req;
+  }
+  doneCount++;
+}
+//------------------------------------------------------------------------------
+static void initRequests(FsIoRequest* req, uint8_t* calls, uint8_t n) {
+  memset(calls, 0, n);
+  for (uint8_t i = 0; i < n; i++) {
+    req[i] = FsIoRequest();
+    req[i].callback = callback;
+    req[i].context = &calls[i];
+  }
+  doneCount = 0;
+}
+//------------------------------------------------------------------------------
+// Each request completed once in index order.
+static void checkOrder(FsIoRequest* req, uint8_t* calls, uint8_t n,
+                       const char* msg) {
+  bool ok = doneCount == n;
+  for (uint8_t i = 0; i < n && ok; i++) {
+    ok = calls[i] == 1 && doneOrder[i] == &req[i] && req[i].isDone() &&
+         !req[i].isError();
+  }
+  check(ok, msg);
+}
+//------------------------------------------------------------------------------
+static void queueTest() {
+  FsIoQueue queue;
+  FsIoRequest req[FsIoQueue::SIZE + 1];
+  check(queue.count() == 0 && !queue.front(), "empty queue");
+  for (uint8_t i = 0; i < FsIoQueue::SIZE; i++) {
+    check(queue.push(&req[i]), "push");
+  }
+  check(queue.isFull() && !queue.push(&req[FsIoQueue::SIZE]), "queue full");
+  check(queue.count() == FsIoQueue::SIZE, "full count");
+  // FIFO order while the ring wraps.
+  uint8_t head = 0;
+  uint8_t tail = FsIoQueue::SIZE;
+  for (uint8_t n = 0; n < 3 * FsIoQueue::SIZE; n++) {
+    if (queue.front() != &req[head]) {
+      check(false, "queue order");
+      break;
+    }
+    queue.pop();
+    head = (head + 1) % (FsIoQueue::SIZE + 1);
+    check(queue.push(&req[tail]), "push after pop");
+    tail = (tail + 1) % (FsIoQueue::SIZE + 1);
+  }
+  while (queue.count()) {
+    queue.pop();
+  }
+  queue.pop();
+  check(queue.count() == 0 && !queue.front(), "pop empty");
+}
+//------------------------------------------------------------------------------
+static void diskTest() {
+  FsIoRequest req[REQ_COUNT];
+  uint8_t calls[REQ_COUNT];
+  const uint8_t ns = 3;
+  initRequests(req, calls, REQ_COUNT);
+  for (uint8_t i = 0; i < REQ_COUNT; i++) {
+    req[i].op = FS_IO_WRITE;
+    req[i].sector = 100 + ns * i;
+    req[i].count = ns;
+    req[i].data = data + 512 * ns * i;
+    // A full queue waits in poll() so earlier requests complete.
+    check(ram.submit(&req[i]), "submit write");
+    check(ram.isBusy() && req[i].isPending(), "pending");
+  }
+  check(doneCount > 0 && doneCount < REQ_COUNT, "full queue polled");
+  while (ram.poll()) {
+  }
+  check(!ram.isBusy(), "not busy");
+  checkOrder(req, calls, REQ_COUNT, "write order");
+  // Extra polls and syncs do not call callbacks again.
+  check(ram.poll() == 0 && ram.syncDevice(), "idle poll");
+  checkOrder(req, calls, REQ_COUNT, "callback once");
+
+  initRequests(req, calls, REQ_COUNT);
+  memset(buf, 0, sizeof(buf));
+  for (uint8_t i = 0; i < REQ_COUNT; i++) {
+    req[i].op = FS_IO_READ;
+    req[i].sector = 100 + ns * i;
+    req[i].count = ns;
+    req[i].data = buf + 512 * ns * i;
+    check(ram.submit(&req[i]), "submit read");
+  }
+  // A blocking read completes all queued requests first.
+  check(ram.readSector(0, buf + sizeof(buf) - 512), "blocking read");
+  checkOrder(req, calls, REQ_COUNT, "read order");
+  check(!memcmp(buf, data, 512 * ns * REQ_COUNT), "read data");
+
+  // Bad requests fail and call the callback once.
+  initRequests(req, calls, 2);
+  req[0].sector = DISK_SECTORS - 1;
+  req[0].count = 2;
+  req[0].data = buf;
+  req[1].sector = 0;
+  req[1].count = 0;
+  req[1].data = buf;
+  for (uint8_t i = 0; i < 2; i++) {
+    check(!ram.submit(&req[i]), "bad request");
+    check(req[i].isError() && calls[i] == 1, "error status");
+  }
+  check(!ram.isBusy(), "error not queued");
+}
+//------------------------------------------------------------------------------
+// Transfer count bytes at the current position, one request at a time.
+template <class File>
+static bool transfer(File* file, uint8_t op, uint8_t* dst, size_t count) {
+  FsIoRequest req;
+  while (count) {
+    int n = op == FS_IO_WRITE ? file->writeAsync(&req, dst, count)
+                              : file->readAsync(&req, dst, count);
+    if (n <= 0) {
+      return false;
+    }
+    while (!req.isDone()) {
+      file->pollAsync();
+    }
+    if (req.isError()) {
+      return false;
+    }
+    dst += n;
+    count -= n;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+template <class Vol, class File>
+static void fileTest(Vol* vol, bool exFat) {
+  FsIoRequest req[REQ_COUNT];
+  uint8_t calls[REQ_COUNT];
+  File file;
+  bool ok;
+  if (exFat) {
+    ExFatFormatter fmt;
+    ok = fmt.format(&ram, secBuf);
+  } else {
+    FatFormatter fmt;
+    ok = fmt.format(&ram, secBuf);
+  }
+  check(ok, "format");
+  check(vol->begin(&ram), "mount");
+  if (failCount) {
+    return;
+  }
+  printf("\n%s\n", exFat ? "exFAT" : vol->fatType() == 16 ? "FAT16" : "FAT32");
+  check(file.open(vol, "ASYNC.BIN", O_RDWR | O_CREAT), "create");
+
+  // Queue more sector writes than the queue holds.
+  initRequests(req, calls, REQ_COUNT);
+  for (uint8_t i = 0; i < REQ_COUNT; i++) {
+    check(file.writeAsync(&req[i], data + 512 * i, 512) == 512,
+          "writeAsync");
+  }
+  check(file.curPosition() == 512U * REQ_COUNT, "position");
+  check(calls[0] == 1 && req[REQ_COUNT - 1].isPending(), "queue full");
+  check(file.sync(), "sync");
+  checkOrder(req, calls, REQ_COUNT, "file write order");
+  check(transfer(&file, FS_IO_WRITE, data + 512 * REQ_COUNT,
+                 FILE_SIZE - 512 * REQ_COUNT) &&
+            file.sync(),
+        "write rest");
+  check(file.fileSize() == FILE_SIZE, "file size");
+
+  // Bad requests.
+  check(file.seekSet(1) && file.readAsync(&req[0], buf, 512) < 0,
+        "unaligned position");
+  check(file.seekSet(0) && file.readAsync(&req[0], buf, 1024) == 1024,
+        "readAsync");
+  check(req[0].isPending() && file.readAsync(&req[0], buf, 512) < 0,
+        "request pending");
+  check(file.sync() && req[0].isDone(), "sync read");
+
+  // An async read sees a dirty cache sector.
+  memset(buf, 0, sizeof(buf));
+  check(file.seekSet(0) && file.write("dirty", 5) == 5, "write cache");
+  check(file.seekSet(0) && transfer(&file, FS_IO_READ, buf, FILE_SIZE),
+        "read dirty");
+  check(!memcmp(buf, "dirty", 5) && !memcmp(buf + 5, data + 5, 1019),
+        "dirty data");
+  memcpy(data, "dirty", 5);
+
+  // read() sees data from an async write over a cached sector.
+  check(file.seekSet(0) && file.read(buf, 10) == 10, "read cache");
+  for (size_t i = 0; i < 1024; i++) {
+    data[i] = ~data[i];
+  }
+  check(file.seekSet(0) && transfer(&file, FS_IO_WRITE, data, 1024),
+        "write over cache");
+  check(file.seekSet(0) && file.read(buf, FILE_SIZE) == FILE_SIZE &&
+            !memcmp(buf, data, FILE_SIZE),
+        "read after async write");
+  check(file.close(), "close");
+
+  // Data is on the disk after a remount.
+  check(vol->begin(&ram) && file.open(vol, "ASYNC.BIN", O_RDONLY), "reopen");
+  check(file.writeAsync(&req[0], data, 512) < 0, "read only");
+  file.clearWriteError();
+  memset(buf, 0, sizeof(buf));
+  check(transfer(&file, FS_IO_READ, buf, FILE_SIZE) &&
+            !memcmp(buf, data, FILE_SIZE),
+        "remount data");
+  check(file.readAsync(&req[0], buf, 512) == 0, "end of file");
+  file.close();
+}
+#endif  // USE_ASYNC_IO
+//------------------------------------------------------------------------------
+int main() {
+  printf("USE_ASYNC_IO %d\n", USE_ASYNC_IO);
+#if USE_ASYNC_IO
+  uint8_t* mem = static_cast<uint8_t*>(calloc(DISK_SECTORS, 512));
+  if (!mem || !ram.begin(mem, DISK_SECTORS)) {
+    printf("RAM disk allocation failed\n");
+    return 1;
+  }
+  for (size_t i = 0; i < FILE_SIZE; i++) {
+    data[i] = i ^ (i >> 9);
+  }
+  queueTest();
+  diskTest();
+  fileTest<FatVolume, FatFile>(&fatVol, false);
+  fileTest<ExFatVolume, ExFatFile>(&exFatVol, true);
+  fileTest<FsVolume, FsFile>(&fsVol, true);
+  ram.end();
+  free(mem);
+#endif  // USE_ASYNC_IO
+  printf(failCount ? "%d FAILURES\n" : "\nALL OK\n", failCount);
+  return failCount ? 1 : 0;
+}
@@ -0,0 +1,139 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief Check AU aligned allocation on disk images.
+ *
+ * Formats a FAT16 and an exFAT image with a 4 MiB AU.  A file that can't
+ * grow in place must continue at the start of a free AU.  A directory
+ * that can't grow in place must use the next free cluster.  FsVolume is
+ * run on exFAT to check that it forwards setAuSize() and auCount().
+ * Build with USE_AU_ALLOCATION nonzero.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FsImageDevice.h"
+#include "FsLib/FsLib.h"
+static int failCount = 0;
+#if USE_AU_ALLOCATION
+//------------------------------------------------------------------------------
+static const uint32_t AU_SECTORS = 8192;
+static FsImageDevice dev;
+static FatVolume fatVol;
+static ExFatVolume exFatVol;
+static FsVolume fsVol;
+static uint8_t secBuf[512];
+//------------------------------------------------------------------------------
+static void check(bool ok, const char* msg) {
+  if (!ok) {
+    printf("FAIL: %s\n", msg);
+    failCount++;
+  }
+}
+//------------------------------------------------------------------------------
+template <class Vol, class File>
+static void run(Vol* vol, const char* path, uint32_t mib, bool exFat) {
+  bool ok;
+  char name[24];
+  uint8_t buf[512];
+  uint32_t clusterSize;
+  uint32_t n;
+  int fails = failCount;
+  File a;
+  File b;
+  File dir;
+  File file;
+  check(dev.create(path, 2048 * mib), "create image");
+  if (exFat) {
+    ExFatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  } else {
+    FatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  }
+  check(ok, "format");
+  check(vol->begin(&dev), "mount");
+  if (failCount != fails) {
+    return;
+  }
+  printf("\n%s %lu MiB\n", exFat ? "exFAT" : vol->fatType() == 16 ? "FAT16"
+                                                                 : "FAT32",
+         (unsigned long)mib);
+  check(vol->setAuSize(AU_SECTORS), "setAuSize");
+  clusterSize = vol->bytesPerCluster();
+  memset(buf, 'a', sizeof(buf));
+
+  // A directory that grows after a file took the next cluster.  There
+  // are more files than entries in a cluster.
+  check(vol->mkdir("dir") && dir.open(vol, "dir", O_RDONLY), "mkdir");
+  check(file.open(vol, "file.bin", O_RDWR | O_CREAT) &&
+            file.write(buf, 1) == 1 && file.close(),
+        "file");
+  for (n = 0; n < clusterSize / 32 && failCount == fails; n++) {
+    sprintf(name, "dir/%u.txt", (unsigned)n);
+    check(file.open(vol, name, O_WRONLY | O_CREAT) && file.close(),
+          "create");
+  }
+  // Reopen for the exFAT directory size.
+  dir.close();
+  check(dir.open(vol, "dir", O_RDONLY), "open dir");
+  printf("dir: %u files, %u AU\n", (unsigned)n, (unsigned)dir.auCount());
+  check(dir.auCount() == 1, "directory jumped to a new AU");
+  dir.close();
+
+  // Interleaved files.  The second cluster of a can't follow the first.
+  check(a.open(vol, "a.bin", O_RDWR | O_CREAT) &&
+            b.open(vol, "b.bin", O_RDWR | O_CREAT),
+        "open");
+  for (n = 0; n < clusterSize && failCount == fails; n += sizeof(buf)) {
+    check(a.write(buf, sizeof(buf)) == sizeof(buf), "write a");
+  }
+  check(b.write(buf, 1) == 1 && a.write(buf, 1) == 1, "write");
+  check(a.sync() && b.sync(), "sync");
+  printf("a: %u AU, b: %u AU\n", (unsigned)a.auCount(),
+         (unsigned)b.auCount());
+  check(a.auCount() == 2 && b.auCount() == 1, "file did not jump");
+  a.close();
+  b.close();
+  dev.end();
+}
+#endif  // USE_AU_ALLOCATION
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  const char* path = argc > 1 ? argv[1] : "AuAllocTest.img";
+  printf("USE_AU_ALLOCATION %d\n", USE_AU_ALLOCATION);
+  (void)path;
+#if USE_AU_ALLOCATION
+  run<FatVolume, FatFile>(&fatVol, path, 256, false);
+  run<ExFatVolume, ExFatFile>(&exFatVol, path, 1024, true);
+  run<FsVolume, FsFile>(&fsVol, path, 1024, true);
+  unlink(path);
+#endif  // USE_AU_ALLOCATION
+  printf(failCount ? "%d FAILURES\n" : "\nALL OK\n", failCount);
+  return failCount ? 1 : 0;
+}
@@ -0,0 +1,138 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief Run the BenchSuite example on a disk image or RAM disk.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../../examples/BenchSuite/BenchSuite.h"
+#include "FsImageDevice.h"
+#include "common/FsRamDisk.h"
+//------------------------------------------------------------------------------
+static uint8_t buf[65536];
+//------------------------------------------------------------------------------
+static int usage() {
+  fprintf(stderr,
+          "usage: BenchSuite [-x] [-m MIB] [-f FILE_MIB] [-d N,N] "
+          "[IMAGE]\n"
+          "  -x  format exFAT (needs at least 512 MiB)\n"
+          "  -m  volume size, default 256 MiB or 1024 MiB for exFAT\n"
+          "  -f  sequential and random file size, default 16 MiB\n"
+          "  -d  lookup directory sizes, default 1000,10000\n"
+          "  -k  keep IMAGE, do not format it\n"
+          "A RAM disk is used if IMAGE is not given.\n");
+  return 2;
+}
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  BenchConfig cfg;
+  BenchSuite suite;
+  FsImageDevice image;
+  FsRamDisk ram;
+  FsBlockDevice* dev;
+  uint8_t* mem = nullptr;
+  uint32_t mib = 0;
+  bool exFat = false;
+  bool keep = false;
+  int opt;
+
+  cfg.fileSize = 16UL << 20;
+  cfg.dirEntries[0] = 1000;
+  cfg.dirEntries[1] = 10000;
+  cfg.lookups = 1000;
+  cfg.smallFiles = 1000;
+  cfg.appendSyncs = 1000;
+  while ((opt = getopt(argc, argv, "xkm:f:d:")) != -1) {
+    switch (opt) {
+      case 'x':
+        exFat = true;
+        break;
+      case 'k':
+        keep = true;
+        break;
+      case 'm':
+        mib = atol(optarg);
+        break;
+      case 'f':
+        cfg.fileSize = atol(optarg) << 20;
+        break;
+      case 'd':
+        if (sscanf(optarg, "%hu,%hu", &cfg.dirEntries[0],
+                   &cfg.dirEntries[1]) < 1) {
+          return usage();
+        }
+        break;
+      default:
+        return usage();
+    }
+  }
+  if (mib == 0) {
+    mib = exFat ? 1024 : 256;
+  }
+  if (optind < argc) {
+    if (keep ? !image.begin(argv[optind])
+             : !image.create(argv[optind], 2048 * mib)) {
+      fprintf(stderr, "open %s failed\n", argv[optind]);
+      return 1;
+    }
+    dev = &image;
+  } else {
+    if (keep) {
+      return usage();
+    }
+    mem = static_cast<uint8_t*>(calloc(mib, 1 << 20));
+    if (!mem || !ram.begin(mem, 2048 * mib)) {
+      fprintf(stderr, "RAM disk allocation failed\n");
+      return 1;
+    }
+    dev = &ram;
+  }
+  if (!keep) {
+    bool ok;
+    if (exFat) {
+      ExFatFormatter fmt;
+      ok = fmt.format(dev, buf);
+    } else {
+      FatFormatter fmt;
+      ok = fmt.format(dev, buf);
+    }
+    if (!ok) {
+      fprintf(stderr, "format failed\n");
+      return 1;
+    }
+  }
+  if (!suite.begin(dev, buf, sizeof(buf), &Serial)) {
+    fprintf(stderr, "mount failed\n");
+    return 1;
+  }
+  bool ok = suite.run(cfg);
+  dev->end();
+  free(mem);
+  return ok ? 0 : 1;
+}
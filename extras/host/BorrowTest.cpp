@@ -0,0 +1,243 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief Check borrowRead(), borrowWrite() and release() on disk images.
+ *
+ * Formats a FAT16 and an exFAT image and writes two fragmented files and
+ * one preallocated file.  The files are read with borrowRead() in uneven
+ * steps mixed with read() and seekSet(), then changed in place with
+ * borrowWrite() and checked with read() after a remount.  A pass of
+ * borrowWrite() that changes nothing must not write to the device.  FsFile
+ * is run on exFAT to check that it forwards the calls.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FsLib/FsLib.h"
+#include "FsImageDevice.h"
+//------------------------------------------------------------------------------
+/** Image device that counts write commands. */
+class WriteCountDevice : public FsImageDevice {
+ public:
+  bool writeSectors(Sector_t sector, const uint8_t* src, size_t ns) override {
+    writes++;
+    return FsImageDevice::writeSectors(sector, src, ns);
+  }
+  uint32_t writes = 0;
+};
+//------------------------------------------------------------------------------
+static const uint32_t FILE_SIZE = 300000 + 13;
+static const uint32_t CHUNK = 4096;
+static int failCount = 0;
+static WriteCountDevice dev;
+static FatVolume fatVol;
+static ExFatVolume exFatVol;
+static FsVolume fsVol;
+static uint8_t buf[CHUNK];
+static uint8_t secBuf[512];
+//------------------------------------------------------------------------------
+static void check(bool ok, const char* msg) {
+  if (!ok) {
+    printf("FAIL: %s\n", msg);
+    failCount++;
+  }
+}
+//------------------------------------------------------------------------------
+static uint8_t pattern(uint32_t pos, uint8_t seed) {
+  return pos ^ (pos >> 8) ^ (pos >> 16) ^ seed;
+}
+//------------------------------------------------------------------------------
+static void fill(uint32_t pos, size_t n, uint8_t seed) {
+  for (size_t i = 0; i < n; i++) {
+    buf[i] = pattern(pos + i, seed);
+  }
+}
+//------------------------------------------------------------------------------
+// Read the whole file with borrowRead() in uneven steps.
+template <class File>
+static void borrowCheck(File* file, uint8_t seed, const char* msg) {
+  size_t count;
+  uint32_t pos = 0;
+  uint32_t step = 0;
+  const uint8_t* src;
+  check(file->seekSet(0), "rewind");
+  while ((src = file->borrowRead(&count)) != nullptr) {
+    // Use part of the bytes at times so borrows start mid sector.
+    size_t n = step % 3 == 0 && count > 100 ? 100 : count;
+    for (size_t i = 0; i < n; i++) {
+      if (src[i] != pattern(pos + i, seed)) {
+        printf("%s: data at %lu\n", msg, (unsigned long)(pos + i));
+        check(false, "borrow data");
+        return;
+      }
+    }
+    check(file->release(n), "release");
+    pos += n;
+    // Mix in read() and seekSet() which also move the current cluster.
+    if (step % 7 == 3 && FILE_SIZE - pos > 700) {
+      check(file->read(buf, 700) == 700, "read");
+      for (size_t i = 0; i < 700; i++) {
+        if (buf[i] != pattern(pos + i, seed)) {
+          check(false, "read data");
+          return;
+        }
+      }
+      pos += 700;
+    } else if (step % 11 == 5 && FILE_SIZE - pos > CHUNK) {
+      pos += CHUNK;
+      check(file->seekSet(pos), "seekSet");
+    }
+    step++;
+  }
+  check(count == 0, "count at EOF");
+  if (pos != FILE_SIZE) {
+    printf("%s: end %lu\n", msg, (unsigned long)pos);
+    check(false, "borrow size");
+  }
+}
+//------------------------------------------------------------------------------
+// Change every byte of the file in place with borrowWrite().
+template <class File>
+static void borrowChange(File* file, uint8_t seed, uint8_t delta) {
+  size_t count;
+  uint32_t pos = 0;
+  uint8_t* dst;
+  check(file->seekSet(0), "rewind");
+  while ((dst = file->borrowWrite(&count)) != nullptr) {
+    for (size_t i = 0; i < count; i++) {
+      dst[i] = pattern(pos + i, seed ^ delta);
+    }
+    check(file->release(count, true), "release write");
+    pos += count;
+  }
+  check(pos == FILE_SIZE, "write size");
+}
+//------------------------------------------------------------------------------
+// Check file data with read().
+template <class File>
+static void readCheck(File* file, uint8_t seed) {
+  check(file->seekSet(0), "rewind");
+  for (uint32_t pos = 0; pos < FILE_SIZE; pos += CHUNK) {
+    size_t n = FILE_SIZE - pos < CHUNK ? FILE_SIZE - pos : CHUNK;
+    if (file->read(buf, n) != (int)n) {
+      check(false, "read size");
+      return;
+    }
+    for (size_t i = 0; i < n; i++) {
+      if (buf[i] != pattern(pos + i, seed)) {
+        printf("read data at %lu\n", (unsigned long)(pos + i));
+        check(false, "read data");
+        return;
+      }
+    }
+  }
+}
+//------------------------------------------------------------------------------
+template <class Vol, class File>
+static void run(Vol* vol, const char* path, uint32_t mib, bool exFat) {
+  static const char* const name[] = {"frag0.bin", "frag1.bin", "contig.bin"};
+  bool ok;
+  size_t count;
+  File file[3];
+  check(dev.create(path, 2048 * mib), "create image");
+  if (exFat) {
+    ExFatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  } else {
+    FatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  }
+  check(ok, "format");
+  check(vol->begin(&dev), "mount");
+  if (failCount) {
+    return;
+  }
+  printf("%s %lu MiB\n", exFat ? "exFAT" : vol->fatType() == 16 ? "FAT16"
+                                                                 : "FAT32",
+         (unsigned long)mib);
+  // Interleaved writes fragment the first two files.
+  for (int k = 0; k < 3; k++) {
+    check(file[k].open(vol, name[k], O_RDWR | O_CREAT | O_TRUNC), "create");
+  }
+  check(file[2].preAllocate(FILE_SIZE), "preAllocate");
+  if (exFat) {
+    // No bytes before the valid length.
+    check(!file[2].borrowRead(&count) && count == 0, "valid length");
+  }
+  for (uint32_t pos = 0; pos < FILE_SIZE && !failCount; pos += CHUNK) {
+    size_t n = FILE_SIZE - pos < CHUNK ? FILE_SIZE - pos : CHUNK;
+    for (int k = 0; k < 3; k++) {
+      fill(pos, n, k);
+      check(file[k].write(buf, n) == n, "write");
+    }
+  }
+  for (int k = 0; k < 3; k++) {
+    check(file[k].close(), "close");
+  }
+  for (int k = 0; k < 3 && !failCount; k++) {
+    check(file[k].open(vol, name[k], O_RDONLY), "open");
+    check(!file[k].borrowWrite(&count) && count == 0, "read only");
+    borrowCheck(&file[k], k, name[k]);
+    check(!file[k].borrowRead(&count) && count == 0, "EOF");
+    // Too many bytes for the sector.
+    check(file[k].seekSet(510), "seek");
+    check(file[k].borrowRead(&count) && count == 2, "end of sector");
+    check(!file[k].release(3), "release size");
+    check(file[k].curPosition() == 510, "position");
+    check(!file[k].release(1, true), "release modified read only");
+    file[k].close();
+    check(file[k].open(vol, name[k], O_WRONLY), "open write");
+    check(!file[k].borrowRead(&count), "write only");
+    // Unchanged borrows must not dirty the cache or the directory entry.
+    dev.writes = 0;
+    while (file[k].borrowWrite(&count)) {
+      check(file[k].release(count), "release unchanged");
+    }
+    check(file[k].sync() && dev.writes == 0, "unchanged borrow written");
+    borrowChange(&file[k], k, 0X5A);
+    check(file[k].close(), "close changed");
+  }
+  check(vol->begin(&dev), "remount");
+  for (int k = 0; k < 3 && !failCount; k++) {
+    check(file[k].open(vol, name[k], O_RDONLY), "reopen");
+    readCheck(&file[k], k ^ 0X5A);
+    borrowCheck(&file[k], k ^ 0X5A, name[k]);
+    file[k].close();
+  }
+  dev.end();
+}
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  const char* path = argc > 1 ? argv[1] : "BorrowTest.img";
+  run<FatVolume, FatFile>(&fatVol, path, 256, false);
+  run<ExFatVolume, ExFatFile>(&exFatVol, path, 1024, true);
+  run<FsVolume, FsFile>(&fsVol, path, 1024, true);
+  unlink(path);
+  printf(failCount ? "%d FAILURES\n" : "\nALL OK\n", failCount);
+  return failCount ? 1 : 0;
+}
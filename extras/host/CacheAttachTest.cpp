@@ -0,0 +1,162 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief Check caller-owned cache sectors on disk images.
+ *
+ * Formats a FAT16 and an exFAT image and creates files in a directory
+ * that spans more sectors than the built-in cache.  Opening every file
+ * again must read fewer sectors with a buffer attached by cacheAttach().
+ * Data written while the buffer is attached must be on the image after
+ * the buffer is removed and the volume is mounted again.  Build with
+ * FS_CACHE_USER_SECTOR_COUNT of at least USER_SECTORS.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FsImageDevice.h"
+#include "FsLib/FsLib.h"
+static int failCount = 0;
+#if FS_CACHE_USER_SECTOR_COUNT >= 16
+//------------------------------------------------------------------------------
+/** Image device that counts read commands. */
+class ReadCountDevice : public FsImageDevice {
+ public:
+  bool readSectors(Sector_t sector, uint8_t* dst, size_t ns) override {
+    reads++;
+    return FsImageDevice::readSectors(sector, dst, ns);
+  }
+  uint32_t reads = 0;
+};
+//------------------------------------------------------------------------------
+static const uint8_t USER_SECTORS = 16;
+static const uint16_t FILE_COUNT = 40;
+static ReadCountDevice dev;
+static FatVolume fatVol;
+static ExFatVolume exFatVol;
+static uint8_t secBuf[512];
+static uint8_t lines[USER_SECTORS][512] __attribute__((aligned(4)));
+//------------------------------------------------------------------------------
+static void check(bool ok, const char* msg) {
+  if (!ok) {
+    printf("FAIL: %s\n", msg);
+    failCount++;
+  }
+}
+//------------------------------------------------------------------------------
+// Open every file and check that it holds its number.
+template <class Vol, class File>
+static uint32_t openAll(Vol* vol) {
+  char name[40];
+  uint16_t n;
+  uint32_t reads = dev.reads;
+  File file;
+  for (uint16_t i = 0; i < FILE_COUNT && !failCount; i++) {
+    sprintf(name, "/dir/long file name %u.txt", i);
+    check(file.open(vol, name, O_RDONLY), "open");
+    check(file.read(&n, 2) == 2 && n == i, "data");
+    file.close();
+  }
+  return dev.reads - reads;
+}
+//------------------------------------------------------------------------------
+template <class Vol, class File>
+static void run(Vol* vol, const char* path, uint32_t mib, bool exFat) {
+  bool ok;
+  char name[40];
+  uint32_t before;
+  uint32_t after;
+  File file;
+  check(dev.create(path, 2048 * mib), "create image");
+  if (exFat) {
+    ExFatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  } else {
+    FatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  }
+  check(ok, "format");
+  check(vol->begin(&dev), "mount");
+  if (failCount) {
+    return;
+  }
+  printf("\n%s %lu MiB\n", exFat ? "exFAT" : vol->fatType() == 16 ? "FAT16"
+                                                                 : "FAT32",
+         (unsigned long)mib);
+  check(!vol->cacheAttach(lines[0], USER_SECTORS + 1) &&
+            !vol->cacheAttach(nullptr, USER_SECTORS),
+        "bad arguments");
+  check(vol->mkdir("/dir"), "mkdir");
+  for (uint16_t i = 0; i < FILE_COUNT && !failCount; i++) {
+    sprintf(name, "/dir/long file name %u.txt", i);
+    check(file.open(vol, name, O_WRONLY | O_CREAT) &&
+              file.write(&i, 2) == 2 && file.close(),
+          "create");
+  }
+  before = openAll<Vol, File>(vol);
+  check(vol->cacheAttach(lines[0], USER_SECTORS), "attach");
+  openAll<Vol, File>(vol);
+  after = openAll<Vol, File>(vol);
+  printf("reads to open all files: %lu, attached %lu\n",
+         (unsigned long)before, (unsigned long)after);
+  check(2 * after < before, "attached sectors not used");
+
+  // Data written while attached is written when the buffer is removed.
+  for (uint16_t i = 0; i < FILE_COUNT && !failCount; i += 3) {
+    uint16_t n = i + 1000;
+    sprintf(name, "/dir/long file name %u.txt", i);
+    check(file.open(vol, name, O_WRONLY) && file.write(&n, 2) == 2 &&
+              file.close(),
+          "rewrite");
+  }
+  check(vol->cacheAttach(nullptr, 0), "detach");
+  memset(lines, 0XFF, sizeof(lines));
+  check(vol->begin(&dev), "remount");
+  for (uint16_t i = 0; i < FILE_COUNT && !failCount; i++) {
+    uint16_t n;
+    sprintf(name, "/dir/long file name %u.txt", i);
+    check(file.open(vol, name, O_RDONLY) && file.read(&n, 2) == 2 &&
+              n == (i % 3 ? i : i + 1000),
+          "data after detach");
+    file.close();
+  }
+  dev.end();
+}
+#endif  // FS_CACHE_USER_SECTOR_COUNT >= 16
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  const char* path = argc > 1 ? argv[1] : "CacheAttachTest.img";
+  printf("FS_CACHE_USER_SECTOR_COUNT %d\n", FS_CACHE_USER_SECTOR_COUNT);
+  (void)path;
+#if FS_CACHE_USER_SECTOR_COUNT >= 16
+  run<FatVolume, FatFile>(&fatVol, path, 256, false);
+  run<ExFatVolume, ExFatFile>(&exFatVol, path, 1024, true);
+  unlink(path);
+#endif  // FS_CACHE_USER_SECTOR_COUNT >= 16
+  printf(failCount ? "%d FAILURES\n" : "\nALL OK\n", failCount);
+  return failCount ? 1 : 0;
+}
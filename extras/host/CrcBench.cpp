@@ -0,0 +1,142 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief Check and compare the speed of the SD CRC functions.
+ *
+ * Each CRC16 function is checked against the shift based function for
+ * random data of every length up to two sectors, then timed on 512 byte
+ * sectors.  The CRC7 functions are timed on six byte commands.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "SdCard/SdCrc.h"
+//------------------------------------------------------------------------------
+struct Crc16Variant {
+  const char* name;
+  uint16_t (*crc)(const uint8_t*, size_t);
+};
+struct Crc7Variant {
+  const char* name;
+  uint8_t (*crc)(const uint8_t*, size_t);
+};
+static const Crc16Variant crc16Variants[] = {
+    {"shift", sdCrc16Shift},   {"nibble", sdCrc16Nibble},
+    {"table", sdCrc16Table},   {"slice4", sdCrc16Slice4},
+    {"slice8", sdCrc16Slice8},
+#if USE_SD_CRC
+    {"sdCrc16", sdCrc16},
+#endif  // USE_SD_CRC
+};
+static const Crc7Variant crc7Variants[] = {
+    {"bitwise", sdCrc7Bitwise}, {"table", sdCrc7Table},
+#if USE_SD_CRC
+    {"sdCrc7", sdCrc7},
+#endif  // USE_SD_CRC
+};
+static const size_t BUF_SIZE = 64 * 1024;
+static uint8_t buf[BUF_SIZE];
+static int failCount = 0;
+//------------------------------------------------------------------------------
+static void check(bool ok, const char* name, size_t n) {
+  if (!ok) {
+    printf("FAIL: %s length %lu\n", name, (unsigned long)n);
+    failCount++;
+  }
+}
+//------------------------------------------------------------------------------
+static void checkCrc() {
+  static const uint8_t digits[] = "123456789";
+  static const uint8_t cmd0[] = {0X40, 0, 0, 0, 0};
+  static const uint8_t cmd8[] = {0X48, 0, 0, 1, 0XAA};
+  for (const Crc16Variant& v : crc16Variants) {
+    check(v.crc(digits, 9) == 0X31C3, v.name, 9);
+    for (size_t n = 0; n <= 1024; n++) {
+      check(v.crc(buf + 3, n) == sdCrc16Shift(buf + 3, n), v.name, n);
+    }
+  }
+  for (const Crc7Variant& v : crc7Variants) {
+    check(v.crc(cmd0, 5) == 0X95, v.name, 5);
+    check(v.crc(cmd8, 5) == 0X87, v.name, 5);
+    for (size_t n = 0; n <= 64; n++) {
+      check(v.crc(buf, n) == sdCrc7Bitwise(buf, n), v.name, n);
+    }
+  }
+}
+//------------------------------------------------------------------------------
+// Call fcn for chunks of size bytes until minMicros have elapsed.
+// Return bytes per microsecond which is MB/s.
+template <typename Fcn>
+static double rate(Fcn fcn, size_t size, uint32_t minMicros) {
+  volatile uint32_t sink = 0;
+  uint64_t bytes = 0;
+  uint32_t t0 = micros();
+  uint32_t us;
+  do {
+    for (size_t i = 0; i + size <= BUF_SIZE; i += size) {
+      sink = sink + fcn(buf + i, size);
+    }
+    bytes += BUF_SIZE - BUF_SIZE % size;
+    us = micros() - t0;
+  } while (us < minMicros);
+  return static_cast<double>(bytes) / us;
+}
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  uint32_t ms = 250;
+  int opt;
+  while ((opt = getopt(argc, argv, "t:")) != -1) {
+    if (opt == 't') {
+      ms = atoi(optarg);
+    } else {
+      fprintf(stderr, "usage: CrcBench [-t MS_PER_TEST]\n");
+      return 1;
+    }
+  }
+  srand(1);
+  for (size_t i = 0; i < BUF_SIZE; i++) {
+    buf[i] = rand();
+  }
+  checkCrc();
+  printf("USE_SD_CRC %d\n", USE_SD_CRC);
+  printf("%-8s %9s %10s\n", "crc16", "MB/s", "us/sector");
+  for (const Crc16Variant& v : crc16Variants) {
+    double mbs = rate(v.crc, 512, 1000 * ms);
+    printf("%-8s %9.1f %10.3f\n", v.name, mbs, 512 / mbs);
+  }
+  printf("%-8s %9s %10s\n", "crc7", "MB/s", "ns/cmd");
+  for (const Crc7Variant& v : crc7Variants) {
+    double mbs = rate(v.crc, 5, 1000 * ms);
+    printf("%-8s %9.1f %10.1f\n", v.name, mbs, 5000 / mbs);
+  }
+  if (failCount) {
+    printf("%d failures\n", failCount);
+    return 1;
+  }
+  printf("ALL OK\n");
+  return 0;
+}
@@ -0,0 +1,272 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief Check createNew() on disk images.
+ *
+ * Formats a FAT16 and an exFAT image and creates a few thousand files in
+ * one directory with createNew().  FsFile is run on exFAT to check that
+ * it forwards createNew().  Sector reads per create are reported for the
+ * first and last files.  Creates with other directory objects make the
+ * remembered end stale.  Every file is then opened by name and checked
+ * after a remount.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FsLib/FsLib.h"
+#include "FsImageDevice.h"
+static int failCount = 0;
+#if USE_CREATE_NEW
+//------------------------------------------------------------------------------
+/** Image device that counts read commands. */
+class ReadCountDevice : public FsImageDevice {
+ public:
+  bool readSectors(Sector_t sector, uint8_t* dst, size_t ns) override {
+    reads++;
+    return FsImageDevice::readSectors(sector, dst, ns);
+  }
+  uint32_t reads = 0;
+};
+//------------------------------------------------------------------------------
+static const uint16_t FILE_COUNT = 3000;
+static const uint16_t SAMPLE_COUNT = 100;
+static ReadCountDevice dev;
+static FatVolume fatVol;
+static ExFatVolume exFatVol;
+static FsVolume fsVol;
+#if USE_DIR_INDEX
+static FsDirIndexEntry table[4096];
+#endif  // USE_DIR_INDEX
+static bool exists[FILE_COUNT];
+static uint8_t secBuf[512];
+//------------------------------------------------------------------------------
+static void check(bool ok, const char* msg) {
+  if (!ok) {
+    printf("FAIL: %s\n", msg);
+    failCount++;
+  }
+}
+//------------------------------------------------------------------------------
+static void makeName(char* name, uint16_t i) {
+  static const char* const fmt[] = {
+      "LOG%05u.TXT",  // short name
+      "log%05u.txt",  // lower case short name
+#if USE_LONG_FILE_NAMES
+      "Log%05u.Txt",        // mixed case
+      "segment %05u.log"};  // numeric tail short name
+#else   // USE_LONG_FILE_NAMES
+      "LG%06u.TXT", "lg%06u.log"};
+#endif  // USE_LONG_FILE_NAMES
+  sprintf(name, fmt[i % 4], i);
+}
+//------------------------------------------------------------------------------
+template <class File>
+static bool createNew(File* dir, uint16_t i, bool trusted) {
+  char name[40];
+  File file;
+  makeName(name, i);
+  bool ok = trusted ? file.createNew(dir, name)
+                    : file.open(dir, name, O_WRONLY | O_CREAT | O_EXCL);
+  if (!ok || file.write(name, strlen(name)) != strlen(name) ||
+      !file.close()) {
+    return false;
+  }
+  exists[i] = true;
+  return true;
+}
+//------------------------------------------------------------------------------
+// Create files [first, last) with only names of kind 0 to 2.
+template <class File>
+static double createRun(File* dir, uint16_t first, uint16_t last,
+                        bool trusted) {
+  uint32_t reads = dev.reads;
+  uint32_t n = 0;
+  for (uint16_t i = first; i < last && !failCount; i++) {
+    if (i % 4 != 3) {
+      check(createNew(dir, i, trusted), "create");
+      n++;
+    }
+  }
+  return n ? (double)(dev.reads - reads) / n : 0;
+}
+//------------------------------------------------------------------------------
+template <class Vol, class File>
+static void verify(Vol* vol, const char* step) {
+  char name[40];
+  char data[40];
+  uint16_t count = 0;
+  File dir;
+  File file;
+  check(dir.open(vol, "/log", O_RDONLY), "open dir");
+  for (uint16_t i = 0; i < FILE_COUNT && !failCount; i++) {
+    makeName(name, i);
+    bool found = file.open(&dir, name, O_RDONLY);
+    if (found != exists[i]) {
+      printf("%s: %s %s\n", step, name, found ? "found" : "missing");
+      check(false, "verify open");
+      break;
+    }
+    if (found) {
+      int n = file.read(data, sizeof(data));
+      if (n != (int)strlen(name) || memcmp(data, name, n)) {
+        printf("%s: %s data\n", step, name);
+        check(false, "verify data");
+      }
+      file.close();
+      count++;
+    }
+  }
+  // No extra or duplicate entries.
+  dir.rewind();
+  while (file.openNext(&dir, O_RDONLY)) {
+    file.close();
+    count--;
+  }
+  check(count == 0, "file count");
+}
+//------------------------------------------------------------------------------
+// Check FAT short names are unique.
+static void checkSfn() {
+  static char sfn[FILE_COUNT][13];
+  uint16_t n = 0;
+  FatFile dir;
+  FatFile file;
+  check(dir.open(&fatVol, "/log", O_RDONLY), "open dir");
+  while (n < FILE_COUNT && file.openNext(&dir, O_RDONLY)) {
+    file.getSFN(sfn[n++], sizeof(sfn[0]));
+    file.close();
+  }
+  for (uint16_t i = 0; i < n; i++) {
+    for (uint16_t k = i + 1; k < n; k++) {
+      if (!strcmp(sfn[i], sfn[k])) {
+        printf("duplicate SFN %s\n", sfn[i]);
+        check(false, "unique SFN");
+        return;
+      }
+    }
+  }
+}
+//------------------------------------------------------------------------------
+template <class Vol, class File>
+static void run(Vol* vol, const char* path, uint32_t mib, bool exFat) {
+  bool ok;
+  char name[40];
+  uint16_t i;
+  File dir;
+  File other;
+  File file;
+  check(dev.create(path, 2048 * mib), "create image");
+  if (exFat) {
+    ExFatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  } else {
+    FatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  }
+  check(ok, "format");
+  check(vol->begin(&dev), "mount");
+  check(vol->mkdir("/log"), "mkdir");
+  check(dir.open(vol, "/log", O_RDONLY), "open dir");
+  if (failCount) {
+    return;
+  }
+  printf("\n%s %lu MiB\n", exFat ? "exFAT" : vol->fatType() == 16 ? "FAT16"
+                                                                 : "FAT32",
+         (unsigned long)mib);
+  memset(exists, 0, sizeof(exists));
+  // Bad arguments.
+  check(!file.createNew(&dir, "a/b.txt"), "path");
+  check(!file.createNew(&dir, "a.txt", O_RDONLY), "read only");
+  check(!file.createNew(&file, "a.txt"), "not a dir");
+
+  double first = createRun(&dir, 0, SAMPLE_COUNT, true);
+  createRun(&dir, SAMPLE_COUNT, FILE_COUNT / 2 - SAMPLE_COUNT, true);
+  double last =
+      createRun(&dir, FILE_COUNT / 2 - SAMPLE_COUNT, FILE_COUNT / 2, true);
+  double scan = createRun(&dir, FILE_COUNT / 2, FILE_COUNT / 2 + 40, false);
+  printf("%-12s %8.1f reads/create\n", "first", first);
+  printf("%-12s %8.1f reads/create\n", "last", last);
+  printf("%-12s %8.1f reads/create\n", "O_CREAT", scan);
+  check(last < 2 + 2 * first, "constant time create");
+
+  // Creates with another directory object make the end stale.  An exFAT
+  // directory object is also stale after another object extends the
+  // directory so only FAT uses two objects.
+  check(other.open(vol, "/log", O_RDONLY), "open other");
+  File* odd = exFat ? &dir : &other;
+  for (i = FILE_COUNT / 2 + 40; i < FILE_COUNT - 200 && !failCount; i++) {
+    check(createNew(i % 2 ? &dir : odd, i, true), "create stale");
+  }
+  // Free entries at the end.
+  for (i = FILE_COUNT / 2; i < FILE_COUNT - 200 && !failCount; i += 3) {
+    if (exists[i]) {
+      makeName(name, i);
+      check(file.open(&dir, name, O_WRONLY) && file.remove(), "remove");
+      exists[i] = false;
+    }
+  }
+  // Names with a numeric tail short name.
+  for (i = 3; i < FILE_COUNT - 100 && !failCount; i += 4) {
+    if (!exists[i]) {
+      check(createNew(i % 8 == 3 ? &dir : odd, i, true), "create tail");
+    }
+  }
+  other.close();
+#if USE_DIR_INDEX
+  // Creates with an index attached.
+  check(vol->setDirIndex("/log", table, sizeof(table) / sizeof(table[0])),
+        "setDirIndex");
+  for (i = FILE_COUNT - 100; i < FILE_COUNT && !failCount; i++) {
+    check(createNew(&dir, i, true), "create index");
+  }
+  check(vol->setDirIndex("/log", nullptr, 0), "remove index");
+#endif  // USE_DIR_INDEX
+  dir.close();
+  verify<Vol, File>(vol, "create");
+  if (!exFat) {
+    checkSfn();
+  }
+  check(vol->begin(&dev), "remount");
+  verify<Vol, File>(vol, "remount");
+  dev.end();
+}
+#endif  // USE_CREATE_NEW
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  const char* path = argc > 1 ? argv[1] : "CreateNewTest.img";
+  printf("USE_CREATE_NEW %d\n", USE_CREATE_NEW);
+  (void)path;
+#if USE_CREATE_NEW
+  run<FatVolume, FatFile>(&fatVol, path, 256, false);
+  run<ExFatVolume, ExFatFile>(&exFatVol, path, 1024, true);
+  run<FsVolume, FsFile>(&fsVol, path, 1024, true);
+  unlink(path);
+#endif  // USE_CREATE_NEW
+  printf(failCount ? "%d FAILURES\n" : "\nALL OK\n", failCount);
+  return failCount ? 1 : 0;
+}
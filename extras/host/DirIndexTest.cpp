@@ -0,0 +1,282 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief Check the directory index on disk images.
+ *
+ * Formats a FAT16 and an exFAT image and creates, opens, renames and
+ * removes a few thousand files in a subdirectory with an index attached.
+ * Each file holds its own name.  The directory is then checked without
+ * the index, after a remount and with a table that is too small.  Sector
+ * reads per open are reported with and without the index.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ExFatLib/ExFatLib.h"
+#include "FatLib/FatLib.h"
+#include "FsImageDevice.h"
+static int failCount = 0;
+#if USE_DIR_INDEX
+//------------------------------------------------------------------------------
+/** Image device that counts read commands. */
+class ReadCountDevice : public FsImageDevice {
+ public:
+  bool readSectors(Sector_t sector, uint8_t* dst, size_t ns) override {
+    reads++;
+    return FsImageDevice::readSectors(sector, dst, ns);
+  }
+  uint32_t reads = 0;
+};
+//------------------------------------------------------------------------------
+static const uint16_t FILE_COUNT = 3000;
+static const size_t TABLE_SIZE = 4096;
+static ReadCountDevice dev;
+static FatVolume fatVol;
+static ExFatVolume exFatVol;
+static FsDirIndexEntry table[TABLE_SIZE];
+// Zero for no file, else the name kind of file i.
+static uint8_t state[FILE_COUNT];
+// Name kind of file i when created.  Files hold the path at create.
+static uint8_t content[FILE_COUNT];
+static uint8_t secBuf[512];
+//------------------------------------------------------------------------------
+static void check(bool ok, const char* msg) {
+  if (!ok) {
+    printf("FAIL: %s\n", msg);
+    failCount++;
+  }
+}
+//------------------------------------------------------------------------------
+static void makePath(char* path, uint16_t i, uint8_t kind) {
+  static const char* const fmt[] = {
+      "/data/data_%05u.csv",  // lossy short name
+      "/data/S%05u.TXT",      // short name only
+      "/data/Mx%04u.Txt",     // mixed case
+      "/data/renamed file %05u.dat", "/data/new_%05u.bin"};
+  uint8_t k = kind ? kind - 1 : i % 3;
+  sprintf(path, fmt[k], k == 2 ? i % 10000 : i);
+}
+//------------------------------------------------------------------------------
+static uint8_t nameKind(uint16_t i) { return 1 + i % 3; }
+//------------------------------------------------------------------------------
+template <class Vol, class File>
+static bool create(Vol* vol, uint16_t i, uint8_t kind) {
+  char path[40];
+  File file;
+  makePath(path, i, kind);
+  if (!file.open(vol, path, O_WRONLY | O_CREAT | O_EXCL) ||
+      file.write(path, strlen(path)) != strlen(path) || !file.close()) {
+    return false;
+  }
+  state[i] = kind;
+  content[i] = kind;
+  return true;
+}
+//------------------------------------------------------------------------------
+// Open every name in every form and check existence and content.
+template <class Vol, class File>
+static void verify(Vol* vol, const char* step) {
+  char path[40];
+  char data[40];
+  uint32_t reads = dev.reads;
+  uint32_t opens = 0;
+  for (uint16_t i = 0; i < FILE_COUNT && !failCount; i++) {
+    for (uint8_t kind = 1; kind <= 5; kind++) {
+      if (kind <= 3 && kind != nameKind(i)) {
+        continue;
+      }
+      File file;
+      makePath(path, i, kind);
+      bool found = file.open(vol, path, O_RDONLY);
+      opens++;
+      if (found != (state[i] == kind)) {
+        printf("%s: %s %s\n", step, path, found ? "found" : "missing");
+        check(false, "verify open");
+        break;
+      }
+      if (found) {
+        makePath(path, i, content[i]);
+        int n = file.read(data, sizeof(data));
+        if (n != (int)strlen(path) || memcmp(data, path, n)) {
+          printf("%s: %s data\n", step, path);
+          check(false, "verify data");
+        }
+      }
+    }
+  }
+  printf("%-12s %8.1f reads/open\n", step,
+         (double)(dev.reads - reads) / opens);
+}
+//------------------------------------------------------------------------------
+// Remove, rename and create files to mix used and free entries.
+template <class Vol, class File>
+static void churn(Vol* vol, uint16_t seed) {
+  char oldPath[40];
+  char newPath[40];
+  for (uint16_t i = 0; i < FILE_COUNT && !failCount; i++) {
+    uint16_t r = (i + seed) % 7;
+    if (!state[i]) {
+      check(create<Vol, File>(vol, i, 5), "create new");
+    } else if (r == 1) {
+      makePath(oldPath, i, state[i]);
+      check(vol->remove(oldPath), "remove");
+      state[i] = 0;
+    } else if (r == 3 && state[i] != 4) {
+      makePath(oldPath, i, state[i]);
+      makePath(newPath, i, 4);
+      check(vol->rename(oldPath, newPath), "rename");
+      state[i] = 4;
+    }
+  }
+}
+//------------------------------------------------------------------------------
+// Check FAT short names are unique.
+static void checkSfn() {
+  static char sfn[FILE_COUNT][13];
+  char path[40];
+  uint16_t n = 0;
+  FatFile dir;
+  FatFile file;
+  check(dir.open(&fatVol, "/data", O_RDONLY), "open dir");
+  while (n < FILE_COUNT && file.openNext(&dir, O_RDONLY)) {
+    file.getSFN(sfn[n++], sizeof(sfn[0]));
+    file.close();
+  }
+  for (uint16_t i = 0; i < n; i++) {
+    for (uint16_t k = i + 1; k < n; k++) {
+      if (!strcmp(sfn[i], sfn[k])) {
+        printf("duplicate SFN %s\n", sfn[i]);
+        check(false, "unique SFN");
+        return;
+      }
+    }
+  }
+  // Open files by short name.
+  for (uint16_t i = 0; i < n; i += 97) {
+    memcpy(path, "/data/", 6);
+    memcpy(path + 6, sfn[i], sizeof(sfn[0]));
+    check(file.open(&fatVol, path, O_RDONLY), "open SFN");
+    file.close();
+  }
+}
+//------------------------------------------------------------------------------
+template <class Vol, class File>
+static void run(Vol* vol, const char* path, uint32_t mib, bool exFat) {
+  bool ok;
+  char name[40];
+  uint32_t reads;
+  check(dev.create(path, 2048 * mib), "create image");
+  if (exFat) {
+    ExFatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  } else {
+    FatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  }
+  check(ok, "format");
+  check(vol->begin(&dev), "mount");
+  check(vol->mkdir("/data"), "mkdir");
+  check(vol->setDirIndex("/data", table, TABLE_SIZE), "setDirIndex");
+  if (failCount) {
+    return;
+  }
+  printf("\n%s %lu MiB\n", exFat ? "exFAT" : vol->fatType() == 16 ? "FAT16"
+                                                                 : "FAT32",
+         (unsigned long)mib);
+  memset(state, 0, sizeof(state));
+  reads = dev.reads;
+  for (uint16_t i = 0; i < FILE_COUNT && !failCount; i++) {
+    check(create<Vol, File>(vol, i, nameKind(i)), "create");
+  }
+  printf("%-12s %8.1f reads/create\n", "create",
+         (double)(dev.reads - reads) / FILE_COUNT);
+  check(!vol->exists("/data/DATA_00000.CSV") == !state[0], "upper case");
+  check(!vol->exists("/data/none"), "none");
+  verify<Vol, File>(vol, "index");
+  // Files in another directory don't change the index.
+  check(vol->mkdir("/other"), "mkdir other");
+  for (uint16_t i = 0; i < 100 && !failCount; i++) {
+    File file;
+    sprintf(name, "/other/data_%05u.csv", i);
+    check(file.open(vol, name, O_WRONLY | O_CREAT), "create other");
+    file.close();
+    check(i % 2 || vol->remove(name), "remove other");
+  }
+  churn<Vol, File>(vol, 0);
+  verify<Vol, File>(vol, "churn");
+  if (!exFat) {
+    checkSfn();
+  }
+  // Linear scan must agree with the index.
+  check(vol->setDirIndex("/data", nullptr, 0), "remove index");
+  verify<Vol, File>(vol, "linear");
+  // Rebuild from a directory with free entries.
+  check(vol->begin(&dev), "remount");
+  check(vol->setDirIndex("/data", table, TABLE_SIZE), "setDirIndex");
+  churn<Vol, File>(vol, 3);
+  verify<Vol, File>(vol, "rebuild");
+  if (!exFat) {
+    checkSfn();
+  }
+  // A table that is too small turns the index off.
+  check(vol->setDirIndex("/data", table, 10), "small index");
+  churn<Vol, File>(vol, 5);
+  check(vol->setDirIndex("/data", nullptr, 0), "remove index");
+  verify<Vol, File>(vol, "small");
+  // Remove the indexed directory.
+  check(vol->setDirIndex("/data", table, TABLE_SIZE), "setDirIndex");
+  for (uint16_t i = 0; i < FILE_COUNT && !failCount; i++) {
+    if (state[i]) {
+      makePath(name, i, state[i]);
+      check(vol->remove(name), "remove all");
+      state[i] = 0;
+    }
+  }
+  check(vol->rmdir("/data"), "rmdir");
+  check(vol->mkdir("/data"), "mkdir again");
+  check(create<Vol, File>(vol, 0, 1), "create after rmdir");
+  check(vol->exists("/data/data_00000.csv"), "exists after rmdir");
+  dev.end();
+}
+#endif  // USE_DIR_INDEX
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  const char* path = argc > 1 ? argv[1] : "DirIndexTest.img";
+  printf("USE_DIR_INDEX %d\n", USE_DIR_INDEX);
+  (void)path;
+#if USE_DIR_INDEX
+  // FAT volumes require USE_LONG_FILE_NAMES.
+  if (USE_LONG_FILE_NAMES) {
+    run<FatVolume, FatFile>(&fatVol, path, 256, false);
+  }
+  run<ExFatVolume, ExFatFile>(&exFatVol, path, 1024, true);
+  unlink(path);
+#endif  // USE_DIR_INDEX
+  printf(failCount ? "%d FAILURES\n" : "\nALL OK\n", failCount);
+  return failCount ? 1 : 0;
+}
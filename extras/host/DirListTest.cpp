@@ -0,0 +1,327 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief Check listPage() on disk images.
+ *
+ * Formats a FAT16 and an exFAT image and fills a subdirectory with files
+ * that have repeated sizes and modify times, hidden files, directories and
+ * holes.  Pages from listPage() are compared with a sorted copy of all
+ * entries for each sort key, several patterns and filters, a small arena
+ * that needs several scans and an arena that holds the whole directory.
+ * FsFile is run on exFAT to check that it forwards listPage().
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FsImageDevice.h"
+#include "FsLib/FsLib.h"
+//------------------------------------------------------------------------------
+/** Image device that counts read commands. */
+class ReadCountDevice : public FsImageDevice {
+ public:
+  bool readSectors(Sector_t sector, uint8_t* dst, size_t ns) override {
+    reads++;
+    return FsImageDevice::readSectors(sector, dst, ns);
+  }
+  uint32_t reads = 0;
+};
+//------------------------------------------------------------------------------
+static const uint16_t FILE_COUNT = 200;
+static const uint16_t MAX_ENTRY = 256;
+static const size_t NAME_SIZE = 64;
+#if USE_LONG_FILE_NAMES
+#define TXT_FMT "Log %03u.txt"
+#define CSV_FMT "log %03u.CSV"
+#define HIDDEN_FMT "hidden %u.txt"
+#define DIR_FMT "dir %u"
+static const char* const PATTERNS[] = {nullptr, "*.txt", "LOG 1*", "*?0?.*"};
+#else  // USE_LONG_FILE_NAMES
+#define TXT_FMT "LOG%03u.TXT"
+#define CSV_FMT "LOG%03u.CSV"
+#define HIDDEN_FMT "HIDDEN%u.TXT"
+#define DIR_FMT "DIR%u"
+static const char* const PATTERNS[] = {nullptr, "*.txt", "LOG1*", "*?0?.*"};
+#endif  // USE_LONG_FILE_NAMES
+static const uint8_t FLAGS[] = {
+    0, FsDirList::LIST_HIDDEN | FsDirList::LIST_NO_DIRS,
+    FsDirList::LIST_NO_FILES};
+static const uint8_t ORDERS[] = {
+    FsDirList::SORT_NAME, FsDirList::SORT_NAME | FsDirList::SORT_DESCEND,
+    FsDirList::SORT_MTIME, FsDirList::SORT_MTIME | FsDirList::SORT_DESCEND,
+    FsDirList::SORT_SIZE, FsDirList::SORT_SIZE | FsDirList::SORT_DESCEND};
+static int failCount = 0;
+static ReadCountDevice dev;
+static FatVolume fatVol;
+static ExFatVolume exFatVol;
+static FsVolume fsVol;
+static uint8_t secBuf[512];
+static uint8_t data[200];
+// All entries of the directory.
+static uint16_t allCount;
+static FsDirStat allStat[MAX_ENTRY];
+static char allName[MAX_ENTRY][NAME_SIZE];
+// Entries that pass the filter in sorted order.
+static uint16_t refCount;
+static uint16_t ref[MAX_ENTRY];
+static uint8_t refOrder;
+// Arena that holds all entries and one for a few entries.
+static uint64_t bigArena[MAX_ENTRY * (sizeof(FsDirListEntry) + NAME_SIZE) / 8];
+static uint8_t smallArena[8 * (sizeof(FsDirListEntry) + NAME_SIZE) + 3];
+//------------------------------------------------------------------------------
+static void check(bool ok, const char* msg) {
+  if (!ok) {
+    printf("FAIL: %s\n", msg);
+    failCount++;
+  }
+}
+//------------------------------------------------------------------------------
+static int caseCmp(const char* a, const char* b) {
+  for (;; a++, b++) {
+    int ca = 'a' <= *a && *a <= 'z' ? *a - 32 : (uint8_t)*a;
+    int cb = 'a' <= *b && *b <= 'z' ? *b - 32 : (uint8_t)*b;
+    if (ca != cb || !ca) {
+      return ca - cb;
+    }
+  }
+}
+//------------------------------------------------------------------------------
+static int refCmp(const void* va, const void* vb) {
+  uint16_t a = *reinterpret_cast<const uint16_t*>(va);
+  uint16_t b = *reinterpret_cast<const uint16_t*>(vb);
+  uint64_t ka = 0;
+  uint64_t kb = 0;
+  int rtn;
+  if ((refOrder & 0X7F) == FsDirList::SORT_MTIME) {
+    ka = (uint32_t)allStat[a].modifyDate << 16 | allStat[a].modifyTime;
+    kb = (uint32_t)allStat[b].modifyDate << 16 | allStat[b].modifyTime;
+  } else if ((refOrder & 0X7F) == FsDirList::SORT_SIZE) {
+    ka = allStat[a].size;
+    kb = allStat[b].size;
+  }
+  rtn = ka < kb ? -1 : ka > kb ? 1 : caseCmp(allName[a], allName[b]);
+  if (rtn == 0) {
+    rtn = allStat[a].dirIndex < allStat[b].dirIndex ? -1 : 1;
+  }
+  return refOrder & FsDirList::SORT_DESCEND ? -rtn : rtn;
+}
+//------------------------------------------------------------------------------
+static void makeRef(const char* pattern, uint8_t flags, uint8_t order) {
+  refCount = 0;
+  for (uint16_t i = 0; i < allCount; i++) {
+    const FsDirStat* st = &allStat[i];
+    if (st->isHidden() && !(flags & FsDirList::LIST_HIDDEN)) {
+      continue;
+    }
+    if (flags & (st->isDir() ? FsDirList::LIST_NO_DIRS
+                             : FsDirList::LIST_NO_FILES)) {
+      continue;
+    }
+    if (pattern && !FsDirList::match(pattern, allName[i])) {
+      continue;
+    }
+    ref[refCount++] = i;
+  }
+  refOrder = order;
+  qsort(ref, refCount, sizeof(ref[0]), refCmp);
+}
+//------------------------------------------------------------------------------
+// Check the page against the sorted entries starting at index first.
+static bool pageOk(FsDirList* list, int16_t n, uint32_t first) {
+  if (n < 0 || first + n > refCount) {
+    return false;
+  }
+  for (int16_t i = 0; i < n; i++) {
+    uint16_t k = ref[first + i];
+    if (strcmp(list->name(i), allName[k]) ||
+        list->stat(i)->dirIndex != allStat[k].dirIndex ||
+        list->stat(i)->size != allStat[k].size) {
+      return false;
+    }
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+template <class File>
+static void makeFile(File* dir, const char* name, size_t size, uint16_t i) {
+  File file;
+  check(file.open(dir, name, O_WRONLY | O_CREAT | O_EXCL), "create");
+  check(file.write(data, size) == size, "write");
+  check(file.timestamp(T_WRITE, 2020, 1 + i % 3, 1 + i % 7, (i * 7) % 24,
+                       (i * 13) % 4, 0),
+        "timestamp");
+  check(file.close(), "close");
+}
+//------------------------------------------------------------------------------
+template <class File>
+static void listAll(File* dir) {
+  allCount = 0;
+  dir->rewind();
+  while (allCount < MAX_ENTRY &&
+         dir->readDirPlus(&allStat[allCount], allName[allCount],
+                          NAME_SIZE) > 0) {
+    allCount++;
+  }
+}
+//------------------------------------------------------------------------------
+template <class File>
+static void listCheck(File* dir, void* arena, size_t size, const char* pattern,
+                      uint8_t flags, uint8_t order, uint16_t pageSize) {
+  FsDirList list;
+  int16_t n;
+  uint32_t first = 0;
+  makeRef(pattern, flags, order);
+  check(list.begin(arena, size, NAME_SIZE, order, pattern, flags), "begin");
+  do {
+    n = dir->listPage(&list, pageSize);
+    check(pageOk(&list, n, first), "page");
+    check(list.total() == refCount, "total");
+    first += n > 0 ? n : 0;
+  } while (n > 0 && !failCount);
+  check(first == refCount, "count");
+  if (refCount > 60) {
+    // Entries 40 to 49, 10 to 19 and the last entries.
+    list.seek(40);
+    check(pageOk(&list, dir->listPage(&list, 10), 40), "seek 40");
+    list.seek(10);
+    check(pageOk(&list, dir->listPage(&list, 10), 10), "seek 10");
+    list.seek(refCount - 5);
+    check(pageOk(&list, dir->listPage(&list, 10), refCount - 5), "seek end");
+  }
+}
+//------------------------------------------------------------------------------
+template <class Vol, class File>
+static void run(Vol* vol, const char* path, uint32_t mib, bool exFat) {
+  bool ok;
+  char name[40];
+  uint32_t reads;
+  int16_t n;
+  File dir;
+  File file;
+  FsDirList list;
+  check(dev.create(path, 2048 * mib), "create image");
+  if (exFat) {
+    ExFatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  } else {
+    FatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  }
+  check(ok, "format");
+  check(vol->begin(&dev), "mount");
+  if (failCount) {
+    return;
+  }
+  printf("\n%s %lu MiB\n", exFat ? "exFAT" : vol->fatType() == 16 ? "FAT16"
+                                                                 : "FAT32",
+         (unsigned long)mib);
+  check(vol->mkdir("/LOGS"), "mkdir");
+  check(dir.open(vol, "/LOGS", O_RDONLY), "open dir");
+  for (uint16_t k = 0; k < FILE_COUNT && !failCount; k++) {
+    // Create in a scrambled order.
+    uint16_t i = (k * 73) % FILE_COUNT;
+    sprintf(name, i & 1 ? CSV_FMT : TXT_FMT, i);
+    makeFile(&dir, name, (i * 37) % 11 * 10, i);
+  }
+  for (uint16_t i = 0; i < FILE_COUNT; i += 9) {
+    sprintf(name, i & 1 ? CSV_FMT : TXT_FMT, i);
+    check(dir.remove(name), "remove");
+  }
+  for (uint16_t i = 0; i < 3; i++) {
+    sprintf(name, HIDDEN_FMT, i);
+    makeFile(&dir, name, i, i);
+    check(file.open(&dir, name, O_RDONLY) && file.attrib(FS_ATTRIB_HIDDEN) &&
+              file.close(),
+          "hidden");
+    sprintf(name, DIR_FMT, i);
+    check(file.mkdir(&dir, name) && file.close(), "mkdir sub");
+  }
+  listAll(&dir);
+  check(allCount == FILE_COUNT - (FILE_COUNT + 8) / 9 + 6, "entry count");
+
+  for (const char* pattern : PATTERNS) {
+    for (uint8_t flags : FLAGS) {
+      for (uint8_t order : ORDERS) {
+        listCheck(&dir, smallArena, sizeof(smallArena), pattern, flags, order,
+                  7);
+        listCheck(&dir, bigArena, sizeof(bigArena), pattern, flags, order,
+                  50);
+      }
+    }
+  }
+  check(!list.begin(smallArena, sizeof(FsDirListEntry), NAME_SIZE, 0),
+        "arena too small");
+
+  dir.close();
+
+  // Oldest log files first.
+  for (uint8_t big = 0; big < 2; big++) {
+    uint32_t pages = 0;
+    check(vol->begin(&dev) && dir.open(vol, "/LOGS", O_RDONLY), "remount");
+    if (big) {
+      list.begin(bigArena, sizeof(bigArena), NAME_SIZE, FsDirList::SORT_MTIME,
+                 "*.csv", FsDirList::LIST_NO_DIRS);
+    } else {
+      list.begin(smallArena, sizeof(smallArena), NAME_SIZE,
+                 FsDirList::SORT_MTIME, "*.csv", FsDirList::LIST_NO_DIRS);
+    }
+    reads = dev.reads;
+    n = dir.listPage(&list, 5);
+    printf("%s arena %3u entries, first page %3lu reads",
+           big ? "big  " : "small", list.capacity(),
+           (unsigned long)(dev.reads - reads));
+    reads = dev.reads;
+    while (n > 0) {
+      pages++;
+      n = dir.listPage(&list, 5);
+    }
+    check(n == 0, "oldest");
+    printf(", %2lu more pages %3lu reads\n", (unsigned long)pages,
+           (unsigned long)(dev.reads - reads));
+    check(!big || dev.reads == reads, "no scan");
+    dir.close();
+  }
+  dev.end();
+}
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  const char* path = argc > 1 ? argv[1] : "DirListTest.img";
+  for (size_t i = 0; i < sizeof(data); i++) {
+    data[i] = i;
+  }
+  check(FsDirList::match("*.TXT", "a.b.txt"), "match");
+  check(FsDirList::match("a*b?d*", "AxxbCdyy"), "match");
+  check(!FsDirList::match("a*b?d", "abd"), "match");
+  check(FsDirList::match("?x", "\xC3\xA9x"), "match utf-8");
+  check(FsDirList::match("*", ""), "match empty");
+  run<FatVolume, FatFile>(&fatVol, path, 256, false);
+  run<ExFatVolume, ExFatFile>(&exFatVol, path, 1024, true);
+  run<FsVolume, FsFile>(&fsVol, path, 1024, true);
+  unlink(path);
+  printf(failCount ? "%d FAILURES\n" : "\nALL OK\n", failCount);
+  return failCount ? 1 : 0;
+}
@@ -0,0 +1,316 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief Check readDirPlus() and ls() on disk images.
+ *
+ * Formats FAT16, FAT32 and exFAT images and fills a directory with long,
+ * short, hidden and, for UTF-8 builds, multi-byte names, then removes
+ * some files to leave holes.  Each entry from readDirPlus() must match
+ * the file opened by openNext().  A name buffer too small for the long
+ * name must give the short name on FAT and a truncated name on exFAT.
+ * ls() must print a long name that does not fit its name buffer.
+ * Sector reads for a listing with openNext() and with readDirPlus() are
+ * reported.  FAT16 and FAT32 are both run since the root directory is
+ * listed and it is a fixed area on FAT16.  FsFile is run on exFAT to
+ * check that it forwards readDirPlus().
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FsImageDevice.h"
+#include "FsLib/FsLib.h"
+//------------------------------------------------------------------------------
+/** Image device that counts read commands. */
+class ReadCountDevice : public FsImageDevice {
+ public:
+  bool readSectors(Sector_t sector, uint8_t* dst, size_t ns) override {
+    reads++;
+    return FsImageDevice::readSectors(sector, dst, ns);
+  }
+  uint32_t reads = 0;
+};
+//------------------------------------------------------------------------------
+/** Print that counts lines and lines that end with a name. */
+class LinePrint : public print_t {
+ public:
+  using print_t::write;
+  size_t write(uint8_t b) override {
+    if (b == '\n') {
+      lines++;
+      size_t n = want ? strlen(want) : 0;
+      if (n && length >= n && !memcmp(line + length - n, want, n)) {
+        found++;
+      }
+      length = 0;
+    } else if (b != '\r' && length < sizeof(line)) {
+      line[length++] = b;
+    }
+    return 1;
+  }
+  uint32_t lines = 0;
+  uint32_t found = 0;
+  const char* want = nullptr;
+
+ private:
+  char line[300];
+  size_t length = 0;
+};
+//------------------------------------------------------------------------------
+static const uint16_t FILE_COUNT = 60;
+#if USE_LONG_FILE_NAMES
+#define FILE_FMT "data file %03u.csv"
+#define SUB_FMT "sub file %u.txt"
+static const char* const NAMES[] = {
+    "readme.txt",
+    "A name longer than the small buffer used by this test.dat",
+    "DATA.BIN",
+    "mixed Case.Txt",
+#if USE_UTF8_LONG_NAMES
+    "caf\xC3\xA9 \xE2\x82\xAC.txt",
+    "\xF0\x9F\x98\x80 smile.txt",
+#endif  // USE_UTF8_LONG_NAMES
+    "A name longer than the name buffer in ls() so it is printed from the "
+    "directory entries.txt",
+};
+#else  // USE_LONG_FILE_NAMES
+#define FILE_FMT "DATA%03u.CSV"
+#define SUB_FMT "SUB%u.TXT"
+static const char* const NAMES[] = {"README.TXT", "LONGNAME.DAT", "DATA.BIN"};
+#endif  // USE_LONG_FILE_NAMES
+static const uint8_t NAME_COUNT = sizeof(NAMES) / sizeof(NAMES[0]);
+static const size_t SMALL_SIZE = 13;
+static int failCount = 0;
+static ReadCountDevice dev;
+static FatVolume fatVol;
+static ExFatVolume exFatVol;
+static FsVolume fsVol;
+static uint8_t data[2000];
+static uint8_t secBuf[512];
+//------------------------------------------------------------------------------
+static void check(bool ok, const char* msg) {
+  if (!ok) {
+    printf("FAIL: %s\n", msg);
+    failCount++;
+  }
+}
+//------------------------------------------------------------------------------
+template <class File>
+static void makeFile(File* dir, const char* name, size_t size) {
+  File file;
+  check(file.open(dir, name, O_WRONLY | O_CREAT | O_EXCL), "create");
+  check(file.write(data, size) == size, "write");
+  check(file.close(), "close");
+}
+//------------------------------------------------------------------------------
+// Short name buffer gives the SFN on FAT or a truncated name on exFAT.
+static bool smallOk(FatFile* file, const char* small, const char*) {
+  char sfn[13];
+  file->getSFN(sfn, sizeof(sfn));
+  return !strcmp(small, sfn);
+}
+static bool smallOk(ExFatFile*, const char* small, const char* name) {
+  return strlen(small) < SMALL_SIZE && !strncmp(small, name, strlen(small));
+}
+static bool smallOk(FsFile*, const char* small, const char* name) {
+  return strlen(name) < SMALL_SIZE ? !strcmp(small, name)
+                                   : strlen(small) < SMALL_SIZE;
+}
+//------------------------------------------------------------------------------
+// Compare readDirPlus() with openNext() and return the entry count.
+template <class Vol, class File>
+static uint32_t compare(Vol* vol, const char* path) {
+  char name[256];
+  char full[256];
+  char small[SMALL_SIZE];
+  int8_t rtn;
+  uint16_t date;
+  uint16_t time;
+  uint32_t count = 0;
+  FsDirStat stat;
+  File dir;
+  File next;
+  File file;
+  check(dir.open(vol, path, O_RDONLY), "open dir");
+  check(next.open(vol, path, O_RDONLY), "open next");
+  while ((rtn = dir.readDirPlus(&stat, name, sizeof(name))) > 0) {
+    count++;
+    if (!file.openNext(&next, O_RDONLY)) {
+      check(false, "openNext");
+      break;
+    }
+    file.getName(full, sizeof(full));
+    check(!strcmp(name, full), "name");
+    check(stat.isDir() == file.isDir(), "isDir");
+    check(stat.isHidden() == file.isHidden(), "isHidden");
+    check((stat.attributes & FS_ATTRIB_USER_SETTABLE) ==
+              (file.attrib() & FS_ATTRIB_USER_SETTABLE),
+          "attrib");
+    check(stat.dirIndex == file.dirIndex(), "dirIndex");
+    check(stat.firstCluster == file.firstCluster(), "firstCluster");
+    check(file.isDir() || stat.size == file.fileSize(), "size");
+    check(file.getModifyDateTime(&date, &time) && date == stat.modifyDate &&
+              time == stat.modifyTime,
+          "modify");
+    check(file.getCreateDateTime(&date, &time) && date == stat.createDate &&
+              time == stat.createTime,
+          "create");
+    // Entry is reopened by index.
+    file.close();
+    check(file.open(&next, stat.dirIndex, O_RDONLY), "open index");
+    file.getName(full, sizeof(full));
+    check(!strcmp(name, full), "index name");
+    if (!strcmp(name, NAMES[1])) {
+      check(dir.seekSet(FS_DIR_SIZE * stat.dirIndex) &&
+                dir.readDirPlus(&stat, small, sizeof(small)) == 1 &&
+                smallOk(&file, small, name),
+            "small buffer");
+    }
+    file.close();
+  }
+  check(rtn == 0, "readDirPlus end");
+  check(!file.openNext(&next, O_RDONLY), "openNext end");
+  // Without a name.
+  uint32_t n = 0;
+  dir.rewind();
+  while (dir.readDirPlus(&stat) > 0) {
+    n++;
+  }
+  check(n == count, "no name count");
+  dir.close();
+  next.close();
+  return count;
+}
+//------------------------------------------------------------------------------
+template <class Vol, class File>
+static uint32_t listReads(Vol* vol, const char* path, bool plus) {
+  char name[256];
+  FsDirStat stat;
+  File dir;
+  File file;
+  check(vol->begin(&dev), "remount");
+  check(dir.open(vol, path, O_RDONLY), "open dir");
+  uint32_t reads = dev.reads;
+  if (plus) {
+    while (dir.readDirPlus(&stat, name, sizeof(name)) > 0) {
+    }
+  } else {
+    while (file.openNext(&dir, O_RDONLY)) {
+      file.getName(name, sizeof(name));
+      file.fileSize();
+      file.close();
+    }
+  }
+  return dev.reads - reads;
+}
+//------------------------------------------------------------------------------
+template <class Vol, class File>
+static void run(Vol* vol, const char* path, uint32_t mib, bool exFat) {
+  bool ok;
+  char name[40];
+  uint32_t count;
+  File dir;
+  File sub;
+  File file;
+  check(dev.create(path, 2048 * mib), "create image");
+  if (exFat) {
+    ExFatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  } else {
+    FatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  }
+  check(ok, "format");
+  check(vol->begin(&dev), "mount");
+  if (failCount) {
+    return;
+  }
+  printf("\n%s %lu MiB\n", exFat ? "exFAT" : vol->fatType() == 16 ? "FAT16"
+                                                                 : "FAT32",
+         (unsigned long)mib);
+  check(vol->mkdir("/LIST"), "mkdir");
+  check(dir.open(vol, "/LIST", O_RDONLY), "open list");
+  for (uint8_t i = 0; i < NAME_COUNT; i++) {
+    makeFile(&dir, NAMES[i], 100 * i);
+  }
+  for (uint16_t i = 0; i < FILE_COUNT; i++) {
+    sprintf(name, FILE_FMT, i);
+    makeFile(&dir, name, i * sizeof(data) / FILE_COUNT);
+  }
+  // Leave holes in the directory.
+  for (uint16_t i = 0; i < FILE_COUNT; i += 3) {
+    sprintf(name, FILE_FMT, i);
+    check(dir.remove(name), "remove");
+  }
+  makeFile(&dir, "HIDDEN.TXT", 5);
+  check(file.open(&dir, "HIDDEN.TXT", O_RDONLY) &&
+            file.attrib(FS_ATTRIB_HIDDEN) && file.close(),
+        "hidden");
+  check(sub.mkdir(&dir, "SUBDIR"), "mkdir sub");
+  for (uint8_t i = 0; i < 4; i++) {
+    sprintf(name, SUB_FMT, i);
+    makeFile(&sub, name, i);
+  }
+  sub.close();
+  dir.close();
+
+  count = compare<Vol, File>(vol, "/LIST");
+  check(compare<Vol, File>(vol, "/LIST/SUBDIR") == 4, "sub count");
+  check(compare<Vol, File>(vol, "/") == 1, "root count");
+
+  // ls() lists hidden files with LS_A and recurses with LS_R.
+  LinePrint pr;
+  pr.want = NAMES[NAME_COUNT - 1];
+  check(dir.open(vol, "/LIST", O_RDONLY), "open list");
+  check(dir.ls(&pr, LS_DATE | LS_SIZE), "ls");
+  check(pr.lines == count - 1, "ls lines");
+  check(pr.found == 1, "ls long name");
+  pr.lines = 0;
+  check(dir.ls(&pr, LS_A | LS_R | LS_SIZE), "ls -R");
+  check(pr.lines == count + 4, "ls -R lines");
+  dir.close();
+
+  printf("%-14s %6lu reads\n", "openNext()",
+         (unsigned long)listReads<Vol, File>(vol, "/LIST", false));
+  printf("%-14s %6lu reads\n", "readDirPlus()",
+         (unsigned long)listReads<Vol, File>(vol, "/LIST", true));
+  dev.end();
+}
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  const char* path = argc > 1 ? argv[1] : "DirStatTest.img";
+  for (size_t i = 0; i < sizeof(data); i++) {
+    data[i] = i;
+  }
+  run<FatVolume, FatFile>(&fatVol, path, 256, false);
+  run<FatVolume, FatFile>(&fatVol, path, 2100, false);
+  run<ExFatVolume, ExFatFile>(&exFatVol, path, 1024, true);
+  run<FsVolume, FsFile>(&fsVol, path, 1024, true);
+  unlink(path);
+  printf(failCount ? "%d FAILURES\n" : "\nALL OK\n", failCount);
+  return failCount ? 1 : 0;
+}
@@ -0,0 +1,174 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief Check second FAT writes on a disk image.
+ *
+ * Formats FAT16 and FAT32 images, grows several files a cluster at a
+ * time, then truncates and removes files.  Counts writes to each FAT and
+ * checks that the two FAT copies match after every sync.  With
+ * USE_DEFERRED_FAT_MIRROR nonzero no second FAT sector may be written
+ * before a sync.  The copy to the second FAT must use FAT sectors that
+ * are still cached rather than read them back from the first FAT.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FatLib/FatLib.h"
+#include "FsImageDevice.h"
+//------------------------------------------------------------------------------
+/** Image device that counts writes to each FAT. */
+class FatCountDevice : public FsImageDevice {
+ public:
+  bool readSectors(Sector_t sector, uint8_t* dst, size_t ns) override {
+    if (sector < fat1 + fatSize && (sector + ns) > fat1) {
+      fat1Reads += ns;
+    }
+    return FsImageDevice::readSectors(sector, dst, ns);
+  }
+  bool writeSectors(Sector_t sector, const uint8_t* src, size_t ns) override {
+    if (sector < fat2 + fatSize && (sector + ns) > fat1) {
+      if (sector >= fat2) {
+        fat2Commands++;
+        fat2Sectors += ns;
+      } else {
+        fat1Sectors += ns;
+      }
+    }
+    return FsImageDevice::writeSectors(sector, src, ns);
+  }
+  void clearCounts() {
+    fat1Reads = fat1Sectors = fat2Commands = fat2Sectors = 0;
+  }
+  Sector_t fat1 = 0;
+  Sector_t fat2 = 0;
+  Sector_t fatSize = 0;
+  uint32_t fat1Reads = 0;
+  uint32_t fat1Sectors = 0;
+  uint32_t fat2Commands = 0;
+  uint32_t fat2Sectors = 0;
+};
+//------------------------------------------------------------------------------
+static const uint8_t FILE_COUNT = 4;
+static FatCountDevice dev;
+static FatVolume vol;
+static uint8_t buf[4096];
+static uint8_t fat2Buf[512];
+static int failCount = 0;
+//------------------------------------------------------------------------------
+static void check(bool ok, const char* msg) {
+  if (!ok) {
+    printf("FAIL: %s\n", msg);
+    failCount++;
+  }
+}
+//------------------------------------------------------------------------------
+static bool fatsMatch() {
+  for (Sector_t i = 0; i < dev.fatSize; i++) {
+    if (!dev.readSector(dev.fat1 + i, buf) ||
+        !dev.readSector(dev.fat2 + i, fat2Buf) ||
+        memcmp(buf, fat2Buf, sizeof(fat2Buf))) {
+      return false;
+    }
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+static void report(const char* name) {
+  printf("%-10s %8lu %8lu %8lu %8lu\n", name, (unsigned long)dev.fat1Reads,
+         (unsigned long)dev.fat1Sectors, (unsigned long)dev.fat2Sectors,
+         (unsigned long)dev.fat2Commands);
+  dev.clearCounts();
+}
+//------------------------------------------------------------------------------
+static void run(const char* path, uint32_t mib) {
+  FatFormatter fmt;
+  FatFile file[FILE_COUNT];
+  char name[8] = "F0.BIN";
+  check(dev.create(path, 2048 * mib), "create image");
+  check(fmt.format(&dev, buf), "format");
+  check(vol.begin(&dev), "mount");
+  if (failCount) {
+    return;
+  }
+  dev.fat1 = vol.fatStartSector();
+  dev.fatSize = vol.sectorsPerFat();
+  dev.fat2 = dev.fat1 + dev.fatSize;
+  dev.clearCounts();
+  printf("\nFAT%u %lu MiB\n", vol.fatType(), (unsigned long)mib);
+  printf("%-10s %8s %8s %8s %8s\n", "step", "fat1rd", "fat1", "fat2",
+         "fat2cmd");
+  check(vol.fatCount() == 2, "fatCount");
+  memset(buf, 'x', sizeof(buf));
+  for (uint8_t i = 0; i < FILE_COUNT; i++) {
+    name[1] = '0' + i;
+    check(file[i].open(&vol, name, O_RDWR | O_CREAT), "open");
+  }
+  if (failCount) {
+    return;
+  }
+  // Interleave cluster sized writes so each file is fragmented.
+  for (uint32_t n = 0; n < 2000 && !failCount; n++) {
+    uint8_t i = n % FILE_COUNT;
+    for (uint32_t m = 0; m < vol.bytesPerCluster(); m += sizeof(buf)) {
+      check(file[i].write(buf, sizeof(buf)) == sizeof(buf), "write");
+    }
+  }
+  check(!USE_DEFERRED_FAT_MIRROR || dev.fat2Sectors == 0,
+        "second FAT written before sync");
+  report("write");
+  for (uint8_t i = 0; i < FILE_COUNT; i++) {
+    check(file[i].sync(), "sync");
+  }
+  check(!USE_DEFERRED_FAT_MIRROR || FS_CACHE_SECTOR_COUNT < 2 ||
+            dev.fat1Reads < dev.fat2Sectors,
+        "cached FAT sectors read for the second FAT");
+  report("sync");
+  check(fatsMatch(), "FATs differ after write");
+  // Truncate and remove sync the volume.
+  check(file[0].truncate(vol.bytesPerCluster() * 3), "truncate");
+  report("truncate");
+  check(file[1].remove(), "remove");
+  report("remove");
+  for (uint8_t i = 0; i < FILE_COUNT; i++) {
+    check(i == 1 || file[i].close(), "close");
+  }
+  report("close");
+  check(fatsMatch(), "FATs differ after free");
+  vol.end();
+  dev.end();
+}
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  const char* path = argc > 1 ? argv[1] : "FatMirrorTest.img";
+  printf("USE_DEFERRED_FAT_MIRROR %d\n", USE_DEFERRED_FAT_MIRROR);
+  run(path, 256);
+  run(path, 2100);
+  unlink(path);
+  printf(failCount ? "%d FAILURES\n" : "\nALL OK\n", failCount);
+  return failCount ? 1 : 0;
+}
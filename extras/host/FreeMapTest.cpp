@@ -0,0 +1,178 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief Check the FAT free map on a disk image.
+ *
+ * Fills the front of a FAT32 image, remounts it and attaches a free map.
+ * The map is built when it is attached so the first cluster allocated
+ * after attach must not scan the FAT.  Files are grown, removed and
+ * grown again with the map attached, then the image is remounted without
+ * a map to check the free cluster count and file data.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FatLib/FatLib.h"
+#include "FsImageDevice.h"
+static int failCount = 0;
+#if USE_FAT_FREE_MAP
+//------------------------------------------------------------------------------
+/** Image device that counts read commands. */
+class ReadCountDevice : public FsImageDevice {
+ public:
+  bool readSectors(Sector_t sector, uint8_t* dst, size_t ns) override {
+    reads++;
+    return FsImageDevice::readSectors(sector, dst, ns);
+  }
+  uint32_t reads = 0;
+};
+//------------------------------------------------------------------------------
+static const uint8_t FILE_COUNT = 4;
+static const uint32_t FILL_SIZE = 64UL << 20;
+static ReadCountDevice dev;
+static FatVolume vol;
+static uint32_t freeMap[16];
+static uint8_t buf[4096];
+//------------------------------------------------------------------------------
+static void check(bool ok, const char* msg) {
+  if (!ok) {
+    printf("FAIL: %s\n", msg);
+    failCount++;
+  }
+}
+//------------------------------------------------------------------------------
+// Return reads used to allocate the first cluster of a new file.
+static uint32_t firstWrite(const char* name) {
+  FatFile file;
+  check(file.open(&vol, name, O_RDWR | O_CREAT), "open");
+  uint32_t reads = dev.reads;
+  check(file.write(buf, sizeof(buf)) == sizeof(buf), "first write");
+  reads = dev.reads - reads;
+  check(file.close(), "close");
+  return reads;
+}
+//------------------------------------------------------------------------------
+static bool mount(bool useMap) {
+  vol.end();
+  if (!vol.begin(&dev)) {
+    return false;
+  }
+  return !useMap || vol.setFreeMap(freeMap, sizeof(freeMap) / 4);
+}
+//------------------------------------------------------------------------------
+static void run(const char* path, uint32_t mib) {
+  FatFormatter fmt;
+  FatFile root;
+  FatFile file[FILE_COUNT];
+  char name[8] = "F0.BIN";
+  check(dev.create(path, 2048 * mib), "create image");
+  check(fmt.format(&dev, buf), "format");
+  check(vol.begin(&dev), "mount");
+  if (failCount) {
+    return;
+  }
+  printf("\nFAT%u %lu MiB\n", vol.fatType(), (unsigned long)mib);
+  check(root.openRoot(&vol), "open root");
+  check(file[0].createContiguous(&root, "FILL.BIN", FILL_SIZE), "fill");
+  check(file[0].close() && root.close(), "close fill");
+  check(mount(false), "remount");
+  uint32_t noMap = firstWrite("A.BIN");
+  check(mount(true), "attach map");
+  int32_t freeCount = vol.freeClusterCount();
+  uint32_t withMap = firstWrite("B.BIN");
+  printf("reads for first cluster: %lu, with map %lu\n",
+         (unsigned long)noMap, (unsigned long)withMap);
+  check(4 * withMap < noMap, "first allocation scanned the FAT");
+  uint32_t reads = dev.reads;
+  check(vol.freeClusterCount() == freeCount - 1, "free count after write");
+  check(!MAINTAIN_FREE_CLUSTER_COUNT || dev.reads == reads,
+        "free count scanned the FAT");
+  check(!vol.setFreeMap(freeMap, 0), "empty map accepted");
+  check(vol.setFreeMap(freeMap, sizeof(freeMap) / 4), "attach map again");
+
+  // Interleave cluster writes, remove a file and grow the others into
+  // the freed clusters.
+  for (uint8_t i = 0; i < FILE_COUNT; i++) {
+    name[1] = '0' + i;
+    check(file[i].open(&vol, name, O_RDWR | O_CREAT), "open");
+  }
+  for (uint32_t n = 0; n < 400 && !failCount; n++) {
+    uint8_t i = n % FILE_COUNT;
+    memset(buf, 'a' + i, sizeof(buf));
+    check(file[i].write(buf, sizeof(buf)) == sizeof(buf), "write");
+  }
+  check(file[1].remove(), "remove");
+  for (uint32_t n = 0; n < 600 && !failCount; n++) {
+    uint8_t i = n % FILE_COUNT;
+    if (i != 1) {
+      memset(buf, 'a' + i, sizeof(buf));
+      check(file[i].write(buf, sizeof(buf)) == sizeof(buf), "write");
+    }
+  }
+  for (uint8_t i = 0; i < FILE_COUNT; i++) {
+    check(i == 1 || file[i].close(), "close");
+  }
+  freeCount = vol.freeClusterCount();
+
+  // Remount without the map and check the count and data.
+  check(mount(false), "remount");
+  check(vol.freeClusterCount() == freeCount, "free count after remount");
+  for (uint8_t i = 0; i < FILE_COUNT; i++) {
+    if (i == 1) {
+      continue;
+    }
+    name[1] = '0' + i;
+    check(file[i].open(&vol, name, O_RDONLY), "open read");
+    check(file[i].fileSize() == 250UL * sizeof(buf), "file size");
+    while (file[i].available() && !failCount) {
+      check(file[i].read(buf, sizeof(buf)) == sizeof(buf), "read");
+      for (size_t k = 0; k < sizeof(buf); k++) {
+        if (buf[k] != 'a' + i) {
+          check(false, "data");
+          break;
+        }
+      }
+    }
+    file[i].close();
+  }
+  vol.end();
+  dev.end();
+}
+#endif  // USE_FAT_FREE_MAP
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  const char* path = argc > 1 ? argv[1] : "FreeMapTest.img";
+  printf("USE_FAT_FREE_MAP %d\n", USE_FAT_FREE_MAP);
+  (void)path;
+#if USE_FAT_FREE_MAP
+  run(path, 2100);
+  unlink(path);
+#endif  // USE_FAT_FREE_MAP
+  printf(failCount ? "%d FAILURES\n" : "\nALL OK\n", failCount);
+  return failCount ? 1 : 0;
+}
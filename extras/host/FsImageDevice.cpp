@@ -0,0 +1,145 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#define DBG_FILE "FsImageDevice.cpp"
+#include "FsImageDevice.h"
+
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/fs.h>
+#endif  // __linux__
+
+#include "common/DebugMacros.h"
+//------------------------------------------------------------------------------
+bool FsImageDevice::begin(const char* path, bool readOnly) {
+  m_readOnly = readOnly;
+  return open(path, readOnly ? O_RDONLY : O_RDWR);
+}
+//------------------------------------------------------------------------------
+bool FsImageDevice::create(const char* path, Sector_t count) {
+  m_readOnly = false;
+  if (!open(path, O_RDWR | O_CREAT)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (ftruncate(m_fd, 512 * static_cast<off_t>(count)) != 0) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_sectorCount = count;
+  return true;
+
+fail:
+  end();
+  return false;
+}
+//------------------------------------------------------------------------------
+void FsImageDevice::end() {
+  if (m_fd >= 0) {
+    if (!m_readOnly) {
+      fsync(m_fd);
+    }
+    close(m_fd);
+  }
+  m_fd = -1;
+  m_sectorCount = 0;
+}
+//------------------------------------------------------------------------------
+bool FsImageDevice::open(const char* path, int flags) {
+  struct stat st;
+  uint64_t size;
+  end();
+  m_fd = ::open(path, flags, 0644);
+  if (m_fd < 0 || fstat(m_fd, &st) != 0) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  size = st.st_size;
+#ifdef BLKGETSIZE64
+  if (S_ISBLK(st.st_mode) && ioctl(m_fd, BLKGETSIZE64, &size) != 0) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+#endif  // BLKGETSIZE64
+  // Sector_t is 32-bit so larger images are truncated to 2 TiB.
+  size /= 512;
+  m_sectorCount = size > 0XFFFFFFFF ? 0XFFFFFFFF : size;
+  return true;
+
+fail:
+  end();
+  return false;
+}
+//------------------------------------------------------------------------------
+bool FsImageDevice::readSectors(Sector_t sector, uint8_t* dst, size_t ns) {
+  off_t pos = 512 * static_cast<off_t>(sector);
+  size_t n = 512 * ns;
+  if (!inRange(sector, ns)) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  while (n) {
+    ssize_t rtn = pread(m_fd, dst, n, pos);
+    if (rtn <= 0) {
+      DBG_FAIL_MACRO;
+      return false;
+    }
+    dst += rtn;
+    pos += rtn;
+    n -= rtn;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+bool FsImageDevice::syncDevice() {
+  if (m_durable && !m_readOnly && m_fd >= 0 && fdatasync(m_fd) != 0) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+bool FsImageDevice::writeSectors(Sector_t sector, const uint8_t* src,
+                                 size_t ns) {
+  off_t pos = 512 * static_cast<off_t>(sector);
+  size_t n = 512 * ns;
+  if (m_readOnly || !inRange(sector, ns)) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  while (n) {
+    ssize_t rtn = pwrite(m_fd, src, n, pos);
+    if (rtn <= 0) {
+      DBG_FAIL_MACRO;
+      return false;
+    }
+    src += rtn;
+    pos += rtn;
+    n -= rtn;
+  }
+  return true;
+}
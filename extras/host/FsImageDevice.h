@@ -0,0 +1,130 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+/**
+ * \file
+ * \brief FsImageDevice class
+ */
+#include "common/FsBlockDeviceInterface.h"
+//------------------------------------------------------------------------------
+/**
+ * \class FsImageDevice
+ * \brief Block device backed by a disk image file on a POSIX host.
+ *
+ * Sectors are transferred with pread() and pwrite() so the image can
+ * be a regular file or a raw device such as /dev/sdb.  Data is flushed
+ * to the host disk by end() or, after setDurable(true), by every call
+ * to syncDevice().
+ */
+class FsImageDevice : public FsBlockDeviceInterface {
+ public:
+  FsImageDevice() = default;
+  ~FsImageDevice() override { end(); }
+  /** Open an existing image.
+   *
+   * \param[in] path Image file path.
+   * \param[in] readOnly Open the image read only.
+   * \return true for success or false for failure.
+   */
+  bool begin(const char* path, bool readOnly = false);
+  /** Create an image or resize an existing image.
+   *
+   * \param[in] path Image file path.
+   * \param[in] count Size of the image in sectors.
+   * \return true for success or false for failure.
+   */
+  bool create(const char* path, Sector_t count);
+  /** Flush the image and close it. */
+  void end() override;
+  /** \return false - the device is never busy. */
+  bool isBusy() override { return false; }
+  /** \return true if the image is open. */
+  bool isOpen() const { return m_fd >= 0; }
+  /**
+   * Read a sector.
+   *
+   * \param[in] sector Logical sector to be read.
+   * \param[out] dst Pointer to the location that will receive the data.
+   * \return true for success or false for failure.
+   */
+  bool readSector(Sector_t sector, uint8_t* dst) override {
+    return readSectors(sector, dst, 1);
+  }
+  /**
+   * Read multiple sectors.
+   *
+   * \param[in] sector Logical sector to be read.
+   * \param[in] ns Number of sectors to be read.
+   * \param[out] dst Pointer to the location that will receive the data.
+   * \return true for success or false for failure.
+   */
+  bool readSectors(Sector_t sector, uint8_t* dst, size_t ns) override;
+  /** \return image size in sectors. */
+  Sector_t sectorCount() override { return m_sectorCount; }
+  /** Select whether syncDevice() calls fdatasync().
+   *
+   * Durable sync is off by default so benchmarks measure the library
+   * rather than the host disk.
+   *
+   * \param[in] durable true to flush the image on every syncDevice().
+   */
+  void setDurable(bool durable) { m_durable = durable; }
+  /** Flush the image if durable sync is enabled.
+   * \return true for success or false for failure.
+   */
+  bool syncDevice() override;
+  /**
+   * Writes a sector.
+   *
+   * \param[in] sector Logical sector to be written.
+   * \param[in] src Pointer to the location of the data to be written.
+   * \return true for success or false for failure.
+   */
+  bool writeSector(Sector_t sector, const uint8_t* src) override {
+    return writeSectors(sector, src, 1);
+  }
+  /**
+   * Write multiple sectors.
+   *
+   * \param[in] sector Logical sector to be written.
+   * \param[in] ns Number of sectors to be written.
+   * \param[in] src Pointer to the location of the data to be written.
+   * \return true for success or false for failure.
+   */
+  bool writeSectors(Sector_t sector, const uint8_t* src, size_t ns) override;
+
+ private:
+  FsImageDevice(const FsImageDevice&) = delete;
+  FsImageDevice& operator=(const FsImageDevice&) = delete;
+  bool inRange(Sector_t sector, size_t ns) const {
+    return m_fd >= 0 && sector < m_sectorCount &&
+           ns <= (m_sectorCount - sector);
+  }
+  bool open(const char* path, int flags);
+  int m_fd = -1;
+  Sector_t m_sectorCount = 0;
+  bool m_durable = false;
+  bool m_readOnly = false;
+};
@@ -0,0 +1,162 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief Create, list and copy files to and from FAT/exFAT disk images.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FsImageDevice.h"
+#include "FsLib/FsLib.h"
+//------------------------------------------------------------------------------
+static FsImageDevice dev;
+static FsVolume vol;
+static uint8_t secBuf[512];
+//------------------------------------------------------------------------------
+static int usage() {
+  fprintf(stderr,
+          "usage: ImageTool create IMAGE MIB [fat|exfat]\n"
+          "       ImageTool info IMAGE\n"
+          "       ImageTool ls IMAGE\n"
+          "       ImageTool put IMAGE HOST_FILE PATH\n"
+          "       ImageTool get IMAGE PATH HOST_FILE\n");
+  return 2;
+}
+//------------------------------------------------------------------------------
+static int fail(const char* msg) {
+  fprintf(stderr, "ImageTool: %s\n", msg);
+  return 1;
+}
+//------------------------------------------------------------------------------
+static int create(const char* path, uint32_t mib, bool exFat) {
+  if (!dev.create(path, 2048 * mib)) {
+    return fail("create image failed");
+  }
+  if (exFat) {
+    ExFatFormatter fmt;
+    if (!fmt.format(&dev, secBuf, &Serial)) {
+      return fail("exFAT format failed");
+    }
+  } else {
+    FatFormatter fmt;
+    if (!fmt.format(&dev, secBuf, &Serial)) {
+      return fail("FAT format failed");
+    }
+  }
+  return 0;
+}
+//------------------------------------------------------------------------------
+static int get(const char* path, const char* hostPath) {
+  FsFile file;
+  FILE* out;
+  int n;
+  if (!file.open(path, O_RDONLY)) {
+    return fail("open PATH failed");
+  }
+  out = fopen(hostPath, "wb");
+  if (!out) {
+    return fail("open HOST_FILE failed");
+  }
+  while ((n = file.read(secBuf, sizeof(secBuf))) > 0) {
+    if (fwrite(secBuf, 1, n, out) != static_cast<size_t>(n)) {
+      fclose(out);
+      return fail("write HOST_FILE failed");
+    }
+  }
+  fclose(out);
+  return n < 0 ? fail("read PATH failed") : 0;
+}
+//------------------------------------------------------------------------------
+static int info() {
+  uint32_t bytesPerCluster = vol.bytesPerCluster();
+  int32_t freeCount = vol.freeClusterCount();
+  printf("type: %s\n", vol.fatType() == FAT_TYPE_EXFAT ? "exFAT" : "FAT");
+  printf("fatType: %u\n", vol.fatType());
+  printf("bytesPerCluster: %lu\n", (unsigned long)bytesPerCluster);
+  printf("clusterCount: %lu\n", (unsigned long)vol.clusterCount());
+  printf("freeClusterCount: %ld\n", (long)freeCount);
+  printf("freeMiB: %.1f\n", freeCount * (bytesPerCluster / 1048576.0));
+  return freeCount < 0 ? fail("freeClusterCount failed") : 0;
+}
+//------------------------------------------------------------------------------
+static int put(const char* hostPath, const char* path) {
+  FsFile file;
+  FILE* in = fopen(hostPath, "rb");
+  size_t n;
+  if (!in) {
+    return fail("open HOST_FILE failed");
+  }
+  if (!file.open(path, O_WRONLY | O_CREAT | O_TRUNC)) {
+    fclose(in);
+    return fail("open PATH failed");
+  }
+  while ((n = fread(secBuf, 1, sizeof(secBuf), in)) > 0) {
+    if (file.write(secBuf, n) != n) {
+      fclose(in);
+      return fail("write PATH failed");
+    }
+  }
+  fclose(in);
+  return file.close() ? 0 : fail("close PATH failed");
+}
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  int rtn;
+  if (argc < 3) {
+    return usage();
+  }
+  const char* cmd = argv[1];
+  if (!strcmp(cmd, "create")) {
+    if (argc < 4 || (argc > 4 && strcmp(argv[4], "fat") &&
+                     strcmp(argv[4], "exfat"))) {
+      return usage();
+    }
+    rtn = create(argv[2], atol(argv[3]), argc > 4 && !strcmp(argv[4], "exfat"));
+    dev.end();
+    return rtn;
+  }
+  if (!dev.begin(argv[2], !strcmp(cmd, "info") || !strcmp(cmd, "ls") ||
+                              !strcmp(cmd, "get"))) {
+    return fail("open IMAGE failed");
+  }
+  if (!vol.begin(&dev)) {
+    return fail("mount failed");
+  }
+  if (!strcmp(cmd, "info")) {
+    rtn = info();
+  } else if (!strcmp(cmd, "ls")) {
+    rtn = vol.ls(&Serial, LS_R | LS_DATE | LS_SIZE) ? 0 : fail("ls failed");
+  } else if (!strcmp(cmd, "put") && argc == 5) {
+    rtn = put(argv[3], argv[4]);
+  } else if (!strcmp(cmd, "get") && argc == 5) {
+    rtn = get(argv[3], argv[4]);
+  } else {
+    rtn = usage();
+  }
+  dev.end();
+  return rtn;
+}
@@ -0,0 +1,239 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief Check RawStream on disk images.
+ *
+ * Formats a FAT16 and an exFAT image, preallocates a contiguous file
+ * and writes it with a RawStream in chunks of odd and whole sector
+ * sizes.  Streaming must only write sectors in the file's extent and
+ * close() must set the valid length with one directory write.  The data is
+ * checked with File::read() and a RawStream in read mode, then the file
+ * is appended to capacity after a remount.  Raw access past the file's
+ * clusters or in a file that is not contiguous must be rejected.  FsFile
+ * is run on exFAT to check that it forwards the raw calls.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FsImageDevice.h"
+#include "FsLib/FsLib.h"
+#include "RawStream.h"
+//------------------------------------------------------------------------------
+/** Image device that counts write commands inside and outside an extent. */
+class ExtentCountDevice : public FsImageDevice {
+ public:
+  bool writeSectors(Sector_t sector, const uint8_t* src, size_t ns) override {
+    if (sector >= extBgn && sector + ns - 1 <= extEnd) {
+      inside++;
+      sectors += ns;
+    } else {
+      outside++;
+    }
+    return FsImageDevice::writeSectors(sector, src, ns);
+  }
+  void clear() { inside = outside = sectors = 0; }
+  Sector_t extBgn = 0;
+  Sector_t extEnd = 0;
+  uint32_t inside = 0;
+  uint32_t outside = 0;
+  uint32_t sectors = 0;
+};
+//------------------------------------------------------------------------------
+static const uint32_t CAPACITY = 256 * 1024UL;
+static const uint32_t FIRST_SIZE = 100000;
+static const size_t CHUNK_SIZE[] = {1, 7, 511, 512, 513, 4096, 1000, 8195};
+static const size_t CHUNK_COUNT = sizeof(CHUNK_SIZE) / sizeof(CHUNK_SIZE[0]);
+static int failCount = 0;
+static ExtentCountDevice dev;
+static FatVolume fatVol;
+static ExFatVolume exFatVol;
+static FsVolume fsVol;
+static uint8_t secBuf[512];
+static uint8_t data[CAPACITY];
+//------------------------------------------------------------------------------
+static void check(bool ok, const char* msg) {
+  if (!ok) {
+    printf("FAIL: %s\n", msg);
+    failCount++;
+  }
+}
+//------------------------------------------------------------------------------
+// Write data[bgn, end) in chunks of varying size.
+template <class File>
+static bool writeChunks(RawStream<File>* rs, uint32_t bgn, uint32_t end) {
+  for (size_t i = 0; bgn < end; i++) {
+    size_t n = CHUNK_SIZE[i % CHUNK_COUNT];
+    n = n < end - bgn ? n : end - bgn;
+    if (rs->write(data + bgn, n) != n) {
+      return false;
+    }
+    bgn += n;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+// Check file data with File::read() and with RawStream::read().
+template <class File>
+static void verify(File* file, uint32_t size) {
+  static uint8_t buf[CAPACITY];
+  RawStream<File> rs;
+  uint32_t pos = 0;
+  check(file->validLength() == size, "valid length");
+  memset(buf, 0, size);
+  check(file->seekSet(0) && file->read(buf, size) == (int)size &&
+            !memcmp(buf, data, size),
+        "file read");
+  memset(buf, 0, size);
+  check(rs.openRead(file) && rs.available() == size, "openRead");
+  for (size_t i = 0; pos < size; i++) {
+    int n = rs.read(buf + pos, CHUNK_SIZE[(i + 3) % CHUNK_COUNT]);
+    if (n <= 0) {
+      break;
+    }
+    pos += n;
+  }
+  check(pos == size && !memcmp(buf, data, size), "stream read");
+  check(rs.read(buf, 1) == 0 && rs.write(buf, 1) == 0, "read mode");
+  rs.close();
+}
+//------------------------------------------------------------------------------
+template <class Vol, class File>
+static void run(Vol* vol, const char* path, uint32_t mib, bool exFat) {
+  bool ok;
+  File file;
+  RawStream<File> rs;
+  check(dev.create(path, 2048 * mib), "create image");
+  if (exFat) {
+    ExFatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  } else {
+    FatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  }
+  check(ok, "format");
+  check(vol->begin(&dev), "mount");
+  if (failCount) {
+    return;
+  }
+  printf("\n%s %lu MiB\n", exFat ? "exFAT" : vol->fatType() == 16 ? "FAT16"
+                                                                 : "FAT32",
+         (unsigned long)mib);
+  // Files with no extent or opened read-only are rejected.
+  check(file.open(vol, "RAW.BIN", O_RDWR | O_CREAT), "create");
+  check(!rs.openWrite(&file) && !rs.isOpen(), "no extent");
+  check(file.preAllocate(CAPACITY) && file.close(), "preAllocate");
+  check(file.open(vol, "RAW.BIN", O_RDONLY), "open read-only");
+  check(!rs.openWrite(&file), "read-only");
+  check(file.close() && file.open(vol, "RAW.BIN", O_RDWR), "open");
+  check(file.contiguousRange(&dev.extBgn, &dev.extEnd), "contiguousRange");
+
+  // Stream the first part.  Only the close() writes metadata.
+  check(rs.openWrite(&file) && rs.capacity() == CAPACITY, "openWrite");
+  check(rs.curPosition() == 0 && rs.available() == CAPACITY, "position");
+  dev.clear();
+  check(writeChunks(&rs, 0, FIRST_SIZE), "write");
+  check(dev.outside == 0, "writes outside extent");
+  printf("%lu bytes, %lu sectors in %lu writes\n", (unsigned long)FIRST_SIZE,
+         (unsigned long)dev.sectors, (unsigned long)dev.inside);
+  check(dev.sectors == FIRST_SIZE / 512, "sector count");
+  check(rs.close() && !rs.isOpen(), "close");
+  check(dev.outside == 1, "one metadata write");
+  verify(&file, FIRST_SIZE);
+  check(file.close(), "close file");
+
+  // Remount and append to capacity.
+  check(vol->begin(&dev), "remount");
+  check(file.open(vol, "RAW.BIN", O_RDWR), "reopen");
+  verify(&file, FIRST_SIZE);
+  check(rs.openWrite(&file, file.validLength()) &&
+            rs.curPosition() == FIRST_SIZE, "append");
+  check(writeChunks(&rs, FIRST_SIZE, CAPACITY - 100), "append write");
+  check(rs.sync(), "sync");
+  check(rs.write(data + CAPACITY - 100, 200) == 100, "capacity");
+  check(rs.available() == 0 && rs.write(data, 1) == 0, "full");
+  check(rs.close(), "close");
+  verify(&file, CAPACITY);
+  check(file.close(), "close file");
+  check(vol->begin(&dev) && file.open(vol, "RAW.BIN", O_RDONLY), "reopen");
+  verify(&file, CAPACITY);
+  file.close();
+
+  // Raw access past the end of the range from contiguousRange().
+  uint8_t sec[512];
+  uint32_t ns = dev.extEnd - dev.extBgn + 1;
+  check(file.open(vol, "RAW.BIN", O_RDWR), "open");
+  check(file.rawRead(ns - 1, sec, 1) && file.rawWrite(ns - 1, sec, 1),
+        "last sector");
+  check(!file.rawRead(ns, sec, 1) && !file.rawWrite(ns, sec, 1) &&
+            !file.rawWrite(ns - 1, sec, 2) &&
+            !file.rawWrite(0XFFFFFFFF, sec, 1) && !file.rawWrite(0, sec, 0),
+        "rawWrite out of range");
+  check(!file.rawEnd(512ULL * ns + 1) && file.validLength() == CAPACITY,
+        "rawEnd out of range");
+  // FAT checks sectors past the file size in the FAT.
+  check(file.rawEnd(FIRST_SIZE) && file.rawWrite(ns - 1, sec, 1) &&
+            !file.rawWrite(ns, sec, 1) && file.rawEnd(CAPACITY),
+        "past file size");
+  check(file.close(), "close file");
+
+  // A file that is not contiguous.
+  File a;
+  File b;
+  uint32_t clusterSize = vol->bytesPerCluster();
+  check(a.open(vol, "A.BIN", O_RDWR | O_CREAT) &&
+            b.open(vol, "B.BIN", O_RDWR | O_CREAT),
+        "open");
+  for (uint32_t n = 0; n < clusterSize; n += sizeof(sec)) {
+    check(a.write(sec, sizeof(sec)) == sizeof(sec), "write a");
+  }
+  check(b.write(sec, 1) == 1 && a.write(sec, sizeof(sec)) == sizeof(sec) &&
+            a.sync() && b.sync(),
+        "fragment");
+  check(!a.contiguousRange(nullptr, nullptr), "not contiguous");
+  check(!a.rawRead(clusterSize / 512, sec, 1) &&
+            !a.rawWrite(clusterSize / 512, sec, 1),
+        "raw not contiguous");
+  // exFAT allows any validLength up to dataLength.
+  check(exFat || !a.rawEnd(clusterSize + 1), "rawEnd not contiguous");
+  a.close();
+  b.close();
+  dev.end();
+}
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  const char* path = argc > 1 ? argv[1] : "RawStreamTest.img";
+  for (uint32_t i = 0; i < CAPACITY; i++) {
+    data[i] = i * 7 + (i >> 9);
+  }
+  run<FatVolume, FatFile>(&fatVol, path, 256, false);
+  run<ExFatVolume, ExFatFile>(&exFatVol, path, 1024, true);
+  run<FsVolume, FsFile>(&fsVol, path, 1024, true);
+  unlink(path);
+  printf(failCount ? "%d FAILURES\n" : "\nALL OK\n", failCount);
+  return failCount ? 1 : 0;
+}
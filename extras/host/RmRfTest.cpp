@@ -0,0 +1,269 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief Check rmRfStar() on disk images.
+ *
+ * Formats FAT16, FAT32 and exFAT images and builds a tree with several
+ * hundred files, empty files, an empty directory and a chain of nested
+ * directories deeper than FsRmRf::MAX_DEPTH.  The tree is removed with
+ * one file at a time remove() calls, with rmRfStar() and with a budget
+ * and a remount between calls.  Sector writes are reported and the free
+ * cluster count must return to its value before the tree was built.
+ * FAT16 and FAT32 are both run since chains are freed a FAT sector at a
+ * time.  FsFile is run on exFAT to check that it forwards rmRfStar().
+ * rmRfStar() without an argument must use a smaller state than FsRmRf.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FsLib/FsLib.h"
+#include "FsImageDevice.h"
+//------------------------------------------------------------------------------
+/** Image device that counts write commands. */
+class WriteCountDevice : public FsImageDevice {
+ public:
+  bool writeSectors(Sector_t sector, const uint8_t* src, size_t ns) override {
+    writes++;
+    return FsImageDevice::writeSectors(sector, src, ns);
+  }
+  uint32_t writes = 0;
+};
+//------------------------------------------------------------------------------
+static const uint16_t DIR_COUNT = 6;
+static const uint16_t FILE_COUNT = 150;
+static const uint8_t DEEP_COUNT = 12;
+static const uint32_t BUDGET = 37;
+#if USE_LONG_FILE_NAMES
+#define DAY_FMT "day %02u"
+#define LOG_FMT "sample log %03u-%03u.txt"
+#define LEVEL_FMT "/level %02u"
+#define DEEP_FMT "deep file %u.bin"
+#else  // USE_LONG_FILE_NAMES
+#define DAY_FMT "DAY%02u"
+#define LOG_FMT "L%03u%03u.TXT"
+#define LEVEL_FMT "/LEVEL%02u"
+#define DEEP_FMT "DEEP%u.BIN"
+#endif  // USE_LONG_FILE_NAMES
+static int failCount = 0;
+static uint32_t fileCount;
+static uint32_t progressCount;
+static uint32_t progressRemoved;
+static WriteCountDevice dev;
+static FatVolume fatVol;
+static ExFatVolume exFatVol;
+static FsVolume fsVol;
+static uint8_t data[3000];
+static uint8_t secBuf[512];
+//------------------------------------------------------------------------------
+static void check(bool ok, const char* msg) {
+  if (!ok) {
+    printf("FAIL: %s\n", msg);
+    failCount++;
+  }
+}
+//------------------------------------------------------------------------------
+static void progress(uint32_t removed) {
+  progressCount++;
+  check(removed >= progressRemoved, "progress order");
+  progressRemoved = removed;
+}
+//------------------------------------------------------------------------------
+template <class File>
+static void makeFile(File* dir, const char* name, size_t size) {
+  File file;
+  check(file.open(dir, name, O_WRONLY | O_CREAT | O_EXCL), "create");
+  check(file.write(data, size) == size, "write");
+  check(file.close(), "close");
+  fileCount++;
+}
+//------------------------------------------------------------------------------
+// Build the tree and return the number of files and directories.
+template <class Vol, class File>
+static uint32_t makeTree(Vol* vol, const char* path) {
+  char name[40];
+  File top;
+  File dir;
+  fileCount = 0;
+  check(vol->mkdir(path), "mkdir");
+  check(top.open(vol, path, O_RDONLY), "open top");
+  for (uint16_t d = 0; d < DIR_COUNT && !failCount; d++) {
+    sprintf(name, DAY_FMT, d);
+    check(dir.mkdir(&top, name), "mkdir day");
+    fileCount++;
+    for (uint16_t i = 0; i < FILE_COUNT && !failCount; i++) {
+      sprintf(name, LOG_FMT, d, i);
+      makeFile(&dir, name, (i % 5) * sizeof(data) / 4);
+    }
+    dir.close();
+  }
+  check(dir.mkdir(&top, "empty"), "mkdir empty");
+  fileCount++;
+  dir.close();
+  // Nested directories.
+  char deep[300];
+  strcpy(deep, path);
+  for (uint8_t k = 0; k < DEEP_COUNT && !failCount; k++) {
+    sprintf(deep + strlen(deep), LEVEL_FMT, k);
+    check(vol->mkdir(deep), "mkdir level");
+    fileCount++;
+    check(dir.open(vol, deep, O_RDONLY), "open level");
+    for (uint8_t i = 0; i < 3; i++) {
+      sprintf(name, DEEP_FMT, i);
+      makeFile(&dir, name, i * 1000);
+    }
+    dir.close();
+  }
+  makeFile(&top, "last.txt", 10);
+  top.close();
+  return fileCount;
+}
+//------------------------------------------------------------------------------
+// Remove a tree one file at a time like rmRfStar() used to.
+template <class File>
+static void removeEach(File* dir) {
+  char name[40];
+  File file;
+  dir->rewind();
+  while (file.openNext(dir, O_RDONLY)) {
+    if (file.isDir()) {
+      removeEach(&file);
+    } else {
+      file.getName(name, sizeof(name));
+      file.close();
+      check(file.open(dir, name, O_WRONLY) && file.remove(), "remove");
+    }
+    if (failCount) {
+      return;
+    }
+  }
+  check(dir->rmdir(), "rmdir");
+}
+//------------------------------------------------------------------------------
+template <class Vol, class File>
+static void run(Vol* vol, const char* path, uint32_t mib, bool exFat) {
+  bool ok;
+  int8_t rtn;
+  uint32_t calls = 0;
+  uint32_t count;
+  uint32_t writes;
+  int64_t free0;
+  FsRmRf rm;
+  File dir;
+  File file;
+  check(dev.create(path, 2048 * mib), "create image");
+  if (exFat) {
+    ExFatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  } else {
+    FatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  }
+  check(ok, "format");
+  check(vol->begin(&dev), "mount");
+  if (failCount) {
+    return;
+  }
+  printf("\n%s %lu MiB\n", exFat ? "exFAT" : vol->fatType() == 16 ? "FAT16"
+                                                                 : "FAT32",
+         (unsigned long)mib);
+  free0 = vol->freeClusterCount();
+
+  // One file at a time.
+  count = makeTree<Vol, File>(vol, "/TREE");
+  check(dir.open(vol, "/TREE", O_RDONLY), "open tree");
+  writes = dev.writes;
+  removeEach(&dir);
+  printf("%-12s %8.2f writes/file\n", "remove()",
+         (double)(dev.writes - writes) / count);
+  check(!vol->exists("/TREE"), "tree removed");
+
+  // Bulk delete.
+  count = makeTree<Vol, File>(vol, "/TREE");
+  check(dir.open(vol, "/TREE", O_RDONLY), "open tree");
+  writes = dev.writes;
+  check(dir.rmRfStar(), "rmRfStar");
+  printf("%-12s %8.2f writes/file\n", "rmRfStar()",
+         (double)(dev.writes - writes) / count);
+  check(!dir.isOpen() && !vol->exists("/TREE"), "tree removed");
+  check(vol->begin(&dev), "remount");
+  check(vol->freeClusterCount() == free0, "free count");
+
+  // Steps with a remount after each call.
+  count = makeTree<Vol, File>(vol, "/TREE");
+  check(vol->begin(&dev), "remount");
+  rm.begin(BUDGET, progress);
+  progressCount = 0;
+  progressRemoved = 0;
+  do {
+    calls++;
+    check(dir.open(vol, "/TREE", O_RDONLY), "open step");
+    rtn = dir.rmRfStar(&rm);
+    check(rtn >= 0, "step");
+    check(rm.removed() <= calls * (BUDGET + 1), "budget");
+    dir.close();
+    check(vol->begin(&dev), "remount step");
+  } while (rtn == 0 && !failCount && calls < 1000);
+  printf("%-12s %8lu calls\n", "budget", (unsigned long)calls);
+  check(rm.removed() == count + 1, "removed count");
+  check(progressCount > calls && progressRemoved <= rm.removed(), "progress");
+  check(!vol->exists("/TREE"), "tree removed");
+  check(vol->freeClusterCount() == free0, "free count");
+
+  // Root is emptied but not removed.
+  makeTree<Vol, File>(vol, "/TREE");
+  check(dir.open(vol, "/", O_RDONLY), "open root");
+  makeFile(&dir, "root.txt", 100);
+  check(dir.rmRfStar() && dir.isOpen(), "rmRfStar root");
+  dir.rewind();
+  check(!file.openNext(&dir, O_RDONLY), "root empty");
+  dir.close();
+  check(vol->begin(&dev), "remount");
+  check(vol->freeClusterCount() == free0, "free count");
+  // The volume is still usable.
+  count = makeTree<Vol, File>(vol, "/AGAIN");
+  check(dir.open(vol, "/AGAIN", O_RDONLY), "again");
+  dir.close();
+  dev.end();
+}
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  const char* path = argc > 1 ? argv[1] : "RmRfTest.img";
+  for (size_t i = 0; i < sizeof(data); i++) {
+    data[i] = i;
+  }
+  printf("FsRmRf %u bytes, rmRfStar() state %u bytes\n",
+         (unsigned)sizeof(FsRmRf), (unsigned)sizeof(FsRmRfOnce));
+  check(sizeof(FsRmRfOnce) < sizeof(FsRmRf), "rmRfStar() state size");
+  run<FatVolume, FatFile>(&fatVol, path, 256, false);
+  run<FatVolume, FatFile>(&fatVol, path, 2100, false);
+  run<ExFatVolume, ExFatFile>(&exFatVol, path, 1024, true);
+  run<FsVolume, FsFile>(&fsVol, path, 1024, true);
+  unlink(path);
+  printf(failCount ? "%d FAILURES\n" : "\nALL OK\n", failCount);
+  return failCount ? 1 : 0;
+}
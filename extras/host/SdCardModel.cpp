@@ -0,0 +1,447 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "SdCardModel.h"
+//------------------------------------------------------------------------------
+// Data response tokens.
+static const uint8_t DATA_RES_CRC_ERROR = 0XEB;
+static const uint8_t DATA_RES_OK = 0XE5;
+static const uint8_t DATA_RES_WRITE_ERROR = 0XED;
+// Error token for read data - card ECC failed.
+static const uint8_t READ_ERROR_TOKEN = 0X04;
+// R1 bits.
+static const uint8_t R1_COM_CRC_ERROR = 0X08;
+static const uint8_t R1_ERASE_SEQUENCE_ERROR = 0X10;
+static const uint8_t R1_PARAMETER_ERROR = 0X40;
+//------------------------------------------------------------------------------
+// Bitwise CRCs are kept independent of the driver's table versions.
+static uint8_t crc7(const uint8_t* data, size_t n) {
+  uint8_t crc = 0;
+  for (size_t i = 0; i < n; i++) {
+    uint8_t d = data[i];
+    for (uint8_t j = 0; j < 8; j++, d <<= 1) {
+      crc <<= 1;
+      if ((d ^ crc) & 0X80) {
+        crc ^= 0X09;
+      }
+    }
+  }
+  return (crc << 1) | 1;
+}
+//------------------------------------------------------------------------------
+static uint16_t crc16(const uint8_t* data, size_t n) {
+  uint16_t crc = 0;
+  for (size_t i = 0; i < n; i++) {
+    crc ^= static_cast<uint16_t>(data[i]) << 8;
+    for (uint8_t j = 0; j < 8; j++) {
+      crc = crc & 0X8000 ? (crc << 1) ^ 0X1021 : crc << 1;
+    }
+  }
+  return crc;
+}
+//==============================================================================
+bool SdCardModel::attach(FsBlockDeviceInterface* media) {
+  m_media = media;
+  m_capacity = media ? media->sectorCount() & ~1023UL : 0;
+  m_selected = false;
+  m_idle = true;
+  m_state = STATE_IDLE;
+  m_segCount = 0;
+  m_cmdLen = 0;
+  resetStats();
+  return m_capacity != 0;
+}
+//------------------------------------------------------------------------------
+void SdCardModel::begin(SdSpiConfig config) { (void)config; }
+//------------------------------------------------------------------------------
+uint8_t SdCardModel::clock(uint8_t in) {
+  uint8_t out = 0XFF;
+  uint8_t kind = SD_MODEL_IDLE;
+  m_busNanos += 8000000000ULL / m_sck;
+  if (!m_selected) {
+    // Programming continues while the card is not selected.
+    if (m_segCount && m_segment[m_segHead].kind == SD_MODEL_BUSY) {
+      if (++m_segPos == m_segment[m_segHead].len) {
+        m_segHead = (m_segHead + 1) % SEGMENT_COUNT;
+        m_segCount--;
+        m_segPos = 0;
+      }
+    }
+    m_bytes[SD_MODEL_DESELECT]++;
+    return 0XFF;
+  }
+  if (!m_segCount && m_state == STATE_READ_MULTI) {
+    if (readSector(m_sector)) {
+      m_sector++;
+    } else {
+      m_state = STATE_IDLE;
+    }
+  }
+  if (m_segCount) {
+    Segment* seg = &m_segment[m_segHead];
+    out = seg->data ? seg->data[m_segPos] : seg->fill;
+    kind = seg->kind;
+    if (++m_segPos == seg->len) {
+      m_segHead = (m_segHead + 1) % SEGMENT_COUNT;
+      m_segCount--;
+      m_segPos = 0;
+    }
+  }
+  if (m_state == STATE_WRITE_DATA) {
+    m_rx[m_rxLen++] = in;
+    kind = m_rxLen <= 512 ? SD_MODEL_DATA : SD_MODEL_TOKEN;
+    if (m_rxLen == sizeof(m_rx)) {
+      writeData();
+    }
+  } else if (m_cmdLen) {
+    m_cmd[m_cmdLen++] = in;
+    kind = SD_MODEL_CMD;
+    if (m_cmdLen == sizeof(m_cmd)) {
+      command();
+      m_cmdLen = 0;
+    }
+  } else if (kind != SD_MODEL_BUSY) {
+    if ((in & 0XC0) == 0X40) {
+      m_cmd[0] = in;
+      m_cmdLen = 1;
+      kind = SD_MODEL_CMD;
+    } else if ((m_state == STATE_WRITE_SINGLE && in == DATA_START_SECTOR) ||
+               (m_state == STATE_WRITE_MULTI && in == WRITE_MULTIPLE_TOKEN)) {
+      m_writeState = m_state;
+      m_state = STATE_WRITE_DATA;
+      m_rxLen = 0;
+      kind = SD_MODEL_TOKEN;
+    } else if (m_state == STATE_WRITE_MULTI && in == STOP_TRAN_TOKEN) {
+      m_state = STATE_IDLE;
+      kind = SD_MODEL_TOKEN;
+      queueFill(0XFF, 1, SD_MODEL_IDLE);
+      queueFill(0, clocks(m_timing.stopMicros), SD_MODEL_BUSY);
+    }
+  }
+  m_bytes[kind]++;
+  return out;
+}
+//------------------------------------------------------------------------------
+uint32_t SdCardModel::clocks(uint32_t us) const {
+  uint64_t n = (static_cast<uint64_t>(us) * m_sck) / 8000000;
+  return n ? n : 1;
+}
+//------------------------------------------------------------------------------
+void SdCardModel::command() {
+  uint8_t cmd = m_cmd[0] & 0X3F;
+  uint32_t arg = static_cast<uint32_t>(m_cmd[1]) << 24 |
+                 static_cast<uint32_t>(m_cmd[2]) << 16 |
+                 static_cast<uint32_t>(m_cmd[3]) << 8 | m_cmd[4];
+  bool app = m_appCmd;
+  uint8_t r1 = m_idle ? R1_IDLE_STATE : R1_READY_STATE;
+  m_appCmd = false;
+  m_cmdCount[cmd]++;
+  // A command ends data output and a multiple sector read.
+  m_segCount = 0;
+  m_segPos = 0;
+  if (m_state == STATE_READ_MULTI) {
+    m_state = STATE_IDLE;
+  }
+  if ((m_crc || cmd == CMD0 || cmd == CMD8) && crc7(m_cmd, 5) != m_cmd[5]) {
+    queueR1(r1 | R1_COM_CRC_ERROR);
+    return;
+  }
+  if (m_idle && cmd != CMD0 && cmd != CMD8 && cmd != CMD55 &&
+      cmd != CMD58 && cmd != CMD59 && !(app && cmd == ACMD41)) {
+    queueR1(r1 | R1_ILLEGAL_COMMAND);
+    return;
+  }
+  if (app) {
+    switch (cmd) {
+      case ACMD13:
+        // SD status with AU_SIZE 4 MiB.
+        memset(m_reg, 0, 64);
+        m_reg[10] = 0X90;
+        m_rsp[0] = 0;
+        queueR1(r1, m_rsp, 1);
+        queueRead(m_reg, 64, 0);
+        return;
+      case ACMD23:
+        queueR1(r1);
+        return;
+      case ACMD41:
+        if (++m_initPolls > m_timing.initPolls) {
+          m_idle = false;
+        }
+        queueR1(m_idle ? R1_IDLE_STATE : R1_READY_STATE);
+        return;
+      case ACMD51:
+        memset(m_reg, 0, 8);
+        m_reg[0] = 0X02;
+        m_reg[1] = 0X35;
+        m_reg[2] = 0X80;
+        queueR1(r1);
+        queueRead(m_reg, 8, 0);
+        return;
+    }
+  }
+  switch (cmd) {
+    case CMD0:
+      m_idle = true;
+      m_crc = false;
+      m_initPolls = 0;
+      m_state = STATE_IDLE;
+      queueR1(R1_IDLE_STATE);
+      break;
+
+    case CMD6:
+      memset(m_reg, 0, 64);
+      queueR1(r1);
+      queueRead(m_reg, 64, 0);
+      break;
+
+    case CMD8:
+      m_rsp[0] = 0;
+      m_rsp[1] = 0;
+      m_rsp[2] = (arg >> 8) & 0XF;
+      m_rsp[3] = arg & 0XFF;
+      queueR1(r1, m_rsp, 4);
+      break;
+
+    case CMD9: {
+      uint32_t c = m_capacity / 1024 - 1;
+      const uint8_t csd[15] = {0X40, 0X0E, 0X00, 0X32, 0X5B, 0X59, 0X00,
+                               static_cast<uint8_t>((c >> 16) & 0X3F),
+                               static_cast<uint8_t>(c >> 8),
+                               static_cast<uint8_t>(c), 0X7F, 0X80, 0X0A,
+                               0X40, 0X00};
+      memcpy(m_reg, csd, 15);
+      m_reg[15] = crc7(m_reg, 15);
+      queueR1(r1);
+      queueRead(m_reg, 16, 0);
+      break;
+    }
+
+    case CMD10: {
+      // Made January 2025.
+      const uint8_t cid[15] = {0X7F, 'H', 'M', 'M', 'O', 'D', 'E', 'L',
+                               0X10, 0X12, 0X34, 0X56, 0X78, 0X01, 0X91};
+      memcpy(m_reg, cid, 15);
+      m_reg[15] = crc7(m_reg, 15);
+      queueR1(r1);
+      queueRead(m_reg, 16, 0);
+      break;
+    }
+
+    case CMD12:
+      queueR1(r1);
+      queueFill(0, clocks(m_timing.stopMicros), SD_MODEL_BUSY);
+      break;
+
+    case CMD13:
+      m_rsp[0] = 0;
+      queueR1(r1, m_rsp, 1);
+      break;
+
+    case CMD17:
+    case CMD18:
+    case CMD24:
+    case CMD25:
+      if (faultCheck(SD_FAULT_NO_RESPONSE, arg)) {
+        break;
+      }
+      if (arg >= m_capacity) {
+        queueR1(r1 | R1_PARAMETER_ERROR);
+        break;
+      }
+      queueR1(r1);
+      m_sector = arg;
+      if (cmd == CMD17) {
+        readSector(arg);
+      } else {
+        m_state = cmd == CMD18   ? STATE_READ_MULTI
+                  : cmd == CMD24 ? STATE_WRITE_SINGLE
+                                 : STATE_WRITE_MULTI;
+      }
+      break;
+
+    case CMD32:
+      m_eraseStart = arg;
+      queueR1(r1);
+      break;
+
+    case CMD33:
+      m_eraseEnd = arg;
+      queueR1(r1);
+      break;
+
+    case CMD38:
+      if (faultCheck(SD_FAULT_ERASE_REJECT, m_eraseStart)) {
+        queueR1(r1 | R1_ERASE_SEQUENCE_ERROR);
+        break;
+      }
+      memset(m_rx, 0, 512);
+      for (Sector_t s = m_eraseStart; s <= m_eraseEnd && s < m_capacity;
+           s++) {
+        m_media->writeSector(s, m_rx);
+      }
+      queueR1(r1);
+      queueFill(0, clocks(m_timing.eraseMicros), SD_MODEL_BUSY);
+      break;
+
+    case CMD55:
+      m_appCmd = true;
+      queueR1(r1);
+      break;
+
+    case CMD58:
+      m_rsp[0] = m_idle ? 0X40 : 0XC0;
+      m_rsp[1] = 0XFF;
+      m_rsp[2] = 0X80;
+      m_rsp[3] = 0;
+      queueR1(r1, m_rsp, 4);
+      break;
+
+    case CMD59:
+      m_crc = arg & 1;
+      queueR1(r1);
+      break;
+
+    default:
+      queueR1(r1 | R1_ILLEGAL_COMMAND);
+      break;
+  }
+}
+//------------------------------------------------------------------------------
+bool SdCardModel::faultCheck(uint8_t fault, Sector_t sector) {
+  if (m_fault != fault || !m_faultCount ||
+      (m_faultSector != 0XFFFFFFFF && m_faultSector != sector)) {
+    return false;
+  }
+  if (--m_faultCount == 0) {
+    m_fault = SD_FAULT_NONE;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+void SdCardModel::queue(const uint8_t* data, uint32_t len, uint8_t kind) {
+  if (len && m_segCount < SEGMENT_COUNT) {
+    Segment* seg = &m_segment[(m_segHead + m_segCount++) % SEGMENT_COUNT];
+    seg->data = data;
+    seg->len = len;
+    seg->fill = 0XFF;
+    seg->kind = kind;
+  }
+}
+//------------------------------------------------------------------------------
+void SdCardModel::queueFill(uint8_t fill, uint32_t len, uint8_t kind) {
+  queue(nullptr, len, kind);
+  m_segment[(m_segHead + m_segCount - 1) % SEGMENT_COUNT].fill = fill;
+}
+//------------------------------------------------------------------------------
+void SdCardModel::queueR1(uint8_t r1, const uint8_t* extra, uint8_t n) {
+  // m_rsp may hold extra so build the response at the end of m_rsp.
+  uint8_t* rsp = m_rsp + 8;
+  rsp[0] = r1;
+  memcpy(rsp + 1, extra, n);
+  queueFill(0XFF, m_timing.ncr, SD_MODEL_RESPONSE);
+  queue(rsp, n + 1, SD_MODEL_RESPONSE);
+}
+//------------------------------------------------------------------------------
+void SdCardModel::queueRead(const uint8_t* data, size_t len, Sector_t sector) {
+  uint16_t crc = crc16(data, len);
+  if (data != m_tx + 1) {
+    memcpy(m_tx + 1, data, len);
+  }
+  m_tx[0] = DATA_START_SECTOR;
+  if (len == 512 && faultCheck(SD_FAULT_READ_CRC, sector)) {
+    crc = ~crc;
+  }
+  m_tx[len + 1] = crc >> 8;
+  m_tx[len + 2] = crc;
+  queueFill(0XFF, len == 512 ? clocks(m_timing.readMicros) : 1,
+            SD_MODEL_WAIT);
+  queue(m_tx, 1, SD_MODEL_TOKEN);
+  queue(m_tx + 1, len, SD_MODEL_DATA);
+  queue(m_tx + len + 1, 2, SD_MODEL_TOKEN);
+}
+//------------------------------------------------------------------------------
+bool SdCardModel::readSector(Sector_t sector) {
+  if (sector >= m_capacity || faultCheck(SD_FAULT_READ_TOKEN, sector) ||
+      !m_media->readSector(sector, m_tx + 1)) {
+    m_tx[0] = READ_ERROR_TOKEN;
+    queueFill(0XFF, clocks(m_timing.readMicros), SD_MODEL_WAIT);
+    queue(m_tx, 1, SD_MODEL_TOKEN);
+    return false;
+  }
+  m_sectorsRead++;
+  queueRead(m_tx + 1, 512, sector);
+  return true;
+}
+//------------------------------------------------------------------------------
+uint8_t SdCardModel::receive(uint8_t* buf, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    buf[i] = clock(0XFF);
+  }
+  return 0;
+}
+//------------------------------------------------------------------------------
+void SdCardModel::resetStats() {
+  m_busNanos = 0;
+  memset(m_bytes, 0, sizeof(m_bytes));
+  memset(m_cmdCount, 0, sizeof(m_cmdCount));
+  m_sectorsRead = 0;
+  m_sectorsWritten = 0;
+}
+//------------------------------------------------------------------------------
+void SdCardModel::send(const uint8_t* buf, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    clock(buf[i]);
+  }
+}
+//------------------------------------------------------------------------------
+void SdCardModel::setSckSpeed(uint32_t maxSck) {
+  // SD cards in SPI mode are limited to 25 or 50 MHz.
+  m_sck = maxSck < 100000 ? 100000 : maxSck > 50000000 ? 50000000 : maxSck;
+}
+//------------------------------------------------------------------------------
+void SdCardModel::writeData() {
+  uint32_t us = m_timing.writeMicros;
+  uint16_t crc = static_cast<uint16_t>(m_rx[512]) << 8 | m_rx[513];
+  m_state = m_writeState;
+  if (m_crc && crc != crc16(m_rx, 512)) {
+    m_dataResponse = DATA_RES_CRC_ERROR;
+  } else if (m_sector >= m_capacity ||
+             faultCheck(SD_FAULT_WRITE_REJECT, m_sector) ||
+             !m_media->writeSector(m_sector, m_rx)) {
+    m_dataResponse = DATA_RES_WRITE_ERROR;
+  } else {
+    m_dataResponse = DATA_RES_OK;
+    m_sectorsWritten++;
+    if (faultCheck(SD_FAULT_WRITE_SLOW, m_sector)) {
+      us += m_timing.slowWriteMicros;
+    }
+  }
+  m_sector++;
+  queue(&m_dataResponse, 1, SD_MODEL_TOKEN);
+  queueFill(0, clocks(us), SD_MODEL_BUSY);
+  if (m_state == STATE_WRITE_SINGLE) {
+    m_state = STATE_IDLE;
+  }
+}
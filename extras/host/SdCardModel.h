@@ -0,0 +1,233 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+/**
+ * \file
+ * \brief SdCardModel class
+ */
+#include "SdCard/SdSpiCard/SdSpiCard.h"
+//------------------------------------------------------------------------------
+/** Byte kinds counted by SdCardModel. */
+enum SdModelByte : uint8_t {
+  /** Command bytes sent by the host. */
+  SD_MODEL_CMD,
+  /** Fill bytes and command responses. */
+  SD_MODEL_RESPONSE,
+  /** Data tokens, data CRC and data responses. */
+  SD_MODEL_TOKEN,
+  /** Sector and register data. */
+  SD_MODEL_DATA,
+  /** Read latency before a data token. */
+  SD_MODEL_WAIT,
+  /** Busy polls while the card programs or erases. */
+  SD_MODEL_BUSY,
+  /** Other bytes clocked with the card selected. */
+  SD_MODEL_IDLE,
+  /** Bytes clocked with the card not selected. */
+  SD_MODEL_DESELECT,
+  /** Number of byte kinds. */
+  SD_MODEL_KIND_COUNT
+};
+//------------------------------------------------------------------------------
+/** Faults that SdCardModel can inject. */
+enum SdModelFault : uint8_t {
+  /** No fault. */
+  SD_FAULT_NONE,
+  /** Do not respond to a read or write command. */
+  SD_FAULT_NO_RESPONSE,
+  /** Send a data error token in place of read data. */
+  SD_FAULT_READ_TOKEN,
+  /** Send read data with a bad CRC. */
+  SD_FAULT_READ_CRC,
+  /** Reject write data with a write error data response. */
+  SD_FAULT_WRITE_REJECT,
+  /** Add the slow write time to programming of a sector. */
+  SD_FAULT_WRITE_SLOW,
+  /** Reject CMD38 with an erase sequence error. */
+  SD_FAULT_ERASE_REJECT
+};
+//------------------------------------------------------------------------------
+/**
+ * \struct SdModelTiming
+ * \brief Card timing.  Times are converted to byte clocks at the
+ * current SCK rate so runs are repeatable.
+ */
+struct SdModelTiming {
+  /** Fill bytes before a command response, 1 to 8. */
+  uint8_t ncr = 1;
+  /** ACMD41 polls before the card leaves the idle state. */
+  uint8_t initPolls = 2;
+  /** Read access time before each data token. */
+  uint32_t readMicros = 100;
+  /** Programming time for each written sector. */
+  uint32_t writeMicros = 250;
+  /** Extra programming time for SD_FAULT_WRITE_SLOW. */
+  uint32_t slowWriteMicros = 100000;
+  /** Busy time after a stop transmission token or CMD12. */
+  uint32_t stopMicros = 20;
+  /** Erase time. */
+  uint32_t eraseMicros = 2000;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class SdCardModel
+ * \brief Byte level model of an SDHC card in SPI mode.
+ *
+ * The model is an external SPI driver for SPI_DRIVER_SELECT == 3 so
+ * SdSpiCard runs its full protocol against it on a host.  Sectors are
+ * stored on another block device such as FsRamDisk.  Every byte clocked
+ * is counted by kind and converts to bus time at the current SCK rate.
+ *
+ * Chip select is tracked through sdCsHook in SdFatHost.h.
+ */
+class SdCardModel : public SdSpiBaseClass {
+ public:
+  /** Attach the model to storage.
+   *
+   * \param[in] media Storage for card sectors.  The card capacity is
+   *                  sectorCount() rounded down to a multiple of 1024.
+   * \return true for success or false for failure.
+   */
+  bool attach(FsBlockDeviceInterface* media);
+  /** Initialize the SPI bus. \param[in] config SPI configuration. */
+  void begin(SdSpiConfig config) override;
+  /** \return bus time in microseconds for all bytes clocked. */
+  uint64_t busMicros() const { return m_busNanos / 1000; }
+  /** \return Number of bytes of a kind. \param[in] kind Byte kind. */
+  uint64_t byteCount(uint8_t kind) const { return m_bytes[kind]; }
+  /** \return Number of commands received. \param[in] cmd Command index. */
+  uint32_t cmdCount(uint8_t cmd) const { return m_cmdCount[cmd & 0X3F]; }
+  /** Set chip select level.
+   * \param[in] level Chip select level, false selects the card.
+   */
+  void csWrite(bool level) { m_selected = !level; }
+  /**
+   * Inject a fault.
+   *
+   * \param[in] fault Fault from SdModelFault.
+   * \param[in] sector Sector that triggers the fault or 0XFFFFFFFF
+   *                   for any sector.
+   * \param[in] count Number of times the fault is triggered.
+   */
+  void injectFault(uint8_t fault, Sector_t sector, uint16_t count = 1) {
+    m_fault = fault;
+    m_faultSector = sector;
+    m_faultCount = count;
+  }
+  /** Receive a byte. \return The byte. */
+  uint8_t receive() override { return clock(0XFF); }
+  /** Receive multiple bytes.
+   *
+   * \param[out] buf Buffer to receive the data.
+   * \param[in] count Number of bytes to receive.
+   * \return Zero for no error.
+   */
+  uint8_t receive(uint8_t* buf, size_t count) override;
+  /** Reset byte and command counts. */
+  void resetStats();
+  /** \return Sectors read by the host. */
+  uint32_t sectorsRead() const { return m_sectorsRead; }
+  /** \return Sectors written by the host. */
+  uint32_t sectorsWritten() const { return m_sectorsWritten; }
+  /** Send a byte. \param[in] data Byte to send. */
+  void send(uint8_t data) override { clock(data); }
+  /** Send multiple bytes.
+   *
+   * \param[in] buf Buffer for data to be sent.
+   * \param[in] count Number of bytes to send.
+   */
+  void send(const uint8_t* buf, size_t count) override;
+  /** Set the SCK rate. \param[in] maxSck SCK frequency in Hz. */
+  void setSckSpeed(uint32_t maxSck) override;
+  /** \return Card timing that may be changed. */
+  SdModelTiming* timing() { return &m_timing; }
+
+ private:
+  enum State : uint8_t {
+    STATE_IDLE,
+    STATE_READ_MULTI,
+    STATE_WRITE_SINGLE,
+    STATE_WRITE_MULTI,
+    STATE_WRITE_DATA
+  };
+  struct Segment {
+    const uint8_t* data;
+    uint32_t len;
+    uint8_t fill;
+    uint8_t kind;
+  };
+  static const uint8_t SEGMENT_COUNT = 8;
+
+  uint32_t clocks(uint32_t us) const;
+  uint8_t clock(uint8_t in);
+  void command();
+  bool faultCheck(uint8_t fault, Sector_t sector);
+  void queue(const uint8_t* data, uint32_t len, uint8_t kind);
+  void queueFill(uint8_t fill, uint32_t len, uint8_t kind);
+  void queueRead(const uint8_t* data, size_t len, Sector_t sector);
+  void queueR1(uint8_t r1, const uint8_t* extra = nullptr, uint8_t n = 0);
+  bool readSector(Sector_t sector);
+  void writeData();
+
+  FsBlockDeviceInterface* m_media = nullptr;
+  SdModelTiming m_timing;
+  Sector_t m_capacity = 0;
+  uint32_t m_sck = 400000;
+  uint64_t m_busNanos = 0;
+  uint64_t m_bytes[SD_MODEL_KIND_COUNT];
+  uint32_t m_cmdCount[64];
+  uint32_t m_sectorsRead = 0;
+  uint32_t m_sectorsWritten = 0;
+
+  Segment m_segment[SEGMENT_COUNT];
+  uint8_t m_segHead = 0;
+  uint8_t m_segCount = 0;
+  uint32_t m_segPos = 0;
+
+  bool m_selected = false;
+  bool m_idle = true;
+  bool m_appCmd = false;
+  bool m_crc = false;
+  uint8_t m_initPolls = 0;
+  State m_state = STATE_IDLE;
+  State m_writeState = STATE_IDLE;
+  Sector_t m_sector = 0;
+  Sector_t m_eraseStart = 0;
+  Sector_t m_eraseEnd = 0;
+
+  uint8_t m_cmd[6];
+  uint8_t m_cmdLen = 0;
+  uint8_t m_rsp[16];
+  uint8_t m_reg[64];
+  // Token, 512 data bytes and CRC.
+  uint8_t m_tx[515];
+  uint8_t m_rx[514];
+  uint16_t m_rxLen = 0;
+  uint8_t m_dataResponse;
+
+  uint8_t m_fault = SD_FAULT_NONE;
+  Sector_t m_faultSector = 0;
+  uint16_t m_faultCount = 0;
+};
@@ -0,0 +1,62 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <time.h>
+
+#include "SdCard/SdSpiCard/SpiDriver/SdSpiDriver.h"
+//------------------------------------------------------------------------------
+HostSerial Serial;
+void (*sdCsHook)(SdCsPin_t pin, bool level) = nullptr;
+//------------------------------------------------------------------------------
+static uint64_t nanos() {
+  static uint64_t start = 0;
+  timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  uint64_t ns = 1000000000ULL * ts.tv_sec + ts.tv_nsec;
+  if (start == 0) {
+    start = ns;
+  }
+  return ns - start;
+}
+//------------------------------------------------------------------------------
+void delay(uint32_t ms) {
+  timespec ts;
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = 1000000L * (ms % 1000);
+  nanosleep(&ts, nullptr);
+}
+//------------------------------------------------------------------------------
+uint32_t micros() { return nanos() / 1000; }
+//------------------------------------------------------------------------------
+uint32_t millis() { return nanos() / 1000000; }
+//------------------------------------------------------------------------------
+// There are no pins on the host.  A model of a card may follow chip
+// select with sdCsHook.
+void sdCsInit(SdCsPin_t pin) { (void)pin; }
+//------------------------------------------------------------------------------
+void sdCsWrite(SdCsPin_t pin, bool level) {
+  if (sdCsHook) {
+    sdCsHook(pin, level);
+  }
+}
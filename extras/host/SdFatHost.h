@@ -0,0 +1,80 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+/**
+ * \file
+ * \brief Minimal Arduino shim for building SdFat on a Linux host.
+ *
+ * The Makefile force includes this file in every translation unit so
+ * library sources compile unchanged with ENABLE_ARDUINO_FEATURES zero.
+ */
+#include <stdint.h>
+#include <stdio.h>
+
+#include "common/PrintBasic.h"
+/** Print base class for RingBuf, BufferedPrint and StreamLogger. */
+typedef PrintBasic Print;
+//------------------------------------------------------------------------------
+/**
+ * \class HostSerial
+ * \brief Print to stdout in place of the Arduino Serial port.
+ */
+class HostSerial : public PrintBasic {
+ public:
+  /** \return true - stdout is always ready. */
+  operator bool() const { return true; }
+  /** Write buffered output. */
+  void flush() override { fflush(stdout); }
+  using PrintBasic::write;
+  /** Write a byte. \param[in] b Byte to write. \return one. */
+  size_t write(uint8_t b) override { return putchar(b) == EOF ? 0 : 1; }
+  /** Write bytes.
+   * \param[in] buffer Data to write.
+   * \param[in] size Number of bytes.
+   * \return Number of bytes written.
+   */
+  size_t write(const uint8_t* buffer, size_t size) override {
+    return fwrite(buffer, 1, size, stdout);
+  }
+};
+/** Standard output for library and example messages. */
+extern HostSerial Serial;
+//------------------------------------------------------------------------------
+/** \return Milliseconds since the program started. */
+uint32_t millis();
+/** \return Microseconds since the program started. */
+uint32_t micros();
+/** Delay for a number of milliseconds. \param[in] ms Milliseconds. */
+void delay(uint32_t ms);
+/** Called by sdCsWrite() if not null so a host SPI driver can track
+ * chip select.
+ */
+extern void (*sdCsHook)(SdCsPin_t pin, bool level);
+/** Nothing to protect on the host. */
+inline void interrupts() {}
+/** Nothing to protect on the host. */
+inline void noInterrupts() {}
+/** Nothing to schedule on the host. */
+inline void yield() {}
@@ -0,0 +1,286 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief Check SegmentLog on disk images.
+ *
+ * Formats a FAT16 and an exFAT image and appends records of varying
+ * size to a ring of four segments until it has wrapped many times.  The
+ * records read back must be the newest records in order, the free
+ * cluster count must not change after begin() and the sector writes for
+ * a rotation must not grow.  A power failure is simulated by a remount
+ * without sync(), a torn state write by overwriting the newest copy, and
+ * the log is reopened after end() and with a new segment count.  State
+ * with an offset inside the segment header must be rejected and segments
+ * beyond a smaller count must be removed.  FsFile is run on exFAT since
+ * the example sketch logs with file_t.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FsImageDevice.h"
+#include "FsLib/FsLib.h"
+#include "SdCard/SdCrc.h"
+#include "SegmentLog.h"
+//------------------------------------------------------------------------------
+/** Image device that counts write commands. */
+class WriteCountDevice : public FsImageDevice {
+ public:
+  bool writeSectors(Sector_t sector, const uint8_t* src, size_t ns) override {
+    writes++;
+    return FsImageDevice::writeSectors(sector, src, ns);
+  }
+  uint32_t writes = 0;
+};
+//------------------------------------------------------------------------------
+static const uint8_t SEG_COUNT = 4;
+static const uint32_t SEG_SIZE = 4096;
+static const uint32_t RECORD_COUNT = 3000;
+static int failCount = 0;
+static WriteCountDevice dev;
+static FatVolume fatVol;
+static ExFatVolume exFatVol;
+static FsVolume fsVol;
+static uint8_t secBuf[512];
+//------------------------------------------------------------------------------
+static void check(bool ok, const char* msg) {
+  if (!ok) {
+    printf("FAIL: %s\n", msg);
+    failCount++;
+  }
+}
+//------------------------------------------------------------------------------
+// Record id is in the first four bytes followed by a pattern.
+static uint16_t makeRecord(uint32_t id, uint8_t* rec) {
+  uint16_t n = 4 + (id * 37) % 300;
+  memcpy(rec, &id, 4);
+  for (uint16_t i = 4; i < n; i++) {
+    rec[i] = id + i;
+  }
+  return n;
+}
+//------------------------------------------------------------------------------
+template <class File>
+static bool append(SegmentLog<File>* log, uint32_t id) {
+  uint8_t rec[400];
+  uint16_t n = makeRecord(id, rec);
+  return log->append(rec, n);
+}
+//------------------------------------------------------------------------------
+// Read all records and check that they are in order and end at last.
+// Return the first id or -1 for an error.
+template <class File>
+static int32_t readAll(SegmentLog<File>* log, int32_t last) {
+  uint8_t rec[400];
+  uint8_t expect[400];
+  int n;
+  int32_t first = -1;
+  int32_t id = -1;
+  check(log->readBegin(), "readBegin");
+  while ((n = log->readNext(rec, sizeof(rec))) > 0) {
+    int32_t k;
+    memcpy(&k, rec, 4);
+    if (first < 0) {
+      first = k;
+    } else if (k != id + 1) {
+      check(false, "record order");
+      return -1;
+    }
+    id = k;
+    if (n != makeRecord(k, expect) || memcmp(rec, expect, n)) {
+      check(false, "record data");
+      return -1;
+    }
+  }
+  check(n == 0, "readNext end");
+  check(id == last, "last record");
+  return first;
+}
+//------------------------------------------------------------------------------
+template <class Vol, class File>
+static void run(Vol* vol, const char* path, uint32_t mib, bool exFat) {
+  bool ok;
+  int32_t first;
+  uint32_t id;
+  int64_t free0;
+  uint32_t writes;
+  uint32_t firstRotate = 0;
+  uint32_t maxRotate = 0;
+  uint32_t rotations = 0;
+  uint32_t synced;
+  File dir;
+  File file;
+  SegmentLog<File>* log;
+  check(dev.create(path, 2048 * mib), "create image");
+  if (exFat) {
+    ExFatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  } else {
+    FatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  }
+  check(ok, "format");
+  check(vol->begin(&dev), "mount");
+  if (failCount) {
+    return;
+  }
+  printf("\n%s %lu MiB\n", exFat ? "exFAT" : vol->fatType() == 16 ? "FAT16"
+                                                                 : "FAT32",
+         (unsigned long)mib);
+  log = new SegmentLog<File>;
+  check(vol->mkdir("/LOG") && dir.open(vol, "/LOG", O_RDONLY), "dir");
+  check(!log->begin(&dir, 1, SEG_SIZE) && !log->begin(&dir, 4, 1000),
+        "bad geometry");
+  check(log->begin(&dir, SEG_COUNT, SEG_SIZE), "begin");
+  check(readAll(log, -1) == -1, "empty");
+  free0 = vol->freeClusterCount();
+
+  // Wrap the ring many times.
+  for (id = 0; id < RECORD_COUNT && !failCount; id++) {
+    uint32_t head = log->head();
+    writes = dev.writes;
+    check(append(log, id), "append");
+    if (log->head() != head) {
+      writes = dev.writes - writes;
+      if (!rotations++) {
+        firstRotate = writes;
+      }
+      maxRotate = writes > maxRotate ? writes : maxRotate;
+    }
+  }
+  check(log->sync(), "sync");
+  printf("%lu rotations, sector writes first %lu max %lu\n",
+         (unsigned long)rotations, (unsigned long)firstRotate,
+         (unsigned long)maxRotate);
+  check(rotations > 10 * SEG_COUNT, "rotations");
+  check(maxRotate <= firstRotate + 2, "rotate writes");
+  check(vol->freeClusterCount() == free0, "no allocation");
+  check(log->head() - log->tail() == SEG_COUNT - 1U, "ring full");
+  first = readAll(log, id - 1);
+  check(first > 0, "oldest dropped");
+
+  // Power failure: records after sync() or the last rotation are lost.
+  synced = id - 1;
+  for (uint8_t i = 0; i < 50; i++) {
+    uint32_t head = log->head();
+    check(append(log, id), "append");
+    if (log->head() != head) {
+      synced = id - 1;
+    }
+    id++;
+  }
+  // Leak the lost log.  Deleting it would close its files, which can't
+  // happen after a power failure.
+  log = new SegmentLog<File>;
+  check(vol->begin(&dev), "remount");
+  dir.close();
+  check(dir.open(vol, "/LOG", O_RDONLY), "dir");
+  check(log->begin(&dir, SEG_COUNT, SEG_SIZE), "begin after failure");
+  readAll(log, synced);
+  for (id = synced + 1; id < synced + 200; id++) {
+    check(append(log, id), "append after failure");
+  }
+  check(log->end(), "end");
+  check(log->begin(&dir, SEG_COUNT, SEG_SIZE), "begin after end");
+  first = readAll(log, id - 1);
+
+  // Discard the oldest segment.
+  check(log->discard() && readAll(log, id - 1) > first, "discard");
+  while (log->discard()) {
+  }
+  check(log->tail() == log->head(), "discard all");
+  check(readAll(log, id - 1) > 0, "head only");
+
+  // Torn write of the newest state copy.  The older copy is from rotate().
+  synced = id - 1;
+  check(log->rotate(), "rotate");
+  for (uint8_t i = 0; i < 10; i++) {
+    check(append(log, id++), "append");
+  }
+  check(log->sync(), "sync");
+  check(log->end(), "end");
+  check(file.open(&dir, "SEGLOG.DAT", O_RDWR), "open state");
+  uint8_t copy[2][32];
+  check(file.read(copy[0], 32) == 32 && file.seekSet(512) &&
+            file.read(copy[1], 32) == 32,
+        "read state");
+  uint32_t gen0;
+  uint32_t gen1;
+  memcpy(&gen0, copy[0] + 4, 4);
+  memcpy(&gen1, copy[1] + 4, 4);
+  copy[0][0] = 0XFF;
+  check(file.seekSet(gen1 > gen0 ? 512 : 0) && file.write(copy[0], 32) == 32 &&
+            file.close(),
+        "tear state");
+  check(log->begin(&dir, SEG_COUNT, SEG_SIZE), "begin after tear");
+  readAll(log, synced);
+  check(append(log, synced + 1) && log->sync(), "append after tear");
+  readAll(log, synced + 1);
+
+  check(log->end(), "end");
+
+  // Both copies of the state with a valid CRC and an offset inside the
+  // segment header.  The log must start over.
+  check(file.open(&dir, "SEGLOG.DAT", O_RDWR), "open state");
+  for (uint32_t pos = 0; pos < 1024; pos += 512) {
+    uint8_t meta[28];
+    uint32_t offset = 4;
+    check(file.seekSet(pos) && file.read(meta, 28) == 28, "read state");
+    memcpy(meta + 20, &offset, 4);
+    uint16_t crc = sdCrc16Nibble(meta, 26);
+    memcpy(meta + 26, &crc, 2);
+    check(file.seekSet(pos) && file.write(meta, 28) == 28, "write state");
+  }
+  check(file.close(), "close state");
+  check(log->begin(&dir, SEG_COUNT, SEG_SIZE), "begin bad offset");
+  check(readAll(log, -1) == -1, "bad offset rejected");
+
+  // New geometry clears the log.
+  check(log->begin(&dir, SEG_COUNT + 1, SEG_SIZE), "begin new count");
+  check(readAll(log, -1) == -1, "new log empty");
+  check(append(log, 0) && readAll(log, 0) == 0, "new log append");
+  check(log->end(), "end");
+  // A smaller count removes the extra segments.
+  check(log->begin(&dir, SEG_COUNT - 1, SEG_SIZE) && log->end(),
+        "begin smaller count");
+  check(dir.exists("SEG02.LOG") && !dir.exists("SEG03.LOG") &&
+            !dir.exists("SEG04.LOG"),
+        "stale segments");
+  delete log;
+  dir.close();
+  dev.end();
+}
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  const char* path = argc > 1 ? argv[1] : "SegmentLogTest.img";
+  run<FatVolume, FatFile>(&fatVol, path, 256, false);
+  run<ExFatVolume, ExFatFile>(&exFatVol, path, 1024, true);
+  run<FsVolume, FsFile>(&fsVol, path, 1024, true);
+  unlink(path);
+  printf(failCount ? "%d FAILURES\n" : "\nALL OK\n", failCount);
+  return failCount ? 1 : 0;
+}
@@ -0,0 +1,224 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief Check generated short names on FAT images.
+ *
+ * Formats a FAT16 image and creates a few thousand files in a
+ * subdirectory with long names that share a prefix so each needs a
+ * generated ~HHHH short name.  Short names must be unique and every file
+ * must open by its long and short name.  Sector reads per create are
+ * reported for the first and last files.  Build with SFN_TAIL_MAP_SIZE
+ * nonzero to use the tail map and with USE_CREATE_NEW nonzero to also
+ * create files with createNew().
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FatLib/FatLib.h"
+#include "FsImageDevice.h"
+static int failCount = 0;
+#if USE_LONG_FILE_NAMES
+//------------------------------------------------------------------------------
+/** Image device that counts read commands. */
+class ReadCountDevice : public FsImageDevice {
+ public:
+  bool readSectors(Sector_t sector, uint8_t* dst, size_t ns) override {
+    reads++;
+    return FsImageDevice::readSectors(sector, dst, ns);
+  }
+  uint32_t reads = 0;
+};
+//------------------------------------------------------------------------------
+static const uint16_t FILE_COUNT = 2000;
+static const uint16_t SAMPLE_COUNT = 100;
+static ReadCountDevice dev;
+static FatVolume vol;
+static bool exists[FILE_COUNT];
+// Files hold the name of the file when created.
+static uint16_t content[FILE_COUNT];
+static char sfn[FILE_COUNT][13];
+static uint8_t secBuf[512];
+//------------------------------------------------------------------------------
+static void check(bool ok, const char* msg) {
+  if (!ok) {
+    printf("FAIL: %s\n", msg);
+    failCount++;
+  }
+}
+//------------------------------------------------------------------------------
+// Most names share a prefix, every fifth has another prefix.
+static void makeName(char* name, uint16_t i) {
+  sprintf(name, i % 5 ? "sensor_%06u.csv" : "sensor log %06u.txt", i);
+}
+//------------------------------------------------------------------------------
+static bool create(FatFile* dir, uint16_t i, bool createNew) {
+  char name[40];
+  FatFile file;
+  makeName(name, i);
+#if USE_CREATE_NEW
+  bool ok = createNew ? file.createNew(dir, name)
+                      : file.open(dir, name, O_WRONLY | O_CREAT | O_EXCL);
+#else   // USE_CREATE_NEW
+  (void)createNew;
+  bool ok = file.open(dir, name, O_WRONLY | O_CREAT | O_EXCL);
+#endif  // USE_CREATE_NEW
+  if (!ok || file.write(name, strlen(name)) != strlen(name) ||
+      !file.close()) {
+    return false;
+  }
+  exists[i] = true;
+  content[i] = i;
+  return true;
+}
+//------------------------------------------------------------------------------
+static double createRun(FatFile* dir, uint16_t first, uint16_t last,
+                        bool createNew) {
+  uint32_t reads = dev.reads;
+  uint16_t n = 0;
+  for (uint16_t i = first; i < last && !failCount; i++) {
+    if (!exists[i]) {
+      check(create(dir, i, createNew), "create");
+      n++;
+    }
+  }
+  return n ? (double)(dev.reads - reads) / n : 0;
+}
+//------------------------------------------------------------------------------
+// Check names, content and unique short names.
+static void verify(const char* step) {
+  char name[40];
+  char data[40];
+  uint16_t n = 0;
+  FatFile dir;
+  FatFile file;
+  check(dir.open(&vol, "/data", O_RDONLY), "open dir");
+  for (uint16_t i = 0; i < FILE_COUNT && !failCount; i++) {
+    makeName(name, i);
+    bool found = file.open(&dir, name, O_RDONLY);
+    if (found != exists[i]) {
+      printf("%s: %s %s\n", step, name, found ? "found" : "missing");
+      check(false, "verify open");
+      break;
+    }
+    if (found) {
+      int k = file.read(data, sizeof(data));
+      makeName(name, content[i]);
+      check(k == (int)strlen(name) && !memcmp(data, name, k), "verify data");
+      file.close();
+    }
+  }
+  dir.rewind();
+  while (n < FILE_COUNT && file.openNext(&dir, O_RDONLY)) {
+    file.getSFN(sfn[n++], sizeof(sfn[0]));
+    file.close();
+  }
+  for (uint16_t i = 0; i < n && !failCount; i++) {
+    for (uint16_t k = i + 1; k < n; k++) {
+      if (!strcmp(sfn[i], sfn[k])) {
+        printf("%s: duplicate SFN %s\n", step, sfn[i]);
+        check(false, "unique SFN");
+        break;
+      }
+    }
+  }
+  // Open files by short name.
+  for (uint16_t i = 0; i < n && !failCount; i += 37) {
+    check(file.open(&dir, sfn[i], O_RDONLY), "open SFN");
+    file.close();
+  }
+}
+//------------------------------------------------------------------------------
+static void run(const char* path, uint32_t mib) {
+  char name[40];
+  FatFile dir;
+  FatFile file;
+  FatFormatter fmt;
+  uint16_t i;
+  check(dev.create(path, 2048 * mib), "create image");
+  check(fmt.format(&dev, secBuf), "format");
+  check(vol.begin(&dev), "mount");
+  check(vol.mkdir("/data"), "mkdir");
+  check(dir.open(&vol, "/data", O_RDONLY), "open dir");
+  if (failCount) {
+    return;
+  }
+  printf("\nFAT%u %lu MiB\n", vol.fatType(), (unsigned long)mib);
+  memset(exists, 0, sizeof(exists));
+  const uint16_t half = FILE_COUNT / 2;
+  double first = createRun(&dir, 0, SAMPLE_COUNT, false);
+  createRun(&dir, SAMPLE_COUNT, half - SAMPLE_COUNT, false);
+  double last = createRun(&dir, half - SAMPLE_COUNT, half, false);
+  printf("%-12s %8.1f reads/create\n", "first", first);
+  printf("%-12s %8.1f reads/create\n", "last", last);
+  verify("open");
+
+  // Remove and rename files.  Renames create entries with generated names.
+  for (i = 0; i < half && !failCount; i += 7) {
+    makeName(name, i);
+    check(file.open(&dir, name, O_WRONLY) && file.remove(), "remove");
+    exists[i] = false;
+  }
+  for (i = 3; i < half && !failCount; i += 7) {
+    char newName[40];
+    makeName(name, i);
+    makeName(newName, half + i);
+    check(file.open(&dir, name, O_WRONLY) && file.rename(&dir, newName) &&
+              file.close(),
+          "rename");
+    exists[i] = false;
+    exists[half + i] = true;
+    content[half + i] = i;
+  }
+  // Remount so the map is built again.
+  dir.close();
+  check(vol.begin(&dev), "remount");
+  check(dir.open(&vol, "/data", O_RDONLY), "open dir");
+  for (i = half; i < FILE_COUNT - SAMPLE_COUNT && !failCount; i++) {
+    if (!exists[i]) {
+      check(create(&dir, i, true), "create trusted");
+    }
+  }
+  last = createRun(&dir, FILE_COUNT - SAMPLE_COUNT, FILE_COUNT, true);
+  printf("%-12s %8.1f reads/create\n", USE_CREATE_NEW ? "createNew" : "last",
+         last);
+  verify("remount");
+  dev.end();
+}
+#endif  // USE_LONG_FILE_NAMES
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  const char* path = argc > 1 ? argv[1] : "SfnTailTest.img";
+  printf("SFN_TAIL_MAP_SIZE %d\n", SFN_TAIL_MAP_SIZE);
+  (void)path;
+#if USE_LONG_FILE_NAMES
+  run(path, 256);
+  unlink(path);
+#endif  // USE_LONG_FILE_NAMES
+  printf(failCount ? "%d FAILURES\n" : "\nALL OK\n", failCount);
+  return failCount ? 1 : 0;
+}
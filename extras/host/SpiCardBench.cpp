@@ -0,0 +1,296 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief Measure SdSpiCard protocol overhead on a model of an SD card.
+ *
+ * Reports the bytes clocked per sector by kind for single and multiple
+ * sector transfers in shared and dedicated SPI mode, checks data read
+ * back, and checks that injected card faults are reported.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FsLib/FsLib.h"
+#include "SdCardModel.h"
+#include "common/FsRamDisk.h"
+//------------------------------------------------------------------------------
+// 64 MiB card.
+static const Sector_t CARD_SECTORS = 131072;
+static FsRamDisk ram;
+static SdCardModel model;
+static SdSpiCard card;
+static uint8_t buf[64 * 512];
+static int failCount = 0;
+#if ENABLE_DEDICATED_SPI
+static const uint8_t SPI_MODES = 2;
+#else   // ENABLE_DEDICATED_SPI
+static const uint8_t SPI_MODES = 1;
+const uint8_t DEDICATED_SPI = SHARED_SPI;
+#endif  // ENABLE_DEDICATED_SPI
+//------------------------------------------------------------------------------
+static void check(bool ok, const char* msg) {
+  if (!ok) {
+    printf("FAIL: %s error 0X%02X data 0X%02lX\n", msg, card.errorCode(),
+           (unsigned long)card.errorData());
+    failCount++;
+  }
+}
+//------------------------------------------------------------------------------
+static void header() {
+  printf(
+      "%-14s %7s %8s %6s %6s %6s %6s %6s %6s %6s %8s\n", "test", "sectors",
+      "bytes", "cmd", "rsp", "token", "wait", "busy", "idle", "desel",
+      "KB/s");
+}
+//------------------------------------------------------------------------------
+static void report(const char* name, uint32_t sectors) {
+  uint64_t total = 0;
+  for (uint8_t i = 0; i < SD_MODEL_KIND_COUNT; i++) {
+    total += model.byteCount(i);
+  }
+  double n = sectors;
+  uint64_t us = model.busMicros();
+  printf("%-14s %7lu %8.1f %6.1f %6.1f %6.1f %6.1f %6.1f %6.1f %6.1f %8.0f\n",
+         name, (unsigned long)sectors, total / n,
+         model.byteCount(SD_MODEL_CMD) / n,
+         model.byteCount(SD_MODEL_RESPONSE) / n,
+         model.byteCount(SD_MODEL_TOKEN) / n,
+         model.byteCount(SD_MODEL_WAIT) / n,
+         model.byteCount(SD_MODEL_BUSY) / n,
+         model.byteCount(SD_MODEL_IDLE) / n,
+         model.byteCount(SD_MODEL_DESELECT) / n,
+         us ? 500000.0 * sectors / us : 0.0);
+}
+//------------------------------------------------------------------------------
+static void fill(uint8_t* dst, Sector_t sector, size_t ns) {
+  for (size_t i = 0; i < 512 * ns; i++) {
+    dst[i] = (sector + i / 512) * 7 + i;
+  }
+}
+//------------------------------------------------------------------------------
+static bool verify(const uint8_t* src, Sector_t sector, size_t ns) {
+  for (size_t i = 0; i < 512 * ns; i++) {
+    if (src[i] != static_cast<uint8_t>((sector + i / 512) * 7 + i)) {
+      return false;
+    }
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+static void transfers(bool dedicated) {
+  const uint32_t N = 256;
+  const char* mode = dedicated ? "ded" : "shr";
+  char name[24];
+  check(card.setDedicatedSpi(dedicated) || !ENABLE_DEDICATED_SPI,
+        "setDedicatedSpi");
+
+  snprintf(name, sizeof(name), "write1 %s", mode);
+  model.resetStats();
+  for (uint32_t i = 0; i < N; i++) {
+    fill(buf, i, 1);
+    check(card.writeSector(i, buf), "writeSector");
+  }
+  check(card.syncDevice(), "syncDevice");
+  report(name, N);
+
+  snprintf(name, sizeof(name), "read1 %s", mode);
+  model.resetStats();
+  for (uint32_t i = 0; i < N; i++) {
+    check(card.readSector(i, buf) && verify(buf, i, 1), "readSector");
+  }
+  check(card.syncDevice(), "syncDevice");
+  report(name, N);
+
+  for (size_t ns = 8; ns <= 64; ns *= 8) {
+    snprintf(name, sizeof(name), "write%zu %s", ns, mode);
+    model.resetStats();
+    for (uint32_t s = 1024; s < 1024 + 8 * N; s += ns) {
+      fill(buf, s, ns);
+      check(card.writeSectors(s, buf, ns), "writeSectors");
+    }
+    check(card.syncDevice(), "syncDevice");
+    report(name, 8 * N);
+
+    snprintf(name, sizeof(name), "read%zu %s", ns, mode);
+    model.resetStats();
+    for (uint32_t s = 1024; s < 1024 + 8 * N; s += ns) {
+      check(card.readSectors(s, buf, ns) && verify(buf, s, ns),
+            "readSectors");
+    }
+    check(card.syncDevice(), "syncDevice");
+    report(name, 8 * N);
+  }
+  snprintf(name, sizeof(name), "readRand %s", mode);
+  model.resetStats();
+  for (uint32_t i = 0; i < N; i++) {
+    Sector_t s = 1024 + (i * 97) % (8 * N);
+    check(card.readSector(s, buf) && verify(buf, s, 1), "random read");
+  }
+  check(card.syncDevice(), "syncDevice");
+  report(name, N);
+}
+//------------------------------------------------------------------------------
+static void faults() {
+  struct {
+    uint8_t fault;
+    bool write;
+    const char* name;
+  } const tests[] = {{SD_FAULT_NO_RESPONSE, false, "no response read"},
+                     {SD_FAULT_NO_RESPONSE, true, "no response write"},
+                     {SD_FAULT_READ_TOKEN, false, "read error token"},
+                     {SD_FAULT_READ_CRC, false, "read CRC"},
+                     {SD_FAULT_WRITE_REJECT, true, "write reject"}};
+  for (uint8_t pass = 0; pass < SPI_MODES; pass++) {
+    bool dedicated = pass;
+    card.setDedicatedSpi(dedicated);
+    for (const auto& t : tests) {
+      bool ok;
+      char msg[64];
+      Sector_t s = 2000;
+      // Commands address the first sector of a transfer.
+      model.injectFault(t.fault,
+                        t.fault == SD_FAULT_NO_RESPONSE ? s : s + 2);
+      fill(buf, s, 4);
+      ok = t.write ? card.writeSectors(s, buf, 4) && card.syncDevice()
+                   : card.readSectors(s, buf, 4) && card.syncDevice();
+      if (t.fault == SD_FAULT_READ_CRC && !USE_SD_CRC) {
+        // CRC is not checked by the driver.
+        ok = !ok;
+      }
+      snprintf(msg, sizeof(msg), "%s %s not reported", t.name,
+               dedicated ? "ded" : "shr");
+      if (ok) {
+        printf("FAIL: %s\n", msg);
+        failCount++;
+      }
+      // The driver must recover for the next transfer.
+      model.injectFault(SD_FAULT_NONE, 0, 0);
+      card.syncDevice();
+      fill(buf, s, 4);
+      snprintf(msg, sizeof(msg), "%s %s recovery", t.name,
+               dedicated ? "ded" : "shr");
+      check(card.writeSectors(s, buf, 4) && card.syncDevice() &&
+                card.readSectors(s, buf, 4) && verify(buf, s, 4),
+            msg);
+    }
+  }
+  // A slow sector adds busy polls but must not fail.
+  model.resetStats();
+  model.injectFault(SD_FAULT_WRITE_SLOW, 3000);
+  check(card.writeSectors(3000, buf, 4) && card.syncDevice(), "slow write");
+  printf("slow write busy bytes: %llu\n",
+         (unsigned long long)model.byteCount(SD_MODEL_BUSY));
+}
+//------------------------------------------------------------------------------
+static void files() {
+  FatFormatter fmt;
+  FsVolume vol;
+  FsFile file;
+  check(fmt.format(&card, buf), "format");
+  check(vol.begin(&card), "mount");
+  check(file.open(&vol, "seq.bin", O_RDWR | O_CREAT | O_TRUNC), "open");
+  fill(buf, 0, 8);
+  model.resetStats();
+  for (int i = 0; i < 256; i++) {
+    check(file.write(buf, 4096) == 4096, "file write");
+  }
+  check(file.sync(), "file sync");
+  report("file write4k", 2048);
+  file.rewind();
+  model.resetStats();
+  for (int i = 0; i < 256; i++) {
+    check(file.read(buf, 4096) == 4096 && verify(buf, 0, 8), "file read");
+  }
+  report("file read4k", 2048);
+  file.close();
+
+  // A rejected erase hint must not leave a card error.
+  uint8_t errorCode = card.errorCode();
+  uint32_t sector;
+  model.injectFault(SD_FAULT_ERASE_REJECT, 0XFFFFFFFF);
+  check(file.open(&vol, "pre.bin", O_RDWR | O_CREAT) &&
+            file.preAllocate(1 << 20, true),
+        "erase hint");
+  check(card.errorCode() == errorCode, "erase hint error code");
+  sector = file.firstSector();
+  file.close();
+  // The hint used the fault so this erase succeeds.
+  check(card.erase(sector, sector), "erase");
+  model.injectFault(SD_FAULT_ERASE_REJECT, 0XFFFFFFFF);
+  check(!card.erase(sector, sector) &&
+            card.errorCode() == SD_CARD_ERROR_ERASE,
+        "erase error");
+}
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  uint32_t mhz = 25;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:r:w:")) != -1) {
+    switch (opt) {
+      case 's':
+        mhz = atol(optarg);
+        break;
+      case 'r':
+        model.timing()->readMicros = atol(optarg);
+        break;
+      case 'w':
+        model.timing()->writeMicros = atol(optarg);
+        break;
+      default:
+        fprintf(stderr,
+                "usage: SpiCardBench [-s SCK_MHZ] [-r READ_US] "
+                "[-w WRITE_US]\n");
+        return 2;
+    }
+  }
+  uint8_t* mem = static_cast<uint8_t*>(calloc(CARD_SECTORS, 512));
+  if (!mem || !ram.begin(mem, CARD_SECTORS) || !model.attach(&ram)) {
+    fprintf(stderr, "RAM disk allocation failed\n");
+    return 1;
+  }
+  sdCsHook = [](SdCsPin_t, bool level) { model.csWrite(level); };
+  if (!card.begin(SdSpiConfig(0, DEDICATED_SPI, SD_SCK_MHZ(mhz), &model))) {
+    printf("FAIL: begin error 0X%02X\n", card.errorCode());
+    return 1;
+  }
+  printf("SCK %lu MHz, read %lu us, write %lu us, USE_SD_CRC %d\n",
+         (unsigned long)mhz, (unsigned long)model.timing()->readMicros,
+         (unsigned long)model.timing()->writeMicros, USE_SD_CRC);
+  printf("init bytes %llu, sectorCount %lu\n",
+         (unsigned long long)model.byteCount(SD_MODEL_CMD) +
+             model.byteCount(SD_MODEL_RESPONSE),
+         (unsigned long)card.sectorCount());
+  header();
+  for (uint8_t pass = 0; pass < SPI_MODES; pass++) {
+    transfers(pass);
+  }
+  files();
+  faults();
+  printf(failCount ? "%d FAILURES\n" : "ALL OK\n", failCount);
+  return failCount ? 1 : 0;
+}
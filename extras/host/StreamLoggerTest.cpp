@@ -0,0 +1,165 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief Check StreamLogger on disk images.
+ *
+ * Formats a FAT16 and an exFAT image and logs records of varying size to
+ * a preallocated file, calling task() after every few records, until the
+ * file is full.  Each task() must write whole sectors with at most two
+ * writes.  A record too large for the ring is dropped and counted.  After
+ * end() the file size must equal the bytes logged and the data must read
+ * back after a remount.  FAT files must reject 4 GiB, so FsFile is run on
+ * FAT16.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FsImageDevice.h"
+#include "FsLib/FsLib.h"
+#include "StreamLogger.h"
+//------------------------------------------------------------------------------
+/** Image device that counts write commands. */
+class WriteCountDevice : public FsImageDevice {
+ public:
+  bool writeSectors(Sector_t sector, const uint8_t* src, size_t ns) override {
+    writes++;
+    return FsImageDevice::writeSectors(sector, src, ns);
+  }
+  uint32_t writes = 0;
+};
+//------------------------------------------------------------------------------
+static const size_t SECTOR_COUNT = 8;
+static const uint64_t MAX_SIZE = 300000;
+static int failCount = 0;
+static WriteCountDevice dev;
+static FatVolume fatVol;
+static ExFatVolume exFatVol;
+static FsVolume fsVol;
+static uint8_t secBuf[512];
+//------------------------------------------------------------------------------
+static void check(bool ok, const char* msg) {
+  if (!ok) {
+    printf("FAIL: %s\n", msg);
+    failCount++;
+  }
+}
+//------------------------------------------------------------------------------
+static uint8_t pattern(uint64_t pos) { return pos ^ (pos >> 8) ^ (pos >> 16); }
+//------------------------------------------------------------------------------
+template <class Vol, class File>
+static void run(Vol* vol, const char* path, uint32_t mib, bool exFat) {
+  bool ok;
+  uint8_t rec[StreamLogger<File, SECTOR_COUNT>::BUF_SIZE + 1];
+  uint64_t logged = 0;
+  uint32_t maxTaskWrites = 0;
+  int fails = failCount;
+  File file;
+  StreamLogger<File, SECTOR_COUNT> logger;
+  check(dev.create(path, 2048 * mib), "create image");
+  if (exFat) {
+    ExFatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  } else {
+    FatFormatter fmt;
+    ok = fmt.format(&dev, secBuf);
+  }
+  check(ok, "format");
+  check(vol->begin(&dev), "mount");
+  if (failCount != fails) {
+    return;
+  }
+  printf("\n%s %lu MiB\n", exFat ? "exFAT" : vol->fatType() == 16 ? "FAT16"
+                                                                 : "FAT32",
+         (unsigned long)mib);
+  check(file.open(vol, "LOG.BIN", O_RDWR | O_CREAT | O_TRUNC), "open");
+  if (!exFat) {
+    // Would be 512 bytes if the size was truncated to 32 bits.
+    check(!logger.begin(&file, (1ULL << 32) + 512), "4 GiB FAT file");
+    check(file.fileSize() == 0 && !file.contiguousRange(nullptr, nullptr),
+          "no allocation");
+  }
+  check(logger.begin(&file, MAX_SIZE) && file.contiguousRange(nullptr, nullptr),
+        "begin");
+  for (uint32_t i = 0; !logger.isFull() && failCount == fails; i++) {
+    size_t n = 1 + (i * 37) % 250;
+    for (size_t k = 0; k < n; k++) {
+      rec[k] = pattern(logged + k);
+    }
+    check(logger.write(rec, n) == n, "write");
+    logged += n;
+    if (i % 3 == 0) {
+      uint32_t writes = dev.writes;
+      uint64_t before = logger.bytesWritten();
+      // False once less than a sector of room is left.
+      check(logger.task() || MAX_SIZE - logger.bytesWritten() < 512, "task");
+      writes = dev.writes - writes;
+      maxTaskWrites = writes > maxTaskWrites ? writes : maxTaskWrites;
+      check((logger.bytesWritten() - before) % 512 == 0, "whole sectors");
+    }
+    if (i == 100) {
+      // Too large for free space in the ring.
+      check(logger.write(rec, logger.bytesFree() + 1) == 0 &&
+                logger.overrunCount() == 1,
+            "overrun");
+    }
+  }
+  printf("%lu bytes, %lu task writes, max %lu device writes per task\n",
+         (unsigned long)logged, (unsigned long)logger.writeCount(),
+         (unsigned long)maxTaskWrites);
+  check(maxTaskWrites <= 2, "task writes");
+  check(logger.maxBytesUsed() <= logger.BUF_SIZE, "maxBytesUsed");
+  check(logger.end() && logger.bytesWritten() == logged, "end");
+  check(file.fileSize() == logged, "file size");
+  check(file.close(), "close");
+
+  // Check data after a remount.
+  check(vol->begin(&dev) && file.open(vol, "LOG.BIN", O_RDONLY), "reopen");
+  for (uint64_t pos = 0; pos < logged && failCount == fails;) {
+    int n = file.read(rec, sizeof(rec));
+    check(n > 0, "read");
+    for (int k = 0; k < n; k++) {
+      if (rec[k] != pattern(pos + k)) {
+        check(false, "data");
+        break;
+      }
+    }
+    pos += n;
+  }
+  file.close();
+  dev.end();
+}
+//------------------------------------------------------------------------------
+int main(int argc, char* argv[]) {
+  const char* path = argc > 1 ? argv[1] : "StreamLoggerTest.img";
+  run<FatVolume, FatFile>(&fatVol, path, 256, false);
+  run<ExFatVolume, ExFatFile>(&exFatVol, path, 1024, true);
+  run<FsVolume, FsFile>(&fsVol, path, 256, false);
+  unlink(path);
+  printf(failCount ? "%d FAILURES\n" : "\nALL OK\n", failCount);
+  return failCount ? 1 : 0;
+}
@@ -41,6 +41,125 @@ inline bool lfnLegalChar(uint8_t c) {
 #endif  // USE_UTF8_LONG_NAMES
 }
 //------------------------------------------------------------------------------
+#if USE_ASYNC_IO
+// Queue a transfer of whole sectors at the current position.
+int ExFatFile::asyncIo(FsIoRequest* req, uint8_t op, uint8_t* buf,
+                       size_t count) {
+  uint32_t ns;
+  uint32_t sectorOfCluster;
+  if (!isFile() || req->isPending()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (op == FS_IO_WRITE) {
+    if (!isWritable() || EXFAT_READ_ONLY) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if ((m_flags & FILE_FLAG_APPEND) && !seekSet(m_dataLength)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (m_curPosition > m_validLength) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  } else {
+    if (!isReadable()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (m_curPosition >= m_validLength) {
+      count = 0;
+    } else if (count > (m_validLength - m_curPosition)) {
+      count = m_validLength - m_curPosition;
+    }
+  }
+  if (m_curPosition & m_vol->sectorMask()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  ns = count >> m_vol->bytesPerSectorShift();
+  if (ns == 0) {
+    return 0;
+  }
+  sectorOfCluster = (m_curPosition & m_vol->clusterMask()) >>
+                    m_vol->bytesPerSectorShift();
+  if (sectorOfCluster == 0) {
+    // start of new cluster
+    int8_t fg = 1;
+    if (m_curCluster == 0) {
+      m_curCluster = m_firstCluster;
+      fg = m_curCluster != 0;
+    } else if (isContiguous()) {
+      Cluster_t lc = m_firstCluster;
+      lc += (m_dataLength - 1) >> m_vol->bytesPerClusterShift();
+      if (m_curCluster < lc) {
+        m_curCluster++;
+      } else {
+        fg = 0;
+      }
+    } else {
+      fg = m_vol->fatGet(m_curCluster, &m_curCluster);
+      if (fg < 0) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+    }
+    if (fg == 0) {
+#if !EXFAT_READ_ONLY
+      if (op == FS_IO_WRITE && addCluster()) {
+        if (m_firstCluster == 0) {
+          m_firstCluster = m_curCluster;
+        }
+      } else {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+#else   // !EXFAT_READ_ONLY
+      DBG_FAIL_MACRO;
+      goto fail;
+#endif  // !EXFAT_READ_ONLY
+    }
+#if FS_EXTENT_COUNT
+    m_extentMap.add(m_curPosition >> m_vol->bytesPerClusterShift(),
+                    m_curCluster);
+#endif  // FS_EXTENT_COUNT
+  }
+  req->sector = m_vol->clusterStartSector(m_curCluster) + sectorOfCluster;
+  if (!clusterRun(sectorOfCluster, &ns, op == FS_IO_WRITE)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  req->data = buf;
+  req->count = ns;
+  req->op = op;
+  if (!m_vol->cacheSafeSubmit(req)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  count = ns << m_vol->bytesPerSectorShift();
+  m_curPosition += count;
+  if (op == FS_IO_WRITE) {
+    if (m_curPosition > m_validLength) {
+      m_validLength = m_curPosition;
+      m_flags |= FILE_FLAG_DIR_DIRTY;
+    }
+    if (m_curPosition > m_dataLength) {
+      m_dataLength = m_curPosition;
+      m_flags |= FILE_FLAG_DIR_DIRTY;
+    } else if (FsDateTime::callback) {
+      m_flags |= FILE_FLAG_DIR_DIRTY;
+    }
+  }
+  return count;
+
+fail:
+  m_error |= op == FS_IO_WRITE ? WRITE_ERROR : READ_ERROR;
+  return -1;
+}
+#endif  // USE_ASYNC_IO
+//------------------------------------------------------------------------------
 bool ExFatFile::attrib(uint8_t bits) {
   if (!isFileOrSubDir() || (bits & FS_ATTRIB_USER_SETTABLE) != bits) {
     DBG_FAIL_MACRO;
@@ -63,6 +182,150 @@ bool ExFatFile::attrib(uint8_t bits) {
 fail:
   return false;
 }
+#if USE_AU_ALLOCATION
+//------------------------------------------------------------------------------
+uint32_t ExFatFile::auCount() {
+  uint32_t n = 0;
+  uint32_t au = 0;
+  Cluster_t cluster = m_firstCluster;
+  if (!isOpen() || m_vol->auClusters() == 0) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (isContiguous()) {
+    if (!m_firstCluster || !m_dataLength) {
+      return 0;
+    }
+    Cluster_t last = m_firstCluster +
+                     ((m_dataLength - 1) >> m_vol->bytesPerClusterShift());
+    return m_vol->auIndex(last) - m_vol->auIndex(m_firstCluster) + 1;
+  }
+  while (cluster) {
+    if (n == 0 || m_vol->auIndex(cluster) != au) {
+      au = m_vol->auIndex(cluster);
+      n++;
+    }
+    int8_t fg = m_vol->fatGet(cluster, &cluster);
+    if (fg < 0) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (fg == 0) {
+      break;
+    }
+  }
+  return n;
+
+fail:
+  return 0;
+}
+#endif  // USE_AU_ALLOCATION
+//------------------------------------------------------------------------------
+uint8_t* ExFatFile::borrow(size_t* count, bool write) {
+  uint64_t n;
+  uint16_t sectorOffset;
+  uint32_t clusterOffset;
+  Cluster_t cluster = m_curCluster;
+  Sector_t sector;
+  uint8_t* pc;
+  *count = 0;
+  if (!isFile() || !(write ? isWritable() : isReadable())) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (m_curPosition >= m_validLength) {
+    // EOF or no data on the device.
+    return nullptr;
+  }
+  n = m_validLength - m_curPosition;
+  clusterOffset = m_curPosition & m_vol->clusterMask();
+  sectorOffset = clusterOffset & m_vol->sectorMask();
+  if (clusterOffset == 0) {
+    // m_curCluster is advanced by read() or seekSet() so just look ahead.
+    if (m_curPosition == 0) {
+      cluster = m_firstCluster;
+    } else if (isContiguous()) {
+      cluster++;
+    } else if (m_vol->fatGet(m_curCluster, &cluster) <= 0) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+  sector = m_vol->clusterStartSector(cluster) +
+           (clusterOffset >> m_vol->bytesPerSectorShift());
+  pc = m_vol->dataCachePrepare(sector, FsCache::CACHE_FOR_READ);
+  if (!pc) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (n > static_cast<uint64_t>(m_vol->bytesPerSector() - sectorOffset)) {
+    n = m_vol->bytesPerSector() - sectorOffset;
+  }
+  *count = n;
+  return pc + sectorOffset;
+
+fail:
+  return nullptr;
+}
+#if USE_DIR_INDEX
+//------------------------------------------------------------------------------
+// Index all file sets in the directory by the stream entry name hash.
+bool ExFatFile::buildDirIndex(FsDirIndex* index) {
+  int n;
+  uint8_t buf[FS_DIR_SIZE];
+  uint8_t count = 0;
+  uint32_t curIndex;
+  uint32_t first = 0;
+  uint32_t freeIndex = 0;
+  uint32_t freeFound = 0;
+  uint16_t hash;
+
+  index->buildBegin();
+  rewind();
+  while (1) {
+    curIndex = m_curPosition / FS_DIR_SIZE;
+    n = read(buf, FS_DIR_SIZE);
+    if (n == 0) {
+      break;
+    }
+    if (n != FS_DIR_SIZE) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (!(buf[0] & EXFAT_TYPE_USED)) {
+      if (buf[0] == EXFAT_TYPE_END_DIR) {
+        break;
+      }
+      if (freeFound == 0) {
+        freeIndex = curIndex;
+      }
+      freeFound++;
+      count = 0;
+      continue;
+    }
+    if (freeFound) {
+      index->addFree(freeIndex, freeFound);
+      freeFound = 0;
+    }
+    if (buf[0] == EXFAT_TYPE_FILE) {
+      first = curIndex;
+      count = reinterpret_cast<DirFile_t*>(buf)->setCount + 1;
+    } else if (buf[0] == EXFAT_TYPE_STREAM && count && curIndex == first + 1) {
+      hash = getLe16(reinterpret_cast<DirStream_t*>(buf)->nameHash);
+      index->add(first, count, hash, hash);
+    }
+  }
+  index->buildEnd(curIndex);
+  if (freeFound) {
+    index->addFree(freeIndex, freeFound);
+  }
+  m_vol->m_dirIndexContiguous = isContiguous();
+  return true;
+
+fail:
+  return false;
+}
+#endif  // USE_DIR_INDEX
 //------------------------------------------------------------------------------
 uint8_t* ExFatFile::dirCache(uint8_t set, uint8_t options) {
   DirPos_t pos = m_dirPos;
@@ -79,6 +342,72 @@ bool ExFatFile::close() {
   return rtn;
 }
 //------------------------------------------------------------------------------
+#if USE_MULTI_SECTOR_IO || USE_ASYNC_IO
+// Extend a multi-sector transfer over physically adjacent clusters.
+// The transfer starts at sectorOfCluster in the current cluster and *ns is
+// the number of sectors wanted.  On return *ns is limited to the run and
+// m_curCluster is the cluster of the last sector.  Clusters are added at
+// the end of the chain if grow is true.
+bool ExFatFile::clusterRun(uint32_t sectorOfCluster, uint32_t* ns, bool grow) {
+  uint32_t index = m_curPosition >> m_vol->bytesPerClusterShift();
+  uint32_t mb = m_vol->sectorsPerCluster() - sectorOfCluster;
+  while (mb < *ns) {
+    Cluster_t next;
+    int8_t fg;
+    if (isContiguous()) {
+      // Allocated clusters end at m_dataLength.
+      if (m_dataLength &&
+          index < ((m_dataLength - 1) >> m_vol->bytesPerClusterShift())) {
+        next = m_curCluster + 1;
+        fg = 1;
+      } else {
+        fg = 0;
+      }
+    } else {
+      fg = m_vol->fatGet(m_curCluster, &next);
+      if (fg < 0) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+    }
+    if (fg == 0) {
+#if !EXFAT_READ_ONLY
+      if (!grow) {
+        break;
+      }
+      Cluster_t cc = m_curCluster;
+      if (!addCluster()) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      // Chain now has the new cluster.  The caller follows it if not adjacent.
+      next = m_curCluster;
+      m_curCluster = cc;
+#else   // !EXFAT_READ_ONLY
+      (void)grow;
+      break;
+#endif  // !EXFAT_READ_ONLY
+    }
+    if (next != (m_curCluster + 1)) {
+      break;
+    }
+    m_curCluster = next;
+    index++;
+#if FS_EXTENT_COUNT
+    m_extentMap.add(index, m_curCluster);
+#endif  // FS_EXTENT_COUNT
+    mb += m_vol->sectorsPerCluster();
+  }
+  if (*ns > mb) {
+    *ns = mb;
+  }
+  return true;
+
+fail:
+  return false;
+}
+#endif  // USE_MULTI_SECTOR_IO || USE_ASYNC_IO
+//------------------------------------------------------------------------------
 bool ExFatFile::contiguousRange(Sector_t* bgnSector, Sector_t* endSector) {
   if (!isContiguous()) {
     return false;
@@ -93,6 +422,26 @@ bool ExFatFile::contiguousRange(Sector_t* bgnSector, Sector_t* endSector) {
   return true;
 }
 //------------------------------------------------------------------------------
+#if USE_CREATE_NEW
+bool ExFatFile::createNew(ExFatFile* dirFile, const char* name,
+                          oflag_t oflag) {
+  ExName_t fname;
+  if (isOpen() || !dirFile->isDir() || !isWriteMode(oflag)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (!parsePathName(name, &fname, &name) || *name) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  fname.isNew = true;
+  return openPrivate(dirFile, &fname, oflag | O_CREAT | O_EXCL);
+
+fail:
+  return false;
+}
+#endif  // USE_CREATE_NEW
+//------------------------------------------------------------------------------
 void ExFatFile::fgetpos(fspos_t* pos) const {
   pos->position = m_curPosition;
   pos->cluster = m_curCluster;
@@ -182,6 +531,34 @@ fail:
 //------------------------------------------------------------------------------
 bool ExFatFile::isBusy() { return m_vol->isBusy(); }
 //------------------------------------------------------------------------------
+int16_t ExFatFile::listPage(FsDirList* list, uint16_t count) {
+  int8_t rtn;
+  FsDirStat stat;
+  char* name = list->nameBuffer();
+  size_t size = list->nameSize();
+  if (!isDir()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  list->pageBegin(count);
+  while (list->scanNeeded()) {
+    rewind();
+    list->scanBegin();
+    while ((rtn = readDirPlus(&stat, name, size)) > 0) {
+      list->add(&stat);
+    }
+    if (rtn < 0) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    list->scanEnd();
+  }
+  return list->pageEnd();
+
+fail:
+  return -1;
+}
+//------------------------------------------------------------------------------
 bool ExFatFile::open(const char* path, oflag_t oflag) {
   return open(ExFatVolume::cwv(), path, oflag);
 }
@@ -285,6 +662,13 @@ bool ExFatFile::openPrivate(ExFatFile* dir, ExName_t* fname, oflag_t oflag) {
   uint8_t freeCount = 0;
   uint8_t freeNeed = 3;
   bool inSet = false;
+#if USE_DIR_INDEX
+  bool freeTaken = false;
+  uint32_t scanEnd = 0;
+  size_t iter = 0;
+  const FsDirIndexEntry* entry;
+  FsDirIndex* index = nullptr;
+#endif  // USE_DIR_INDEX
 
   // error if already open, no access mode, or no directory.
   if (isOpen() || !dir->isDir()) {
@@ -310,12 +694,64 @@ bool ExFatFile::openPrivate(ExFatFile* dir, ExName_t* fname, oflag_t oflag) {
 
   if (fname) {
     freeNeed = 2 + (fname->nameLength + 14) / 15;
+#if USE_DIR_INDEX
+    index = dir->m_vol->dirIndex(dir->m_firstCluster);
+    if (index && !index->isBuilt() && !dir->buildDirIndex(index)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    // Not built if the table is too small.
+    if (index && !index->isBuilt()) {
+      index = nullptr;
+    }
+#endif  // USE_DIR_INDEX
+#if USE_CREATE_NEW
+    if (fname->isNew) {
+#if USE_DIR_INDEX
+      if (index) {
+        goto create;
+      }
+#endif  // USE_DIR_INDEX
+      // Use the remembered end if it is still free or at EOF.
+      if (dir->m_dirEnd &&
+          dir->seekSet(FS_DIR_SIZE * (dir->m_dirEnd - 1ULL))) {
+        n = dir->read(buf, FS_DIR_SIZE);
+        if (n == 0) {
+          goto create;
+        }
+        if (n == FS_DIR_SIZE && buf[0] == EXFAT_TYPE_END_DIR) {
+          freePos.position = dir->curPosition() - FS_DIR_SIZE;
+          freePos.cluster = dir->curCluster();
+          freeCount = 1;
+          goto create;
+        }
+      }
+    }
+#endif  // USE_CREATE_NEW
     dir->rewind();
   }
 
   while (1) {
+#if USE_DIR_INDEX
+    if (index && dir->curPosition() >= scanEnd) {
+      // Go to the next set with a matching hash.
+      entry = index->find(&iter, fname->nameHash, fname->nameHash);
+      if (!entry) {
+        goto create;
+      }
+      scanEnd = FS_DIR_SIZE * (entry->index + entry->count);
+      inSet = false;
+      if (!dir->seekSet(FS_DIR_SIZE * entry->index)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+    }
+#endif  // USE_DIR_INDEX
     n = dir->read(buf, FS_DIR_SIZE);
     if (n == 0) {
+#if USE_CREATE_NEW
+      dir->m_dirEnd = dir->curPosition() / FS_DIR_SIZE + 1;
+#endif  // USE_CREATE_NEW
       goto create;
     }
     if (n != FS_DIR_SIZE) {
@@ -332,6 +768,9 @@ bool ExFatFile::openPrivate(ExFatFile* dir, ExName_t* fname, oflag_t oflag) {
         freeCount++;
       }
       if (buf[0] == EXFAT_TYPE_END_DIR) {
+#if USE_CREATE_NEW
+        dir->m_dirEnd = dir->curPosition() / FS_DIR_SIZE;
+#endif  // USE_CREATE_NEW
         if (fname) {
           goto create;
         }
@@ -434,6 +873,17 @@ create:
     DBG_WARN_MACRO;
     goto fail;
   }
+#if USE_DIR_INDEX
+  if (index) {
+    // Use free entries from the index.
+    freeTaken = true;
+    freeCount = 0;
+    if (!dir->seekSet(FS_DIR_SIZE * (uint64_t)index->takeFree(freeNeed))) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+#endif  // USE_DIR_INDEX
   while (freeCount < freeNeed) {
     n = dir->read(buf, FS_DIR_SIZE);
     if (n == 0) {
@@ -510,10 +960,30 @@ create:
       }
     }
   }
+#if USE_CREATE_NEW
+  if (dir->m_dirEnd &&
+      dir->m_dirEnd <= freePos.position / FS_DIR_SIZE + freeNeed) {
+    // New entries are at the end.
+    dir->m_dirEnd = freePos.position / FS_DIR_SIZE + freeNeed + 1;
+  }
+#endif  // USE_CREATE_NEW
+#if USE_DIR_INDEX
+  if (index) {
+    index->add(freePos.position / FS_DIR_SIZE, freeNeed, fname->nameHash,
+               fname->nameHash);
+    m_vol->m_dirIndexContiguous = dir->isContiguous();
+  }
+#endif  // USE_DIR_INDEX
   return sync();
 #endif  // EXFAT_READ_ONLY
 
 fail:
+#if USE_DIR_INDEX
+  if (freeTaken) {
+    // Free entries taken from the index may not be used.
+    index->invalidate();
+  }
+#endif  // USE_DIR_INDEX
   // close file
   m_attributes = FILE_ATTR_CLOSED;
   m_flags = 0;
@@ -573,6 +1043,33 @@ int ExFatFile::peek() {
   return c;
 }
 //------------------------------------------------------------------------------
+#if USE_ASYNC_IO
+uint8_t ExFatFile::pollAsync() { return m_vol->pollAsync(); }
+#endif  // USE_ASYNC_IO
+//------------------------------------------------------------------------------
+// Check that ns sectors at index are in the range from contiguousRange().
+bool ExFatFile::rawCheck(uint32_t index, size_t ns) {
+  if (!isFile() || !isContiguous() || m_firstCluster == 0 ||
+      m_dataLength == 0 || ns == 0 ||
+      (uint64_t)index + ns - 1 >
+          ((m_dataLength - 1) >> m_vol->bytesPerSectorShift())) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  return true;
+}
+//------------------------------------------------------------------------------
+bool ExFatFile::rawRead(uint32_t index, uint8_t* dst, size_t ns) {
+  if (!rawCheck(index, ns)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  return m_vol->cacheSafeRead(firstSector() + index, dst, ns);
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
 int ExFatFile::read(void* buf, size_t count) {
   uint8_t* dst = reinterpret_cast<uint8_t*>(buf);
   int8_t fg;
@@ -625,6 +1122,10 @@ int ExFatFile::read(void* buf, size_t count) {
           goto fail;
         }
       }
+#if FS_EXTENT_COUNT
+      m_extentMap.add(m_curPosition >> m_vol->bytesPerClusterShift(),
+                      m_curCluster);
+#endif  // FS_EXTENT_COUNT
     }
     sector = m_vol->clusterStartSector(m_curCluster) +
              (clusterOffset >> m_vol->bytesPerSectorShift());
@@ -645,11 +1146,11 @@ int ExFatFile::read(void* buf, size_t count) {
 #if USE_MULTI_SECTOR_IO
     } else if (toRead >= 2 * m_vol->bytesPerSector()) {
       uint32_t ns = toRead >> m_vol->bytesPerSectorShift();
-      // Limit reads to current cluster.
-      uint32_t maxNs = m_vol->sectorsPerCluster() -
-                       (clusterOffset >> m_vol->bytesPerSectorShift());
-      if (ns > maxNs) {
-        ns = maxNs;
+      // Read over adjacent clusters with one command.
+      if (!clusterRun(clusterOffset >> m_vol->bytesPerSectorShift(), &ns,
+                      false)) {
+        DBG_FAIL_MACRO;
+        goto fail;
       }
       n = ns << m_vol->bytesPerSectorShift();
       if (!m_vol->cacheSafeRead(sector, dst, ns)) {
@@ -682,6 +1183,24 @@ fail:
   return -1;
 }
 //------------------------------------------------------------------------------
+bool ExFatFile::release(size_t count, bool modified) {
+  if (!isFile() || (modified && !isWritable()) ||
+      count > static_cast<size_t>(m_vol->bytesPerSector() -
+                                  (m_curPosition & m_vol->sectorMask()))) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (modified) {
+    // The borrowed sector is still the current cache line.
+    m_vol->dataCacheDirty();
+    m_flags |= FILE_FLAG_DIR_DIRTY;
+  }
+  return seekSet(m_curPosition + count);
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
 bool ExFatFile::remove(const char* path) {
   ExFatFile file;
   if (!file.open(this, path, O_WRONLY)) {
@@ -724,20 +1243,37 @@ bool ExFatFile::seekSet(uint64_t pos) {
     m_curCluster = m_firstCluster + nNew;
     goto done;
   }
+#if FS_EXTENT_COUNT
+  m_curCluster = m_extentMap.find(nNew);
+  if (m_curCluster) {
+    goto done;
+  }
+  m_curCluster = tmp;
+#endif  // FS_EXTENT_COUNT
   // calculate cluster index for current position
   nCur = (m_curPosition - 1) >> m_vol->bytesPerClusterShift();
   if (nNew < nCur || m_curPosition == 0) {
     // must follow chain from first cluster
     m_curCluster = isRoot() ? m_vol->rootDirectoryCluster() : m_firstCluster;
-  } else {
-    // advance from curPosition
-    nNew -= nCur;
+    nCur = 0;
+  }
+#if FS_EXTENT_COUNT
+  m_extentMap.add(nCur, m_curCluster);
+  if (m_extentMap.end() > nCur + 1) {
+    // start from last mapped cluster
+    nCur = m_extentMap.end() - 1;
+    m_curCluster = m_extentMap.find(nCur);
   }
-  while (nNew--) {
+#endif  // FS_EXTENT_COUNT
+  while (nCur < nNew) {
     if (m_vol->fatGet(m_curCluster, &m_curCluster) <= 0) {
       DBG_FAIL_MACRO;
       goto fail;
     }
+    nCur++;
+#if FS_EXTENT_COUNT
+    m_extentMap.add(nCur, m_curCluster);
+#endif  // FS_EXTENT_COUNT
   }
 
 done:
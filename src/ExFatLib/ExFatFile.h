@@ -33,10 +33,14 @@
 #include "../common/FmtNumber.h"
 #include "../common/FsApiConstants.h"
 #include "../common/FsDateTime.h"
+#include "../common/FsDirStat.h"
+#include "../common/FsExtentMap.h"
 #include "../common/FsName.h"
 #include "ExFatPartition.h"
 
 class ExFatVolume;
+class FsBaseRmRf;
+class FsDirList;
 //------------------------------------------------------------------------------
 /** Expression for path name separator. */
 #define isDirSeparator(c) ((c) == '/')
@@ -51,6 +55,10 @@ class ExName_t : public FsName {
   size_t nameLength;
   /** Hash for UTF-16 name */
   uint16_t nameHash;
+#if USE_CREATE_NEW
+  /** Caller promises the name is not in the directory. */
+  bool isNew = false;
+#endif  // USE_CREATE_NEW
 };
 //------------------------------------------------------------------------------
 /**
@@ -162,6 +170,13 @@ class ExFatFile {
    * \return true for success or false for failure.
    */
   bool attrib(uint8_t bits);
+#if USE_AU_ALLOCATION
+  /** \return The number of card allocation units (AU) spanned by the
+   * file's clusters or zero if the AU size is not set or an error occurs.
+   * An AU is counted again each time the cluster chain returns to it.
+   */
+  uint32_t auCount();
+#endif  // USE_AU_ALLOCATION
   /** \return The number of bytes available from the current position
    * to EOF for normal files.  INT_MAX is returned for very large files.
    *
@@ -178,6 +193,36 @@ class ExFatFile {
    * to EOF for normal files.  Zero is returned for directory files.
    */
   uint64_t available64() { return isFile() ? fileSize() - curPosition() : 0; }
+  /** Borrow cached bytes at the current position for reading.
+   *
+   * The bytes are in the volume cache so no copy is made.  The bytes run
+   * from the current position to the end of the sector or EOF.  The
+   * position is not changed until release() is called.
+   *
+   * The address is only valid until the next call that accesses the
+   * volume other than release().
+   *
+   * \param[out] count Number of bytes at the returned address.
+   *
+   * \return Address of the bytes or nullptr at EOF or for an error.
+   *         Bytes after the valid length of the file are not returned.
+   */
+  const uint8_t* borrowRead(size_t* count) {
+    return borrow(count, false);
+  }
+  /** Borrow cached bytes at the current position for overwriting.
+   *
+   * Same as borrowRead() for a file that is open for write.  The cached
+   * sector is only marked dirty by release() with \a modified true, so
+   * a borrow that changes nothing writes nothing.  Only existing bytes
+   * can be changed.  The file can't be extended, nullptr is returned at
+   * EOF so use write() to append.
+   *
+   * \param[out] count Number of bytes at the returned address.
+   *
+   * \return Address of the bytes or nullptr at EOF or for an error.
+   */
+  uint8_t* borrowWrite(size_t* count) { return borrow(count, true); }
   /** Clear all error bits. */
   void clearError() { m_error = 0; }
   /** Clear writeError. */
@@ -198,6 +243,25 @@ class ExFatFile {
    * \return true for success or false for failure.
    */
   bool contiguousRange(Sector_t* bgnSector, Sector_t* endSector);
+#if USE_CREATE_NEW
+  /** Create and open a file with a name that is not in the directory.
+   *
+   * The directory is not searched for the name.  New entries go at the
+   * end of used entries remembered by \a dirFile so a sequence of creates
+   * in one open directory doesn't rescan the directory.
+   *
+   * WARNING: A duplicate name will result if the name is in the directory.
+   *
+   * \param[in] dirFile An open directory where the file will be created.
+   * \param[in] name A valid file name, not a path.
+   * \param[in] oflag Open flags, must include O_WRONLY or O_RDWR.
+   *            O_CREAT and O_EXCL are implied.
+   *
+   * \return true for success or false for failure.
+   */
+  bool createNew(ExFatFile* dirFile, const char* name,
+                 oflag_t oflag = O_WRONLY);
+#endif  // USE_CREATE_NEW
   /** \return The current cluster number for a file or directory. */
   Cluster_t curCluster() const { return m_curCluster; }
   /** \return The current position for a file or directory. */
@@ -347,6 +411,19 @@ class ExFatFile {
   bool isSystem() const { return m_attributes & FS_ATTRIB_SYSTEM; }
   /** \return True file is writable. */
   bool isWritable() const { return m_flags & FILE_FLAG_WRITE; }
+  /** Read the next page of a sorted directory listing.
+   *
+   * The directory is scanned with readDirPlus() only when the entries for
+   * the page are not already in the arena of \a list.  See FsDirList.
+   *
+   * \param[in,out] list State from FsDirList::begin().  Entries of the
+   *                 page are available with FsDirList::entry().
+   * \param[in] count Maximum number of entries in the page.
+   *
+   * \return Number of entries in the page, zero at the end of the list, or
+   *         -1 for an error.
+   */
+  int16_t listPage(FsDirList* list, uint16_t count);
   /** List directory contents.
    *
    * \param[in] pr Print stream for list.
@@ -504,6 +581,13 @@ class ExFatFile {
    * \return The byte if no error and not at eof else -1;
    */
   int peek();
+#if USE_ASYNC_IO
+  /** Advance asynchronous requests on the file's device without waiting.
+   *
+   * \return Number of requests not yet complete.
+   */
+  uint8_t pollAsync();
+#endif  // USE_ASYNC_IO
   /** Allocate contiguous clusters to an empty file.
    *
    * The file must be empty with no clusters allocated.
@@ -512,9 +596,11 @@ class ExFatFile {
    * will equal the requested length.
    *
    * \param[in] length size of allocated space in bytes.
+   * \param[in] erase Erase the allocated sectors so later writes go to
+   *            pre-erased flash.  Ignored if the device can't erase.
    * \return true for success or false for failure.
    */
-  bool preAllocate(uint64_t length);
+  bool preAllocate(uint64_t length, bool erase = false);
   /** Print a file's access date and time
    *
    * \param[in] pr Print stream for output.
@@ -626,6 +712,38 @@ class ExFatFile {
    * \return true for success or false for failure.
    */
   size_t printName8(print_t* pr);
+  /** Set validLength for a file written with rawWrite() and sync it.
+   *
+   * Updates the directory entry with one write.  The file position is
+   * set to zero and dataLength is not changed.
+   *
+   * \param[in] length New validLength.  Must not be more than dataLength.
+   * \return true for success or false for failure.
+   */
+  bool rawEnd(uint64_t length);
+  /** Read sectors of a contiguous file directly from the device.
+   *
+   * The sectors must be in the range from contiguousRange().  Cached
+   * sectors are written first so the data is current.
+   *
+   * \param[in] index Index of the first sector in the file.
+   * \param[out] dst Location for the data.
+   * \param[in] ns Number of sectors.
+   * \return true for success or false for failure.
+   */
+  bool rawRead(uint32_t index, uint8_t* dst, size_t ns);
+  /** Write sectors of a contiguous file directly to the device.
+   *
+   * Used with rawEnd() to write a preallocated contiguous file at the
+   * device's multi-sector rate.  The sectors must be in the range from
+   * contiguousRange().  The file size is not changed.
+   *
+   * \param[in] index Index of the first sector in the file.
+   * \param[in] src Data to write.
+   * \param[in] ns Number of sectors.
+   * \return true for success or false for failure.
+   */
+  bool rawWrite(uint32_t index, const uint8_t* src, size_t ns);
   /** Read the next byte from a file.
    *
    * \return For success read returns the next byte in the file as an int.
@@ -647,6 +765,51 @@ class ExFatFile {
    * If an error occurs, read() returns -1.
    */
   int read(void* buf, size_t count);
+#if USE_ASYNC_IO
+  /** Queue a read of whole sectors at the current position.
+   *
+   * The position must be a multiple of 512.  The request stops at the last
+   * whole sector of valid data or at the end of a run of adjacent clusters
+   * so call again for the rest.  Use read() for a partial last sector.
+   * The position advances when the request is queued.
+   *
+   * \param[in,out] req Request for the transfer.
+   * \param[out] buf Location for the data.  Valid when req is done.
+   * \param[in] count Maximum number of bytes to read.
+   * \return Number of bytes queued, zero if less than one sector remains
+   * or -1 for an error.
+   */
+  int readAsync(FsIoRequest* req, void* buf, size_t count) {
+    return asyncIo(req, FS_IO_READ, reinterpret_cast<uint8_t*>(buf), count);
+  }
+#endif  // USE_ASYNC_IO
+  /** Read the next file or subdirectory of a directory without opening it.
+   *
+   * The directory is read in one pass and the name is decoded as its
+   * entries are read.  A name that does not fit in \a size bytes is
+   * truncated at a character boundary and FsDirStat::nameTruncated is set.
+   * Use open(dirFile, stat->dirIndex) and printName() for the full name.
+   *
+   * \param[out] stat Information for the entry.
+   * \param[out] name Name of the entry or nullptr if not needed.
+   * \param[in] size Size of \a name.
+   *
+   * \return 1 for an entry, 0 at the end of the directory, or -1 for an
+   *         error.
+   */
+  int8_t readDirPlus(FsDirStat* stat, char* name = nullptr, size_t size = 0);
+  /** Move the current position past bytes from borrowRead() or
+   * borrowWrite().
+   *
+   * \param[in] count Number of bytes used.  Not more than the count
+   *            returned by the borrow call.
+   * \param[in] modified Set true if bytes from borrowWrite() were
+   *            changed.  The cached sector is then written to the device
+   *            and sync() updates the modify time.
+   *
+   * \return true for success or false for failure.
+   */
+  bool release(size_t count, bool modified = false);
   /** Remove a file.
    *
    * The directory entry and all data for the file are deleted.
@@ -703,6 +866,31 @@ class ExFatFile {
    * \return true for success or false for failure.
    */
   bool rmdir();
+  /** Recursively delete a directory and all contained files.
+   *
+   * This is like the Unix/Linux 'rm -rf *' if called with the root directory
+   * hence the name.
+   *
+   * Warning - This will remove all contents of the directory including
+   * subdirectories.  The directory will then be removed if it is not root.
+   * The read-only attribute for files will be ignored.
+   *
+   * \return true for success or false for failure.
+   */
+  bool rmRfStar();
+  /** Recursively delete a directory in steps.
+   *
+   * Same as rmRfStar() but each call removes at most rm->budget() files
+   * and directories.  Entry sets are marked deleted in the cache and the
+   * clusters are freed in batches.  The volume is synced once at the end
+   * of each call.  Call rm->begin() before the first call.
+   *
+   * \param[in,out] rm State of the delete, normally an FsRmRf.
+   *
+   * \return 1 when the delete is done, 0 if the budget is used, or -1 for
+   *         an error.
+   */
+  int8_t rmRfStar(FsBaseRmRf* rm);
   /** Set the files position to current position + \a pos. See seekSet().
    * \param[in] offset The new position in bytes from the current position.
    * \return true for success or false for failure.
@@ -811,6 +999,27 @@ class ExFatFile {
    * \a count. If an error occurs, write() returns zero and writeError is set.
    */
   size_t write(const void* buf, size_t count);
+#if USE_ASYNC_IO
+  /** Queue a write of whole sectors at the current position.
+   *
+   * The position must be a multiple of 512 and not past the end of valid
+   * data.  Clusters are allocated as needed.  The request stops at the end
+   * of a run of adjacent clusters so call again for the rest.  The position
+   * and file size advance when the request is queued.  Call sync() to
+   * complete all requests and update the directory entry.
+   *
+   * \param[in,out] req Request for the transfer.
+   * \param[in] buf Data to be written.  Must not change until req is done.
+   * \param[in] count Maximum number of bytes to write.
+   * \return Number of bytes queued, zero if count is less than one sector
+   * or -1 for an error.
+   */
+  int writeAsync(FsIoRequest* req, const void* buf, size_t count) {
+    return asyncIo(req, FS_IO_WRITE,
+                   const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(buf)),
+                   count);
+  }
+#endif  // USE_ASYNC_IO
 //------------------------------------------------------------------------------
 #if ENABLE_ARDUINO_SERIAL
   /** List directory contents.
@@ -838,13 +1047,28 @@ class ExFatFile {
   friend class ExFatVolume;
   bool addCluster();
   bool addDirCluster();
+#if USE_ASYNC_IO
+  int asyncIo(FsIoRequest* req, uint8_t op, uint8_t* buf, size_t count);
+#endif  // USE_ASYNC_IO
+  uint8_t* borrow(size_t* count, bool write);
+#if USE_DIR_INDEX
+  bool buildDirIndex(FsDirIndex* index);
+#endif  // USE_DIR_INDEX
+#if USE_MULTI_SECTOR_IO || USE_ASYNC_IO
+  bool clusterRun(uint32_t sectorOfCluster, uint32_t* ns, bool grow);
+#endif  // USE_MULTI_SECTOR_IO || USE_ASYNC_IO
   bool cmpName(const DirName_t* dirName, ExName_t* fname);
   uint8_t* dirCache(uint8_t set, uint8_t options);
   bool hashName(ExName_t* fname);
+  bool lsPrivate(print_t* pr, uint8_t flags, uint8_t indent, char* name,
+                 size_t size);
   bool mkdir(ExFatFile* parent, ExName_t* fname);
 
   bool openPrivate(ExFatFile* dir, ExName_t* fname, oflag_t oflag);
   bool parsePathName(const char* path, ExName_t* fname, const char** ptr);
+  bool rawCheck(uint32_t index, size_t ns);
+  int8_t rmRfDir(FsBaseRmRf* rm, uint8_t depth);
+  bool rmRfFlush(FsBaseRmRf* rm);
   ExFatVolume* volume() const { return m_vol; }
   bool syncDir();
   //----------------------------------------------------------------------------
@@ -879,6 +1103,12 @@ class ExFatFile {
   uint8_t m_attributes = FILE_ATTR_CLOSED;
   uint8_t m_error = 0;
   uint8_t m_flags = 0;
+#if USE_CREATE_NEW
+  uint32_t m_dirEnd;  // end of directory index plus one, zero if unknown
+#endif  // USE_CREATE_NEW
+#if FS_EXTENT_COUNT
+  FsExtentMap m_extentMap;  // cluster runs learned from the FAT
+#endif  // FS_EXTENT_COUNT
 };
 #include "../common/ArduinoFiles.h"
 /**
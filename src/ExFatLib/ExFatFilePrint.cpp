@@ -26,69 +26,80 @@
 #include "../common/DebugMacros.h"
 #include "../common/FsUtf.h"
 #include "ExFatLib.h"
+// Names that don't fit are printed from the directory entries.
+static const size_t LS_NAME_SIZE = 64;
 //------------------------------------------------------------------------------
-bool ExFatFile::ls(print_t* pr) {
-  ExFatFile file;
-  if (!isDir()) {
-    DBG_FAIL_MACRO;
-    goto fail;
-  }
-  rewind();
-  while (file.openNext(this, O_RDONLY)) {
-    if (!file.isHidden()) {
-      file.printName(pr);
-      if (file.isDir()) {
-        pr->write('/');
-      }
-      pr->write('\r');
-      pr->write('\n');
-    }
-    file.close();
-  }
-  if (getError()) {
-    DBG_FAIL_MACRO;
-    goto fail;
+static size_t printSize(print_t* pr, uint64_t n) {
+  char buf[21];
+  char* str = &buf[sizeof(buf) - 1];
+  char* bgn = str - 12;
+  *str = '\0';
+  do {
+    uint64_t m = n;
+    n /= 10;
+    *--str = m - 10 * n + '0';
+  } while (n);
+  while (str > bgn) {
+    *--str = ' ';
   }
-  return true;
-
-fail:
-  return false;
+  return pr->write(str);
 }
 //------------------------------------------------------------------------------
+bool ExFatFile::ls(print_t* pr) { return ls(pr, 0, 0); }
+//------------------------------------------------------------------------------
 bool ExFatFile::ls(print_t* pr, uint8_t flags, uint8_t indent) {
+  char name[LS_NAME_SIZE];
+  return lsPrivate(pr, flags, indent, name, sizeof(name));
+}
+//------------------------------------------------------------------------------
+// List with one name buffer for all levels.
+bool ExFatFile::lsPrivate(print_t* pr, uint8_t flags, uint8_t indent,
+                          char* name, size_t size) {
+  int8_t rtn;
+  FsDirStat stat;
   ExFatFile file;
   if (!isDir()) {
     DBG_FAIL_MACRO;
     goto fail;
   }
   rewind();
-  while (file.openNext(this, O_RDONLY)) {
+  while ((rtn = readDirPlus(&stat, name, size)) > 0) {
     // indent for dir level
-    if (!file.isHidden() || (flags & LS_A)) {
+    if (!stat.isHidden() || (flags & LS_A)) {
       for (uint8_t i = 0; i < indent; i++) {
         pr->write(' ');
       }
       if (flags & LS_DATE) {
-        file.printModifyDateTime(pr);
+        fsPrintDateTime(pr, stat.modifyDate, stat.modifyTime);
         pr->write(' ');
       }
       if (flags & LS_SIZE) {
-        file.printFileSize(pr);
+        printSize(pr, stat.size);
         pr->write(' ');
       }
-      file.printName(pr);
-      if (file.isDir()) {
+      if (!stat.nameTruncated) {
+        pr->write(name);
+      } else if (!file.open(this, stat.dirIndex, O_RDONLY) ||
+                 !file.printName(pr) || !file.close()) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      if (stat.isDir()) {
         pr->write('/');
       }
       pr->write('\r');
       pr->write('\n');
-      if ((flags & LS_R) && file.isDir()) {
-        file.ls(pr, flags, indent + 2);
+      if ((flags & LS_R) && stat.isDir()) {
+        if (!file.open(this, stat.dirIndex, O_RDONLY) ||
+            !file.lsPrivate(pr, flags, indent + 2, name, size)) {
+          DBG_FAIL_MACRO;
+          goto fail;
+        }
+        file.close();
       }
     }
-    file.close();
   }
-  if (getError()) {
+  if (rtn < 0) {
     DBG_FAIL_MACRO;
     goto fail;
   }
@@ -117,20 +128,7 @@ size_t ExFatFile::printCreateDateTime(print_t* pr) {
 }
 //------------------------------------------------------------------------------
 size_t ExFatFile::printFileSize(print_t* pr) {
-  uint64_t n = fileSize();
-  char buf[21];
-  char* str = &buf[sizeof(buf) - 1];
-  char* bgn = str - 12;
-  *str = '\0';
-  do {
-    uint64_t m = n;
-    n /= 10;
-    *--str = m - 10 * n + '0';
-  } while (n);
-  while (str > bgn) {
-    *--str = ' ';
-  }
-  return pr->write(str);
+  return printSize(pr, fileSize());
 }
 //------------------------------------------------------------------------------
 size_t ExFatFile::printModifyDateTime(print_t* pr) {
@@ -34,8 +34,19 @@ bool ExFatFile::mkdir(ExFatFile* parent, const char* path, bool pFlag) {
   (void)pFlag;
   return false;
 }
-bool ExFatFile::preAllocate(uint64_t length) {
+bool ExFatFile::preAllocate(uint64_t length, bool erase) {
   (void)length;
+  (void)erase;
+  return false;
+}
+bool ExFatFile::rawEnd(uint64_t length) {
+  (void)length;
+  return false;
+}
+bool ExFatFile::rawWrite(uint32_t index, const uint8_t* src, size_t ns) {
+  (void)index;
+  (void)src;
+  (void)ns;
   return false;
 }
 bool ExFatFile::rename(const char* newPath) {
@@ -71,6 +82,17 @@ bool ExFatFile::addCluster() {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  if (m_curCluster && find != (m_curCluster + 1) && !isDir()) {
+    // Can't extend file data in place so continue in a free AU.
+    Cluster_t au = m_vol->auFind(m_vol->auClusters());
+    if (au == 0) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (au > 1) {
+      find = au;
+    }
+  }
   if (!m_vol->bitmapModify(find, 1, 1)) {
     DBG_FAIL_MACRO;
     goto fail;
@@ -219,7 +241,7 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
-bool ExFatFile::preAllocate(uint64_t length) {
+bool ExFatFile::preAllocate(uint64_t length, bool erase) {
   uint32_t find;
   uint32_t need;
   if (!length || !isWritable() || m_firstCluster) {
@@ -227,7 +249,11 @@ bool ExFatFile::preAllocate(uint64_t length) {
     goto fail;
   }
   need = 1 + ((length - 1) >> m_vol->bytesPerClusterShift());
-  find = m_vol->bitmapFind(0, need);
+  // Prefer clusters that start on an AU boundary.
+  find = m_vol->auFind(need);
+  if (find == 1) {
+    find = m_vol->bitmapFind(0, need);
+  }
   if (find < 2) {
     DBG_FAIL_MACRO;
     goto fail;
@@ -236,6 +262,12 @@ bool ExFatFile::preAllocate(uint64_t length) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  if (erase) {
+    // Erase is a hint so errors are ignored and not reported.
+    Sector_t first = m_vol->clusterStartSector(find);
+    m_vol->eraseHint(first,
+                     first + (need << m_vol->sectorsPerClusterShift()) - 1);
+  }
   m_dataLength = length;
   m_firstCluster = find;
   m_flags |= FILE_FLAG_DIR_DIRTY | FILE_FLAG_CONTIGUOUS;
@@ -245,6 +277,31 @@ bool ExFatFile::preAllocate(uint64_t length) {
   }
   return true;
 
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool ExFatFile::rawEnd(uint64_t length) {
+  if (!isWritable() || !isFile() || length > m_dataLength) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_validLength = length;
+  m_flags |= FILE_FLAG_DIR_DIRTY;
+  rewind();
+  return sync();
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool ExFatFile::rawWrite(uint32_t index, const uint8_t* src, size_t ns) {
+  if (!isWritable() || !rawCheck(index, ns)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  return m_vol->cacheSafeWrite(firstSector() + index, src, ns);
+
 fail:
   return false;
 }
@@ -255,6 +312,12 @@ bool ExFatFile::remove() {
     DBG_FAIL_MACRO;
     goto fail;
   }
+#if USE_DIR_INDEX
+  // Stop use of the index if this is the indexed directory.
+  if (m_firstCluster && m_vol->dirIndex(m_firstCluster)) {
+    m_vol->m_dirIndex.end();
+  }
+#endif  // USE_DIR_INDEX
   // Free any clusters.
   if (m_firstCluster) {
     if (isContiguous()) {
@@ -280,6 +343,9 @@ bool ExFatFile::remove() {
     // Mark entry not used.
     cache[0] &= 0x7F;
   }
+#if USE_DIR_INDEX
+  m_vol->dirIndexRemove(&m_dirPos, m_setCount + 1);
+#endif  // USE_DIR_INDEX
   // Set this file closed.
   m_attributes = FILE_ATTR_CLOSED;
   m_flags = 0;
@@ -364,6 +430,190 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
+// Remove all file sets of this directory.  The directory is walked set by
+// set in the cache.  Sets are marked deleted in the cache and clusters are
+// freed by rmRfFlush() after the directory is written.
+int8_t ExFatFile::rmRfDir(FsBaseRmRf* rm, uint8_t depth) {
+  int8_t status;
+  uint8_t setCount;
+  bool isDir;
+  uint8_t* cache;
+  DirFile_t* dirFile;
+  DirStream_t* dirStream;
+  DirPos_t pos;
+  DirPos_t set;
+  ExFatFile sub;
+#if USE_DIR_INDEX
+  FsDirIndex* index = m_vol->dirIndex(m_firstCluster);
+  if (index) {
+    index->invalidate();
+  }
+#endif  // USE_DIR_INDEX
+  pos.cluster = isRoot() ? m_vol->rootDirectoryCluster() : m_firstCluster;
+  pos.position = 0;
+  pos.isContiguous = isContiguous();
+  status = m_vol->dirSeek(&pos, rm->position(depth));
+  while (status == 1 && (isRoot() || pos.position < m_dataLength)) {
+    cache = m_vol->dirCache(&pos, FsCache::CACHE_FOR_READ);
+    if (!cache) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (cache[0] == EXFAT_TYPE_END_DIR) {
+      break;
+    }
+    if (cache[0] != EXFAT_TYPE_FILE) {
+      status = m_vol->dirSeek(&pos, FS_DIR_SIZE);
+      continue;
+    }
+    dirFile = reinterpret_cast<DirFile_t*>(cache);
+    setCount = dirFile->setCount;
+    isDir = getLe16(dirFile->attributes) & FS_ATTRIB_DIRECTORY;
+    // Only the stream entry is needed to find the data of the set.
+    set = pos;
+    if (m_vol->dirSeek(&set, FS_DIR_SIZE) != 1) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    cache = m_vol->dirCache(&set, FsCache::CACHE_FOR_READ);
+    if (!cache || cache[0] != EXFAT_TYPE_STREAM) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    dirStream = reinterpret_cast<DirStream_t*>(cache);
+    sub.m_vol = m_vol;
+    sub.m_firstCluster = getLe32(dirStream->firstCluster);
+    sub.m_dataLength = getLe64(dirStream->dataLength);
+    sub.m_flags =
+        dirStream->flags & EXFAT_FLAG_CONTIGUOUS ? FILE_FLAG_CONTIGUOUS : 0;
+    if (isDir) {
+      // Empty the batch for the subdirectory.
+      if (!rmRfFlush(rm)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      rm->setPosition(depth, pos.position);
+      sub.m_attributes = FILE_ATTR_SUBDIR;
+      int8_t rtn = sub.rmRfDir(rm, depth + 1);
+      sub.m_attributes = FILE_ATTR_CLOSED;
+      if (rtn <= 0) {
+        return rtn;
+      }
+#if USE_DIR_INDEX
+      if (m_vol->dirIndex(sub.m_firstCluster)) {
+        m_vol->m_dirIndex.end();
+      }
+#endif  // USE_DIR_INDEX
+    }
+    // Mark the entries of the set not used.  Leaves pos after the set.
+    for (uint8_t is = 0; is <= setCount; is++) {
+      cache = m_vol->dirCache(&pos, FsCache::CACHE_FOR_WRITE);
+      if (!cache) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      cache[0] &= 0x7F;
+      status = m_vol->dirSeek(&pos, FS_DIR_SIZE);
+      if (status < 0) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+    }
+    rm->remove();
+    if (sub.m_firstCluster) {
+      uint32_t nc = sub.isContiguous()
+                        ? 1 + ((sub.m_dataLength - 1) >>
+                               m_vol->bytesPerClusterShift())
+                        : 0;
+      if (rm->add(sub.m_firstCluster, nc) && !rmRfFlush(rm)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+    }
+    if (rm->spent()) {
+      if (!rmRfFlush(rm)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      rm->setPosition(depth, pos.position);
+      return 0;
+    }
+  }
+  if (status < 0) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (!rmRfFlush(rm)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  rm->setPosition(depth, 0);
+  return 1;
+
+fail:
+  return -1;
+}
+//------------------------------------------------------------------------------
+// Write deleted sets then free the clusters of the batch.
+bool ExFatFile::rmRfFlush(FsBaseRmRf* rm) {
+  if (!m_vol->dataCacheSync()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  for (uint8_t i = 0; i < rm->batchCount(); i++) {
+    bool ok = rm->clusterCount(i)
+                  ? m_vol->bitmapModify(rm->cluster(i), rm->clusterCount(i), 0)
+                  : m_vol->freeChain(rm->cluster(i));
+    if (!ok) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+  if (rm->batchCount()) {
+    rm->clearBatch();
+  }
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool ExFatFile::rmRfStar() {
+  FsRmRfOnce rm;
+  rm.begin();
+  return rmRfStar(&rm) > 0;
+}
+//------------------------------------------------------------------------------
+int8_t ExFatFile::rmRfStar(FsBaseRmRf* rm) {
+  int8_t rtn;
+  if (!isDir()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  rm->callBegin();
+  rtn = rmRfDir(rm, 0);
+  if (rtn < 0) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  // don't try to delete root
+  if (rtn > 0 && !isRoot()) {
+    if (!rmdir()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    rm->remove();
+  }
+  if (!m_vol->cacheSync()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  return rtn;
+
+fail:
+  return -1;
+}
+//------------------------------------------------------------------------------
 bool ExFatFile::sync() {
   if (!isOpen()) {
     return true;
@@ -589,6 +839,11 @@ bool ExFatFile::truncate() {
   }
   m_validLength = m_curPosition > m_validLength ? m_validLength : m_curPosition;
   m_dataLength = m_curPosition;
+#if FS_EXTENT_COUNT
+  m_extentMap.truncate(
+      m_curPosition ? ((m_curPosition - 1) >> m_vol->bytesPerClusterShift()) + 1
+                    : 0);
+#endif  // FS_EXTENT_COUNT
   m_flags |= FILE_FLAG_DIR_DIRTY;
   return sync();
 
@@ -670,6 +925,10 @@ size_t ExFatFile::write(const void* buf, size_t nbyte) {
           m_curCluster = m_firstCluster;
         }
       }
+#if FS_EXTENT_COUNT
+      m_extentMap.add(m_curPosition >> m_vol->bytesPerClusterShift(),
+                      m_curCluster);
+#endif  // FS_EXTENT_COUNT
     }
     // sector for data write
     sector = m_vol->clusterStartSector(m_curCluster) +
@@ -716,11 +975,11 @@ size_t ExFatFile::write(const void* buf, size_t nbyte) {
     } else if (toWrite >= 2 * m_vol->bytesPerSector()) {
       // use multiple sector write command
       uint32_t ns = toWrite >> m_vol->bytesPerSectorShift();
-      // Limit writes to current cluster.
-      uint32_t maxNs = m_vol->sectorsPerCluster() -
-                       (clusterOffset >> m_vol->bytesPerSectorShift());
-      if (ns > maxNs) {
-        ns = maxNs;
+      // Write over adjacent clusters with one command.
+      if (!clusterRun(clusterOffset >> m_vol->bytesPerSectorShift(), &ns,
+                      true)) {
+        DBG_FAIL_MACRO;
+        goto fail;
       }
       n = ns << m_vol->bytesPerSectorShift();
       if (!m_vol->cacheSafeWrite(sector, src, ns)) {
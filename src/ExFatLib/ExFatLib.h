@@ -23,5 +23,7 @@
  * DEALINGS IN THE SOFTWARE.
  */
 #pragma once
+#include "../common/FsDirList.h"
+#include "../common/FsRmRf.h"
 #include "ExFatFormatter.h"
 #include "ExFatVolume.h"
@@ -187,3 +187,109 @@ bool ExFatFile::hashName(ExName_t* fname) {
 fail:
   return false;
 }
+//------------------------------------------------------------------------------
+int8_t ExFatFile::readDirPlus(FsDirStat* stat, char* name, size_t size) {
+  int n;
+  uint8_t buf[FS_DIR_SIZE];
+  const DirFile_t* df;
+  const DirStream_t* ds;
+  const DirName_t* dn;
+  char* str = name;
+  // Save space for zero byte.
+  const char* end = size ? name + size - 1 : nullptr;
+  uint8_t setCount = 0;
+  uint8_t nameLength = 0;
+#if USE_UTF8_LONG_NAMES
+  uint16_t hs = 0;
+#endif  // USE_UTF8_LONG_NAMES
+  if (!isDir() || (m_curPosition & 0X1F)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (!end) {
+    name = nullptr;
+  }
+  while (1) {
+    n = read(buf, FS_DIR_SIZE);
+    if (n == 0 || buf[0] == EXFAT_TYPE_END_DIR) {
+      return 0;
+    }
+    if (n != FS_DIR_SIZE) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (!(buf[0] & EXFAT_TYPE_USED)) {
+      setCount = 0;
+      continue;
+    }
+    if (buf[0] == EXFAT_TYPE_FILE) {
+      df = reinterpret_cast<const DirFile_t*>(buf);
+      setCount = df->setCount < 2 ? 0 : df->setCount;
+      memset(stat, 0, sizeof(FsDirStat));
+      stat->dirIndex = m_curPosition / FS_DIR_SIZE - 1;
+      stat->createDate = getLe16(df->createDate);
+      stat->createTime = getLe16(df->createTime);
+      stat->modifyDate = getLe16(df->modifyDate);
+      stat->modifyTime = getLe16(df->modifyTime);
+      stat->accessDate = getLe16(df->accessDate);
+      stat->accessTime = getLe16(df->accessTime);
+      stat->attributes = getLe16(df->attributes) & FS_ATTRIB_COPY;
+      str = name;
+      nameLength = 0;
+#if USE_UTF8_LONG_NAMES
+      hs = 0;
+#endif  // USE_UTF8_LONG_NAMES
+      continue;
+    }
+    if (setCount == 0) {
+      // Not part of a file set.
+      continue;
+    }
+    if (buf[0] == EXFAT_TYPE_STREAM) {
+      ds = reinterpret_cast<const DirStream_t*>(buf);
+      stat->size = getLe64(ds->dataLength);
+      stat->firstCluster = getLe32(ds->firstCluster);
+      nameLength = ds->nameLength;
+    } else if (buf[0] == EXFAT_TYPE_NAME && name) {
+      dn = reinterpret_cast<const DirName_t*>(buf);
+      for (uint8_t in = 0; in < 15 && nameLength; in++, nameLength--) {
+        uint16_t c = getLe16(dn->unicode + 2 * in);
+#if USE_UTF8_LONG_NAMES
+        uint32_t cp = c;
+        if (hs) {
+          cp = FsUtf::isLowSurrogate(c) ? FsUtf::u16ToCp(hs, c) : 0;
+          hs = 0;
+        } else if (FsUtf::isHighSurrogate(c)) {
+          hs = c;
+          continue;
+        } else if (FsUtf::isSurrogate(c)) {
+          cp = 0;
+        }
+        char* ptr = cp ? FsUtf::cpToMb(cp, str, end) : nullptr;
+        if (!ptr) {
+          // Truncate at a bad character or if the name doesn't fit.
+          stat->nameTruncated |= cp && end == name + size - 1;
+          end = str;
+          continue;
+        }
+        str = ptr;
+#else   // USE_UTF8_LONG_NAMES
+        if (str < end) {
+          *str++ = c < 0X7F ? c : '?';
+        } else {
+          stat->nameTruncated = true;
+        }
+#endif  // USE_UTF8_LONG_NAMES
+      }
+    }
+    if (--setCount == 0) {
+      if (name) {
+        *str = '\0';
+      }
+      return 1;
+    }
+  }
+
+fail:
+  return -1;
+}
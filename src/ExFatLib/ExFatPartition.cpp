@@ -25,64 +25,105 @@
 #define DBG_FILE "ExFatPartition.cpp"
 #include "../common/DebugMacros.h"
 #include "ExFatLib.h"
+#include "../common/FsBitmap.h"
+#if USE_AU_ALLOCATION
+//------------------------------------------------------------------------------
+// Return the first AU boundary at or after cluster.
+Cluster_t ExFatPartition::auCeil(Cluster_t cluster) const {
+  if (cluster <= m_auFirstCluster) {
+    return m_auFirstCluster;
+  }
+  uint32_t n = cluster - m_auFirstCluster + m_auClusters - 1;
+  return m_auFirstCluster + n - n % m_auClusters;
+}
+//------------------------------------------------------------------------------
+// Find count free clusters that start on an AU boundary.
+// return 0 if error, 1 if not found, else start cluster.
+Cluster_t ExFatPartition::auFind(uint32_t count) {
+  Cluster_t cluster;
+  if (m_auClusters == 0) {
+    return 1;
+  }
+  cluster = auCeil(m_bitmapStart + 2);
+  while (cluster < m_clusterCount + 2) {
+    Cluster_t find = bitmapFind(cluster, count);
+    if (find < cluster) {
+      // Error, no space, or search wrapped.
+      return find ? 1 : 0;
+    }
+    cluster = auCeil(find);
+    if (cluster == find) {
+      return find;
+    }
+  }
+  return 1;
+}
+#endif  // USE_AU_ALLOCATION
 //------------------------------------------------------------------------------
 // return 0 if error, 1 if no space, else start cluster.
 Cluster_t ExFatPartition::bitmapFind(Cluster_t cluster, uint32_t count) {
+  const uint32_t sectorBits = m_bytesPerSector << 3;
   Cluster_t start = cluster ? cluster - 2 : m_bitmapStart;
   if (start >= m_clusterCount) {
     start = 0;
   }
-  Cluster_t endAlloc = start;
+  // Search start through end of bitmap then zero up to start.
+  Cluster_t end = m_clusterCount;
+  // Start of free run.
   Cluster_t bgnAlloc = start;
-  uint16_t sectorSize = 1 << m_bytesPerSectorShift;
-  size_t i = (start >> 3) & (sectorSize - 1);
-  const uint8_t* cache;
-  uint8_t mask = 1 << (start & 7);
+  // Next cluster to check.
+  Cluster_t pos = start;
   while (true) {
+    if (pos >= end) {
+      if (end == start) {
+        return 1;
+      }
+      end = start;
+      pos = bgnAlloc = 0;
+      continue;
+    }
     Sector_t sector =
-        m_clusterHeapStartSector + (endAlloc >> (m_bytesPerSectorShift + 3));
-    cache = bitmapCachePrepare(sector, FsCache::CACHE_FOR_READ);
+        m_clusterHeapStartSector + (pos >> (m_bytesPerSectorShift + 3));
+    const uint8_t* cache =
+        bitmapCachePrepare(sector, FsCache::CACHE_FOR_READ);
     if (!cache) {
       return 0;
     }
-    for (; i < sectorSize; i++) {
-      for (; mask; mask <<= 1) {
-        endAlloc++;
-        if (!(mask & cache[i])) {
-          if ((endAlloc - bgnAlloc) == count) {
-            if (cluster == 0 && count == 1) {
-              // Start at found sector.  bitmapModify may increase this.
-              m_bitmapStart = bgnAlloc;
-            }
-            return bgnAlloc + 2;
-          }
-        } else {
-          bgnAlloc = endAlloc;
-        }
-        if (endAlloc == start) {
-          return 1;
-        }
-        if (endAlloc >= m_clusterCount) {
-          endAlloc = bgnAlloc = 0;
-          i = sectorSize;
-          break;
+    Cluster_t base = pos & ~(sectorBits - 1);
+    uint32_t lim = end - base < sectorBits ? end - base : sectorBits;
+    uint32_t i = pos - base;
+    while (i < lim) {
+      if (bgnAlloc == (base + i)) {
+        // Not in a free run.
+        i = fsBitmapFind(cache, i, lim, false);
+        bgnAlloc = base + i;
+      }
+      i = fsBitmapFind(cache, i, lim, true);
+      if ((base + i - bgnAlloc) >= count) {
+        if (cluster == 0 && count == 1) {
+          // Start at found sector.  bitmapModify may increase this.
+          m_bitmapStart = bgnAlloc;
         }
+        return bgnAlloc + 2;
+      }
+      if (i < lim) {
+        // Skip allocated cluster.
+        i++;
+        bgnAlloc = base + i;
       }
-      mask = 1;
     }
-    i = 0;
+    pos = base + lim;
   }
   return 0;
 }
 //------------------------------------------------------------------------------
 bool ExFatPartition::bitmapModify(Cluster_t cluster, uint32_t count,
                                   bool value) {
+  const uint32_t sectorBits = m_bytesPerSector << 3;
   Sector_t sector;
   Cluster_t start = cluster - 2;
-  size_t i;
+  uint32_t i;
   uint8_t* cache;
-  uint8_t mask;
-  cluster -= 2;
   if ((start + count) > m_clusterCount) {
     DBG_FAIL_MACRO;
     goto fail;
@@ -96,30 +137,25 @@ bool ExFatPartition::bitmapModify(Cluster_t cluster, uint32_t count,
       m_bitmapStart = start;
     }
   }
-  mask = 1 << (start & 7);
   sector = m_clusterHeapStartSector + (start >> (m_bytesPerSectorShift + 3));
-  i = (start >> 3) & m_sectorMask;
-  while (true) {
+  i = start & (sectorBits - 1);
+  while (count) {
+    uint32_t n = sectorBits - i < count ? sectorBits - i : count;
     cache = bitmapCachePrepare(sector++, FsCache::CACHE_FOR_WRITE);
     if (!cache) {
       DBG_FAIL_MACRO;
       goto fail;
     }
-    for (; i < m_bytesPerSector; i++) {
-      for (; mask; mask <<= 1) {
-        if (value == static_cast<bool>(cache[i] & mask)) {
-          DBG_FAIL_MACRO;
-          goto fail;
-        }
-        cache[i] ^= mask;
-        if (--count == 0) {
-          return true;
-        }
-      }
-      mask = 1;
+    // All bits must change.
+    if (fsBitmapFind(cache, i, i + n, value) != (i + n)) {
+      DBG_FAIL_MACRO;
+      goto fail;
     }
+    fsBitmapFill(cache, i, i + n, value);
+    count -= n;
     i = 0;
   }
+  return true;
 
 fail:
   return false;
@@ -142,6 +178,26 @@ uint8_t* ExFatPartition::dirCache(const DirPos_t* pos, uint8_t options) {
   uint8_t* cache = dataCachePrepare(sector, options);
   return cache ? cache + (pos->position & m_sectorMask) : nullptr;
 }
+#if USE_DIR_INDEX
+//------------------------------------------------------------------------------
+// Remove a set from the directory index if the set is in the directory.
+void ExFatPartition::dirIndexRemove(const DirPos_t* pos, uint8_t count) {
+  DirPos_t tmp;
+  int8_t status;
+  if (!m_dirIndex.isBuilt()) {
+    return;
+  }
+  tmp.cluster = m_dirIndex.dir() ? m_dirIndex.dir() : m_rootDirectoryCluster;
+  tmp.position = 0;
+  tmp.isContiguous = m_dirIndexContiguous;
+  status = dirSeek(&tmp, pos->position & ~m_clusterMask);
+  if (status < 0) {
+    m_dirIndex.invalidate();
+  } else if (status == 1 && tmp.cluster == pos->cluster) {
+    m_dirIndex.remove(pos->position / FS_DIR_SIZE, count);
+  }
+}
+#endif  // USE_DIR_INDEX
 //------------------------------------------------------------------------------
 // return -1 error, 0 EOC, 1 OK
 int8_t ExFatPartition::dirSeek(DirPos_t* pos, uint32_t offset) {
@@ -237,32 +293,21 @@ fail:
 }
 //------------------------------------------------------------------------------
 Cluster_t ExFatPartition::freeClusterCount() {
-  Cluster_t nc = 0;
+  const uint32_t sectorBits = m_bytesPerSector << 3;
   Sector_t sector = m_clusterHeapStartSector;
   Cluster_t usedCount = 0;
   const uint8_t* cache;
 
-  while (true) {
+  for (Cluster_t nc = 0; nc < m_clusterCount; nc += sectorBits) {
     cache = dataCachePrepare(sector++, FsCache::CACHE_FOR_READ);
     if (!cache) {
       return -1;
     }
-    for (size_t i = 0; i < m_bytesPerSector; i++) {
-      if (cache[i] == 0XFF) {
-        usedCount += 8;
-      } else if (cache[i]) {
-        for (uint8_t mask = 1; mask; mask <<= 1) {
-          if ((mask & cache[i])) {
-            usedCount++;
-          }
-        }
-      }
-      nc += 8;
-      if (nc >= m_clusterCount) {
-        return m_clusterCount - usedCount;
-      }
-    }
+    uint32_t n =
+        m_clusterCount - nc < sectorBits ? m_clusterCount - nc : sectorBits;
+    usedCount += fsBitmapCount(cache, 0, n);
   }
+  return m_clusterCount - usedCount;
 }
 //------------------------------------------------------------------------------
 bool ExFatPartition::init(FsBlockDevice* dev, uint8_t part,
@@ -272,6 +317,12 @@ bool ExFatPartition::init(FsBlockDevice* dev, uint8_t part,
   const MbrSector_t* mbr;
   m_fatType = 0;
   m_blockDev = dev;
+#if USE_AU_ALLOCATION
+  m_auClusters = 0;
+#endif  // USE_AU_ALLOCATION
+#if USE_DIR_INDEX
+  m_dirIndex.end();
+#endif  // USE_DIR_INDEX
   cacheInit(m_blockDev);
   // if part == 0 assume super floppy with FAT boot sector in sector zero
   // if part > 0 assume mbr volume with partition table
@@ -325,6 +376,34 @@ bool ExFatPartition::init(FsBlockDevice* dev, uint8_t part,
 fail:
   return false;
 }
+#if USE_AU_ALLOCATION
+//------------------------------------------------------------------------------
+bool ExFatPartition::setAuSize(uint32_t sectors) {
+  Sector_t offset;
+  const uint32_t clusterSectorMask = sectorsPerCluster() - 1;
+  m_auClusters = 0;
+  if (!m_fatType) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (sectors <= sectorsPerCluster()) {
+    // Every cluster is in a single AU.
+    return true;
+  }
+  // Sectors from start of cluster heap to the first AU boundary.
+  offset = (sectors - m_clusterHeapStartSector % sectors) % sectors;
+  if ((offset | sectors) & clusterSectorMask) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_auClusters = sectors >> m_sectorsPerClusterShift;
+  m_auFirstCluster = 2 + (offset >> m_sectorsPerClusterShift);
+  return true;
+
+fail:
+  return false;
+}
+#endif  // USE_AU_ALLOCATION
 //------------------------------------------------------------------------------
 uint32_t ExFatPartition::rootLength() {
   uint32_t nc = chainSize(m_rootDirectoryCluster);
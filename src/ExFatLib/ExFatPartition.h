@@ -29,6 +29,7 @@
  */
 #include "../common/FsBlockDevice.h"
 #include "../common/FsCache.h"
+#include "../common/FsDirIndex.h"
 #include "../common/FsStructs.h"
 #include "../common/SysCall.h"
 /** Set EXFAT_READ_ONLY non-zero for read only */
@@ -60,6 +61,10 @@ struct DirPos_t {
 class ExFatPartition {
  public:
   ExFatPartition() = default;  // cppcheck-suppress uninitMemberVar
+#if USE_AU_ALLOCATION
+  /** \return Clusters in a card allocation unit (AU) or zero if not set. */
+  uint32_t auClusters() const { return m_auClusters; }
+#endif  // USE_AU_ALLOCATION
   /** \return the number of bytes in a cluster. */
   uint32_t bytesPerCluster() const { return m_bytesPerCluster; }
   /** \return the power of two for bytesPerCluster. */
@@ -75,6 +80,45 @@ class ExFatPartition {
    * \return A pointer to the cache buffer or zero if an error occurs.
    */
   uint8_t* cacheClear() { return m_dataCache.clear(); }
+#if FS_CACHE_USER_SECTOR_COUNT
+  /** Add sectors in a caller-owned buffer to the directory and data cache.
+   *
+   * See FS_CACHE_USER_SECTOR_COUNT.  The buffer must stay valid until a
+   * call with a count of zero removes it.
+   *
+   * \param[in] buf Buffer for count sectors, aligned to four bytes.
+   * \param[in] count Number of sectors in buf.
+   * \return true for success or false for failure.
+   */
+  bool cacheAttach(uint8_t* buf, uint8_t count) {
+    return m_dataCache.attach(buf, count);
+  }
+#endif  // FS_CACHE_USER_SECTOR_COUNT
+#if USE_FS_CACHE_STATS
+  /** \return Number of sector cache hits. */
+  uint32_t cacheHitCount() const {
+#if USE_EXFAT_BITMAP_CACHE
+    return m_dataCache.hitCount() + m_bitmapCache.hitCount();
+#else   // USE_EXFAT_BITMAP_CACHE
+    return m_dataCache.hitCount();
+#endif  // USE_EXFAT_BITMAP_CACHE
+  }
+  /** \return Number of sector cache misses. */
+  uint32_t cacheMissCount() const {
+#if USE_EXFAT_BITMAP_CACHE
+    return m_dataCache.missCount() + m_bitmapCache.missCount();
+#else   // USE_EXFAT_BITMAP_CACHE
+    return m_dataCache.missCount();
+#endif  // USE_EXFAT_BITMAP_CACHE
+  }
+  /** Reset sector cache hit and miss counts. */
+  void cacheResetStats() {
+    m_dataCache.resetStats();
+#if USE_EXFAT_BITMAP_CACHE
+    m_bitmapCache.resetStats();
+#endif  // USE_EXFAT_BITMAP_CACHE
+  }
+#endif  // USE_FS_CACHE_STATS
   /** \return the cluster count for the partition. */
   Cluster_t clusterCount() const { return m_clusterCount; }
   /** \return the cluster heap start sector. */
@@ -113,10 +157,32 @@ class ExFatPartition {
    * \return true if busy else false.
    */
   bool isBusy() { return m_blockDev->isBusy(); }
+#if USE_ASYNC_IO
+  /**
+   * Advance asynchronous requests without waiting.
+   *
+   * \return Number of requests not yet complete.
+   */
+  uint8_t pollAsync() { return m_blockDev->poll(); }
+#endif  // USE_ASYNC_IO
   /** \return the root directory start cluster number. */
   Cluster_t rootDirectoryCluster() const { return m_rootDirectoryCluster; }
   /** \return the root directory length. */
   uint32_t rootLength();
+#if USE_AU_ALLOCATION
+  /** Set the card allocation unit (AU) size.
+   *
+   * Contiguous allocations by preAllocate() start on an AU boundary when
+   * possible.  A file that can't be extended in place continues in a free
+   * AU.  SdFat calls this with the AU size from the SD Status register
+   * when the volume is mounted.
+   *
+   * \param[in] sectors AU size in sectors or zero to remove AU alignment.
+   *
+   * \return true for success or false if clusters are not AU aligned.
+   */
+  bool setAuSize(uint32_t sectors);
+#endif  // USE_AU_ALLOCATION
   /** \return the number of sectors in a cluster. */
   Sector_t sectorsPerCluster() const { return 1UL << m_sectorsPerClusterShift; }
   /** \return the power of two for sectors per cluster. */
@@ -138,8 +204,33 @@ class ExFatPartition {
  private:
   /** ExFatFile allowed access to private members. */
   friend class ExFatFile;
+  /** ExFatVolume allowed access to private members. */
+  friend class ExFatVolume;
+#if USE_AU_ALLOCATION
+  uint32_t m_auClusters;       // Clusters per AU or zero.
+  Cluster_t m_auFirstCluster;  // First cluster on an AU boundary.
+  Cluster_t auCeil(Cluster_t cluster) const;
+  Cluster_t auFind(uint32_t count);
+  uint32_t auIndex(Cluster_t cluster) const {
+    return (cluster + m_auClusters - m_auFirstCluster) / m_auClusters;
+  }
+#else   // USE_AU_ALLOCATION
+  uint32_t auClusters() const { return 0; }
+  Cluster_t auFind(uint32_t count) {
+    (void)count;
+    return 1;
+  }
+#endif  // USE_AU_ALLOCATION
   uint32_t bitmapFind(Cluster_t cluster, uint32_t count);
   bool bitmapModify(Cluster_t cluster, uint32_t count, bool value);
+#if USE_DIR_INDEX
+  FsDirIndex m_dirIndex;      // Index of one large directory.
+  bool m_dirIndexContiguous;  // Indexed directory has no FAT chain.
+  FsDirIndex* dirIndex(Cluster_t dir) {
+    return m_dirIndex.covers(dir) ? &m_dirIndex : nullptr;
+  }
+  void dirIndexRemove(const DirPos_t* pos, uint8_t count);
+#endif  // USE_DIR_INDEX
   //----------------------------------------------------------------------------
   // Cache functions.
   uint8_t* bitmapCachePrepare(Sector_t sector, uint8_t option) {
@@ -182,6 +273,9 @@ class ExFatPartition {
   Cluster_t chainSize(Cluster_t cluster);
   bool freeChain(Cluster_t cluster);
   uint16_t sectorMask() const { return m_sectorMask; }
+  bool eraseHint(Sector_t firstSector, Sector_t lastSector) {
+    return m_blockDev->eraseHint(firstSector, lastSector);
+  }
   bool syncDevice() { return m_blockDev->syncDevice(); }
   bool cacheSafeRead(Sector_t sector, uint8_t* dst) {
     return m_dataCache.cacheSafeRead(sector, dst);
@@ -195,6 +289,11 @@ class ExFatPartition {
   bool cacheSafeWrite(Sector_t sector, const uint8_t* src, size_t count) {
     return m_dataCache.cacheSafeWrite(sector, src, count);
   }
+#if USE_ASYNC_IO
+  bool cacheSafeSubmit(FsIoRequest* req) {
+    return m_dataCache.cacheSafeSubmit(req);
+  }
+#endif  // USE_ASYNC_IO
   bool readSector(Sector_t sector, uint8_t* dst) {
     return m_blockDev->readSector(sector, dst);
   }
@@ -43,3 +43,23 @@ bool ExFatVolume::chdir(const char* path) {
 fail:
   return false;
 }
+#if USE_DIR_INDEX
+//------------------------------------------------------------------------------
+bool ExFatVolume::setDirIndex(const char* path, FsDirIndexEntry* table,
+                              size_t size) {
+  ExFatFile dir;
+  m_dirIndex.end();
+  if (!table) {
+    return true;
+  }
+  if (size == 0 || !dir.open(vwd(), path, O_RDONLY) || !dir.isDir()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_dirIndex.begin(table, size, dir.firstCluster());
+  return true;
+
+fail:
+  return false;
+}
+#endif  // USE_DIR_INDEX
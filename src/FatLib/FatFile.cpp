@@ -31,7 +31,7 @@
 bool FatFile::addCluster() {
 #if USE_FAT_FILE_FLAG_CONTIGUOUS
   Cluster_t cc = m_curCluster;
-  if (!m_vol->allocateCluster(m_curCluster, &m_curCluster)) {
+  if (!m_vol->allocateCluster(m_curCluster, &m_curCluster, !isDir())) {
     DBG_FAIL_MACRO;
     goto fail;
   }
@@ -47,7 +47,7 @@ fail:
   return false;
 #else   // USE_FAT_FILE_FLAG_CONTIGUOUS
   m_flags |= FILE_FLAG_DIR_DIRTY;
-  return m_vol->allocateCluster(m_curCluster, &m_curCluster);
+  return m_vol->allocateCluster(m_curCluster, &m_curCluster, !isDir());
 #endif  // USE_FAT_FILE_FLAG_CONTIGUOUS
 }
 //------------------------------------------------------------------------------
@@ -87,6 +87,103 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
+#if USE_ASYNC_IO
+// Queue a transfer of whole sectors at the current position.
+int FatFile::asyncIo(FsIoRequest* req, uint8_t op, uint8_t* buf,
+                     size_t count) {
+  size_t ns;
+  uint8_t sectorOfCluster;
+  if (!isFile() || req->isPending()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (op == FS_IO_WRITE) {
+    if (!isWritable()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if ((m_flags & FILE_FLAG_APPEND) && !seekSet(m_fileSize)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (count > (0XFFFFFFFF - m_curPosition)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  } else {
+    if (!isReadable()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (count > (m_fileSize - m_curPosition)) {
+      count = m_fileSize - m_curPosition;
+    }
+  }
+  if (m_curPosition & m_vol->sectorMask()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  ns = count >> m_vol->bytesPerSectorShift();
+  if (ns == 0) {
+    return 0;
+  }
+  sectorOfCluster = m_vol->sectorOfCluster(m_curPosition);
+  if (sectorOfCluster == 0) {
+    // start of new cluster
+    if (m_curCluster != 0) {
+      int8_t fg = m_vol->fatGet(m_curCluster, &m_curCluster);
+      if (fg < 0) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      if (fg == 0 && (op != FS_IO_WRITE || !addCluster())) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+    } else if (m_firstCluster) {
+      m_curCluster = m_firstCluster;
+    } else {
+      if (op != FS_IO_WRITE || !addCluster()) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      m_firstCluster = m_curCluster;
+    }
+#if FS_EXTENT_COUNT
+    m_extentMap.add(m_curPosition >> m_vol->bytesPerClusterShift(),
+                    m_curCluster);
+#endif  // FS_EXTENT_COUNT
+  }
+  req->sector = m_vol->clusterStartSector(m_curCluster) + sectorOfCluster;
+  if (!clusterRun(sectorOfCluster, &ns, op == FS_IO_WRITE)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  req->data = buf;
+  req->count = ns;
+  req->op = op;
+  if (!m_vol->cacheSafeSubmit(req)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  count = ns << m_vol->bytesPerSectorShift();
+  m_curPosition += count;
+  if (op == FS_IO_WRITE) {
+    if (m_curPosition > m_fileSize) {
+      m_fileSize = m_curPosition;
+      m_flags |= FILE_FLAG_DIR_DIRTY;
+    } else if (FsDateTime::callback) {
+      m_flags |= FILE_FLAG_DIR_DIRTY;
+    }
+  }
+  return count;
+
+fail:
+  m_error |= op == FS_IO_WRITE ? WRITE_ERROR : READ_ERROR;
+  return -1;
+}
+#endif  // USE_ASYNC_IO
+//------------------------------------------------------------------------------
 bool FatFile::attrib(uint8_t bits) {
   if (!isFileOrSubDir() || (bits & FS_ATTRIB_USER_SETTABLE) != bits) {
     DBG_FAIL_MACRO;
@@ -109,6 +206,88 @@ bool FatFile::attrib(uint8_t bits) {
 fail:
   return false;
 }
+#if USE_AU_ALLOCATION
+//------------------------------------------------------------------------------
+uint32_t FatFile::auCount() {
+  uint32_t n = 0;
+  uint32_t au = 0;
+  Cluster_t cluster = m_firstCluster;
+  if (!isOpen() || m_vol->auClusters() == 0) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (isRootFixed()) {
+    // FAT16 root directory is not in the cluster heap.
+    return 0;
+  }
+  while (cluster) {
+    if (n == 0 || m_vol->auIndex(cluster) != au) {
+      au = m_vol->auIndex(cluster);
+      n++;
+    }
+    int8_t fg = m_vol->fatGet(cluster, &cluster);
+    if (fg < 0) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (fg == 0) {
+      break;
+    }
+  }
+  return n;
+
+fail:
+  return 0;
+}
+#endif  // USE_AU_ALLOCATION
+//------------------------------------------------------------------------------
+uint8_t* FatFile::borrow(size_t* count, bool write) {
+  uint32_t n;
+  uint16_t offset;
+  uint8_t sectorOfCluster;
+  Cluster_t cluster = m_curCluster;
+  uint8_t* pc;
+  *count = 0;
+  if (!isFile() || !(write ? isWritable() : isReadable())) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  n = m_fileSize - m_curPosition;
+  if (n == 0) {
+    // EOF
+    return nullptr;
+  }
+  offset = m_curPosition & m_vol->sectorMask();
+  sectorOfCluster = m_vol->sectorOfCluster(m_curPosition);
+  if (offset == 0 && sectorOfCluster == 0) {
+    // m_curCluster is advanced by read() or seekSet() so just look ahead.
+    if (m_curPosition == 0) {
+      cluster = m_firstCluster;
+#if USE_FAT_FILE_FLAG_CONTIGUOUS
+    } else if (isContiguous()) {
+      cluster++;
+#endif  // USE_FAT_FILE_FLAG_CONTIGUOUS
+    } else if (m_vol->fatGet(m_curCluster, &cluster) <= 0) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+  pc = m_vol->dataCachePrepare(
+      m_vol->clusterStartSector(cluster) + sectorOfCluster,
+      FsCache::CACHE_FOR_READ);
+  if (!pc) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (n > static_cast<uint32_t>(m_vol->bytesPerSector() - offset)) {
+    n = m_vol->bytesPerSector() - offset;
+  }
+  *count = n;
+  return pc + offset;
+
+fail:
+  return nullptr;
+}
 //------------------------------------------------------------------------------
 // cache a file's directory entry
 // return pointer to cached entry or null for failure
@@ -132,6 +311,76 @@ bool FatFile::close() {
   return rtn;
 }
 //------------------------------------------------------------------------------
+#if USE_MULTI_SECTOR_IO || USE_ASYNC_IO
+// Extend a multi-sector transfer over physically adjacent clusters.
+// The transfer starts at sectorOfCluster in the current cluster and *ns is
+// the number of sectors wanted.  On return *ns is limited to the run and
+// m_curCluster is the cluster of the last sector.  Clusters are added at
+// the end of the chain if grow is true.
+bool FatFile::clusterRun(uint8_t sectorOfCluster, size_t* ns, bool grow) {
+  uint32_t index = m_curPosition >> m_vol->bytesPerClusterShift();
+  size_t mb = m_vol->sectorsPerCluster() - sectorOfCluster;
+  while (mb < *ns) {
+    Cluster_t next;
+    int8_t fg;
+#if USE_FAT_FILE_FLAG_CONTIGUOUS
+    if (isFile() && isContiguous() && m_fileSize &&
+        index < ((m_fileSize - 1) >> m_vol->bytesPerClusterShift())) {
+      next = m_curCluster + 1;
+      fg = 1;
+    } else {
+      fg = m_vol->fatGet(m_curCluster, &next);
+    }
+#else   // USE_FAT_FILE_FLAG_CONTIGUOUS
+    fg = m_vol->fatGet(m_curCluster, &next);
+#endif  // USE_FAT_FILE_FLAG_CONTIGUOUS
+    if (fg < 0) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (fg == 0) {
+      if (!grow) {
+        break;
+      }
+      Cluster_t cc = m_curCluster;
+      if (!addCluster()) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      // Chain now has the new cluster.  The caller follows it if not adjacent.
+      next = m_curCluster;
+      m_curCluster = cc;
+    }
+    if (next != (m_curCluster + 1)) {
+      break;
+    }
+    m_curCluster = next;
+    index++;
+#if FS_EXTENT_COUNT
+    m_extentMap.add(index, m_curCluster);
+#endif  // FS_EXTENT_COUNT
+    mb += m_vol->sectorsPerCluster();
+  }
+  if (*ns > mb) {
+    *ns = mb;
+  }
+  return true;
+
+fail:
+  return false;
+}
+#endif  // USE_MULTI_SECTOR_IO || USE_ASYNC_IO
+//------------------------------------------------------------------------------
+// Count of clusters known to be contiguous from the first cluster.
+uint32_t FatFile::contiguousClusters() const {
+#if USE_FAT_FILE_FLAG_CONTIGUOUS
+  if (isFile() && isContiguous() && m_fileSize) {
+    return ((m_fileSize - 1) >> m_vol->bytesPerClusterShift()) + 1;
+  }
+#endif  // USE_FAT_FILE_FLAG_CONTIGUOUS
+  return 0;
+}
+//------------------------------------------------------------------------------
 bool FatFile::contiguousRange(Sector_t* bgnSector, Sector_t* endSector) {
   // error if no clusters
   if (!isFile() || m_firstCluster == 0) {
@@ -170,12 +419,12 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
-bool FatFile::createContiguous(const char* path, uint32_t size) {
+bool FatFile::createContiguous(const char* path, uint32_t size, bool erase) {
   if (!open(FatVolume::cwv(), path, O_CREAT | O_EXCL | O_RDWR)) {
     DBG_FAIL_MACRO;
     goto fail;
   }
-  if (preAllocate(size)) {
+  if (preAllocate(size, erase)) {
     return true;
   }
   close();
@@ -184,12 +433,12 @@ fail:
 }
 //------------------------------------------------------------------------------
 bool FatFile::createContiguous(FatFile* dirFile, const char* path,
-                               uint32_t size) {
+                               uint32_t size, bool erase) {
   if (!open(dirFile, path, O_CREAT | O_EXCL | O_RDWR)) {
     DBG_FAIL_MACRO;
     goto fail;
   }
-  if (preAllocate(size)) {
+  if (preAllocate(size, erase)) {
     return true;
   }
   close();
@@ -197,6 +446,25 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
+#if USE_CREATE_NEW
+bool FatFile::createNew(FatFile* dirFile, const char* name, oflag_t oflag) {
+  FatName_t fname;
+  if (isOpen() || !dirFile->isDir() || !isWriteMode(oflag)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (!parsePathName(name, &fname, &name) || *name) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  fname.flags |= FNAME_FLAG_NEW;
+  return open(dirFile, &fname, oflag | O_CREAT | O_EXCL);
+
+fail:
+  return false;
+}
+#endif  // USE_CREATE_NEW
+//------------------------------------------------------------------------------
 bool FatFile::dirEntry(DirFat_t* dst) {
   const DirFat_t* dir;
   // Make sure fields on device are correct.
@@ -323,6 +591,34 @@ fail:
 //------------------------------------------------------------------------------
 bool FatFile::isBusy() { return m_vol->isBusy(); }
 //------------------------------------------------------------------------------
+int16_t FatFile::listPage(FsDirList* list, uint16_t count) {
+  int8_t rtn;
+  FsDirStat stat;
+  char* name = list->nameBuffer();
+  size_t size = list->nameSize();
+  if (!isDir()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  list->pageBegin(count);
+  while (list->scanNeeded()) {
+    rewind();
+    list->scanBegin();
+    while ((rtn = readDirPlus(&stat, name, size)) > 0) {
+      list->add(&stat);
+    }
+    if (rtn < 0) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    list->scanEnd();
+  }
+  return list->pageEnd();
+
+fail:
+  return -1;
+}
+//------------------------------------------------------------------------------
 bool FatFile::mkdir(FatFile* parent, const char* path, bool pFlag) {
   FatName_t fname;
   FatFile tmpDir;
@@ -736,7 +1032,11 @@ int FatFile::peek() {
   return c;
 }
 //------------------------------------------------------------------------------
-bool FatFile::preAllocate(uint32_t length) {
+#if USE_ASYNC_IO
+uint8_t FatFile::pollAsync() { return m_vol->pollAsync(); }
+#endif  // USE_ASYNC_IO
+//------------------------------------------------------------------------------
+bool FatFile::preAllocate(uint32_t length, bool erase) {
   uint32_t need;
   if (!length || !isWritable() || m_firstCluster) {
     DBG_FAIL_MACRO;
@@ -748,6 +1048,12 @@ bool FatFile::preAllocate(uint32_t length) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  if (erase) {
+    // Erase is a hint so errors are ignored and not reported.
+    Sector_t first = m_vol->clusterStartSector(m_firstCluster);
+    m_vol->eraseHint(first,
+                     first + (need << m_vol->sectorsPerClusterShift()) - 1);
+  }
   m_fileSize = length;
 
 #if USE_FAT_FILE_FLAG_CONTIGUOUS
@@ -759,6 +1065,75 @@ bool FatFile::preAllocate(uint32_t length) {
 #endif  // USE_FAT_FILE_FLAG_CONTIGUOUS
   return sync();
 
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+// Check that ns sectors at index are in contiguous clusters of the file.
+// Only FAT entries after the clusters known to be contiguous are read.
+bool FatFile::rawCheck(uint32_t index, size_t ns) {
+  uint64_t last;
+  uint32_t known;
+  Cluster_t cluster;
+  if (!isFile() || m_firstCluster == 0 || ns == 0) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  // Last cluster needed.
+  last = m_firstCluster +
+         (((uint64_t)index + ns - 1) >> m_vol->sectorsPerClusterShift());
+  if (last > m_vol->clusterCount() + 1) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  known = contiguousClusters();
+  cluster = known ? m_firstCluster + known - 1 : m_firstCluster;
+  for (; cluster < last; cluster++) {
+    Cluster_t next;
+    if (m_vol->fatGet(cluster, &next) <= 0 || next != (cluster + 1)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool FatFile::rawEnd(uint64_t length) {
+  if (!isWritable() || !isFile() || length > 0XFFFFFFFF ||
+      (length && !rawCheck((length - 1) >> m_vol->bytesPerSectorShift(), 1))) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_fileSize = length;
+  m_flags |= FILE_FLAG_DIR_DIRTY;
+  rewind();
+  return sync();
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool FatFile::rawRead(uint32_t index, uint8_t* dst, size_t ns) {
+  if (!rawCheck(index, ns)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  return m_vol->cacheSafeRead(firstSector() + index, dst, ns);
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool FatFile::rawWrite(uint32_t index, const uint8_t* src, size_t ns) {
+  if (!isWritable() || !rawCheck(index, ns)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  return m_vol->cacheSafeWrite(firstSector() + index, src, ns);
+
 fail:
   return false;
 }
@@ -822,6 +1197,10 @@ int FatFile::readPrivate(void* buf, size_t nbyte, DirFat_t** cache) {
             goto fail;
           }
         }
+#if FS_EXTENT_COUNT
+        m_extentMap.add(m_curPosition >> m_vol->bytesPerClusterShift(),
+                        m_curCluster);
+#endif  // FS_EXTENT_COUNT
       }
       sector = m_vol->clusterStartSector(m_curCluster) + sectorOfCluster;
     }
@@ -848,11 +1227,10 @@ int FatFile::readPrivate(void* buf, size_t nbyte, DirFat_t** cache) {
 #if USE_MULTI_SECTOR_IO
     } else if (toRead >= 2 * m_vol->bytesPerSector()) {
       size_t ns = toRead >> m_vol->bytesPerSectorShift();
-      if (!isRootFixed()) {
-        size_t mb = m_vol->sectorsPerCluster() - sectorOfCluster;
-        if (mb < ns) {
-          ns = mb;
-        }
+      // Read over adjacent clusters with one command.
+      if (!isRootFixed() && !clusterRun(sectorOfCluster, &ns, false)) {
+        DBG_FAIL_MACRO;
+        goto fail;
       }
       n = ns << m_vol->bytesPerSectorShift();
       if (!m_vol->cacheSafeRead(sector, dst, ns)) {
@@ -920,6 +1298,25 @@ DirFat_t* FatFile::readDirCache() {
   return nullptr;
 }
 //------------------------------------------------------------------------------
+bool FatFile::release(size_t count, bool modified) {
+  if (!isFile() || (modified && !isWritable()) ||
+      count > static_cast<size_t>(m_vol->bytesPerSector() -
+                                  (m_curPosition & m_vol->sectorMask()))) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (modified) {
+    // The borrowed sector is still the current cache line.
+    m_vol->cacheDirty();
+    // set modified bit so sync() updates the modify date and time
+    m_flags |= FILE_FLAG_DIR_DIRTY;
+  }
+  return seekSet(m_curPosition + count);
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
 bool FatFile::remove(const char* path) {
   FatFile file;
   if (!file.open(this, path, O_WRONLY)) {
@@ -1088,19 +1485,26 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
-bool FatFile::rmRfStar() {
-  uint16_t index;
-  FatFile f;
-  if (!isDir()) {
+// Remove all entries of this directory.  Entries are marked deleted in the
+// cache and chains are freed by rmRfFlush() after the directory is written.
+int8_t FatFile::rmRfDir(FsBaseRmRf* rm, uint8_t depth) {
+  uint32_t pos;
+  Cluster_t cluster;
+  DirFat_t* dir;
+  FatFile sub;
+#if USE_DIR_INDEX
+  FsDirIndex* index = m_vol->dirIndex(m_firstCluster);
+  if (index) {
+    index->invalidate();
+  }
+#endif  // USE_DIR_INDEX
+  if (!seekSet(rm->position(depth))) {
     DBG_FAIL_MACRO;
     goto fail;
   }
-  rewind();
   while (1) {
-    // remember position
-    index = m_curPosition / FS_DIR_SIZE;
-
-    const DirFat_t* dir = readDirCache();
+    pos = m_curPosition;
+    dir = readDirCache();
     if (!dir) {
       // At EOF if no error.
       if (!getError()) {
@@ -1113,56 +1517,133 @@ bool FatFile::rmRfStar() {
     if (dir->name[0] == FAT_NAME_FREE) {
       break;
     }
-
-    // skip empty slot or '.' or '..'
-    if (dir->name[0] == FAT_NAME_DELETED || dir->name[0] == '.') {
+    // skip empty slot, '.', '..' or volume label in root
+    if (dir->name[0] == FAT_NAME_DELETED || dir->name[0] == '.' ||
+        (!isFatLongName(dir) && !isFatFileOrSubdir(dir))) {
       continue;
     }
-
-    // skip if part of long file name or volume label in root
-    if (!isFatFileOrSubdir(dir)) {
+    if (isFatLongName(dir)) {
+      dir->name[0] = FAT_NAME_DELETED;
+      m_vol->cacheDirty();
       continue;
     }
-
-    if (!f.open(this, index, O_RDONLY)) {
-      DBG_FAIL_MACRO;
-      goto fail;
-    }
-    if (f.isSubDir()) {
-      // recursively delete
-      if (!f.rmRfStar()) {
+    cluster = ((Cluster_t)getLe16(dir->firstClusterHigh) << 16) |
+              getLe16(dir->firstClusterLow);
+    if (isFatSubdir(dir)) {
+      // Open from the cached entry then empty the batch for the subdirectory.
+      if (!sub.openCachedEntry(this, pos / FS_DIR_SIZE, O_RDONLY, 0) ||
+          !rmRfFlush(rm)) {
         DBG_FAIL_MACRO;
         goto fail;
       }
-    } else {
-      // ignore read-only
-      f.m_flags |= FILE_FLAG_WRITE;
-      if (!f.remove()) {
+      rm->setPosition(depth, pos);
+      int8_t rtn = sub.rmRfDir(rm, depth + 1);
+      if (rtn <= 0) {
+        return rtn;
+      }
+      // Closed without a sync.
+      sub.m_attributes = FILE_ATTR_CLOSED;
+      sub.m_flags = 0;
+#if USE_DIR_INDEX
+      if (m_vol->dirIndex(cluster)) {
+        m_vol->m_dirIndex.end();
+      }
+#endif  // USE_DIR_INDEX
+#if SFN_TAIL_MAP_SIZE
+      if (m_vol->m_sfnTail.dir == cluster) {
+        m_vol->m_sfnTail.base = 0;
+      }
+#endif  // SFN_TAIL_MAP_SIZE
+      dir = cacheDir(pos / FS_DIR_SIZE);
+      if (!dir) {
         DBG_FAIL_MACRO;
         goto fail;
       }
     }
-    // position to next entry if required
-    if (m_curPosition != (32UL * (index + 1))) {
-      if (!seekSet(32UL * (index + 1))) {
+    dir->name[0] = FAT_NAME_DELETED;
+    m_vol->cacheDirty();
+    rm->remove();
+    if (cluster && rm->add(cluster, 0) && !rmRfFlush(rm)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    if (rm->spent()) {
+      if (!rmRfFlush(rm)) {
         DBG_FAIL_MACRO;
         goto fail;
       }
+      rm->setPosition(depth, m_curPosition);
+      return 0;
     }
   }
-  // don't try to delete root
-  if (!isRoot()) {
-    if (!rmdir()) {
+  if (!rmRfFlush(rm)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  rm->setPosition(depth, 0);
+  return 1;
+
+fail:
+  return -1;
+}
+//------------------------------------------------------------------------------
+// Write deleted entries then free the chains of the batch.
+bool FatFile::rmRfFlush(FsBaseRmRf* rm) {
+  if (!m_vol->dataCache()->sync()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  for (uint8_t i = 0; i < rm->batchCount(); i++) {
+    if (!m_vol->freeChain(rm->cluster(i), rm->clusterCount(i))) {
       DBG_FAIL_MACRO;
       goto fail;
     }
   }
+  if (rm->batchCount()) {
+    rm->clearBatch();
+  }
   return true;
 
 fail:
   return false;
 }
 //------------------------------------------------------------------------------
+bool FatFile::rmRfStar() {
+  FsRmRfOnce rm;
+  rm.begin();
+  return rmRfStar(&rm) > 0;
+}
+//------------------------------------------------------------------------------
+int8_t FatFile::rmRfStar(FsBaseRmRf* rm) {
+  int8_t rtn;
+  if (!isDir()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  rm->callBegin();
+  rtn = rmRfDir(rm, 0);
+  if (rtn < 0) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  // don't try to delete root
+  if (rtn > 0 && !isRoot()) {
+    if (!rmdir()) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    rm->remove();
+  }
+  if (!m_vol->cacheSync()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  return rtn;
+
+fail:
+  return -1;
+}
+//------------------------------------------------------------------------------
 bool FatFile::seekSet(uint32_t pos) {
   uint32_t nCur;
   uint32_t nNew;
@@ -1201,21 +1682,38 @@ bool FatFile::seekSet(uint32_t pos) {
     goto done;
   }
 #endif  // USE_FAT_FILE_FLAG_CONTIGUOUS
+#if FS_EXTENT_COUNT
+  m_curCluster = m_extentMap.find(nNew);
+  if (m_curCluster) {
+    goto done;
+  }
+  m_curCluster = tmp;
+#endif  // FS_EXTENT_COUNT
   // calculate cluster index for current position
   nCur = (m_curPosition - 1) >> (m_vol->bytesPerClusterShift());
 
   if (nNew < nCur || m_curPosition == 0) {
     // must follow chain from first cluster
     m_curCluster = isRoot32() ? m_vol->rootDirStart() : m_firstCluster;
-  } else {
-    // advance from curPosition
-    nNew -= nCur;
+    nCur = 0;
+  }
+#if FS_EXTENT_COUNT
+  m_extentMap.add(nCur, m_curCluster);
+  if (m_extentMap.end() > nCur + 1) {
+    // start from last mapped cluster
+    nCur = m_extentMap.end() - 1;
+    m_curCluster = m_extentMap.find(nCur);
   }
-  while (nNew--) {
+#endif  // FS_EXTENT_COUNT
+  while (nCur < nNew) {
     if (m_vol->fatGet(m_curCluster, &m_curCluster) <= 0) {
       DBG_FAIL_MACRO;
       goto fail;
     }
+    nCur++;
+#if FS_EXTENT_COUNT
+    m_extentMap.add(nCur, m_curCluster);
+#endif  // FS_EXTENT_COUNT
   }
 
 done:
@@ -1316,6 +1814,7 @@ fail:
 //------------------------------------------------------------------------------
 bool FatFile::truncate() {
   uint32_t toFree;
+  uint32_t known;
   // error if not a normal file or read-only
   if (!isWritable()) {
     DBG_FAIL_MACRO;
@@ -1324,7 +1823,11 @@ bool FatFile::truncate() {
   if (m_firstCluster == 0) {
     return true;
   }
+  // Clusters after the current cluster that are known to be contiguous.
+  known = contiguousClusters();
   if (m_curCluster) {
+    uint32_t n = ((m_curPosition - 1) >> m_vol->bytesPerClusterShift()) + 1;
+    known = known > n ? known - n : 0;
     toFree = 0;
     int8_t fg = m_vol->fatGet(m_curCluster, &toFree);
     if (fg < 0) {
@@ -1343,12 +1846,17 @@ bool FatFile::truncate() {
     m_firstCluster = 0;
   }
   if (toFree) {
-    if (!m_vol->freeChain(toFree)) {
+    if (!m_vol->freeChain(toFree, known)) {
       DBG_FAIL_MACRO;
       goto fail;
     }
   }
   m_fileSize = m_curPosition;
+#if FS_EXTENT_COUNT
+  m_extentMap.truncate(
+      m_curPosition ? ((m_curPosition - 1) >> m_vol->bytesPerClusterShift()) + 1
+                    : 0);
+#endif  // FS_EXTENT_COUNT
 
   // need to update directory entry
   m_flags |= FILE_FLAG_DIR_DIRTY;
@@ -1427,6 +1935,10 @@ size_t FatFile::write(const void* buf, size_t nbyte) {
           m_curCluster = m_firstCluster;
         }
       }
+#if FS_EXTENT_COUNT
+      m_extentMap.add(m_curPosition >> m_vol->bytesPerClusterShift(),
+                      m_curCluster);
+#endif  // FS_EXTENT_COUNT
     }
     // sector for data write
     Sector_t sector = m_vol->clusterStartSector(m_curCluster) + sectorOfCluster;
@@ -1464,11 +1976,11 @@ size_t FatFile::write(const void* buf, size_t nbyte) {
       }
 #if USE_MULTI_SECTOR_IO
     } else if (nToWrite >= 2 * m_vol->bytesPerSector()) {
-      // use multiple sector write command
-      size_t maxSectors = m_vol->sectorsPerCluster() - sectorOfCluster;
+      // use multiple sector write command over adjacent clusters
       size_t nSector = nToWrite >> m_vol->bytesPerSectorShift();
-      if (nSector > maxSectors) {
-        nSector = maxSectors;
+      if (!clusterRun(sectorOfCluster, &nSector, true)) {
+        DBG_FAIL_MACRO;
+        goto fail;
       }
       n = nSector << m_vol->bytesPerSectorShift();
       if (!m_vol->cacheSafeWrite(sector, src, nSector)) {
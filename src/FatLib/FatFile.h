@@ -34,9 +34,13 @@
 #include "../common/FmtNumber.h"
 #include "../common/FsApiConstants.h"
 #include "../common/FsDateTime.h"
+#include "../common/FsDirStat.h"
+#include "../common/FsExtentMap.h"
 #include "../common/FsName.h"
 #include "FatPartition.h"
 class FatVolume;
+class FsBaseRmRf;
+class FsDirList;
 //------------------------------------------------------------------------------
 /**
  * \struct FatPos_t
@@ -99,6 +103,8 @@ const uint8_t FNAME_FLAG_NEED_LFN =
 const uint8_t FNAME_FLAG_LC_BASE = FAT_CASE_LC_BASE;
 /** Filename extension is all lower case. */
 const uint8_t FNAME_FLAG_LC_EXT = FAT_CASE_LC_EXT;
+/** Caller promises the name is not in the directory. */
+const uint8_t FNAME_FLAG_NEW = 0X80;
 //==============================================================================
 /**
  * \class FatFile
@@ -210,6 +216,13 @@ class FatFile {
    * \return true for success or false for failure.
    */
   bool attrib(uint8_t bits);
+#if USE_AU_ALLOCATION
+  /** \return The number of card allocation units (AU) spanned by the
+   * file's clusters or zero if the AU size is not set or an error occurs.
+   * An AU is counted again each time the cluster chain returns to it.
+   */
+  uint32_t auCount();
+#endif  // USE_AU_ALLOCATION
   /** \return The number of bytes available from the current position
    * to EOF for normal files.  INT_MAX is returned for very large files.
    *
@@ -228,6 +241,35 @@ class FatFile {
   uint32_t available32() const {
     return isFile() ? fileSize() - curPosition() : 0;
   }
+  /** Borrow cached bytes at the current position for reading.
+   *
+   * The bytes are in the volume cache so no copy is made.  The bytes run
+   * from the current position to the end of the sector or EOF.  The
+   * position is not changed until release() is called.
+   *
+   * The address is only valid until the next call that accesses the
+   * volume other than release().
+   *
+   * \param[out] count Number of bytes at the returned address.
+   *
+   * \return Address of the bytes or nullptr at EOF or for an error.
+   */
+  const uint8_t* borrowRead(size_t* count) {
+    return borrow(count, false);
+  }
+  /** Borrow cached bytes at the current position for overwriting.
+   *
+   * Same as borrowRead() for a file that is open for write.  The cached
+   * sector is only marked dirty by release() with \a modified true, so
+   * a borrow that changes nothing writes nothing.  Only existing bytes
+   * can be changed.  The file can't be extended, nullptr is returned at
+   * EOF so use write() to append.
+   *
+   * \param[out] count Number of bytes at the returned address.
+   *
+   * \return Address of the bytes or nullptr at EOF or for an error.
+   */
+  uint8_t* borrowWrite(size_t* count) { return borrow(count, true); }
   /** Clear all error bits. */
   void clearError() { m_error = 0; }
   /** Set writeError to zero */
@@ -253,18 +295,43 @@ class FatFile {
    * \param[in] dirFile The directory where the file will be created.
    * \param[in] path A path with a valid file name.
    * \param[in] size The desired file size.
+   * \param[in] erase Erase the allocated sectors so later writes go to
+   *            pre-erased flash.  Ignored if the device can't erase.
    *
    * \return true for success or false for failure.
    */
-  bool createContiguous(FatFile* dirFile, const char* path, uint32_t size);
+  bool createContiguous(FatFile* dirFile, const char* path, uint32_t size,
+                        bool erase = false);
   /** Create and open a new contiguous file of a specified size.
    *
    * \param[in] path A path with a valid file name.
    * \param[in] size The desired file size.
+   * \param[in] erase Erase the allocated sectors so later writes go to
+   *            pre-erased flash.  Ignored if the device can't erase.
    *
    * \return true for success or false for failure.
    */
-  bool createContiguous(const char* path, uint32_t size);
+  bool createContiguous(const char* path, uint32_t size, bool erase = false);
+#if USE_CREATE_NEW
+  /** Create and open a file with a name that is not in the directory.
+   *
+   * The directory is not searched for the name.  New entries go at the
+   * end of used entries remembered by \a dirFile so a sequence of creates
+   * in one open directory doesn't rescan the directory.  A name that needs
+   * a numeric ~N short name is checked against other short names.
+   *
+   * WARNING: A duplicate name will result if the name, or a short name
+   * equal to the short name for \a name, is in the directory.
+   *
+   * \param[in] dirFile An open directory where the file will be created.
+   * \param[in] name A valid file name, not a path.
+   * \param[in] oflag Open flags, must include O_WRONLY or O_RDWR.
+   *            O_CREAT and O_EXCL are implied.
+   *
+   * \return true for success or false for failure.
+   */
+  bool createNew(FatFile* dirFile, const char* name, oflag_t oflag = O_WRONLY);
+#endif  // USE_CREATE_NEW
   /** \return The current cluster number for a file or directory. */
   Cluster_t curCluster() const { return m_curCluster; }
 
@@ -462,6 +529,19 @@ class FatFile {
   bool isSystem() const { return m_attributes & FS_ATTRIB_SYSTEM; }
   /** \return True file is writable. */
   bool isWritable() const { return m_flags & FILE_FLAG_WRITE; }
+  /** Read the next page of a sorted directory listing.
+   *
+   * The directory is scanned with readDirPlus() only when the entries for
+   * the page are not already in the arena of \a list.  See FsDirList.
+   *
+   * \param[in,out] list State from FsDirList::begin().  Entries of the
+   *                 page are available with FsDirList::entry().
+   * \param[in] count Maximum number of entries in the page.
+   *
+   * \return Number of entries in the page, zero at the end of the list, or
+   *         -1 for an error.
+   */
+  int16_t listPage(FsDirList* list, uint16_t count);
   /** List directory contents.
    *
    * \param[in] pr Print stream for list.
@@ -625,6 +705,13 @@ class FatFile {
    * \return The byte if no error and not at eof else -1;
    */
   int peek();
+#if USE_ASYNC_IO
+  /** Advance asynchronous requests on the file's device without waiting.
+   *
+   * \return Number of requests not yet complete.
+   */
+  uint8_t pollAsync();
+#endif  // USE_ASYNC_IO
   /** Allocate contiguous clusters to an empty file.
    *
    * The file must be empty with no clusters allocated.
@@ -632,9 +719,11 @@ class FatFile {
    * The file will contain uninitialized data.
    *
    * \param[in] length size of the file in bytes.
+   * \param[in] erase Erase the allocated sectors so later writes go to
+   *            pre-erased flash.  Ignored if the device can't erase.
    * \return true for success or false for failure.
    */
-  bool preAllocate(uint32_t length);
+  bool preAllocate(uint32_t length, bool erase = false);
   /** Print a file's access date
    *
    * \param[in] pr Print stream for output.
@@ -774,6 +863,40 @@ class FatFile {
    *         for success and zero is returned for failure.
    */
   size_t printSFN(print_t* pr);
+  /** Set the size of a file written with rawWrite() and sync it.
+   *
+   * Updates the directory entry with one write.  The file position is
+   * set to zero.
+   *
+   * \param[in] length New file size, less than 4 GiB.  Must not be more
+   *            than the contiguous clusters allocated to the file.
+   * \return true for success or false for failure.
+   */
+  bool rawEnd(uint64_t length);
+  /** Read sectors of a contiguous file directly from the device.
+   *
+   * The sectors must be in the range from contiguousRange().  Cached
+   * sectors are written first so the data is current.
+   *
+   * \param[in] index Index of the first sector in the file.
+   * \param[out] dst Location for the data.
+   * \param[in] ns Number of sectors.
+   * \return true for success or false for failure.
+   */
+  bool rawRead(uint32_t index, uint8_t* dst, size_t ns);
+  /** Write sectors of a contiguous file directly to the device.
+   *
+   * Used with rawEnd() to write a preallocated contiguous file at the
+   * device's multi-sector rate.  The sectors must be in the range from
+   * contiguousRange().  The file size is not changed.  FAT entries for
+   * clusters past the file size are read to check the range.
+   *
+   * \param[in] index Index of the first sector in the file.
+   * \param[in] src Data to write.
+   * \param[in] ns Number of sectors.
+   * \return true for success or false for failure.
+   */
+  bool rawWrite(uint32_t index, const uint8_t* src, size_t ns);
   /** Read the next byte from a file.
    *
    * \return For success read returns the next byte in the file as an int.
@@ -795,6 +918,24 @@ class FatFile {
    * If an error occurs, read() returns -1.
    */
   int read(void* buf, size_t count) { return readPrivate(buf, count, nullptr); }
+#if USE_ASYNC_IO
+  /** Queue a read of whole sectors at the current position.
+   *
+   * The position must be a multiple of 512.  The request stops at the last
+   * whole sector of the file or at the end of a run of adjacent clusters
+   * so call again for the rest.  Use read() for a partial last sector.
+   * The position advances when the request is queued.
+   *
+   * \param[in,out] req Request for the transfer.
+   * \param[out] buf Location for the data.  Valid when req is done.
+   * \param[in] count Maximum number of bytes to read.
+   * \return Number of bytes queued, zero if less than one sector remains
+   * or -1 for an error.
+   */
+  int readAsync(FsIoRequest* req, void* buf, size_t count) {
+    return asyncIo(req, FS_IO_READ, reinterpret_cast<uint8_t*>(buf), count);
+  }
+#endif  // USE_ASYNC_IO
   /** Read the next directory entry from a directory file.
    *
    * \param[out] dir The DirFat_t struct that will receive the data.
@@ -806,6 +947,35 @@ class FatFile {
    * a directory file or an I/O error occurred.
    */
   int8_t readDir(DirFat_t* dir);
+  /** Read the next file or subdirectory of a directory without opening it.
+   *
+   * The directory is read in one pass and the long name is decoded as its
+   * entries are read.  Deleted entries, '.', '..' and the volume label are
+   * skipped.  The short name is returned if there is no valid long name or
+   * the long name does not fit in \a size bytes.  FsDirStat::nameTruncated
+   * is set for a long name that does not fit.  Use
+   * open(dirFile, stat->dirIndex) and printName() for the long name.
+   *
+   * \param[out] stat Information for the entry.
+   * \param[out] name Name of the entry or nullptr if not needed.
+   * \param[in] size Size of \a name.  At least 13 for a short name.
+   *
+   * \return 1 for an entry, 0 at the end of the directory, or -1 for an
+   *         error.
+   */
+  int8_t readDirPlus(FsDirStat* stat, char* name = nullptr, size_t size = 0);
+  /** Move the current position past bytes from borrowRead() or
+   * borrowWrite().
+   *
+   * \param[in] count Number of bytes used.  Not more than the count
+   *            returned by the borrow call.
+   * \param[in] modified Set true if bytes from borrowWrite() were
+   *            changed.  The cached sector is then written to the device
+   *            and sync() updates the modify time.
+   *
+   * \return true for success or false for failure.
+   */
+  bool release(size_t count, bool modified = false);
   /** Remove a file.
    *
    * The directory entry and all data for the file are deleted.
@@ -879,6 +1049,19 @@ class FatFile {
    * \return true for success or false for failure.
    */
   bool rmRfStar();
+  /** Recursively delete a directory in steps.
+   *
+   * Same as rmRfStar() but each call removes at most rm->budget() files
+   * and directories.  Entries are marked deleted in the cache and the
+   * chains are freed in batches.  The volume is synced once at the end of
+   * each call.  Call rm->begin() before the first call.
+   *
+   * \param[in,out] rm State of the delete, normally an FsRmRf.
+   *
+   * \return 1 when the delete is done, 0 if the budget is used, or -1 for
+   *         an error.
+   */
+  int8_t rmRfStar(FsBaseRmRf* rm);
   /** Set the files position to current position + \a pos. See seekSet().
    * \param[in] offset The new position in bytes from the current position.
    * \return true for success or false for failure.
@@ -955,6 +1138,8 @@ class FatFile {
    * \return true for success or false for failure.
    */
   bool truncate(uint32_t length) { return seekSet(length) && truncate(); }
+  /** \return The valid number of bytes in a file, same as fileSize(). */
+  uint32_t validLength() const { return m_fileSize; }
   /** Write a string to a file. Used by the Arduino Print class.
    * \param[in] str Pointer to the string.
    * Use getWriteError to check for errors.
@@ -980,6 +1165,27 @@ class FatFile {
    *
    */
   size_t write(const void* buf, size_t count);
+#if USE_ASYNC_IO
+  /** Queue a write of whole sectors at the current position.
+   *
+   * The position must be a multiple of 512.  Clusters are allocated as
+   * needed.  The request stops at the end of a run of adjacent clusters
+   * so call again for the rest.  The position and file size advance when
+   * the request is queued.  Call sync() to complete all requests and update
+   * the directory entry.
+   *
+   * \param[in,out] req Request for the transfer.
+   * \param[in] buf Data to be written.  Must not change until req is done.
+   * \param[in] count Maximum number of bytes to write.
+   * \return Number of bytes queued, zero if count is less than one sector
+   * or -1 for an error.
+   */
+  int writeAsync(FsIoRequest* req, const void* buf, size_t count) {
+    return asyncIo(req, FS_IO_WRITE,
+                   const_cast<uint8_t*>(reinterpret_cast<const uint8_t*>(buf)),
+                   count);
+  }
+#endif  // USE_ASYNC_IO
 //------------------------------------------------------------------------------
 #if ENABLE_ARDUINO_SERIAL
   /** List directory contents.
@@ -1025,12 +1231,24 @@ class FatFile {
 
   bool addCluster();
   bool addDirCluster();
+#if USE_ASYNC_IO
+  int asyncIo(FsIoRequest* req, uint8_t op, uint8_t* buf, size_t count);
+#endif  // USE_ASYNC_IO
+  uint8_t* borrow(size_t* count, bool write);
+#if USE_DIR_INDEX
+  bool buildDirIndex(FsDirIndex* index);
+#endif  // USE_DIR_INDEX
+#if USE_MULTI_SECTOR_IO || USE_ASYNC_IO
+  bool clusterRun(uint8_t sectorOfCluster, size_t* ns, bool grow);
+#endif  // USE_MULTI_SECTOR_IO || USE_ASYNC_IO
   DirFat_t* cacheDir(uint16_t index) {
     return seekSet(32UL * index) ? readDirCache() : nullptr;
   }
   DirFat_t* cacheDirEntry(uint8_t action);
   bool cmpName(uint16_t index, FatLfn_t* fname, uint8_t lfnOrd);
+  uint32_t contiguousClusters() const;
   bool createLFN(uint16_t index, FatLfn_t* fname, uint8_t lfnOrd);
+  static size_t formatSfn(const DirFat_t* dir, char* name, size_t size);
   uint16_t getLfnChar(const DirLfn_t* ldir, uint8_t i);
   uint8_t lfnChecksum(const uint8_t* name) {
     uint8_t sum = 0;
@@ -1039,7 +1257,12 @@ class FatFile {
     }
     return sum;
   }
+  bool lsPrivate(print_t* pr, uint8_t flags, uint8_t indent, char* name,
+                 size_t size);
   static bool makeSFN(FatLfn_t* fname);
+#if SFN_TAIL_MAP_SIZE
+  bool makeSfnTail(FatLfn_t* fname);
+#endif  // SFN_TAIL_MAP_SIZE
   bool makeUniqueSfn(FatLfn_t* fname);
   bool openCluster(FatFile* file);
   bool parsePathName(const char* str, FatLfn_t* fname, const char** ptr);
@@ -1050,7 +1273,10 @@ class FatFile {
   bool openSFN(const FatSfn_t* fname);
   bool openCachedEntry(FatFile* dirFile, uint16_t cacheIndex, oflag_t oflag,
                        uint8_t lfnOrd);
+  bool rawCheck(uint32_t index, size_t ns);
   DirFat_t* readDirCache();
+  int8_t rmRfDir(FsBaseRmRf* rm, uint8_t depth);
+  bool rmRfFlush(FsBaseRmRf* rm);
   int readPrivate(void* buf, size_t nbyte, DirFat_t** cache);
   // bits defined in m_flags
   static const uint8_t FILE_FLAG_READ = 0X01;
@@ -1072,6 +1298,9 @@ class FatFile {
   uint8_t m_flags = 0;  // See above for definition of m_flags bits
   uint8_t m_lfnOrd;
   uint16_t m_dirIndex;  // index of directory entry in dir file
+#if USE_CREATE_NEW
+  uint16_t m_dirEnd;  // end of directory index plus one, zero if unknown
+#endif  // USE_CREATE_NEW
   FatVolume* m_vol;     // volume where file is located
   Cluster_t m_dirCluster;
   Cluster_t m_curCluster;    // cluster for current file position
@@ -1079,6 +1308,9 @@ class FatFile {
   Sector_t m_dirSector;      // sector for this files directory entry
   uint32_t m_fileSize;       // file size in bytes
   Cluster_t m_firstCluster;  // first cluster of file
+#if FS_EXTENT_COUNT
+  FsExtentMap m_extentMap;  // cluster runs learned from the FAT
+#endif  // FS_EXTENT_COUNT
 };
 
 #include "../common/ArduinoFiles.h"
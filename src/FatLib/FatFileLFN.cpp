@@ -52,6 +52,176 @@ static void putLfnChar(DirLfn_t* ldir, uint8_t i, uint16_t c) {
     setLe16(ldir->unicode3 + 2 * (i - 11), c);
   }
 }
+//------------------------------------------------------------------------------
+// Store a ~HHHH tail at pos in a short name.
+static void putSfnTail(uint8_t* sfn, uint8_t pos, uint16_t tail) {
+  sfn[pos] = '~';
+  for (uint8_t i = pos + 4; i > pos; i--) {
+    uint8_t h = tail & 0XF;
+    sfn[i] = h < 10 ? h + '0' : h + 'A' - 10;
+    tail >>= 4;
+  }
+}
+#if USE_DIR_INDEX
+//------------------------------------------------------------------------------
+// Hash of a character at a position in a name.  Terms for each character
+// are added so LFN entries can be hashed in directory order.
+static uint32_t dirHashChar(uint16_t u, uint16_t pos) {
+#if USE_UTF8_LONG_NAMES
+  u = toUpcase(u);
+#else   // USE_UTF8_LONG_NAMES
+  u = u < 0X80 ? toUpper(u) : u;
+#endif  // USE_UTF8_LONG_NAMES
+  uint32_t h = (u | (uint32_t)pos << 16) * 0X9E3779B1;
+  h ^= h >> 15;
+  h *= 0X85EBCA6B;
+  return h ^ (h >> 13);
+}
+//------------------------------------------------------------------------------
+static uint16_t dirHashFold(uint32_t h) { return h ^ (h >> 16); }
+//------------------------------------------------------------------------------
+static uint16_t dirHashLfn(FatLfn_t* fname) {
+  uint32_t h = 0;
+  fname->reset();
+  for (uint16_t pos = 0; !fname->atEnd(); pos++) {
+    h += dirHashChar(fname->get16(), pos);
+  }
+  return dirHashFold(h);
+}
+//------------------------------------------------------------------------------
+static uint16_t dirHashSfn(const uint8_t* sfn) {
+  uint32_t h = 0;
+  for (uint8_t i = 0; i < 11; i++) {
+    h += dirHashChar(sfn[i], i);
+  }
+  return dirHashFold(h);
+}
+#endif  // USE_DIR_INDEX
+#if SFN_TAIL_MAP_SIZE
+//------------------------------------------------------------------------------
+// Bit in the map for the ~HHHH tail of a short name or -1 if the name has
+// no tail at the position for the map or the tail is outside the map.
+// Tails are shared by all prefixes and extensions.
+static int32_t sfnTailBit(const FatSfnTail_t* map, const uint8_t* sfn) {
+  uint8_t pos = map->pos;
+  uint16_t tail = 0;
+  if (sfn[pos] != '~') {
+    return -1;
+  }
+  for (uint8_t i = pos + 1; i < pos + 5; i++) {
+    uint8_t c = sfn[i];
+    if ('0' <= c && c <= '9') {
+      c -= '0';
+    } else if ('A' <= c && c <= 'F') {
+      c -= 'A' - 10;
+    } else {
+      return -1;
+    }
+    tail = (tail << 4) | c;
+  }
+  tail -= map->base;
+  return tail < SFN_TAIL_MAP_SIZE ? tail : -1;
+}
+//------------------------------------------------------------------------------
+// Mark the tail of a short name in a directory as used.
+static void sfnTailMark(FatSfnTail_t* map, Cluster_t dir, const uint8_t* sfn) {
+  if (map->base && map->valid && map->dir == dir) {
+    int32_t bit = sfnTailBit(map, sfn);
+    if (bit >= 0) {
+      map->used[bit >> 5] |= 1UL << (bit & 31);
+    }
+  }
+}
+#endif  // SFN_TAIL_MAP_SIZE
+#if USE_DIR_INDEX
+//==============================================================================
+// Index all files in the directory.  SFN entries without a valid LFN set
+// use the SFN hash for both hashes.
+bool FatFile::buildDirIndex(FsDirIndex* index) {
+  uint8_t checksum = 0;
+  uint8_t order = 0;
+  uint16_t alias;
+  uint32_t curIndex;
+  uint32_t first = 0;
+  uint32_t freeIndex = 0;
+  uint32_t freeFound = 0;
+  uint32_t hash = 0;
+  const DirFat_t* dir;
+  const DirLfn_t* ldir;
+
+  index->buildBegin();
+  rewind();
+  while (1) {
+    curIndex = m_curPosition / FS_DIR_SIZE;
+    dir = readDirCache();
+    if (!dir) {
+      if (getError()) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      // At EOF
+      break;
+    }
+    if (dir->name[0] == FAT_NAME_FREE) {
+      break;
+    }
+    if (dir->name[0] == FAT_NAME_DELETED) {
+      if (freeFound == 0) {
+        freeIndex = curIndex;
+      }
+      freeFound++;
+      order = 0;
+      continue;
+    }
+    if (freeFound) {
+      index->addFree(freeIndex, freeFound);
+      freeFound = 0;
+    }
+    if (isFatLongName(dir)) {
+      ldir = reinterpret_cast<const DirLfn_t*>(dir);
+      if (ldir->order & FAT_ORDER_LAST_LONG_ENTRY) {
+        order = ldir->order & 0X1F;
+        first = curIndex;
+        checksum = ldir->checksum;
+        hash = 0;
+      } else if (order > 1 && ldir->order == order - 1 &&
+                 ldir->checksum == checksum) {
+        order = ldir->order;
+      } else {
+        order = 0;
+      }
+      if (order == 0) {
+        continue;
+      }
+      for (uint8_t i = 0; i < 13; i++) {
+        uint16_t u = getLfnChar(ldir, i);
+        if (u == 0) {
+          break;
+        }
+        hash += dirHashChar(u, 13 * (order - 1) + i);
+      }
+    } else if (isFatFileOrSubdir(dir) && dir->name[0] != '.') {
+      alias = dirHashSfn(dir->name);
+      if (order == 1 && lfnChecksum(dir->name) == checksum) {
+        index->add(first, curIndex - first + 1, dirHashFold(hash), alias);
+      } else {
+        index->add(curIndex, 1, alias, alias);
+      }
+      order = 0;
+    } else {
+      order = 0;
+    }
+  }
+  index->buildEnd(curIndex);
+  if (freeFound) {
+    index->addFree(freeIndex, freeFound);
+  }
+  return true;
+
+fail:
+  return false;
+}
+#endif  // USE_DIR_INDEX
 //==============================================================================
 bool FatFile::cmpName(uint16_t index, FatLfn_t* fname, uint8_t lfnOrd) {
   FatFile dir;
@@ -215,28 +385,131 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
+#if SFN_TAIL_MAP_SIZE
+// Use the first free tail in the map.  The map is built by a directory
+// scan for a new directory or tail position and for the next range of
+// tails when all tails in the map are used.
+bool FatFile::makeSfnTail(FatLfn_t* fname) {
+  FatSfnTail_t* map = &m_vol->m_sfnTail;
+  const DirFat_t* dir;
+  uint8_t* sfn = fname->sfn;
+  uint8_t pos = fname->seqPos < 3 ? fname->seqPos : 3;
+
+  if (!map->base || map->dir != m_firstCluster || map->pos != pos) {
+    map->dir = m_firstCluster;
+    map->pos = pos;
+    map->base = 1;
+    map->valid = false;
+  }
+  while (1) {
+    if (!map->valid) {
+      memset(map->used, 0, sizeof(map->used));
+      map->valid = true;
+      rewind();
+      while (1) {
+        dir = readDirCache();
+        if (!dir) {
+          if (getError()) {
+            DBG_FAIL_MACRO;
+            goto fail;
+          }
+          break;
+        }
+        if (dir->name[0] == FAT_NAME_FREE) {
+          break;
+        }
+        if (isFatFileOrSubdir(dir)) {
+          sfnTailMark(map, m_firstCluster, dir->name);
+        }
+      }
+    }
+    for (uint16_t bit = 0; bit < SFN_TAIL_MAP_SIZE; bit++) {
+      uint32_t tail = map->base + bit;
+      if (tail > 0XFFFF) {
+        break;
+      }
+      if (!(map->used[bit >> 5] & (1UL << (bit & 31)))) {
+        putSfnTail(sfn, pos, tail);
+        return true;
+      }
+    }
+    // All tails in the map are used.
+    if (map->base > 0XFFFF - SFN_TAIL_MAP_SIZE) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    map->base += SFN_TAIL_MAP_SIZE;
+    map->valid = false;
+  }
+
+fail:
+  map->base = 0;
+  return false;
+}
+#endif  // SFN_TAIL_MAP_SIZE
+//------------------------------------------------------------------------------
 bool FatFile::makeUniqueSfn(FatLfn_t* fname) {
   const uint8_t FIRST_HASH_SEQ = 2;  // min value is 2
   uint8_t pos = fname->seqPos;
   const DirFat_t* dir;
   uint16_t hex = 0;
+#if USE_DIR_INDEX
+  size_t iter;
+  const FsDirIndexEntry* entry;
+  FsDirIndex* index = m_vol->dirIndex(m_firstCluster);
+  if (index && !index->isBuilt()) {
+    index = nullptr;
+  }
+#endif  // USE_DIR_INDEX
 
   DBG_HALT_IF(!(fname->flags & FNAME_FLAG_LOST_CHARS));
   DBG_HALT_IF(fname->sfn[pos] != '~' && fname->sfn[pos + 1] != '1');
+#if SFN_TAIL_MAP_SIZE
+#if USE_DIR_INDEX
+  // The index is faster than the map.
+  if (!index)
+#endif  // USE_DIR_INDEX
+  {
+    return makeSfnTail(fname);
+  }
+#endif  // SFN_TAIL_MAP_SIZE
 
+  // Start with a hash of the long name.  Names that share a prefix are
+  // often created in a loop within one millisecond so millis() alone
+  // gives each name the same candidates.  Adding seq makes each try
+  // differ when millis() has not changed.
+  for (const char* p = fname->begin; p < fname->end; p++) {
+    hex = ((hex << 5) | (hex >> 11)) ^ static_cast<uint8_t>(*p);
+  }
+  if (pos > 3) {
+    // Make space in name for ~HHHH.
+    pos = 3;
+  }
   for (uint8_t seq = FIRST_HASH_SEQ; seq < 100; seq++) {
     DBG_WARN_IF(seq > FIRST_HASH_SEQ);
-    hex += millis();
-    if (pos > 3) {
-      // Make space in name for ~HHHH.
-      pos = 3;
-    }
-    for (uint8_t i = pos + 4; i > pos; i--) {
-      uint8_t h = hex & 0XF;
-      fname->sfn[i] = h < 10 ? h + '0' : h + 'A' - 10;
-      hex >>= 4;
+    hex += millis() + seq;
+    putSfnTail(fname->sfn, pos, hex);
+#if USE_DIR_INDEX
+    if (index) {
+      // Only read SFN entries with a matching hash.
+      uint16_t alias = dirHashSfn(fname->sfn);
+      iter = 0;
+      while ((entry = index->find(&iter, alias, alias))) {
+        dir = cacheDir(entry->index + entry->count - 1);
+        if (!dir) {
+          DBG_FAIL_MACRO;
+          goto fail;
+        }
+        if (isFatFileOrSubdir(dir) && !memcmp(fname->sfn, dir->name, 11)) {
+          break;
+        }
+      }
+      if (!entry) {
+        goto done;
+      }
+      continue;
     }
-    fname->sfn[pos] = '~';
+#endif  // USE_DIR_INDEX
     rewind();
     while (1) {
       dir = readDirCache();
@@ -276,7 +549,7 @@ bool FatFile::open(FatFile* dirFile, FatLfn_t* fname, oflag_t oflag) {
   uint8_t checksum = 0;
   uint8_t ms10;
   uint8_t nameOrd;
-  uint16_t curIndex;
+  uint16_t curIndex = 0;
   uint16_t date;
   uint16_t freeIndex = 0;
   uint16_t freeTotal;
@@ -284,6 +557,15 @@ bool FatFile::open(FatFile* dirFile, FatLfn_t* fname, oflag_t oflag) {
   DirFat_t* dir;
   const DirLfn_t* ldir;
   auto vol = dirFile->m_vol;
+#if USE_DIR_INDEX
+  bool freeTaken = false;
+  uint16_t alias = 0;
+  uint16_t hash = 0;
+  uint32_t scanEnd = 0;
+  size_t iter = 0;
+  const FsDirIndexEntry* entry;
+  FsDirIndex* index = vol->dirIndex(dirFile->m_firstCluster);
+#endif  // USE_DIR_INDEX
 
   if (!dirFile->isDir() || isOpen()) {
     DBG_FAIL_MACRO;
@@ -292,9 +574,65 @@ bool FatFile::open(FatFile* dirFile, FatLfn_t* fname, oflag_t oflag) {
   // Number of directory entries needed.
   nameOrd = (fname->len + 12) / 13;
   freeNeed = (fname->flags & FNAME_FLAG_NEED_LFN) ? 1 + nameOrd : 1;
+#if USE_DIR_INDEX
+  if (index) {
+    if (!index->isBuilt() && !dirFile->buildDirIndex(index)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    // Not built if the table is too small.
+    if (index->isBuilt()) {
+      hash = dirHashLfn(fname);
+      alias = dirHashSfn(fname->sfn);
+    } else {
+      index = nullptr;
+    }
+  }
+#endif  // USE_DIR_INDEX
+#if USE_CREATE_NEW
+  if (fname->flags & FNAME_FLAG_NEW) {
+    // A short name with a numeric tail must be checked.
+    fnameFound = fname->flags & FNAME_FLAG_LOST_CHARS;
+#if USE_DIR_INDEX
+    if (index) {
+      goto create;
+    }
+#endif  // USE_DIR_INDEX
+    // Use the remembered end if it is still free or at EOF.
+    if (dirFile->m_dirEnd &&
+        dirFile->seekSet(FS_DIR_SIZE * (dirFile->m_dirEnd - 1UL))) {
+      curIndex = dirFile->m_dirEnd - 1;
+      dir = dirFile->readDirCache();
+      if (dir && dir->name[0] == FAT_NAME_FREE) {
+        freeIndex = curIndex;
+        freeFound = 1;
+        goto create;
+      }
+      if (!dir && !dirFile->getError()) {
+        goto create;
+      }
+    }
+  }
+#endif  // USE_CREATE_NEW
   dirFile->rewind();
   while (1) {
     curIndex = dirFile->m_curPosition / FS_DIR_SIZE;
+#if USE_DIR_INDEX
+    if (index && curIndex >= scanEnd) {
+      // Go to the next set with a matching hash.
+      entry = index->find(&iter, hash, alias);
+      if (!entry) {
+        goto create;
+      }
+      curIndex = entry->index;
+      scanEnd = curIndex + entry->count;
+      lfnOrd = 0;
+      if (!dirFile->seekSet(FS_DIR_SIZE * curIndex)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+    }
+#endif  // USE_DIR_INDEX
     dir = dirFile->readDirCache();
     if (!dir) {
       if (dirFile->getError()) {
@@ -302,6 +640,9 @@ bool FatFile::open(FatFile* dirFile, FatLfn_t* fname, oflag_t oflag) {
         goto fail;
       }
       // At EOF
+#if USE_CREATE_NEW
+      dirFile->m_dirEnd = curIndex + 1;
+#endif  // USE_CREATE_NEW
       goto create;
     }
     if (dir->name[0] == FAT_NAME_DELETED || dir->name[0] == FAT_NAME_FREE) {
@@ -312,6 +653,9 @@ bool FatFile::open(FatFile* dirFile, FatLfn_t* fname, oflag_t oflag) {
         freeFound++;
       }
       if (dir->name[0] == FAT_NAME_FREE) {
+#if USE_CREATE_NEW
+        dirFile->m_dirEnd = curIndex + 1;
+#endif  // USE_CREATE_NEW
         goto create;
       }
     } else {
@@ -374,6 +718,23 @@ create:
     DBG_WARN_MACRO;
     goto fail;
   }
+#if USE_DIR_INDEX
+  if (index) {
+    // Use free entries from the index.
+    freeTaken = true;
+    scanEnd = index->takeFree(freeNeed);
+    if (scanEnd > 0XFFFF) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    curIndex = scanEnd;
+    freeFound = 0;
+    if (!dirFile->seekSet(FS_DIR_SIZE * curIndex)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+#endif  // USE_DIR_INDEX
   // Keep found entries or start at current index if no free entries found.
   if (freeFound == 0) {
     freeIndex = curIndex;
@@ -419,6 +780,9 @@ create:
   // initialize as empty file
   memset(dir, 0, sizeof(DirFat_t));
   memcpy(dir->name, fname->sfn, 11);
+#if SFN_TAIL_MAP_SIZE
+  sfnTailMark(&vol->m_sfnTail, dirFile->m_firstCluster, fname->sfn);
+#endif  // SFN_TAIL_MAP_SIZE
 
   // Set base-name and extension lower case bits.
   dir->caseFlags = (FAT_CASE_LC_BASE | FAT_CASE_LC_EXT) & fname->flags;
@@ -441,6 +805,18 @@ create:
   }
   // Force write of entry to device.
   vol->cacheDirty();
+#if USE_CREATE_NEW
+  if (dirFile->m_dirEnd && dirFile->m_dirEnd <= curIndex + 1UL) {
+    // New entries are at the end.
+    dirFile->m_dirEnd = curIndex < 0XFFFE ? curIndex + 2 : 0;
+  }
+#endif  // USE_CREATE_NEW
+#if USE_DIR_INDEX
+  if (index) {
+    alias = dirHashSfn(fname->sfn);
+    index->add(freeIndex, freeNeed, freeNeed > 1 ? hash : alias, alias);
+  }
+#endif  // USE_DIR_INDEX
 
 open:
   // open entry in cache.
@@ -451,6 +827,12 @@ open:
   return true;
 
 fail:
+#if USE_DIR_INDEX
+  if (freeTaken) {
+    // Free entries taken from the index may not be used.
+    index->invalidate();
+  }
+#endif  // USE_DIR_INDEX
   return false;
 }
 //------------------------------------------------------------------------------
@@ -511,14 +893,25 @@ bool FatFile::remove() {
   FatFile dirFile;
   DirFat_t* dir;
   DirLfn_t* ldir;
+#if USE_DIR_INDEX
+  FsDirIndex* index;
+#endif  // USE_DIR_INDEX
 
   // Cant' remove not open for write.
   if (!isWritable()) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+#if USE_DIR_INDEX
+  // Stop use of the index if this is the indexed directory.
+  index = m_vol->dirIndex(m_firstCluster);
+  if (m_firstCluster && index) {
+    index->end();
+  }
+#endif  // USE_DIR_INDEX
   // Free any clusters.
-  if (m_firstCluster && !m_vol->freeChain(m_firstCluster)) {
+  if (m_firstCluster &&
+      !m_vol->freeChain(m_firstCluster, contiguousClusters())) {
     DBG_FAIL_MACRO;
     goto fail;
   }
@@ -532,6 +925,12 @@ bool FatFile::remove() {
 
   // Mark entry deleted.
   dir->name[0] = FAT_NAME_DELETED;
+#if USE_DIR_INDEX
+  index = m_vol->dirIndex(m_dirCluster);
+  if (index && index->isBuilt()) {
+    index->remove(m_dirIndex - m_lfnOrd, m_lfnOrd + 1);
+  }
+#endif  // USE_DIR_INDEX
 
   // Set this file closed.
   m_attributes = FILE_ATTR_CLOSED;
@@ -27,41 +27,77 @@
 #include "../common/DebugMacros.h"
 #include "FatLib.h"
 
+// Long names that don't fit are printed from the directory entries.
+#if USE_LONG_FILE_NAMES
+static const size_t LS_NAME_SIZE = 64;
+#else  // USE_LONG_FILE_NAMES
+static const size_t LS_NAME_SIZE = 13;
+#endif  // USE_LONG_FILE_NAMES
+//------------------------------------------------------------------------------
+static size_t printSize(print_t* pr, uint32_t size) {
+  char buf[11];
+  char* ptr = buf + sizeof(buf);
+  *--ptr = 0;
+  ptr = fmtBase10(ptr, size);
+  while (ptr > buf) {
+    *--ptr = ' ';
+  }
+  return pr->write(buf);
+}
 //------------------------------------------------------------------------------
 bool FatFile::ls(print_t* pr, uint8_t flags, uint8_t indent) {
+  char name[LS_NAME_SIZE];
+  return lsPrivate(pr, flags, indent, name, sizeof(name));
+}
+//------------------------------------------------------------------------------
+// List with one name buffer for all levels.
+bool FatFile::lsPrivate(print_t* pr, uint8_t flags, uint8_t indent,
+                        char* name, size_t size) {
+  int8_t rtn;
+  FsDirStat stat;
   FatFile file;
   if (!isDir()) {
     DBG_FAIL_MACRO;
     goto fail;
   }
   rewind();
-  while (file.openNext(this, O_RDONLY)) {
+  while ((rtn = readDirPlus(&stat, name, size)) > 0) {
     // indent for dir level
-    if (!file.isHidden() || (flags & LS_A)) {
+    if (!stat.isHidden() || (flags & LS_A)) {
       for (uint8_t i = 0; i < indent; i++) {
         pr->write(' ');
       }
       if (flags & LS_DATE) {
-        file.printModifyDateTime(pr);
+        fsPrintDateTime(pr, stat.modifyDate, stat.modifyTime);
         pr->write(' ');
       }
       if (flags & LS_SIZE) {
-        file.printFileSize(pr);
+        printSize(pr, stat.size);
         pr->write(' ');
       }
-      file.printName(pr);
-      if (file.isDir()) {
+      if (!stat.nameTruncated) {
+        pr->write(name);
+      } else if (!file.open(this, stat.dirIndex, O_RDONLY) ||
+                 !file.printName(pr) || !file.close()) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      if (stat.isDir()) {
         pr->write('/');
       }
       pr->write('\r');
       pr->write('\n');
-      if ((flags & LS_R) && file.isDir()) {
-        file.ls(pr, flags, indent + 2);
+      if ((flags & LS_R) && stat.isDir()) {
+        if (!file.open(this, stat.dirIndex, O_RDONLY) ||
+            !file.lsPrivate(pr, flags, indent + 2, name, size)) {
+          DBG_FAIL_MACRO;
+          goto fail;
+        }
+        file.close();
       }
     }
-    file.close();
   }
-  if (getError()) {
+  if (rtn < 0) {
     DBG_FAIL_MACRO;
     goto fail;
   }
@@ -98,12 +134,5 @@ size_t FatFile::printModifyDateTime(print_t* pr) {
 }
 //------------------------------------------------------------------------------
 size_t FatFile::printFileSize(print_t* pr) {
-  char buf[11];
-  char* ptr = buf + sizeof(buf);
-  *--ptr = 0;
-  ptr = fmtBase10(ptr, fileSize());
-  while (ptr > buf) {
-    *--ptr = ' ';
-  }
-  return pr->write(buf);
+  return printSize(pr, fileSize());
 }
@@ -42,6 +42,23 @@ bool FatFile::open(FatFile* dirFile, const FatSfn_t* fname, oflag_t oflag) {
   DirFat_t* dir;
   const DirLfn_t* ldir;
 
+#if USE_CREATE_NEW
+  // Use the remembered end if it is still free or at EOF.
+  if ((fname->flags & FNAME_FLAG_NEW) && dirFile->m_dirEnd &&
+      dirFile->seekSet(FS_DIR_SIZE * (dirFile->m_dirEnd - 1UL))) {
+    index = dirFile->m_dirEnd - 1;
+    dir = dirFile->readDirCache();
+    if (dir && dir->name[0] == FAT_NAME_FREE) {
+      emptyIndex = index;
+      emptyFound = true;
+      goto create;
+    }
+    if (!dir && !dirFile->getError()) {
+      goto create;
+    }
+    index = 0;
+  }
+#endif  // USE_CREATE_NEW
   dirFile->rewind();
   while (true) {
     dir = dirFile->readDirCache();
@@ -96,6 +113,11 @@ bool FatFile::open(FatFile* dirFile, const FatSfn_t* fname, oflag_t oflag) {
     }
     index++;
   }
+#if USE_CREATE_NEW
+  dirFile->m_dirEnd = index + 1;
+
+create:
+#endif  // USE_CREATE_NEW
   // don't create unless O_CREAT and write mode
   if (!(oflag & O_CREAT) || !isWriteMode(oflag)) {
     DBG_FAIL_MACRO;
@@ -139,6 +161,12 @@ bool FatFile::open(FatFile* dirFile, const FatSfn_t* fname, oflag_t oflag) {
   }
   // Force write of entry to device.
   dirFile->m_vol->cacheDirty();
+#if USE_CREATE_NEW
+  if (dirFile->m_dirEnd && dirFile->m_dirEnd <= index + 1UL) {
+    // New entry is at the end.
+    dirFile->m_dirEnd = index < 0XFFFE ? index + 2 : 0;
+  }
+#endif  // USE_CREATE_NEW
 
   // open entry in cache.
   return openCachedEntry(dirFile, index, oflag, 0);
@@ -290,7 +318,8 @@ bool FatFile::remove() {
     goto fail;
   }
   // Free any clusters.
-  if (m_firstCluster && !m_vol->freeChain(m_firstCluster)) {
+  if (m_firstCluster &&
+      !m_vol->freeChain(m_firstCluster, contiguousClusters())) {
     DBG_FAIL_MACRO;
     goto fail;
   }
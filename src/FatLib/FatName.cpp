@@ -165,33 +165,12 @@ fail:
   return 0;
 }
 //------------------------------------------------------------------------------
-size_t FatFile::getSFN(char* name, size_t size) {
+// Format the short name of an entry with lower case flags applied.
+size_t FatFile::formatSfn(const DirFat_t* dir, char* name, size_t size) {
   char c;
   uint8_t j = 0;
   uint8_t lcBit = FAT_CASE_LC_BASE;
-  const uint8_t* ptr;
-  const DirFat_t* dir;
-  if (!isOpen()) {
-    DBG_FAIL_MACRO;
-    goto fail;
-  }
-  if (isRoot()) {
-    if (size < 2) {
-      DBG_FAIL_MACRO;
-      goto fail;
-    }
-    name[0] = '/';
-    name[1] = '\0';
-    return 1;
-  }
-  // cache entry
-  dir = cacheDirEntry(FsCache::CACHE_FOR_READ);
-  if (!dir) {
-    DBG_FAIL_MACRO;
-    goto fail;
-  }
-  ptr = dir->name;
-  // format name
+  const uint8_t* ptr = dir->name;
   for (uint8_t i = 0; i < 12; i++) {
     if (i == 8) {
       if (*ptr == ' ') {
@@ -217,6 +196,36 @@ size_t FatFile::getSFN(char* name, size_t size) {
   name[j] = '\0';
   return j;
 
+fail:
+  if (size) {
+    name[0] = '\0';
+  }
+  return 0;
+}
+//------------------------------------------------------------------------------
+size_t FatFile::getSFN(char* name, size_t size) {
+  const DirFat_t* dir;
+  if (!isOpen()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (isRoot()) {
+    if (size < 2) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    name[0] = '/';
+    name[1] = '\0';
+    return 1;
+  }
+  // cache entry
+  dir = cacheDirEntry(FsCache::CACHE_FOR_READ);
+  if (!dir) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  return formatSfn(dir, name, size);
+
 fail:
   name[0] = '\0';
   return 0;
@@ -354,3 +363,128 @@ size_t FatFile::printSFN(print_t* pr) {
 fail:
   return 0;
 }
+//------------------------------------------------------------------------------
+int8_t FatFile::readDirPlus(FsDirStat* stat, char* name, size_t size) {
+  const DirFat_t* dir;
+  char* end = size ? name + size - 1 : nullptr;
+  // The long name is built backwards from the end of name.  Null if it
+  // is not valid or does not fit.
+  char* str = nullptr;
+  uint8_t order = 0;
+  uint8_t checksum = 0;
+  bool truncated = false;
+#if USE_LONG_FILE_NAMES && USE_UTF8_LONG_NAMES
+  uint16_t low = 0;
+#endif  // USE_LONG_FILE_NAMES && USE_UTF8_LONG_NAMES
+  if (!isDir() || (m_curPosition & 0X1F)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (!end) {
+    name = nullptr;
+  }
+  while (1) {
+    dir = readDirCache();
+    if (!dir) {
+      // At EOF if no error.
+      if (!getError()) {
+        return 0;
+      }
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    // done if past last entry
+    if (dir->name[0] == FAT_NAME_FREE) {
+      return 0;
+    }
+    // skip empty slot or '.' or '..'
+    if (dir->name[0] == FAT_NAME_DELETED || dir->name[0] == '.') {
+      order = 0;
+      continue;
+    }
+    if (isFatLongName(dir)) {
+#if USE_LONG_FILE_NAMES
+      const DirLfn_t* ldir = reinterpret_cast<const DirLfn_t*>(dir);
+      if (ldir->order & FAT_ORDER_LAST_LONG_ENTRY) {
+        checksum = ldir->checksum;
+        str = end;
+        truncated = false;
+#if USE_UTF8_LONG_NAMES
+        low = 0;
+#endif  // USE_UTF8_LONG_NAMES
+      } else if (order != (ldir->order & 0X1F) + 1 ||
+                 checksum != ldir->checksum) {
+        order = 0;
+        continue;
+      }
+      order = ldir->order & 0X1F;
+      for (int8_t i = 12; i >= 0 && str; i--) {
+        char buf[4];
+        char* bufEnd = buf;
+        uint16_t c = getLfnChar(ldir, i);
+        if (c == 0 || c == 0XFFFF) {
+          // Terminator or pad after the end of the name.
+          continue;
+        }
+#if USE_UTF8_LONG_NAMES
+        if (FsUtf::isLowSurrogate(c) && !low) {
+          low = c;
+          continue;
+        }
+        if (low ? FsUtf::isHighSurrogate(c) : !FsUtf::isSurrogate(c)) {
+          bufEnd = FsUtf::cpToMb(low ? FsUtf::u16ToCp(c, low) : c, buf,
+                                 buf + sizeof(buf));
+        }
+        low = 0;
+#else   // USE_UTF8_LONG_NAMES
+        *bufEnd++ = c < 0X7F ? c : '?';
+#endif  // USE_UTF8_LONG_NAMES
+        if (!bufEnd || bufEnd == buf || str - name < bufEnd - buf) {
+          truncated = bufEnd && bufEnd != buf;
+          str = nullptr;
+          break;
+        }
+        str -= bufEnd - buf;
+        memcpy(str, buf, bufEnd - buf);
+      }
+#endif  // USE_LONG_FILE_NAMES
+      continue;
+    }
+    // skip volume label
+    if (!isFatFileOrSubdir(dir)) {
+      order = 0;
+      continue;
+    }
+    stat->size = getLe32(dir->fileSize);
+    stat->firstCluster = ((Cluster_t)getLe16(dir->firstClusterHigh) << 16) |
+                         getLe16(dir->firstClusterLow);
+    stat->dirIndex = m_curPosition / FS_DIR_SIZE - 1;
+    stat->createDate = getLe16(dir->createDate);
+    stat->createTime = getLe16(dir->createTime);
+    stat->modifyDate = getLe16(dir->modifyDate);
+    stat->modifyTime = getLe16(dir->modifyTime);
+    stat->accessDate = getLe16(dir->accessDate);
+    stat->accessTime = 0;
+    stat->attributes = dir->attributes & FS_ATTRIB_COPY;
+    stat->nameTruncated =
+        truncated && order == 1 && checksum == lfnChecksum(dir->name);
+#if USE_LONG_FILE_NAMES && USE_UTF8_LONG_NAMES
+    if (low) {
+      // Low surrogate without a high surrogate.
+      str = nullptr;
+    }
+#endif  // USE_LONG_FILE_NAMES && USE_UTF8_LONG_NAMES
+    if (name) {
+      if (order == 1 && str && checksum == lfnChecksum(dir->name)) {
+        memmove(name, str, end - str);
+        name[end - str] = '\0';
+      } else {
+        formatSfn(dir, name, size);
+      }
+    }
+    return 1;
+  }
+
+fail:
+  return -1;
+}
@@ -26,10 +26,26 @@
 #define DBG_FILE "FatPartition.cpp"
 #include "../common/DebugMacros.h"
 #include "FatLib.h"
+#include "../common/FsBitmap.h"
 //------------------------------------------------------------------------------
-bool FatPartition::allocateCluster(Cluster_t current, Cluster_t* next) {
+bool FatPartition::allocateCluster(Cluster_t current, Cluster_t* next,
+                                   bool data) {
   Cluster_t find;
+  // First cluster of the run of used clusters ending at find.
+  Cluster_t used;
   bool setStart;
+  // Continue file data in a free AU if it can't be extended in place.
+  int8_t au = data ? auStart(current, &find) : 0;
+  if (au < 0) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (au) {
+    // Don't skip free clusters before find.
+    setStart = find == m_allocSearchStart + 1;
+    used = find;
+    goto found;
+  }
   if (m_allocSearchStart < current) {
     // Try to keep file contiguous. Start just after current cluster.
     find = current;
@@ -38,8 +54,13 @@ bool FatPartition::allocateCluster(Cluster_t current, Cluster_t* next) {
     find = m_allocSearchStart;
     setStart = true;
   }
+  used = 0;
   while (1) {
-    find++;
+    Cluster_t skip = freeMapSkip(find + 1);
+    if (skip != find + 1 || used == 0) {
+      used = skip;
+    }
+    find = skip;
     if (find > m_lastCluster) {
       if (setStart) {
         // Can't find space, checked all clusters.
@@ -48,6 +69,7 @@ bool FatPartition::allocateCluster(Cluster_t current, Cluster_t* next) {
       }
       find = m_allocSearchStart;
       setStart = true;
+      used = 0;
       continue;
     }
     if (find == current) {
@@ -64,7 +86,11 @@ bool FatPartition::allocateCluster(Cluster_t current, Cluster_t* next) {
     if (fg && f == 0) {
       break;
     }
+    // Clear the group of find if the search found it full.
+    freeMapUsed(used, find);
   }
+
+found:
   if (setStart) {
     m_allocSearchStart = find;
   }
@@ -73,6 +99,7 @@ bool FatPartition::allocateCluster(Cluster_t current, Cluster_t* next) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  freeMapUsed(used, find);
   if (current) {
     // Link clusters.
     if (!fatPut(current, find)) {
@@ -91,57 +118,34 @@ fail:
 // find a contiguous group of clusters
 bool FatPartition::allocContiguous(uint32_t count, Cluster_t* firstCluster) {
   // flag to save place to start next search
-  bool setStart = true;
+  bool setStart = false;
   // start of group
   Cluster_t bgnCluster;
   // end of group
   Cluster_t endCluster;
-  // Start at cluster after last allocated cluster.
-  endCluster = bgnCluster = m_allocSearchStart + 1;
-
-  // search the FAT for free clusters
-  while (1) {
-    if (endCluster > m_lastCluster) {
-      // Can't find space.
-      DBG_FAIL_MACRO;
-      goto fail;
-    }
-    uint32_t f;
-    int8_t fg = fatGet(endCluster, &f);
-    if (fg < 0) {
-      DBG_FAIL_MACRO;
-      goto fail;
-    }
-    if (f || fg == 0) {
-      // don't update search start if unallocated clusters before endCluster.
-      if (bgnCluster != endCluster) {
-        setStart = false;
-      }
-      // cluster in use try next cluster as bgnCluster
-      bgnCluster = endCluster + 1;
-    } else if ((endCluster - bgnCluster + 1) == count) {
-      // done - found space
-      break;
-    }
-    endCluster++;
+  // Prefer a group that starts on an AU boundary.
+  int8_t fc = auFind(count, &bgnCluster);
+  if (fc == 0) {
+    // Start at cluster after last allocated cluster.
+    fc = findContiguous(m_allocSearchStart + 1, count, &bgnCluster,
+                        &setStart);
   }
+  if (fc <= 0) {
+    // Can't find space.
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  endCluster = bgnCluster + count - 1;
   // Remember possible next free cluster.
   if (setStart) {
     m_allocSearchStart = endCluster;
   }
-  // mark end of chain
-  if (!fatPutEOC(endCluster)) {
+  // link clusters and mark end of chain
+  if (!fatPutRun(bgnCluster, endCluster, true) || !fatPutEOC(endCluster)) {
     DBG_FAIL_MACRO;
     goto fail;
   }
-  // link clusters
-  while (endCluster > bgnCluster) {
-    if (!fatPut(endCluster - 1, endCluster)) {
-      DBG_FAIL_MACRO;
-      goto fail;
-    }
-    endCluster--;
-  }
+  freeMapFull(bgnCluster, endCluster);
   // Maintain count of free clusters.
   updateFreeClusterCount(-count);
 
@@ -152,6 +156,86 @@ bool FatPartition::allocContiguous(uint32_t count, Cluster_t* firstCluster) {
 fail:
   return false;
 }
+#if USE_AU_ALLOCATION
+//------------------------------------------------------------------------------
+// Return the first AU boundary at or after cluster.
+Cluster_t FatPartition::auCeil(Cluster_t cluster) const {
+  if (cluster <= m_auFirstCluster) {
+    return m_auFirstCluster;
+  }
+  uint32_t n = cluster - m_auFirstCluster + m_auClusters - 1;
+  return m_auFirstCluster + n - n % m_auClusters;
+}
+//------------------------------------------------------------------------------
+// Find count free clusters that start on an AU boundary.  Return -1 for
+// error, 0 if not found, else 1 with the first cluster in *bgn.
+int8_t FatPartition::auFind(uint32_t count, Cluster_t* bgn) {
+  bool setStart;
+  Cluster_t start;
+  if (m_auClusters == 0) {
+    return 0;
+  }
+  start = auCeil(m_allocSearchStart + 1);
+  while (start <= m_lastCluster) {
+    int8_t fc = findContiguous(start, count, bgn, &setStart);
+    if (fc <= 0) {
+      return fc;
+    }
+    start = auCeil(*bgn);
+    if (start == *bgn) {
+      return 1;
+    }
+  }
+  return 0;
+}
+//------------------------------------------------------------------------------
+// Choose the next cluster for a file.  Return -1 for error, 0 for the
+// normal search, else 1 with the cluster in *find.
+int8_t FatPartition::auStart(Cluster_t current, Cluster_t* find) {
+  uint32_t f;
+  int8_t fg;
+  if (m_auClusters == 0 || current == 0) {
+    return 0;
+  }
+  if (current < m_lastCluster) {
+    fg = fatGet(current + 1, &f);
+    if (fg < 0) {
+      DBG_FAIL_MACRO;
+      return -1;
+    }
+    if (fg && f == 0) {
+      *find = current + 1;
+      return 1;
+    }
+  }
+  return auFind(m_auClusters, find);
+}
+//------------------------------------------------------------------------------
+bool FatPartition::setAuSize(uint32_t sectors) {
+  Sector_t offset;
+  m_auClusters = 0;
+  if (!m_fatType) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (sectors <= m_sectorsPerCluster) {
+    // Every cluster is in a single AU.
+    return true;
+  }
+  // Sectors from start of data to the first AU boundary.
+  offset = (sectors - m_dataStartSector % sectors) % sectors;
+  if ((offset | sectors) & m_clusterSectorMask) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_auClusters = sectors >> m_sectorsPerClusterShift;
+  m_auFirstCluster = 2 + (offset >> m_sectorsPerClusterShift);
+  return true;
+
+fail:
+  return false;
+}
+#endif  // USE_AU_ALLOCATION
 //------------------------------------------------------------------------------
 // Fetch a FAT entry - return -1 error, 0 EOC, else 1.
 int8_t FatPartition::fatGet(Cluster_t cluster, Cluster_t* value) {
@@ -230,6 +314,9 @@ bool FatPartition::fatPut(Cluster_t cluster, Cluster_t value) {
     DBG_FAIL_MACRO;
     goto fail;
   }
+  if (value == 0) {
+    freeMapMark(cluster);
+  }
 
   if (fatType() == 32) {
     sector = m_fatStartSector + (cluster >> (m_bytesPerSectorShift - 2));
@@ -297,38 +384,182 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
-// free a cluster chain
-bool FatPartition::freeChain(Cluster_t cluster) {
-  uint32_t next;
-  int8_t fg;
-  do {
-    fg = fatGet(cluster, &next);
+// Store FAT entries for clusters [first, end).  Each entry is linked to the
+// next cluster if link is true, else the entry is freed.  FAT16 and FAT32
+// sectors are prepared once per run and a sector that is completely
+// replaced is not read.
+bool FatPartition::fatPutRun(Cluster_t first, Cluster_t end, bool link) {
+  uint8_t shift;
+  if (first < 2 || first > end || end > (m_lastCluster + 1)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (fatType() == 32) {
+    shift = m_bytesPerSectorShift - 2;
+  } else if (fatType() == 16) {
+    shift = m_bytesPerSectorShift - 1;
+  } else {
+    // FAT12 entries may span sectors.
+    for (; first < end; first++) {
+      if (!fatPut(first, link ? first + 1 : 0)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+    }
+    return true;
+  }
+  while (first < end) {
+    uint16_t index = first & ((1U << shift) - 1);
+    uint32_t n = (1UL << shift) - index;
+    if (n > (end - first)) {
+      n = end - first;
+    }
+    uint8_t* pc =
+        fatCachePrepare(m_fatStartSector + (first >> shift),
+                        n == (1UL << shift) ? FsCache::CACHE_RESERVE_FOR_WRITE
+                                            : FsCache::CACHE_FOR_WRITE);
+    if (!pc) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+    for (uint32_t i = 0; i < n; i++, first++) {
+      Cluster_t value = link ? first + 1 : 0;
+      if (value == 0) {
+        freeMapMark(first);
+      }
+      if (fatType() == 32) {
+        setLe32(pc + 4 * (index + i), value);
+      } else {
+        setLe16(pc + 2 * (index + i), value);
+      }
+    }
+  }
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+// Find count free clusters at or after cluster start.  Return -1 for error,
+// 0 if no space, else 1 with the first cluster in *bgn.  *setStart is false
+// if free clusters before *bgn were passed over.
+int8_t FatPartition::findContiguous(Cluster_t start, uint32_t count,
+                                    Cluster_t* bgn, bool* setStart) {
+  // start of group
+  Cluster_t bgnCluster = start;
+  // end of group
+  Cluster_t endCluster = start;
+  *setStart = true;
+  // search the FAT for free clusters
+  while (1) {
+    if (bgnCluster == endCluster) {
+      // Not in a run of free clusters so skip full groups.
+      endCluster = bgnCluster = freeMapSkip(endCluster);
+    }
+    if (endCluster > m_lastCluster) {
+      return 0;
+    }
+    uint32_t f;
+    int8_t fg = fatGet(endCluster, &f);
     if (fg < 0) {
+      DBG_FAIL_MACRO;
+      return -1;
+    }
+    if (f || fg == 0) {
+      // don't update search start if unallocated clusters before endCluster.
+      if (bgnCluster != endCluster) {
+        *setStart = false;
+      }
+      // cluster in use try next cluster as bgnCluster
+      bgnCluster = endCluster + 1;
+    } else if ((endCluster - bgnCluster + 1) == count) {
+      // done - found space
+      *bgn = bgnCluster;
+      return 1;
+    }
+    endCluster++;
+  }
+}
+//------------------------------------------------------------------------------
+// Free a cluster chain.  The entries for the first known clusters are not
+// read since they are contiguous.  Other FAT16 and FAT32 entries are freed
+// a FAT sector at a time while the chain stays in the sector.
+bool FatPartition::freeChain(Cluster_t cluster, uint32_t known) {
+  uint32_t count = 0;
+  Cluster_t low = cluster;
+  uint8_t shift;
+  if (known > 1) {
+    if (!fatPutRun(cluster, cluster + known - 1, false)) {
       DBG_FAIL_MACRO;
       goto fail;
     }
-    // free cluster
-    if (!fatPut(cluster, 0)) {
+    count = known - 1;
+    cluster += known - 1;
+  }
+  if (fatType() == 32) {
+    shift = m_bytesPerSectorShift - 2;
+  } else if (fatType() == 16) {
+    shift = m_bytesPerSectorShift - 1;
+  } else {
+    uint32_t next;
+    int8_t fg;
+    do {
+      fg = fatGet(cluster, &next);
+      if (fg < 0 || !fatPut(cluster, 0)) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+      count++;
+      low = cluster < low ? cluster : low;
+      cluster = next;
+    } while (fg);
+    goto done;
+  }
+  do {
+    if (cluster < 2 || cluster > m_lastCluster) {
       DBG_FAIL_MACRO;
       goto fail;
     }
-    // Add one to count of free clusters.
-    updateFreeClusterCount(1);
-    if (cluster < m_allocSearchStart) {
-      m_allocSearchStart = cluster - 1;
+    Cluster_t fatIndex = cluster >> shift;
+    uint8_t* pc =
+        fatCachePrepare(m_fatStartSector + fatIndex, FsCache::CACHE_FOR_WRITE);
+    if (!pc) {
+      DBG_FAIL_MACRO;
+      goto fail;
     }
-    cluster = next;
-  } while (fg);
+    // Follow the chain while it stays in this sector.
+    do {
+      uint16_t index = cluster & ((1U << shift) - 1);
+      freeMapMark(cluster);
+      count++;
+      low = cluster < low ? cluster : low;
+      if (fatType() == 32) {
+        cluster = getLe32(pc + 4 * index);
+        setLe32(pc + 4 * index, 0);
+      } else {
+        cluster = getLe16(pc + 2 * index);
+        setLe16(pc + 2 * index, 0);
+      }
+    } while (cluster >= 2 && !isEOC(cluster) && (cluster >> shift) == fatIndex);
+  } while (!isEOC(cluster));
 
+done:
+  // Add count to free clusters.
+  updateFreeClusterCount(count);
+  if (low < m_allocSearchStart) {
+    m_allocSearchStart = low - 1;
+  }
   return true;
 
 fail:
+  // Free count is unknown after a partial free.
+  setFreeClusterCount(-1);
   return false;
 }
 //------------------------------------------------------------------------------
 int32_t FatPartition::freeClusterCount() {
 #if MAINTAIN_FREE_CLUSTER_COUNT
-  if (m_freeClusterCount >= 0) {
+  if (m_freeClusterCount >= 0 && freeMapValid() && fsInfoValid()) {
     return m_freeClusterCount;
   }
 #endif  // MAINTAIN_FREE_CLUSTER_COUNT
@@ -337,6 +568,7 @@ int32_t FatPartition::freeClusterCount() {
   uint32_t todo = m_lastCluster + 1;
   uint16_t n;
 
+  freeMapReset();
   if (FAT12_SUPPORT && fatType() == 12) {
     for (unsigned i = 2; i < todo; i++) {
       uint32_t c;
@@ -346,6 +578,7 @@ int32_t FatPartition::freeClusterCount() {
         goto fail;
       }
       if (fg && c == 0) {
+        freeMapMark(i);
         free++;
       }
     }
@@ -362,20 +595,11 @@ int32_t FatPartition::freeClusterCount() {
         n = todo;
       }
       if (fatType() == 16) {
-        const uint16_t* p16 = reinterpret_cast<uint16_t*>(pc);
-        for (uint16_t i = 0; i < n; i++) {
-          if (p16[i] == 0) {
-            free++;
-          }
-        }
+        free += fsCountZero16(pc, n);
       } else {
-        const uint32_t* p32 = reinterpret_cast<uint32_t*>(pc);
-        for (uint16_t i = 0; i < n; i++) {
-          if (p32[i] == 0) {
-            free++;
-          }
-        }
+        free += fsCountZero32(pc, n);
       }
+      freeMapMarkSector(pc, m_lastCluster + 1 - todo, n);
       todo -= n;
     }
   } else {
@@ -383,12 +607,173 @@ int32_t FatPartition::freeClusterCount() {
     DBG_FAIL_MACRO;
     goto fail;
   }
-  setFreeClusterCount(free);
+#if MAINTAIN_FREE_CLUSTER_COUNT
+  if (m_freeClusterCount != static_cast<int32_t>(free)) {
+    setFreeClusterCount(free);
+    setFsInfoDirty();
+  }
+#endif  // MAINTAIN_FREE_CLUSTER_COUNT
+  setFreeMapValid();
+  setFsInfoValid();
   return free;
 
 fail:
   return -1;
 }
+#if USE_FAT_FREE_MAP
+//------------------------------------------------------------------------------
+// Clear the bits of groups that are inside [first, last], a range of
+// clusters known to be in use.  No FAT sectors are read.
+void FatPartition::freeMapFull(Cluster_t first, Cluster_t last) {
+  if (!m_freeMap || first > last) {
+    return;
+  }
+  for (Cluster_t group = first >> m_freeMapShift;
+       group <= (last >> m_freeMapShift); group++) {
+    Cluster_t bgn = group << m_freeMapShift;
+    Cluster_t end = bgn + (1UL << m_freeMapShift) - 1;
+    if ((bgn >= first || first <= 2) &&
+        (end <= last || last == m_lastCluster)) {
+      m_freeMap[group >> 5] &= ~(1UL << (group & 31));
+    }
+  }
+}
+//------------------------------------------------------------------------------
+// Set group bits for zero entries in a FAT16 or FAT32 sector.
+void FatPartition::freeMapMarkSector(const uint8_t* pc, Cluster_t cluster,
+                                     uint16_t n) {
+  if (m_freeMap) {
+    for (uint16_t i = 0; i < n; i++) {
+      uint32_t f = fatType() == 16 ? getLe16(pc + 2 * i) : getLe32(pc + 4 * i);
+      if (f == 0) {
+        freeMapMark(cluster + i);
+      }
+    }
+  }
+}
+//------------------------------------------------------------------------------
+// Return the first cluster not before cluster in a group with a free
+// cluster or m_lastCluster + 1 if none.  Skip nothing if the map has not
+// been built.
+Cluster_t FatPartition::freeMapSkip(Cluster_t cluster) {
+  if (!m_freeMap || !m_freeMapValid || cluster > m_lastCluster) {
+    return cluster;
+  }
+  Cluster_t group = cluster >> m_freeMapShift;
+  Cluster_t lastGroup = m_lastCluster >> m_freeMapShift;
+  uint32_t i = group >> 5;
+  uint32_t bits = m_freeMap[i] & (0XFFFFFFFF << (group & 31));
+  while (!bits) {
+    if (++i > (lastGroup >> 5)) {
+      return m_lastCluster + 1;
+    }
+    bits = m_freeMap[i];
+  }
+  group = (i << 5) + __builtin_ctzl(bits);
+  if (group > lastGroup) {
+    return m_lastCluster + 1;
+  }
+  group <<= m_freeMapShift;
+  return group > cluster ? group : cluster;
+}
+//------------------------------------------------------------------------------
+bool FatPartition::setFreeMap(uint32_t* map, size_t size) {
+  m_freeMap = nullptr;
+  if (!map) {
+    return true;
+  }
+  if (!m_fatType || size == 0) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_freeMapShift = 0;
+  while (((m_lastCluster >> m_freeMapShift) >> 5) >= size) {
+    m_freeMapShift++;
+  }
+  m_freeMap = map;
+  m_freeMapValid = false;
+  // Build the map now so allocation never scans the FAT.
+  if (freeClusterCount() < 0) {
+    m_freeMap = nullptr;
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  return true;
+
+fail:
+  return false;
+}
+#endif  // USE_FAT_FREE_MAP
+#if USE_FSINFO
+//------------------------------------------------------------------------------
+// Use free count and next free hint from a valid FAT32 FSInfo sector.
+bool FatPartition::fsInfoInit(Sector_t sector) {
+  const FsInfo_t* fsi;
+  uint32_t freeCount;
+  uint32_t nextFree;
+  m_fsInfoSector = 0;
+  m_fsInfoDirty = false;
+#if USE_FSINFO > 1
+  m_fsInfoCheck = false;
+#endif  // USE_FSINFO > 1
+  if (fatType() != 32) {
+    return true;
+  }
+  fsi = reinterpret_cast<FsInfo_t*>(
+      dataCachePrepare(sector, FsCache::CACHE_FOR_READ));
+  if (!fsi) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (getLe32(fsi->leadSignature) != FSINFO_LEAD_SIGNATURE ||
+      getLe32(fsi->structSignature) != FSINFO_STRUCT_SIGNATURE ||
+      getLe32(fsi->trailSignature) != FSINFO_TRAIL_SIGNATURE) {
+    return true;
+  }
+  m_fsInfoSector = sector;
+  freeCount = getLe32(fsi->freeCount);
+  if (freeCount <= clusterCount()) {
+    setFreeClusterCount(freeCount);
+#if USE_FSINFO > 1
+    m_fsInfoCheck = true;
+#endif  // USE_FSINFO > 1
+  }
+  nextFree = getLe32(fsi->nextFree);
+  if (2 <= nextFree && nextFree <= m_lastCluster) {
+    m_allocSearchStart = nextFree - 1;
+  }
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool FatPartition::fsInfoSync() {
+  FsInfo_t* fsi;
+  if (!m_fsInfoDirty) {
+    return true;
+  }
+  fsi = reinterpret_cast<FsInfo_t*>(
+      dataCachePrepare(m_fsInfoSector, FsCache::CACHE_FOR_WRITE));
+  if (!fsi) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  setLe32(fsi->freeCount, m_freeClusterCount);
+  setLe32(fsi->nextFree, m_allocSearchStart < m_lastCluster
+                             ? m_allocSearchStart + 1
+                             : 0XFFFFFFFF);
+  if (!m_cache.sync()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_fsInfoDirty = false;
+  return true;
+
+fail:
+  return false;
+}
+#endif  // USE_FSINFO
 //------------------------------------------------------------------------------
 bool FatPartition::init(FsBlockDevice* dev, uint8_t part,
                         Sector_t startSector) {
@@ -401,6 +786,18 @@ bool FatPartition::init(FsBlockDevice* dev, uint8_t part,
   uint8_t tmp;
   m_fatType = 0;
   m_allocSearchStart = 1;
+#if USE_AU_ALLOCATION
+  m_auClusters = 0;
+#endif  // USE_AU_ALLOCATION
+#if USE_FAT_FREE_MAP
+  m_freeMap = nullptr;
+#endif  // USE_FAT_FREE_MAP
+#if USE_DIR_INDEX
+  m_dirIndex.end();
+#endif  // USE_DIR_INDEX
+#if SFN_TAIL_MAP_SIZE
+  m_sfnTail.base = 0;
+#endif  // SFN_TAIL_MAP_SIZE
   m_cache.init(dev);
 #if USE_SEPARATE_FAT_CACHE
   m_fatCache.init(dev);
@@ -500,6 +897,12 @@ bool FatPartition::init(FsBlockDevice* dev, uint8_t part,
 #if USE_SEPARATE_FAT_CACHE
   m_fatCache.setMirrorOffset(m_sectorsPerFat);
 #endif  // USE_SEPARATE_FAT_CACHE
+#if USE_FSINFO
+  if (!fsInfoInit(startSector + getLe16(bpb->fat32FSInfoSector))) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+#endif  // USE_FSINFO
   return true;
 
 fail:
@@ -31,6 +31,7 @@
 
 #include "../common/FsBlockDevice.h"
 #include "../common/FsCache.h"
+#include "../common/FsDirIndex.h"
 #include "../common/FsStructs.h"
 #include "../common/SysCall.h"
 
@@ -43,6 +44,25 @@ const uint8_t FAT_TYPE_FAT16 = 16;
 /** Type for FAT12 partition */
 const uint8_t FAT_TYPE_FAT32 = 32;
 
+#if SFN_TAIL_MAP_SIZE
+//------------------------------------------------------------------------------
+/**
+ * \struct FatSfnTail_t
+ * \brief Internal type for used short name tails - do not use in user apps.
+ */
+struct FatSfnTail_t {
+  /** First cluster of the directory. */
+  Cluster_t dir;
+  /** Tail for bit zero of the map. */
+  uint16_t base;
+  /** Position of '~' in sfn. */
+  uint8_t pos;
+  /** Map has been built by a directory scan. */
+  bool valid;
+  /** Bit set if the tail is used. */
+  uint32_t used[(SFN_TAIL_MAP_SIZE + 31) / 32];
+};
+#endif  // SFN_TAIL_MAP_SIZE
 //==============================================================================
 /**
  * \class FatPartition
@@ -54,6 +74,10 @@ class FatPartition {
    */
   FatPartition() = default;  // cppcheck-suppress uninitMemberVar
 
+#if USE_AU_ALLOCATION
+  /** \return Clusters in a card allocation unit (AU) or zero if not set. */
+  uint32_t auClusters() const { return m_auClusters; }
+#endif  // USE_AU_ALLOCATION
   /** \return The shift count required to multiply by bytesPerCluster. */
   uint8_t bytesPerClusterShift() const {
     return m_sectorsPerClusterShift + m_bytesPerSectorShift;
@@ -80,6 +104,45 @@ class FatPartition {
    * \return A pointer to the cache buffer or zero if an error occurs.
    */
   uint8_t* cacheClear() { return m_cache.clear(); }
+#if FS_CACHE_USER_SECTOR_COUNT
+  /** Add sectors in a caller-owned buffer to the directory and data cache.
+   *
+   * See FS_CACHE_USER_SECTOR_COUNT.  The buffer must stay valid until a
+   * call with a count of zero removes it.
+   *
+   * \param[in] buf Buffer for count sectors, aligned to four bytes.
+   * \param[in] count Number of sectors in buf.
+   * \return true for success or false for failure.
+   */
+  bool cacheAttach(uint8_t* buf, uint8_t count) {
+    return m_cache.attach(buf, count);
+  }
+#endif  // FS_CACHE_USER_SECTOR_COUNT
+#if USE_FS_CACHE_STATS
+  /** \return Number of sector cache hits. */
+  uint32_t cacheHitCount() const {
+#if USE_SEPARATE_FAT_CACHE
+    return m_cache.hitCount() + m_fatCache.hitCount();
+#else   // USE_SEPARATE_FAT_CACHE
+    return m_cache.hitCount();
+#endif  // USE_SEPARATE_FAT_CACHE
+  }
+  /** \return Number of sector cache misses. */
+  uint32_t cacheMissCount() const {
+#if USE_SEPARATE_FAT_CACHE
+    return m_cache.missCount() + m_fatCache.missCount();
+#else   // USE_SEPARATE_FAT_CACHE
+    return m_cache.missCount();
+#endif  // USE_SEPARATE_FAT_CACHE
+  }
+  /** Reset sector cache hit and miss counts. */
+  void cacheResetStats() {
+    m_cache.resetStats();
+#if USE_SEPARATE_FAT_CACHE
+    m_fatCache.resetStats();
+#endif  // USE_SEPARATE_FAT_CACHE
+  }
+#endif  // USE_FS_CACHE_STATS
   /** \return The total number of clusters in the volume. */
   Cluster_t clusterCount() const { return m_lastCluster - 1; }
   /** \return The shift count required to multiply by sectorsPerCluster. */
@@ -91,7 +154,12 @@ class FatPartition {
    */
   uint8_t* end() {
     m_fatType = 0;
-    return cacheClear();
+#if USE_SEPARATE_FAT_CACHE
+    if (!m_fatCache.syncMirror()) {
+      return nullptr;
+    }
+#endif  // USE_SEPARATE_FAT_CACHE
+    return m_cache.syncMirror() ? cacheClear() : nullptr;
   }
   /** \return The number of File Allocation Tables. */
   uint8_t fatCount() const { return m_fatCount; }
@@ -113,6 +181,36 @@ class FatPartition {
    * \return true for success or false for failure.
    */
   bool init(FsBlockDevice* dev, uint8_t part = 1, Sector_t startSector = 0);
+#if USE_FAT_FREE_MAP
+  /** Attach a RAM map of free space to speed allocation.
+   *
+   * The map must be attached after the volume is initialized and remains
+   * in use until the next call to init().  Each bit covers the smallest
+   * power of two group of clusters that allows the map to fit in \a size
+   * words.  The map is built here by a scan of the FAT, so allocation
+   * never has to scan the FAT to build it.
+   *
+   * \param[in] map Array of \a size words or nullptr to remove the map.
+   * \param[in] size Number of words in \a map.
+   *
+   * \return true for success or false for failure.
+   */
+  bool setFreeMap(uint32_t* map, size_t size);
+#endif  // USE_FAT_FREE_MAP
+#if USE_AU_ALLOCATION
+  /** Set the card allocation unit (AU) size.
+   *
+   * Contiguous allocations by preAllocate() and createContiguous() start
+   * on an AU boundary when possible.  A file that can't be extended in
+   * place continues in a free AU.  SdFat calls this with the AU size from
+   * the SD Status register when the volume is mounted.
+   *
+   * \param[in] sectors AU size in sectors or zero to remove AU alignment.
+   *
+   * \return true for success or false if clusters are not AU aligned.
+   */
+  bool setAuSize(uint32_t sectors);
+#endif  // USE_AU_ALLOCATION
   /** \return The number of entries in the root directory for FAT16 volumes. */
   uint16_t rootDirEntryCount() const { return m_rootDirEntryCount; }
   /** \return The logical sector number for the start of the root directory
@@ -135,6 +233,14 @@ class FatPartition {
    * \return true if busy else false.
    */
   bool isBusy() { return m_blockDev->isBusy(); }
+#if USE_ASYNC_IO
+  /**
+   * Advance asynchronous requests without waiting.
+   *
+   * \return Number of requests not yet complete.
+   */
+  uint8_t pollAsync() { return m_blockDev->poll(); }
+#endif  // USE_ASYNC_IO
   //----------------------------------------------------------------------------
 #ifndef DOXYGEN_SHOULD_SKIP_THIS
   bool dmpDirSector(print_t* pr, Sector_t sector);
@@ -146,6 +252,8 @@ class FatPartition {
  private:
   /** FatFile allowed access to private members. */
   friend class FatFile;
+  /** FatVolume allowed access to private members. */
+  friend class FatVolume;
   //----------------------------------------------------------------------------
   static const uint8_t m_bytesPerSectorShift = 9;
   static const uint16_t m_bytesPerSector = 1 << m_bytesPerSectorShift;
@@ -164,6 +272,82 @@ class FatPartition {
   Sector_t m_fatStartSector;         // Start sector for first FAT.
   Cluster_t m_lastCluster;           // Last cluster number in FAT.
   Cluster_t m_rootDirStart;          // Start sector FAT16, cluster FAT32.
+#if USE_AU_ALLOCATION
+  uint32_t m_auClusters;       // Clusters per AU or zero.
+  Cluster_t m_auFirstCluster;  // First cluster on an AU boundary.
+  Cluster_t auCeil(Cluster_t cluster) const;
+  int8_t auFind(uint32_t count, Cluster_t* bgn);
+  uint32_t auIndex(Cluster_t cluster) const {
+    return (cluster + m_auClusters - m_auFirstCluster) / m_auClusters;
+  }
+  int8_t auStart(Cluster_t current, Cluster_t* find);
+#else   // USE_AU_ALLOCATION
+  int8_t auFind(uint32_t count, Cluster_t* bgn) {
+    (void)count;
+    (void)bgn;
+    return 0;
+  }
+  int8_t auStart(Cluster_t current, Cluster_t* find) {
+    (void)current;
+    (void)find;
+    return 0;
+  }
+#endif  // USE_AU_ALLOCATION
+#if USE_FAT_FREE_MAP
+  uint32_t* m_freeMap = nullptr;  // Bit set if group has a free cluster.
+  uint8_t m_freeMapShift;         // Cluster count to group shift.
+  bool m_freeMapValid;            // Map has been built from the FAT.
+  void freeMapFull(Cluster_t first, Cluster_t last);
+  // Clear the group of find if all of it from used through find is in use.
+  void freeMapUsed(Cluster_t used, Cluster_t find) {
+    Cluster_t bgn = (find >> m_freeMapShift) << m_freeMapShift;
+    freeMapFull(used > bgn ? used : bgn, find);
+  }
+  void freeMapMark(Cluster_t cluster) {
+    if (m_freeMap) {
+      Cluster_t group = cluster >> m_freeMapShift;
+      m_freeMap[group >> 5] |= 1UL << (group & 31);
+    }
+  }
+  void freeMapReset() {
+    m_freeMapValid = false;
+    if (m_freeMap) {
+      memset(m_freeMap, 0, 4 * ((m_lastCluster >> m_freeMapShift >> 5) + 1));
+    }
+  }
+  void freeMapMarkSector(const uint8_t* pc, Cluster_t cluster, uint16_t n);
+  Cluster_t freeMapSkip(Cluster_t cluster);
+  bool freeMapValid() const { return !m_freeMap || m_freeMapValid; }
+  void setFreeMapValid() { m_freeMapValid = true; }
+#else   // USE_FAT_FREE_MAP
+  void freeMapFull(Cluster_t first, Cluster_t last) {
+    (void)first;
+    (void)last;
+  }
+  void freeMapUsed(Cluster_t used, Cluster_t find) {
+    (void)used;
+    (void)find;
+  }
+  void freeMapMark(Cluster_t cluster) { (void)cluster; }
+  void freeMapMarkSector(const uint8_t* pc, Cluster_t cluster, uint16_t n) {
+    (void)pc;
+    (void)cluster;
+    (void)n;
+  }
+  void freeMapReset() {}
+  Cluster_t freeMapSkip(Cluster_t cluster) { return cluster; }
+  bool freeMapValid() const { return true; }
+  void setFreeMapValid() {}
+#endif  // USE_FAT_FREE_MAP
+#if USE_DIR_INDEX
+  FsDirIndex m_dirIndex;  // Index of one large directory.
+  FsDirIndex* dirIndex(Cluster_t dir) {
+    return m_dirIndex.covers(dir) ? &m_dirIndex : nullptr;
+  }
+#endif  // USE_DIR_INDEX
+#if SFN_TAIL_MAP_SIZE
+  FatSfnTail_t m_sfnTail;  // Used short name tails in one directory.
+#endif  // SFN_TAIL_MAP_SIZE
   //----------------------------------------------------------------------------
   // sector I/O functions.
   bool cacheSafeRead(Sector_t sector, uint8_t* dst) {
@@ -178,6 +362,14 @@ class FatPartition {
   bool cacheSafeWrite(Sector_t sector, const uint8_t* dst, size_t count) {
     return m_cache.cacheSafeWrite(sector, dst, count);
   }
+#if USE_ASYNC_IO
+  bool cacheSafeSubmit(FsIoRequest* req) {
+    return m_cache.cacheSafeSubmit(req);
+  }
+#endif  // USE_ASYNC_IO
+  bool eraseHint(Sector_t firstSector, Sector_t lastSector) {
+    return m_blockDev->eraseHint(firstSector, lastSector);
+  }
   bool syncDevice() { return m_blockDev->syncDevice(); }
 #if MAINTAIN_FREE_CLUSTER_COUNT
   int32_t m_freeClusterCount;  // Count of free clusters in volume.
@@ -185,12 +377,33 @@ class FatPartition {
   void updateFreeClusterCount(int32_t change) {
     if (m_freeClusterCount >= 0) {
       m_freeClusterCount += change;
+      setFsInfoDirty();
     }
   }
 #else   // MAINTAIN_FREE_CLUSTER_COUNT
   void setFreeClusterCount(int32_t value) { (void)value; }
   void updateFreeClusterCount(int32_t change) { (void)change; }
 #endif  // MAINTAIN_FREE_CLUSTER_COUNT
+#if USE_FSINFO
+  Sector_t m_fsInfoSector;  // FSInfo sector or zero if none.
+  bool m_fsInfoDirty;       // FSInfo needs to be written.
+#if USE_FSINFO > 1
+  bool m_fsInfoCheck;  // FSInfo free count not validated.
+  bool fsInfoValid() const { return !m_fsInfoCheck; }
+  void setFsInfoValid() { m_fsInfoCheck = false; }
+#else   // USE_FSINFO > 1
+  bool fsInfoValid() const { return true; }
+  void setFsInfoValid() {}
+#endif  // USE_FSINFO > 1
+  bool fsInfoInit(Sector_t sector);
+  bool fsInfoSync();
+  void setFsInfoDirty() { m_fsInfoDirty = m_fsInfoSector != 0; }
+#else   // USE_FSINFO
+  bool fsInfoValid() const { return true; }
+  bool fsInfoSync() { return true; }
+  void setFsInfoDirty() {}
+  void setFsInfoValid() {}
+#endif  // USE_FSINFO
         // sector caches
   FsCache m_cache;
   FsCache* dataCache() { return &m_cache; }
@@ -203,7 +416,8 @@ class FatPartition {
     return m_fatCache.prepare(sector, options);
   }
   bool cacheSync() {
-    return m_cache.sync() && m_fatCache.sync() && syncDevice();
+    return m_cache.sync() && m_fatCache.syncMirror() && fsInfoSync() &&
+           syncDevice();
   }
 #else   // USE_SEPARATE_FAT_CACHE
   uint8_t* fatCachePrepare(Sector_t sector, uint8_t options) {
@@ -212,7 +426,10 @@ class FatPartition {
     }
     return dataCachePrepare(sector, options);
   }
-  bool cacheSync() { return m_cache.sync() && syncDevice(); }
+  bool cacheSync() {
+    return m_cache.sync() && fsInfoSync() && m_cache.syncMirror() &&
+           syncDevice();
+  }
 #endif  // USE_SEPARATE_FAT_CACHE
   uint8_t* dataCachePrepare(Sector_t sector, uint8_t options) {
     return m_cache.prepare(sector, options);
@@ -222,7 +439,7 @@ class FatPartition {
   Sector_t cacheSectorNumber() { return m_cache.sector(); }
   void cacheDirty() { m_cache.dirty(); }
   //----------------------------------------------------------------------------
-  bool allocateCluster(Cluster_t current, Cluster_t* next);
+  bool allocateCluster(Cluster_t current, Cluster_t* next, bool data);
   bool allocContiguous(uint32_t count, Cluster_t* firstCluster);
   uint8_t sectorOfCluster(uint32_t position) const {
     return (position >> 9) & m_clusterSectorMask;
@@ -232,7 +449,10 @@ class FatPartition {
   }
   int8_t fatGet(Cluster_t cluster, Cluster_t* value);
   bool fatPut(Cluster_t cluster, Cluster_t value);
+  bool fatPutRun(Cluster_t first, Cluster_t end, bool link);
+  int8_t findContiguous(Cluster_t start, uint32_t count, Cluster_t* bgn,
+                        bool* setStart);
   bool fatPutEOC(Cluster_t cluster) { return fatPut(cluster, 0x0FFFFFFF); }
-  bool freeChain(Cluster_t cluster);
+  bool freeChain(Cluster_t cluster, uint32_t known = 0);
   bool isEOC(Cluster_t cluster) const { return cluster > m_lastCluster; }
 };
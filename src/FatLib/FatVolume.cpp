@@ -43,3 +43,27 @@ bool FatVolume::chdir(const char* path) {
 fail:
   return false;
 }
+#if USE_DIR_INDEX
+//------------------------------------------------------------------------------
+bool FatVolume::setDirIndex(const char* path, FsDirIndexEntry* table,
+                            size_t size) {
+  FatFile dir;
+  m_dirIndex.end();
+  if (!table) {
+    return true;
+  }
+  if (!USE_LONG_FILE_NAMES || size == 0) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (!dir.open(vwd(), path, O_RDONLY) || !dir.isDir()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_dirIndex.begin(table, size, dir.firstCluster());
+  return true;
+
+fail:
+  return false;
+}
+#endif  // USE_DIR_INDEX
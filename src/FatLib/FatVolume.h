@@ -213,6 +213,25 @@ class FatVolume : public FatPartition {
     FatFile sub;
     return sub.open(this, path, O_RDONLY) && sub.rmdir();
   }
+#if USE_DIR_INDEX
+  //----------------------------------------------------------------------------
+  /** Attach a RAM index to a large directory.
+   *
+   * The index is built by a scan of the directory at the next open or
+   * create in the directory.  The index is kept for creates, removes and
+   * renames until the next call to begin() or setDirIndex().  The index
+   * is turned off if \a size is less than the number of files in the
+   * directory.  Requires USE_LONG_FILE_NAMES.
+   *
+   * \param[in] path Path of the directory.
+   * \param[in] table Array of \a size entries or nullptr to remove the
+   *            index.
+   * \param[in] size Number of entries in \a table.
+   *
+   * \return true for success or false for failure.
+   */
+  bool setDirIndex(const char* path, FsDirIndexEntry* table, size_t size);
+#endif  // USE_DIR_INDEX
   //----------------------------------------------------------------------------
   /** Truncate a file to a specified length.  The current file position
    * will be at the new EOF.
@@ -62,6 +62,26 @@ bool FsBaseFile::close() {
   return rtn;
 }
 //------------------------------------------------------------------------------
+#if USE_CREATE_NEW
+bool FsBaseFile::createNew(FsBaseFile* dir, const char* name, oflag_t oflag) {
+  close();
+  if (dir->m_fFile) {
+    m_fFile = new (m_fileMem) FatFile;
+    if (m_fFile->createNew(dir->m_fFile, name, oflag)) {
+      return true;
+    }
+    m_fFile = nullptr;
+  } else if (dir->m_xFile) {
+    m_xFile = new (m_fileMem) ExFatFile;
+    if (m_xFile->createNew(dir->m_xFile, name, oflag)) {
+      return true;
+    }
+    m_xFile = nullptr;
+  }
+  return false;
+}
+#endif  // USE_CREATE_NEW
+//------------------------------------------------------------------------------
 bool FsBaseFile::mkdir(FsBaseFile* dir, const char* path, bool pFlag) {
   close();
   if (dir->m_fFile) {
@@ -223,3 +243,23 @@ bool FsBaseFile::rmdir() {
   }
   return false;
 }
+//------------------------------------------------------------------------------
+bool FsBaseFile::rmRfStar() {
+  FsRmRfOnce rm;
+  rm.begin();
+  return rmRfStar(&rm) > 0;
+}
+//------------------------------------------------------------------------------
+int8_t FsBaseFile::rmRfStar(FsBaseRmRf* rm) {
+  int8_t rtn = m_fFile   ? m_fFile->rmRfStar(rm)
+               : m_xFile ? m_xFile->rmRfStar(rm)
+                         : -1;
+  // A removed directory is closed.
+  if (m_fFile && !m_fFile->isOpen()) {
+    m_fFile = nullptr;
+  }
+  if (m_xFile && !m_xFile->isOpen()) {
+    m_xFile = nullptr;
+  }
+  return rtn;
+}
@@ -133,6 +133,16 @@ class FsBaseFile {
            : m_xFile ? m_xFile->attrib(bits)
                      : false;
   }
+#if USE_AU_ALLOCATION
+  /** \return The number of card allocation units (AU) spanned by the
+   * file's clusters or zero if the AU size is not set or an error occurs.
+   */
+  uint32_t auCount() {
+    return m_fFile   ? m_fFile->auCount()
+           : m_xFile ? m_xFile->auCount()
+                     : 0;
+  }
+#endif  // USE_AU_ALLOCATION
   /** \return number of bytes available from the current position to EOF
    *   or INT_MAX if more than INT_MAX bytes are available.
    */
@@ -147,6 +157,32 @@ class FsBaseFile {
            : m_xFile ? m_xFile->available64()
                      : 0;
   }
+  /** Borrow cached bytes at the current position for reading.
+   *
+   * See FatFile::borrowRead() and ExFatFile::borrowRead().
+   *
+   * \param[out] count Number of bytes at the returned address.
+   * \return Address of the bytes or nullptr at EOF or for an error.
+   */
+  const uint8_t* borrowRead(size_t* count) {
+    *count = 0;
+    return m_fFile   ? m_fFile->borrowRead(count)
+           : m_xFile ? m_xFile->borrowRead(count)
+                     : nullptr;
+  }
+  /** Borrow cached bytes at the current position for overwriting.
+   *
+   * See FatFile::borrowWrite() and ExFatFile::borrowWrite().
+   *
+   * \param[out] count Number of bytes at the returned address.
+   * \return Address of the bytes or nullptr at EOF or for an error.
+   */
+  uint8_t* borrowWrite(size_t* count) {
+    *count = 0;
+    return m_fFile   ? m_fFile->borrowWrite(count)
+           : m_xFile ? m_xFile->borrowWrite(count)
+                     : nullptr;
+  }
   /** Clear writeError. */
   void clearWriteError() {
     if (m_fFile) m_fFile->clearWriteError();
@@ -173,6 +209,21 @@ class FsBaseFile {
            : m_xFile ? m_xFile->contiguousRange(bgnSector, endSector)
                      : false;
   }
+#if USE_CREATE_NEW
+  /** Create and open a file with a name that is not in the directory.
+   *
+   * See FatFile::createNew() and ExFatFile::createNew().
+   *
+   * WARNING: A duplicate name will result if the name is in the directory.
+   *
+   * \param[in] dir An open directory where the file will be created.
+   * \param[in] name A valid file name, not a path.
+   * \param[in] oflag Open flags, must include O_WRONLY or O_RDWR.
+   *
+   * \return true for success or false for failure.
+   */
+  bool createNew(FsBaseFile* dir, const char* name, oflag_t oflag = O_WRONLY);
+#endif  // USE_CREATE_NEW
   /** \return The current cluster number for a file or directory. */
   Cluster_t curCluster() const {
     return m_fFile   ? m_fFile->curCluster()
@@ -444,6 +495,21 @@ class FsBaseFile {
            : m_xFile ? m_xFile->ls(pr, flags)
                      : false;
   }
+  /** Read the next page of a sorted directory listing.
+   *
+   * See FatFile::listPage() and ExFatFile::listPage().
+   *
+   * \param[in,out] list State from FsDirList::begin().
+   * \param[in] count Maximum number of entries in the page.
+   *
+   * \return Number of entries in the page, zero at the end of the list, or
+   *         -1 for an error.
+   */
+  int16_t listPage(FsDirList* list, uint16_t count) {
+    return m_fFile   ? m_fFile->listPage(list, count)
+           : m_xFile ? m_xFile->listPage(list, count)
+                     : -1;
+  }
   /** Make a new directory.
    *
    * \param[in] dir An open FatFile instance for the directory that will
@@ -577,6 +643,17 @@ class FsBaseFile {
   int peek() {
     return m_fFile ? m_fFile->peek() : m_xFile ? m_xFile->peek() : -1;
   }
+#if USE_ASYNC_IO
+  /** Advance asynchronous requests on the file's device without waiting.
+   *
+   * \return Number of requests not yet complete.
+   */
+  uint8_t pollAsync() {
+    return m_fFile   ? m_fFile->pollAsync()
+           : m_xFile ? m_xFile->pollAsync()
+                     : 0;
+  }
+#endif  // USE_ASYNC_IO
   /** Allocate contiguous clusters to an empty file.
    *
    * The file must be empty with no clusters allocated.
@@ -586,11 +663,14 @@ class FsBaseFile {
    * the requested length.
    *
    * \param[in] length size of the file in bytes.
+   * \param[in] erase Erase the allocated sectors so later writes go to
+   *            pre-erased flash.  Ignored if the device can't erase.
    * \return true for success or false for failure.
    */
-  bool preAllocate(uint64_t length) {
-    return m_fFile   ? length < (1ULL << 32) && m_fFile->preAllocate(length)
-           : m_xFile ? m_xFile->preAllocate(length)
+  bool preAllocate(uint64_t length, bool erase = false) {
+    return m_fFile ? length < (1ULL << 32) &&
+                         m_fFile->preAllocate(length, erase)
+           : m_xFile ? m_xFile->preAllocate(length, erase)
                      : false;
   }
   /** Print a file's access date and time
@@ -680,6 +760,46 @@ class FsBaseFile {
            : m_xFile ? m_xFile->printName(pr)
                      : 0;
   }
+  /** Set validLength() for a file written with rawWrite() and sync it.
+   *
+   * See FatFile::rawEnd() and ExFatFile::rawEnd().
+   *
+   * \param[in] length New validLength().
+   * \return true for success or false for failure.
+   */
+  bool rawEnd(uint64_t length) {
+    return m_fFile   ? m_fFile->rawEnd(length)
+           : m_xFile ? m_xFile->rawEnd(length)
+                     : false;
+  }
+  /** Read sectors of a contiguous file directly from the device.
+   *
+   * See FatFile::rawRead() and ExFatFile::rawRead().
+   *
+   * \param[in] index Index of the first sector in the file.
+   * \param[out] dst Location for the data.
+   * \param[in] ns Number of sectors.
+   * \return true for success or false for failure.
+   */
+  bool rawRead(uint32_t index, uint8_t* dst, size_t ns) {
+    return m_fFile   ? m_fFile->rawRead(index, dst, ns)
+           : m_xFile ? m_xFile->rawRead(index, dst, ns)
+                     : false;
+  }
+  /** Write sectors of a contiguous file directly to the device.
+   *
+   * See FatFile::rawWrite() and ExFatFile::rawWrite().
+   *
+   * \param[in] index Index of the first sector in the file.
+   * \param[in] src Data to write.
+   * \param[in] ns Number of sectors.
+   * \return true for success or false for failure.
+   */
+  bool rawWrite(uint32_t index, const uint8_t* src, size_t ns) {
+    return m_fFile   ? m_fFile->rawWrite(index, src, ns)
+           : m_xFile ? m_xFile->rawWrite(index, src, ns)
+                     : false;
+  }
   /** Read the next byte from a file.
    *
    * \return For success return the next byte in the file as an int.
@@ -707,6 +827,51 @@ class FsBaseFile {
            : m_xFile ? m_xFile->read(buf, count)
                      : -1;
   }
+#if USE_ASYNC_IO
+  /** Queue a read of whole sectors at the current position.
+   *
+   * See FatFile::readAsync() and ExFatFile::readAsync().
+   *
+   * \param[in,out] req Request for the transfer.
+   * \param[out] buf Location for the data.  Valid when req is done.
+   * \param[in] count Maximum number of bytes to read.
+   * \return Number of bytes queued, zero if less than one sector remains
+   * or -1 for an error.
+   */
+  int readAsync(FsIoRequest* req, void* buf, size_t count) {
+    return m_fFile   ? m_fFile->readAsync(req, buf, count)
+           : m_xFile ? m_xFile->readAsync(req, buf, count)
+                     : -1;
+  }
+#endif  // USE_ASYNC_IO
+  /** Read the next file or subdirectory of a directory without opening it.
+   *
+   * See FatFile::readDirPlus() and ExFatFile::readDirPlus().
+   *
+   * \param[out] stat Information for the entry.
+   * \param[out] name Name of the entry or nullptr if not needed.
+   * \param[in] size Size of \a name.
+   *
+   * \return 1 for an entry, 0 at the end of the directory, or -1 for an
+   *         error.
+   */
+  int8_t readDirPlus(FsDirStat* stat, char* name = nullptr, size_t size = 0) {
+    return m_fFile   ? m_fFile->readDirPlus(stat, name, size)
+           : m_xFile ? m_xFile->readDirPlus(stat, name, size)
+                     : -1;
+  }
+  /** Move the current position past bytes from borrowRead() or
+   * borrowWrite().
+   *
+   * \param[in] count Number of borrowed bytes consumed.
+   * \param[in] modified Set true if bytes from borrowWrite() were changed.
+   * \return true for success or false for failure.
+   */
+  bool release(size_t count, bool modified = false) {
+    return m_fFile   ? m_fFile->release(count, modified)
+           : m_xFile ? m_xFile->release(count, modified)
+                     : false;
+  }
   /** Remove a file.
    *
    * The directory entry and all data for the file are deleted.
@@ -778,6 +943,24 @@ class FsBaseFile {
    * \return true for success or false for failure.
    */
   bool rmdir();
+  /** Recursively delete a directory and all contained files.
+   *
+   * See FatFile::rmRfStar() and ExFatFile::rmRfStar().
+   *
+   * \return true for success or false for failure.
+   */
+  bool rmRfStar();
+  /** Recursively delete a directory in steps.
+   *
+   * See FatFile::rmRfStar(FsBaseRmRf*) and
+   * ExFatFile::rmRfStar(FsBaseRmRf*).
+   *
+   * \param[in,out] rm State of the delete, normally an FsRmRf.
+   *
+   * \return 1 when the delete is done, 0 if the budget is used, or -1 for
+   *         an error.
+   */
+  int8_t rmRfStar(FsBaseRmRf* rm);
   /** Set the files position to current position + \a pos. See seekSet().
    * \param[in] offset The new position in bytes from the current position.
    * \return true for success or false for failure.
@@ -903,6 +1086,23 @@ class FsBaseFile {
            : m_xFile ? m_xFile->write(buf, count)
                      : 0;
   }
+#if USE_ASYNC_IO
+  /** Queue a write of whole sectors at the current position.
+   *
+   * See FatFile::writeAsync() and ExFatFile::writeAsync().
+   *
+   * \param[in,out] req Request for the transfer.
+   * \param[in] buf Data to be written.  Must not change until req is done.
+   * \param[in] count Maximum number of bytes to write.
+   * \return Number of bytes queued, zero if count is less than one sector
+   * or -1 for an error.
+   */
+  int writeAsync(FsIoRequest* req, const void* buf, size_t count) {
+    return m_fFile   ? m_fFile->writeAsync(req, buf, count)
+           : m_xFile ? m_xFile->writeAsync(req, buf, count)
+                     : -1;
+  }
+#endif  // USE_ASYNC_IO
 
  private:
   newalign_t m_fileMem[FS_ALIGN_DIM(ExFatFile, FatFile)];
@@ -81,6 +81,46 @@ class FsVolume {
                     : 0;
   }
   //----------------------------------------------------------------------------
+#if FS_CACHE_USER_SECTOR_COUNT
+  /** Add sectors in a caller-owned buffer to the volume cache.
+   *
+   * Call after begin().  See FatVolume::cacheAttach() and
+   * ExFatVolume::cacheAttach().
+   *
+   * \param[in] buf Buffer for count sectors, aligned to four bytes.
+   * \param[in] count Number of sectors in buf.
+   * \return true for success or false for failure.
+   */
+  bool cacheAttach(uint8_t* buf, uint8_t count) {
+    return m_fVol   ? m_fVol->cacheAttach(buf, count)
+           : m_xVol ? m_xVol->cacheAttach(buf, count)
+                    : false;
+  }
+  //----------------------------------------------------------------------------
+#endif  // FS_CACHE_USER_SECTOR_COUNT
+#if USE_FS_CACHE_STATS
+  /** \return Number of sector cache hits. */
+  uint32_t cacheHitCount() const {
+    return m_fVol   ? m_fVol->cacheHitCount()
+           : m_xVol ? m_xVol->cacheHitCount()
+                    : 0;
+  }
+  /** \return Number of sector cache misses. */
+  uint32_t cacheMissCount() const {
+    return m_fVol   ? m_fVol->cacheMissCount()
+           : m_xVol ? m_xVol->cacheMissCount()
+                    : 0;
+  }
+  /** Reset sector cache hit and miss counts. */
+  void cacheResetStats() {
+    if (m_fVol) {
+      m_fVol->cacheResetStats();
+    } else if (m_xVol) {
+      m_xVol->cacheResetStats();
+    }
+  }
+  //----------------------------------------------------------------------------
+#endif  // USE_FS_CACHE_STATS
   /**
    * Set volume working directory to root.
    * \return true for success or false for failure.
@@ -124,6 +164,48 @@ class FsVolume {
     return reinterpret_cast<uint8_t*>(m_volMem);
   }
   //----------------------------------------------------------------------------
+#if USE_AU_ALLOCATION
+  /** Set the card allocation unit (AU) size.
+   *
+   * \param[in] sectors AU size in sectors or zero to remove AU alignment.
+   *
+   * \return true for success or false for failure.
+   */
+  bool setAuSize(uint32_t sectors) {
+    return m_fVol   ? m_fVol->setAuSize(sectors)
+           : m_xVol ? m_xVol->setAuSize(sectors)
+                    : false;
+  }
+#endif  // USE_AU_ALLOCATION
+#if USE_DIR_INDEX
+  /** Attach a RAM index to a large directory.
+   *
+   * \param[in] path Path of the directory.
+   * \param[in] table Array of \a size entries or nullptr to remove the
+   *            index.
+   * \param[in] size Number of entries in \a table.
+   *
+   * \return true for success or false for failure.
+   */
+  bool setDirIndex(const char* path, FsDirIndexEntry* table, size_t size) {
+    return m_fVol   ? m_fVol->setDirIndex(path, table, size)
+           : m_xVol ? m_xVol->setDirIndex(path, table, size)
+                    : false;
+  }
+#endif  // USE_DIR_INDEX
+#if USE_FAT_FREE_MAP
+  /** Attach a RAM map of free space to a FAT16/FAT32 volume.
+   *
+   * \param[in] map Array of \a size words or nullptr to remove the map.
+   * \param[in] size Number of words in \a map.
+   *
+   * \return true for success or false for failure or an exFAT volume.
+   */
+  bool setFreeMap(uint32_t* map, size_t size) {
+    return m_fVol ? m_fVol->setFreeMap(map, size) : false;
+  }
+#endif  // USE_FAT_FREE_MAP
+  //----------------------------------------------------------------------------
   /** Test for the existence of a file in a directory
    *
    * \param[in] path Path of the file to be tested for.
@@ -0,0 +1,272 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+/**
+ * \file
+ * \brief Raw-extent stream for contiguous files.
+ */
+#include <string.h>
+
+#include "common/SysCall.h"
+/**
+ * \class RawStream
+ * \brief Read or write a contiguous file directly with the block device.
+ *
+ * The file must be contiguous, usually from preAllocate().  Data is moved
+ * with rawRead() and rawWrite() so whole sectors go from the caller's
+ * buffer straight to the device.  Consecutive sectors are written as
+ * multi-sector transfers, the card stays in multi-block write mode on a
+ * dedicated SPI bus, and no FAT or directory sectors are touched while
+ * streaming.
+ *
+ * Writes of any size are accepted.  A partial sector is held in a 512 byte
+ * buffer until it is filled.  sync() and close() write the partial sector
+ * and set validLength(), the file size on FAT, with one directory entry
+ * write.  Data written after the last sync() is lost on a power failure.
+ *
+ * F is a file class such as FsFile, ExFile or File32.
+ */
+template <class F>
+class RawStream : public print_t {
+ public:
+  RawStream() { init(nullptr, false); }
+  /** \return Bytes that can be read in read mode or bytes of free
+   *          space in write mode.
+   */
+  uint64_t available() const {
+    return (m_write ? capacity() : m_size) - m_position;
+  }
+  /** \return Maximum size of the file in bytes. */
+  uint64_t capacity() const { return (uint64_t)m_sectorCount << 9; }
+  /**
+   * Sync and close the stream.  The file stays open.
+   *
+   * \return true for success or false for failure.
+   */
+  bool close() {
+    bool rtn = sync();
+    init(nullptr, false);
+    return rtn;
+  }
+  /** \return Current position in bytes. */
+  uint64_t curPosition() const { return m_position; }
+  /** \return true if the stream is open. */
+  bool isOpen() const { return m_file; }
+  /**
+   * Open a stream to read a contiguous file.
+   *
+   * \param[in] file Open contiguous file.
+   * \return true for success or false for failure.
+   */
+  bool openRead(F* file) {
+    if (!open(file, false)) {
+      return false;
+    }
+    m_size = file->validLength();
+    return true;
+  }
+  /**
+   * Open a stream to write a contiguous file.
+   *
+   * Writing starts at position and the stream may grow the file to
+   * capacity().  Use zero for a file from preAllocate() and
+   * validLength() to append.  On exFAT preallocate a multiple of 512
+   * bytes so capacity() matches the allocated length.  Call truncate()
+   * for the file after close() to free unused space.
+   *
+   * \param[in] file Contiguous file open for write.
+   * \param[in] position Byte offset for the first write.
+   * \return true for success or false for failure.
+   */
+  bool openWrite(F* file, uint64_t position = 0) {
+    if (!file || !file->isWritable() || !open(file, true)) {
+      goto fail;
+    }
+    m_position = position;
+    if (m_position > capacity()) {
+      goto fail;
+    }
+    if ((m_position & 511) &&
+        !file->rawRead(m_position >> 9, m_buf, 1)) {
+      goto fail;
+    }
+    return true;
+
+  fail:
+    init(nullptr, false);
+    return false;
+  }
+  /**
+   * Read data from the stream.
+   *
+   * \param[out] buf Location for the data.
+   * \param[in] count Maximum number of bytes to read.
+   * \return Number of bytes read or -1 for an error.
+   */
+  int read(void* buf, size_t count) {
+    uint8_t* dst = reinterpret_cast<uint8_t*>(buf);
+    size_t n;
+    if (!m_file || m_write) {
+      return -1;
+    }
+    if (count > m_size - m_position) {
+      count = m_size - m_position;
+    }
+    n = count;
+    while (n) {
+      uint32_t index = m_position >> 9;
+      size_t offset = m_position & 511;
+      size_t nb;
+      if (offset == 0 && n >= 512) {
+        size_t ns = n >> 9;
+        nb = ns << 9;
+        if (!m_file->rawRead(index, dst, ns)) {
+          return -1;
+        }
+      } else {
+        if (index != m_bufIndex) {
+          if (!m_file->rawRead(index, m_buf, 1)) {
+            return -1;
+          }
+          m_bufIndex = index;
+        }
+        nb = 512 - offset < n ? 512 - offset : n;
+        memcpy(dst, m_buf + offset, nb);
+      }
+      dst += nb;
+      n -= nb;
+      m_position += nb;
+    }
+    return count;
+  }
+  /**
+   * Write any partial sector and set the file's validLength() to
+   * curPosition().
+   *
+   * The directory entry is updated with one write.  Does
+   * nothing in read mode.
+   *
+   * \return true for success or false for failure.
+   */
+  bool sync() {
+    if (!m_file || !m_write) {
+      return m_file;
+    }
+    size_t offset = m_position & 511;
+    if (offset) {
+      memset(m_buf + offset, 0, 512 - offset);
+      if (!m_file->rawWrite(m_position >> 9, m_buf, 1)) {
+        return false;
+      }
+    }
+    return m_file->rawEnd(m_position);
+  }
+  /**
+   * Write data to the stream.  Whole sectors in buf are written to the
+   * device without a copy.  Data that does not fit in capacity() is
+   * not written.
+   *
+   * \param[in] buf Location of data to be written.
+   * \param[in] count Number of bytes to be written.
+   * \return Number of bytes actually written.
+   */
+  size_t write(const void* buf, size_t count) {
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(buf);
+    size_t n;
+    if (!m_file || !m_write) {
+      return 0;
+    }
+    if (count > capacity() - m_position) {
+      count = capacity() - m_position;
+    }
+    n = count;
+    while (n) {
+      uint32_t index = m_position >> 9;
+      size_t offset = m_position & 511;
+      size_t nb;
+      if (offset == 0 && n >= 512) {
+        size_t ns = n >> 9;
+        nb = ns << 9;
+        if (!m_file->rawWrite(index, src, ns)) {
+          break;
+        }
+      } else {
+        nb = 512 - offset < n ? 512 - offset : n;
+        memcpy(m_buf + offset, src, nb);
+        if (offset + nb == 512 && !m_file->rawWrite(index, m_buf, 1)) {
+          break;
+        }
+      }
+      src += nb;
+      n -= nb;
+      m_position += nb;
+    }
+    return count - n;
+  }
+  /**
+   * Override virtual function in Print for efficiency.
+   *
+   * \param[in] buf Location of data to be written.
+   * \param[in] count Number of bytes to be written.
+   * \return Number of bytes actually written.
+   */
+  size_t write(const uint8_t* buf, size_t count) override {
+    return write(static_cast<const void*>(buf), count);
+  }
+  /**
+   * Required function for Print.
+   * \param[in] data Byte to be written.
+   * \return Number of bytes actually written.
+   */
+  size_t write(uint8_t data) override { return write(&data, 1); }
+
+ private:
+  void init(F* file, bool write) {
+    m_file = file;
+    m_write = write;
+    m_position = 0;
+    m_size = 0;
+    m_sectorCount = 0;
+    m_bufIndex = 0XFFFFFFFF;
+  }
+  bool open(F* file, bool write) {
+    Sector_t bgn;
+    Sector_t end;
+    init(nullptr, false);
+    if (!file || !file->contiguousRange(&bgn, &end)) {
+      return false;
+    }
+    init(file, write);
+    m_sectorCount = end - bgn + 1;
+    return true;
+  }
+  F* m_file;
+  bool m_write;
+  uint32_t m_bufIndex;
+  uint32_t m_sectorCount;
+  uint64_t m_position;
+  uint64_t m_size;
+  uint8_t m_buf[512];
+};
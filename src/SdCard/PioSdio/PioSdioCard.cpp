@@ -61,6 +61,7 @@ static const CmdRsp_t CMD38_R1(CMD38, RSP_R1);
 static const CmdRsp_t CMD55_R1(CMD55, RSP_R1);
 static const CmdRsp_t ACMD6_R1(ACMD6, RSP_R1);
 static const CmdRsp_t ACMD13_R1(ACMD13, RSP_R1);
+static const CmdRsp_t ACMD23_R1(ACMD23, RSP_R1);
 static const CmdRsp_t ACMD41_R3(ACMD41, RSP_R3);
 static const CmdRsp_t ACMD51_R1(ACMD51, RSP_R1);
 //==============================================================================
@@ -491,6 +492,22 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
+bool PioSdioCard::eraseHint(Sector_t firstSector, Sector_t lastSector) {
+  uint errorCode;
+  uint errorLine;
+  bool rtn;
+  if (!syncDevice()) {
+    SDIO_FAIL();
+    return false;
+  }
+  errorCode = m_errorCode;
+  errorLine = m_errorLine;
+  rtn = erase(firstSector, lastSector);
+  m_errorCode = errorCode;
+  m_errorLine = errorLine;
+  return rtn;
+}
+//------------------------------------------------------------------------------
 uint8_t PioSdioCard::errorCode() const { return m_errorCode; }
 //------------------------------------------------------------------------------
 uint32_t PioSdioCard::errorData() const { return m_cardRsp; }
@@ -994,6 +1011,16 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
+bool PioSdioCard::writeStart(Sector_t sector, uint32_t count) {
+  if (!cardAcmd(m_rca, ACMD23_R1, count)) {
+    sdError(SD_CARD_ERROR_ACMD23);
+    goto fail;
+  }
+  return writeStart(sector);
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
 bool PioSdioCard::writeStop() {
   if (!syncDevice()) {
     SDIO_FAIL();
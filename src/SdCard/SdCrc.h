@@ -0,0 +1,104 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+/**
+ * \file
+ * \brief CRC functions for SD cards.
+ */
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../common/SysCall.h"
+//------------------------------------------------------------------------------
+// The SD CRC7 uses the x^7 + x^3 + 1 polynomial and the data CRC16 uses
+// the CRC-CCITT x^16 + x^12 + x^5 + 1 polynomial.  All functions start with
+// a CRC of zero and are MSB first as required for SD cards.
+//------------------------------------------------------------------------------
+/**
+ * CRC7 for an SD command with the end bit set.
+ *
+ * The implementation is selected by USE_SD_CRC and SD_CRC_MODE.
+ *
+ * \param[in] data Command bytes.
+ * \param[in] n Number of bytes.
+ * \return CRC7 in bits 1-7 and one in bit 0.
+ */
+uint8_t sdCrc7(const uint8_t* data, size_t n);
+/**
+ * CRC16 for an SD data block.
+ *
+ * The implementation is selected by USE_SD_CRC and SD_CRC_MODE.
+ *
+ * \param[in] data Data bytes.
+ * \param[in] n Number of bytes.
+ * \return CRC-CCITT for the data.
+ */
+uint16_t sdCrc16(const uint8_t* data, size_t n);
+//------------------------------------------------------------------------------
+// The variants below are always available for testing and benchmarks.
+// Unused variants and their tables are removed by the linker.
+//------------------------------------------------------------------------------
+/** Bit at a time CRC7, no table.
+ * \param[in] data Command bytes.
+ * \param[in] n Number of bytes.
+ * \return CRC7 in bits 1-7 and one in bit 0.
+ */
+uint8_t sdCrc7Bitwise(const uint8_t* data, size_t n);
+/** Byte at a time CRC7 with a 256 byte table.
+ * \param[in] data Command bytes.
+ * \param[in] n Number of bytes.
+ * \return CRC7 in bits 1-7 and one in bit 0.
+ */
+uint8_t sdCrc7Table(const uint8_t* data, size_t n);
+/** Shift based CRC16, no table.
+ * \param[in] data Data bytes.
+ * \param[in] n Number of bytes.
+ * \return CRC-CCITT for the data.
+ */
+uint16_t sdCrc16Shift(const uint8_t* data, size_t n);
+/** Nibble at a time CRC16 with a 32 byte table.
+ * \param[in] data Data bytes.
+ * \param[in] n Number of bytes.
+ * \return CRC-CCITT for the data.
+ */
+uint16_t sdCrc16Nibble(const uint8_t* data, size_t n);
+/** Byte at a time CRC16 with a 512 byte table.
+ * \param[in] data Data bytes.
+ * \param[in] n Number of bytes.
+ * \return CRC-CCITT for the data.
+ */
+uint16_t sdCrc16Table(const uint8_t* data, size_t n);
+/** Slice-by-4 CRC16 with a 2 KiB table.
+ * \param[in] data Data bytes.
+ * \param[in] n Number of bytes.
+ * \return CRC-CCITT for the data.
+ */
+uint16_t sdCrc16Slice4(const uint8_t* data, size_t n);
+/** Slice-by-8 CRC16 with a 4 KiB table.
+ * \param[in] data Data bytes.
+ * \param[in] n Number of bytes.
+ * \return CRC-CCITT for the data.
+ */
+uint16_t sdCrc16Slice8(const uint8_t* data, size_t n);
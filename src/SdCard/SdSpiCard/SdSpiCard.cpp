@@ -22,6 +22,7 @@
  * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
  * DEALINGS IN THE SOFTWARE.
  */
+#include "../SdCrc.h"
 #include "SdSpiCard.h"
 //==============================================================================
 namespace {  // Avoid conflict with another Timeout class.
@@ -38,90 +39,6 @@ class Timeout {
 };
 }  // namespace
 //==============================================================================
-#if USE_SD_CRC
-// CRC functions
-//------------------------------------------------------------------------------
-static uint8_t CRC7(const uint8_t* data, uint8_t n) {
-  uint8_t crc = 0;
-  for (uint8_t i = 0; i < n; i++) {
-    uint8_t d = data[i];
-    for (uint8_t j = 0; j < 8; j++) {
-      crc <<= 1;
-      if ((d & 0x80) ^ (crc & 0x80)) {
-        crc ^= 0x09;
-      }
-      d <<= 1;
-    }
-  }
-  return (crc << 1) | 1;
-}
-//------------------------------------------------------------------------------
-#if USE_SD_CRC == 1
-// Shift based CRC-CCITT
-// uses the x^16,x^12,x^5,x^1 polynomial.
-static uint16_t CRC_CCITT(const uint8_t* data, size_t n) {
-  uint16_t crc = 0;
-  for (size_t i = 0; i < n; i++) {
-    crc = (uint8_t)(crc >> 8) | (crc << 8);
-    crc ^= data[i];
-    crc ^= (uint8_t)(crc & 0xff) >> 4;
-    crc ^= crc << 12;
-    crc ^= (crc & 0xff) << 5;
-  }
-  return crc;
-}
-#elif USE_SD_CRC > 1  // CRC_CCITT
-//------------------------------------------------------------------------------
-// Table based CRC-CCITT
-// uses the x^16,x^12,x^5,x^1 polynomial.
-#ifdef __AVR__
-static const uint16_t crctab[] PROGMEM = {
-#else   // __AVR__
-static const uint16_t crctab[] = {
-#endif  // __AVR__
-    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7, 0x8108,
-    0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF, 0x1231, 0x0210,
-    0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6, 0x9339, 0x8318, 0xB37B,
-    0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE, 0x2462, 0x3443, 0x0420, 0x1401,
-    0x64E6, 0x74C7, 0x44A4, 0x5485, 0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE,
-    0xF5CF, 0xC5AC, 0xD58D, 0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6,
-    0x5695, 0x46B4, 0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D,
-    0xC7BC, 0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
-    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B, 0x5AF5,
-    0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12, 0xDBFD, 0xCBDC,
-    0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A, 0x6CA6, 0x7C87, 0x4CE4,
-    0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41, 0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD,
-    0xAD2A, 0xBD0B, 0x8D68, 0x9D49, 0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13,
-    0x2E32, 0x1E51, 0x0E70, 0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A,
-    0x9F59, 0x8F78, 0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E,
-    0xE16F, 0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
-    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E, 0x02B1,
-    0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256, 0xB5EA, 0xA5CB,
-    0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D, 0x34E2, 0x24C3, 0x14A0,
-    0x0481, 0x7466, 0x6447, 0x5424, 0x4405, 0xA7DB, 0xB7FA, 0x8799, 0x97B8,
-    0xE75F, 0xF77E, 0xC71D, 0xD73C, 0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657,
-    0x7676, 0x4615, 0x5634, 0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9,
-    0xB98A, 0xA9AB, 0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882,
-    0x28A3, 0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
-    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92, 0xFD2E,
-    0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9, 0x7C26, 0x6C07,
-    0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1, 0xEF1F, 0xFF3E, 0xCF5D,
-    0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8, 0x6E17, 0x7E36, 0x4E55, 0x5E74,
-    0x2E93, 0x3EB2, 0x0ED1, 0x1EF0};
-static uint16_t CRC_CCITT(const uint8_t* data, size_t n) {
-  uint16_t crc = 0;
-  for (size_t i = 0; i < n; i++) {
-#ifdef __AVR__
-    crc = pgm_read_word(&crctab[(crc >> 8 ^ data[i]) & 0XFF]) ^ (crc << 8);
-#else   // __AVR__
-    crc = crctab[(crc >> 8 ^ data[i]) & 0XFF] ^ (crc << 8);
-#endif  // __AVR__
-  }
-  return crc;
-}
-#endif  // CRC_CCITT
-#endif  // USE_SD_CRC
-//==============================================================================
 // SdSpiCard member functions
 //------------------------------------------------------------------------------
 bool SdSpiCard::begin(SdSpiConfig spiConfig) {
@@ -263,7 +180,7 @@ uint8_t SdSpiCard::cardCommand(uint8_t cmd, uint32_t arg) {
   buf[4] = (uint8_t)arg;
 
   // add CRC
-  buf[5] = CRC7(buf, 5);
+  buf[5] = sdCrc7(buf, 5);
 
   // send message
   spiSend(buf, 6);
@@ -302,7 +219,8 @@ void SdSpiCard::end() {
 //------------------------------------------------------------------------------
 bool SdSpiCard::erase(Sector_t firstSector, Sector_t lastSector) {
   csd_t csd;
-  if (!readCSD(&csd)) {
+  // End any multiple sector transfer.
+  if (!syncDevice() || !readCSD(&csd)) {
     goto fail;
   }
   // check for single sector erase
@@ -336,6 +254,18 @@ fail:
   return false;
 }
 //------------------------------------------------------------------------------
+bool SdSpiCard::eraseHint(Sector_t firstSector, Sector_t lastSector) {
+  uint8_t errorCode;
+  bool rtn;
+  if (!syncDevice()) {
+    return false;
+  }
+  errorCode = m_errorCode;
+  rtn = erase(firstSector, lastSector);
+  m_errorCode = errorCode;
+  return rtn;
+}
+//------------------------------------------------------------------------------
 bool SdSpiCard::eraseSingleSectorEnable() {
   csd_t csd;
   return readCSD(&csd) ? csd.eraseSingleBlock() : false;
@@ -386,7 +316,7 @@ bool SdSpiCard::readData(uint8_t* dst, size_t count) {
 #if USE_SD_CRC
   // get crc
   crc = (spiReceive() << 8) | spiReceive();
-  if (crc != CRC_CCITT(dst, count)) {
+  if (crc != sdCrc16(dst, count)) {
     sdError(SD_CARD_ERROR_READ_CRC);
     goto fail;
   }
@@ -600,6 +530,17 @@ void SdSpiCard::spiStop() {
   }
 }
 //------------------------------------------------------------------------------
+#if USE_ASYNC_IO
+bool SdSpiCard::submit(FsIoRequest* req) {
+  req->status = FS_IO_PENDING;
+  bool ok = req->op == FS_IO_WRITE
+                ? writeSectors(req->sector, req->data, req->count)
+                : readSectors(req->sector, req->data, req->count);
+  req->complete(ok);
+  return ok;
+}
+#endif  // USE_ASYNC_IO
+//------------------------------------------------------------------------------
 bool SdSpiCard::syncDevice() {
   if (m_state == WRITE_STATE) {
     return writeStop();
@@ -639,7 +580,7 @@ fail:
 // send one sector of data for write sector or write multiple sectors
 bool SdSpiCard::writeData(uint8_t token, const uint8_t* src) {
 #if USE_SD_CRC
-  uint16_t crc = CRC_CCITT(src, 512);
+  uint16_t crc = sdCrc16(src, 512);
 #else   // USE_SD_CRC
   uint16_t crc = 0XFFFF;
 #endif  // USE_SD_CRC
@@ -744,6 +685,18 @@ bool SdSpiCard::writeStart(Sector_t sector) {
   m_state = WRITE_STATE;
   return true;
 
+fail:
+  spiStop();
+  return false;
+}
+//------------------------------------------------------------------------------
+bool SdSpiCard::writeStart(Sector_t sector, uint32_t count) {
+  if (cardAcmd(ACMD23, count)) {
+    sdError(SD_CARD_ERROR_ACMD23);
+    goto fail;
+  }
+  return writeStart(sector);
+
 fail:
   spiStop();
   return false;
@@ -110,6 +110,17 @@ class SdSpiCard {
    * \return true for success or false for failure.
    */
   bool erase(Sector_t firstSector, Sector_t lastSector);
+  /** Erase a range of sectors as a hint.
+   *
+   * Like erase() but a failed erase does not change errorCode().  An
+   * error that ends a multiple sector transfer is still reported.
+   *
+   * \param[in] firstSector The address of the first sector in the range.
+   * \param[in] lastSector The address of the last sector in the range.
+   *
+   * \return true if the range was erased.
+   */
+  bool eraseHint(Sector_t firstSector, Sector_t lastSector);
   /** Determine if card supports single sector erase.
    *
    * \return true is returned if single sector erase is supported.
@@ -148,6 +159,12 @@ class SdSpiCard {
 #endif  // ENABLE_DEDICATED_SPI
   /** \return true if card is on SPI bus. */
   bool isSpi() { return true; }
+#if USE_ASYNC_IO
+  /** Requests complete in submit().
+   * \return Zero requests pending.
+   */
+  uint8_t poll() { return 0; }
+#endif  // USE_ASYNC_IO
   /**
    * Read a card's CID register. The CID contains card identification
    * information such as Manufacturer ID, Product name, Product serial
@@ -242,6 +259,16 @@ class SdSpiCard {
    * \return true for success or false for failure.
    */
   bool stopTransfer();
+#if USE_ASYNC_IO
+  /** Perform a sector request and complete it before returning.
+   *
+   * This call blocks like readSectors() and writeSectors().
+   *
+   * \param[in,out] req Request to be performed.
+   * \return true for success or false for failure.
+   */
+  bool submit(FsIoRequest* req);
+#endif  // USE_ASYNC_IO
   /** \return success if sync successful. Not for user apps. */
   bool syncDevice();
   /** Return the card type: SD V1, SD V2 or SDHC/SDXC
@@ -280,6 +307,18 @@ class SdSpiCard {
    * \return true for success or false for failure.
    */
   bool writeStart(Sector_t sector);
+  /** Start a write multiple sectors sequence with pre-erase.
+   *
+   * \param[in] sector Address of first sector in sequence.
+   * \param[in] count Number of sectors to be pre-erased.
+   *
+   * \note This function sends ACMD23 so the card can erase \a count
+   * sectors before they are written.  It is used with writeData() and
+   * writeStop() for optimized multiple sector writes.
+   *
+   * \return true for success or false for failure.
+   */
+  bool writeStart(Sector_t sector, uint32_t count);
 
   /** End a write multiple sectors sequence.
    *
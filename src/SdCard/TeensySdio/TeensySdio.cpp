@@ -122,6 +122,8 @@ const uint32_t ACMD6_XFERTYP = SDHC_XFERTYP_CMDINX(ACMD6) | CMD_RESP_R1;
 const uint32_t ACMD13_XFERTYP =
     SDHC_XFERTYP_CMDINX(ACMD13) | CMD_RESP_R1 | DATA_READ_DMA;
 
+const uint32_t ACMD23_XFERTYP = SDHC_XFERTYP_CMDINX(ACMD23) | CMD_RESP_R1;
+
 const uint32_t ACMD41_XFERTYP = SDHC_XFERTYP_CMDINX(ACMD41) | CMD_RESP_R3;
 
 const uint32_t ACMD51_XFERTYP =
@@ -849,6 +851,21 @@ bool TeensySdioCard::erase(Sector_t firstSector, Sector_t lastSector) {
   return true;
 }
 //------------------------------------------------------------------------------
+bool TeensySdioCard::eraseHint(Sector_t firstSector, Sector_t lastSector) {
+  uint8_t errorCode;
+  uint32_t errorLine;
+  bool rtn;
+  if (m_curState != IDLE_STATE && !syncDevice()) {
+    return false;
+  }
+  errorCode = m_errorCode;
+  errorLine = m_errorLine;
+  rtn = erase(firstSector, lastSector);
+  m_errorCode = errorCode;
+  m_errorLine = errorLine;
+  return rtn;
+}
+//------------------------------------------------------------------------------
 uint8_t TeensySdioCard::errorCode() const { return m_errorCode; }
 //------------------------------------------------------------------------------
 uint32_t TeensySdioCard::errorData() const { return m_irqstat; }
@@ -1174,5 +1191,15 @@ bool TeensySdioCard::writeStart(Sector_t sector) {
   return true;
 }
 //------------------------------------------------------------------------------
+bool TeensySdioCard::writeStart(Sector_t sector, uint32_t count) {
+  if (yieldTimeout(isBusyCMD13)) {
+    return sdError(SD_CARD_ERROR_CMD13);
+  }
+  if (!cardAcmd(m_rca, ACMD23_XFERTYP, count)) {
+    return sdError(SD_CARD_ERROR_ACMD23);
+  }
+  return writeStart(sector);
+}
+//------------------------------------------------------------------------------
 bool TeensySdioCard::writeStop() { return transferStop(); }
 #endif  // defined(__MK64FX512__)  defined(__MK66FX1M0__) defined(__IMXRT1062__)
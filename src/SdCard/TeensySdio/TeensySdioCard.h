@@ -102,6 +102,17 @@ class TeensySdioCard : public SdCardInterface {
    * \return true for success or false for failure.
    */
   bool erase(Sector_t firstSector, Sector_t lastSector) final;
+  /** Erase a range of sectors as a hint.
+   *
+   * Like erase() but a failed erase does not change errorCode().  An
+   * error that ends a multiple sector transfer is still reported.
+   *
+   * \param[in] firstSector The address of the first sector in the range.
+   * \param[in] lastSector The address of the last sector in the range.
+   *
+   * \return true if the range was erased.
+   */
+  bool eraseHint(Sector_t firstSector, Sector_t lastSector) final;
   /**
    * \return code for the last error. See SdCardInfo.h for a list of error
    * codes.
@@ -249,6 +260,18 @@ class TeensySdioCard : public SdCardInterface {
    * \return true for success or false for failure.
    */
   bool writeStart(Sector_t sector);
+  /** Start a write multiple sectors sequence with pre-erase.
+   *
+   * \param[in] sector Address of first sector in sequence.
+   * \param[in] count Number of sectors to be pre-erased.
+   *
+   * \note This function sends ACMD23 so the card can erase \a count
+   * sectors before they are written.  It is used with writeData() and
+   * writeStop() for optimized multiple sector writes.
+   *
+   * \return true for success or false for failure.
+   */
+  bool writeStart(Sector_t sector, uint32_t count);
 
   /** End a write multiple sectors sequence.
    *
@@ -347,7 +347,17 @@ class SdBase : public Vol {
    * \return true for success or false for failure.
    */
   bool volumeBegin() {
-    return Vol::begin(m_card) || Vol::begin(m_card, true, 0);
+    if (!Vol::begin(m_card) && !Vol::begin(m_card, true, 0)) {
+      return false;
+    }
+#if USE_AU_ALLOCATION
+    sds_t sds;
+    // Use AU alignment if the card reports an AU size.
+    if (m_card->readSDS(&sds)) {
+      Vol::setAuSize(2 * sds.auSizeKB());
+    }
+#endif  // USE_AU_ALLOCATION
+    return true;
   }
 #if ENABLE_ARDUINO_SERIAL
   /** Print error details after begin() fails. */
@@ -128,6 +128,18 @@
 #define USE_FAT_FILE_FLAG_CONTIGUOUS 1
 #endif  // USE_FAT_FILE_FLAG_CONTIGUOUS
 //------------------------------------------------------------------------------
+/**
+ * Set FS_EXTENT_COUNT to the number of cluster runs remembered by each open
+ * file.  The runs are learned as the cluster chain is followed so seekSet()
+ * on a fragmented file does not read the FAT again for mapped positions.
+ * Each run uses eight bytes of RAM in every file object.
+ *
+ * Zero disables the extent map.
+ */
+#ifndef FS_EXTENT_COUNT
+#define FS_EXTENT_COUNT 0
+#endif  // FS_EXTENT_COUNT
+//------------------------------------------------------------------------------
 /**
  * Set ENABLE_DEDICATED_SPI non-zero to enable dedicated use of the SPI bus.
  * Selecting dedicated SPI in SdSpiConfig() will produce better
@@ -294,6 +306,28 @@ typedef uint8_t SdCsPin_t;
 #define MAINTAIN_FREE_CLUSTER_COUNT 0
 #endif  // MAINTAIN_FREE_CLUSTER_COUNT
 //------------------------------------------------------------------------------
+/**
+ * Set USE_FSINFO nonzero to use the FAT32 FSInfo sector.  The free cluster
+ * count and next free cluster hint are read when the volume is mounted and
+ * written when the volume is synced.
+ *
+ * USE_FSINFO 1 trusts the FSInfo free count so freeClusterCount() returns
+ * immediately after mount.
+ *
+ * USE_FSINFO 2 validates the FSInfo free count with a FAT scan at the first
+ * call to freeClusterCount() and corrects FSInfo if it is wrong.  Use this
+ * if the volume may have been modified without updating FSInfo.
+ *
+ * USE_FSINFO requires MAINTAIN_FREE_CLUSTER_COUNT.
+ */
+#ifndef USE_FSINFO
+#define USE_FSINFO 0
+#endif  // USE_FSINFO
+
+#if USE_FSINFO && !MAINTAIN_FREE_CLUSTER_COUNT
+#error "USE_FSINFO requires MAINTAIN_FREE_CLUSTER_COUNT to be non-zero."
+#endif  // USE_FSINFO && !MAINTAIN_FREE_CLUSTER_COUNT
+//------------------------------------------------------------------------------
 /**
  * Set the default file time stamp when a RTC callback is not used.
  * A valid date and time is required by the FAT/exFAT standard.
@@ -332,11 +366,40 @@ typedef uint8_t SdCsPin_t;
  *
  * Set USE_SD_CRC to 2 to used a larger table driven CRC-CCITT function.  This
  * function is faster for AVR but may be slower for ARM and other processors.
+ *
+ * Set USE_SD_CRC to 3 to use a nibble table CRC-CCITT function with a 32 byte
+ * table for boards with little flash.
+ *
+ * Set USE_SD_CRC to 4 or 5 to use slice-by-4 or slice-by-8 CRC-CCITT
+ * functions with 2 KiB or 4 KiB tables.  These are the fastest on 32-bit
+ * processors.  Run extras/host/CrcBench to compare the functions.
+ *
+ * Values 2, 4 and 5 also use a 256 byte table for the command CRC7.
  */
 #ifndef USE_SD_CRC
 #define USE_SD_CRC 0
 #endif  // USE_SD_CRC
 //------------------------------------------------------------------------------
+/**
+ * SD_CRC_MODE defines how the functions
+ * uint8_t sdCrc7(const uint8_t* data, size_t n)
+ * and
+ * uint16_t sdCrc16(const uint8_t* data, size_t n)
+ * are defined when USE_SD_CRC is nonzero.
+ *
+ * 0 - Internal definition is a strong symbol and can't be replaced.
+ *
+ * 1 - Internal definition is a weak symbol and can be replaced.
+ *
+ * 2 - No internal definition and must be defined in the application.
+ *
+ * Use mode 1 or 2 to compute the CRC with a CRC peripheral.  The CRC must
+ * start at zero and use the polynomials in SdCard/SdCrc.h.
+ */
+#ifndef SD_CRC_MODE
+#define SD_CRC_MODE 0
+#endif  // SD_CRC_MODE
+//------------------------------------------------------------------------------
 /** If the symbol USE_FCNTL_H is nonzero, open flags for access modes O_RDONLY,
  * O_WRONLY, O_RDWR and the open modifiers O_APPEND, O_CREAT, O_EXCL, O_SYNC
  * will be defined by including the system file fcntl.h.
@@ -425,6 +488,124 @@ typedef uint8_t SdCsPin_t;
 #define USE_EXFAT_BITMAP_CACHE 0
 #endif  // __arm__
 //------------------------------------------------------------------------------
+/**
+ * Set USE_SIMD_BITMAP nonzero to use SSE2 or AArch64 NEON instructions
+ * in exFAT bitmap scans.  Ignored if the processor has neither.
+ */
+#ifndef USE_SIMD_BITMAP
+#define USE_SIMD_BITMAP 0
+#endif  // USE_SIMD_BITMAP
+//------------------------------------------------------------------------------
+/**
+ * Set USE_FAT_FREE_MAP nonzero to allow a RAM map of free space to be
+ * attached to a FAT16/FAT32 volume with FatPartition::setFreeMap().
+ * Each bit of the map is set if a group of clusters has a free cluster.
+ * Allocation searches skip groups with no free clusters.  The map is
+ * built by a scan of the FAT when it is attached and is kept current by
+ * allocation and free, which never read the FAT to update it.
+ */
+#ifndef USE_FAT_FREE_MAP
+#define USE_FAT_FREE_MAP 0
+#endif  // USE_FAT_FREE_MAP
+//------------------------------------------------------------------------------
+/**
+ * Set USE_AU_ALLOCATION nonzero to align allocations to the SD card
+ * allocation unit (AU).  The AU size is read from the SD Status register
+ * when SdFat mounts a volume.  preAllocate() and createContiguous() start
+ * on an AU boundary and file data that can't be extended in place
+ * continues in a free AU.  Directories grow at the next free cluster.
+ * Writes that stay within an AU avoid long card garbage
+ * collection delays.
+ */
+#ifndef USE_AU_ALLOCATION
+#define USE_AU_ALLOCATION 0
+#endif  // USE_AU_ALLOCATION
+//------------------------------------------------------------------------------
+/**
+ * Set USE_DIR_INDEX nonzero to allow a RAM index of one large directory
+ * to be attached to a volume with setDirIndex().  The index holds a hash
+ * of each name and a short list of free entry runs.  It is built by a
+ * scan of the directory at the first open in the directory.  Opens then
+ * read only the entries with a matching hash and creates go directly to
+ * a free run.  FAT volumes require USE_LONG_FILE_NAMES.
+ */
+#ifndef USE_DIR_INDEX
+#define USE_DIR_INDEX 0
+#endif  // USE_DIR_INDEX
+//------------------------------------------------------------------------------
+/**
+ * Set USE_CREATE_NEW nonzero to enable createNew().  The caller promises
+ * the name is not in the directory so the name search is skipped.  An open
+ * directory remembers the end of its used entries and sequential creates
+ * append there without a scan.  FAT names that need a numeric ~N short
+ * name still scan to check the short name unless the directory has an
+ * index, see USE_DIR_INDEX.
+ */
+#ifndef USE_CREATE_NEW
+#define USE_CREATE_NEW 0
+#endif  // USE_CREATE_NEW
+//------------------------------------------------------------------------------
+/**
+ * Set SFN_TAIL_MAP_SIZE nonzero to keep a map of used ~HHHH tails for
+ * generated short names in one directory of a FAT volume.  A long name
+ * that needs a generated short name gets the next free tail from the map.
+ * The map is built by one scan of the directory and is kept for later
+ * creates in the directory, so bulk creates of long names with a common
+ * prefix don't scan the directory for each file.  The map tracks
+ * SFN_TAIL_MAP_SIZE tails with one bit per tail.  A directory with an
+ * index, see USE_DIR_INDEX, doesn't use the map.
+ */
+#ifndef SFN_TAIL_MAP_SIZE
+#define SFN_TAIL_MAP_SIZE 0
+#endif  // SFN_TAIL_MAP_SIZE
+//------------------------------------------------------------------------------
+/**
+ * Set USE_DEFERRED_FAT_MIRROR nonzero to delay writes to the second FAT
+ * until a file or the volume is synced.  FAT sectors are written to the
+ * first FAT when they leave the cache and their numbers are kept in a
+ * short list of sector ranges.  The ranges are then copied from the
+ * first FAT to the second FAT in sector order.  Sectors still in the
+ * cache are written from the cache.  Others are read from the first FAT
+ * into one cache line, so the rest of the cache survives the copy.
+ *
+ * Crash consistency: the second FAT may be older than the first FAT
+ * after a power loss or reset between syncs.  SdFat and most other
+ * systems only read the first FAT.  A disk checker may report that the
+ * FAT copies differ.  Repair from the first FAT.
+ */
+#ifndef USE_DEFERRED_FAT_MIRROR
+#define USE_DEFERRED_FAT_MIRROR 0
+#endif  // USE_DEFERRED_FAT_MIRROR
+//------------------------------------------------------------------------------
+/**
+ * Set FS_CACHE_SECTOR_COUNT to the number of 512 byte sectors in each
+ * volume cache.  Sectors are replaced in least recently used order.
+ * A value larger than one reduces reads and writes of FAT, bitmap and
+ * directory sectors at the cost of 512 bytes of RAM per extra sector in
+ * every volume.  The maximum is 127.
+ */
+#ifndef FS_CACHE_SECTOR_COUNT
+#define FS_CACHE_SECTOR_COUNT 1
+#endif  // FS_CACHE_SECTOR_COUNT
+//------------------------------------------------------------------------------
+/**
+ * Set FS_CACHE_USER_SECTOR_COUNT to the maximum number of sectors a
+ * program may add to a volume cache with cacheAttach().  The sectors are
+ * in a buffer supplied by the program, so only a few bytes per sector
+ * are used when no buffer is attached.  The sum with FS_CACHE_SECTOR_COUNT
+ * must not be more than 127.
+ */
+#ifndef FS_CACHE_USER_SECTOR_COUNT
+#define FS_CACHE_USER_SECTOR_COUNT 0
+#endif  // FS_CACHE_USER_SECTOR_COUNT
+//------------------------------------------------------------------------------
+/**
+ * Set USE_FS_CACHE_STATS nonzero to count cache hits and misses.
+ */
+#ifndef USE_FS_CACHE_STATS
+#define USE_FS_CACHE_STATS 0
+#endif  // USE_FS_CACHE_STATS
+//------------------------------------------------------------------------------
 /**
  * Set USE_MULTI_SECTOR_IO nonzero to use multi-sector SD read/write.
  *
@@ -436,6 +617,28 @@ typedef uint8_t SdCsPin_t;
 #define USE_MULTI_SECTOR_IO 1
 #endif  // RAMEND
 //------------------------------------------------------------------------------
+/**
+ * Set USE_ASYNC_IO nonzero to enable queued sector requests, submit() and
+ * poll() in FsBlockDeviceInterface plus readAsync() and writeAsync() for
+ * files.  Devices without native support complete requests at submit().
+ *
+ * No SD card driver is asynchronous yet.  SdSpiCard and the SDIO drivers,
+ * including TeensySdioCard, perform the transfer in submit() and return
+ * when it is done, so the caller can't overlap work with card I/O.  The
+ * API lets an application be written now for a driver that queues
+ * requests later.
+ */
+#ifndef USE_ASYNC_IO
+#define USE_ASYNC_IO 0
+#endif  // USE_ASYNC_IO
+//------------------------------------------------------------------------------
+/**
+ * Maximum number of outstanding requests in a device queue.
+ */
+#ifndef ASYNC_IO_QUEUE_SIZE
+#define ASYNC_IO_QUEUE_SIZE 4
+#endif  // ASYNC_IO_QUEUE_SIZE
+//------------------------------------------------------------------------------
 /** Enable SDIO driver if available. */
 #if defined(ARDUINO_ARCH_RP2040)
 #define HAS_PIO_SDIO 1
@@ -0,0 +1,393 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+/**
+ * \file
+ * \brief Segmented log in a ring of preallocated files.
+ */
+#include "SdCard/SdCrc.h"
+#include "common/FsApiConstants.h"
+#include "common/SysCall.h"
+/**
+ * \class SegmentLog
+ * \brief Log of records in a ring of preallocated contiguous files.
+ *
+ * The log is kept in a directory as segmentCount() files named SEG00.LOG,
+ * SEG01.LOG, ... of segmentSize() bytes plus a small state file named
+ * SEGLOG.DAT.  The files are created and preallocated by the first
+ * begin().  After that a full segment is reused by writing over its old
+ * data so no clusters are allocated or freed and the time to rotate does
+ * not grow with the age of the log.  When all segments are used the
+ * oldest segment is overwritten.
+ *
+ * Each segment starts with its sequence number.  Records are stored with
+ * a two byte length and never span segments.  The head, tail and write
+ * position are saved by sync() in two alternating copies of a CRC
+ * checked record so a power failure during sync() leaves one valid copy.
+ * Records appended after the last sync() are lost after a power failure.
+ *
+ * F is a file class such as FsFile, ExFile or File32.
+ */
+template <class F>
+class SegmentLog {
+ public:
+  /** Maximum number of segments. */
+  static const uint8_t MAX_SEGMENTS = 100;
+  /** Bytes at the start of each segment for its sequence number. */
+  static const uint32_t HEADER_SIZE = 8;
+  SegmentLog() : m_dir(nullptr) {}
+  /** Open the log in a directory or create it if it does not exist.
+   *
+   * An existing log is reused only if it has the same segment count and
+   * size, otherwise it is cleared and the segments are allocated again.
+   * Segments of an old log beyond the new count are removed.
+   *
+   * \param[in] dir Open directory for the log.  Must stay open.
+   * \param[in] segmentCount Number of segments, two to MAX_SEGMENTS.
+   * \param[in] segmentSize Bytes in each segment, a multiple of 512.
+   * \param[in] erase Erase new segments for flatter write latency.
+   * \return true for success or false for failure.
+   */
+  bool begin(F* dir, uint8_t segmentCount, uint32_t segmentSize,
+             bool erase = false) {
+    m_dir = dir;
+    m_count = segmentCount;
+    m_size = segmentSize;
+    m_file.close();
+    m_meta.close();
+    m_reader.close();
+    if (segmentCount < 2 || segmentCount > MAX_SEGMENTS ||
+        segmentSize < 512 || (segmentSize & 511)) {
+      goto fail;
+    }
+    if (!m_meta.open(dir, "SEGLOG.DAT", O_RDWR | O_CREAT)) {
+      goto fail;
+    }
+    if (!readMeta()) {
+      // New log.  Remove segments left by a log with a larger count.
+      for (uint8_t i = m_count; i < MAX_SEGMENTS; i++) {
+        if (openSegment(&m_file, i, O_RDWR) && !m_file.remove()) {
+          goto fail;
+        }
+      }
+      for (uint8_t i = 0; i < m_count; i++) {
+        if (!openSegment(&m_file, i, O_RDWR | O_CREAT | O_TRUNC) ||
+            !m_file.preAllocate(m_size, erase) || !m_file.close()) {
+          goto fail;
+        }
+      }
+      m_head = 0;
+      m_tail = 0;
+      m_generation = 0;
+      if (!startSegment() || !clearMeta() || !writeMeta() || !writeMeta()) {
+        goto fail;
+      }
+    } else if (!openSegment(&m_file, m_head % m_count, O_RDWR) ||
+               !m_file.seekSet(m_offset)) {
+      goto fail;
+    }
+    m_synced = m_offset;
+    return true;
+
+  fail:
+    closeFiles();
+    return false;
+  }
+  /** Append a record.
+   *
+   * A new segment is started if the record does not fit in the current
+   * segment.
+   *
+   * \param[in] data Record to append.
+   * \param[in] size Size of the record.  Not zero and not more than
+   *            segmentSize() - HEADER_SIZE - 2.
+   * \return true for success or false for failure.
+   */
+  bool append(const void* data, uint16_t size) {
+    uint8_t len[2] = {uint8_t(size), uint8_t(size >> 8)};
+    if (!m_dir || size == 0 || size + 2UL > m_size - HEADER_SIZE) {
+      return false;
+    }
+    if (m_offset + 2 + size > m_size && !rotate()) {
+      return false;
+    }
+    if (m_file.write(len, 2) != 2 || m_file.write(data, size) != size) {
+      m_dir = nullptr;
+      return false;
+    }
+    m_offset += 2 + size;
+    return true;
+  }
+  /** Remove the oldest segment if it is not the head segment.
+   *
+   * \return true for success or false if only the head segment is left.
+   */
+  bool discard() {
+    if (!m_dir || m_tail == m_head) {
+      return false;
+    }
+    m_tail++;
+    return writeMeta();
+  }
+  /** Save the log and close its files.
+   * \return true for success or false for failure.
+   */
+  bool end() {
+    bool rtn = sync();
+    closeFiles();
+    return rtn;
+  }
+  /** \return Sequence number of the segment for new records. */
+  uint32_t head() const { return m_head; }
+  /** \return true if the log is open. */
+  bool isOpen() const { return m_dir != nullptr; }
+  /** Start to read records from the oldest segment.
+   *
+   * Don't append records until reading is done.
+   *
+   * \return true for success or false for failure.
+   */
+  bool readBegin() {
+    m_reader.close();
+    m_readSeq = m_tail;
+    return sync();
+  }
+  /** Read the next record.
+   *
+   * \param[out] buf Location for the record.
+   * \param[in] size Size of \a buf.
+   * \return Size of the record, zero after the newest record, or -1 for
+   *         an error or if the record does not fit in \a buf.
+   */
+  int readNext(void* buf, size_t size) {
+    uint8_t len[2];
+    uint32_t end;
+    uint32_t pos;
+    uint16_t n;
+    if (!m_dir) {
+      return -1;
+    }
+    while (1) {
+      if (!m_reader.isOpen()) {
+        if (m_readSeq < m_tail) {
+          // Segments were discarded.
+          m_readSeq = m_tail;
+        }
+        if (m_readSeq > m_head) {
+          return 0;
+        }
+        if (!openSegment(&m_reader, m_readSeq % m_count, O_RDONLY)) {
+          return -1;
+        }
+        if (!checkHeader(&m_reader, m_readSeq)) {
+          // Old data in a segment that was being reused.
+          m_reader.close();
+          m_readSeq++;
+          continue;
+        }
+      }
+      end = m_readSeq == m_head ? m_offset : m_size;
+      pos = m_reader.curPosition();
+      if (pos + 2 <= end) {
+        if (m_reader.read(len, 2) != 2) {
+          return -1;
+        }
+        n = len[0] | len[1] << 8;
+        if (n != 0 && pos + 2 + n <= end) {
+          if (n > size) {
+            return -1;
+          }
+          return m_reader.read(buf, n) == n ? n : -1;
+        }
+      }
+      // End of segment.
+      m_reader.close();
+      m_readSeq++;
+    }
+  }
+  /** Start a new segment.
+   *
+   * The oldest segment is removed if all segments are used.
+   *
+   * \return true for success or false for failure.
+   */
+  bool rotate() {
+    uint8_t zero[2] = {0, 0};
+    if (!m_dir) {
+      return false;
+    }
+    // Mark the end of the records.
+    if (m_offset + 2 <= m_size && m_file.write(zero, 2) != 2) {
+      goto fail;
+    }
+    if (!m_file.close()) {
+      goto fail;
+    }
+    m_head++;
+    if (m_head - m_tail >= m_count) {
+      m_tail = m_head - m_count + 1;
+    }
+    if (!startSegment() || !writeMeta()) {
+      goto fail;
+    }
+    return true;
+
+  fail:
+    closeFiles();
+    return false;
+  }
+  /** \return Number of segments. */
+  uint8_t segmentCount() const { return m_count; }
+  /** \return Size of each segment in bytes. */
+  uint32_t segmentSize() const { return m_size; }
+  /** Write records to the card and save the head position.
+   * \return true for success or false for failure.
+   */
+  bool sync() {
+    if (!m_dir || !m_file.sync()) {
+      return false;
+    }
+    return m_synced == m_offset || writeMeta();
+  }
+  /** \return Sequence number of the oldest segment. */
+  uint32_t tail() const { return m_tail; }
+  /** \return Bytes used in the head segment including its header. */
+  uint32_t usedInHead() const { return m_offset; }
+
+ private:
+  static const uint32_t MAGIC = 0X474F4C53;
+  struct Meta {
+    uint32_t magic;
+    uint32_t generation;
+    uint32_t size;
+    uint32_t head;
+    uint32_t tail;
+    uint32_t offset;
+    uint8_t count;
+    uint8_t reserved;
+    uint16_t crc;
+  };
+  bool checkHeader(F* file, uint32_t seq) {
+    uint32_t header[2];
+    return file->read(header, sizeof(header)) == sizeof(header) &&
+           header[0] == MAGIC && header[1] == seq;
+  }
+  // Close the files after end() or an error.
+  void closeFiles() {
+    m_reader.close();
+    m_file.close();
+    m_meta.close();
+    m_dir = nullptr;
+  }
+  // Make room for two copies of the state.
+  bool clearMeta() {
+    uint8_t zero[32];
+    memset(zero, 0, sizeof(zero));
+    if (!m_meta.seekSet(0)) {
+      return false;
+    }
+    for (uint8_t i = 0; i < 1024 / sizeof(zero); i++) {
+      if (m_meta.write(zero, sizeof(zero)) != sizeof(zero)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  bool openSegment(F* file, uint8_t i, oflag_t oflag) {
+    char name[] = "SEG00.LOG";
+    name[3] = '0' + i / 10;
+    name[4] = '0' + i % 10;
+    return file->open(m_dir, name, oflag);
+  }
+  // Load the newest valid copy of the state.
+  bool readMeta() {
+    Meta meta;
+    bool found = false;
+    for (uint8_t i = 0; i < 2; i++) {
+      if (!m_meta.seekSet(512UL * i) ||
+          m_meta.read(&meta, sizeof(meta)) != sizeof(meta) ||
+          meta.magic != MAGIC || meta.count != m_count ||
+          meta.size != m_size || meta.offset < HEADER_SIZE ||
+          meta.offset > m_size ||
+          meta.head - meta.tail >= m_count ||
+          meta.crc != sdCrc16Nibble(reinterpret_cast<uint8_t*>(&meta),
+                                    sizeof(meta) - 2)) {
+        continue;
+      }
+      if (!found || meta.generation - m_generation < 0X80000000) {
+        found = true;
+        m_generation = meta.generation;
+        m_head = meta.head;
+        m_tail = meta.tail;
+        m_offset = meta.offset;
+      }
+    }
+    return found;
+  }
+  // Open the head segment and write its sequence number.
+  bool startSegment() {
+    uint32_t header[2] = {MAGIC, m_head};
+    if (!openSegment(&m_file, m_head % m_count, O_RDWR) ||
+        m_file.write(header, sizeof(header)) != sizeof(header)) {
+      return false;
+    }
+    m_offset = HEADER_SIZE;
+    return true;
+  }
+  // Write the state over the older copy.
+  bool writeMeta() {
+    Meta meta;
+    memset(&meta, 0, sizeof(meta));
+    m_generation++;
+    meta.magic = MAGIC;
+    meta.generation = m_generation;
+    meta.size = m_size;
+    meta.head = m_head;
+    meta.tail = m_tail;
+    meta.offset = m_offset;
+    meta.count = m_count;
+    meta.crc =
+        sdCrc16Nibble(reinterpret_cast<uint8_t*>(&meta), sizeof(meta) - 2);
+    if (!m_file.sync() || !m_meta.seekSet(512UL * (m_generation & 1)) ||
+        m_meta.write(&meta, sizeof(meta)) != sizeof(meta) || !m_meta.sync()) {
+      m_dir = nullptr;
+      return false;
+    }
+    m_synced = m_offset;
+    return true;
+  }
+  F* m_dir;
+  F m_file;
+  F m_meta;
+  F m_reader;
+  uint32_t m_size;
+  uint32_t m_head;
+  uint32_t m_tail;
+  uint32_t m_offset;
+  uint32_t m_synced;
+  uint32_t m_generation;
+  uint32_t m_readSeq;
+  uint8_t m_count;
+};
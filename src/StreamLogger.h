@@ -0,0 +1,201 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+/**
+ * \file
+ * \brief Streaming data logger.
+ */
+#include "RingBuf.h"
+class FatFile;
+/**
+ * \class StreamLogger
+ * \brief Sustained rate data logger built on RingBuf.
+ *
+ * Data is buffered in a ring of SectorCount 512 byte sectors.  Call task()
+ * often from loop().  When the card is not busy all whole sectors in the
+ * ring are written with one multi-sector write to a preallocated
+ * contiguous file, so writes overlap the time used to acquire data.
+ *
+ * Use write() or print() to log data.  Use beginISR() and endISR() around
+ * calls in an ISR.  Data that does not fit in the ring is dropped and
+ * counted by overrunCount().
+ *
+ * F is a file class such as FsFile, ExFile or File32.
+ */
+template <class F, size_t SectorCount>
+class StreamLogger : public Print {
+ public:
+  /** Size of the ring buffer in bytes. */
+  static const size_t BUF_SIZE = 512 * SectorCount;
+  StreamLogger() { begin(nullptr); }
+  /**
+   * Initialize the logger for an empty open file.
+   *
+   * \param[in] file Open file with no data.
+   * \param[in] maxSize Bytes to preallocate.  The log can't exceed maxSize.
+   *            Must be less than 4 GiB for FAT files.
+   * \param[in] erase Erase the preallocated space for flatter write latency.
+   * \return true for success or false for failure.
+   */
+  bool begin(F* file, uint64_t maxSize, bool erase = false) {
+    begin(file);
+    if (!file || !sizeOk(file, maxSize) ||
+        !file->preAllocate(maxSize, erase)) {
+      m_file = nullptr;
+      return false;
+    }
+    m_maxSize = maxSize;
+    return true;
+  }
+  /** Disable protection of counts by noInterrupts()/interrupts(). */
+  void beginISR() { m_ring.beginISR(); }
+  /** \return Free space in the ring buffer. */
+  size_t bytesFree() const { return m_ring.bytesFree(); }
+  /** \return Bytes in the ring buffer. */
+  size_t bytesUsed() const { return m_ring.bytesUsed(); }
+  /** \return Bytes written to the file. */
+  uint64_t bytesWritten() const { return m_bytesWritten; }
+  /**
+   * Write all data, including a partial sector, and remove
+   * preallocated space after the data.
+   *
+   * \return true for success or false for failure.
+   */
+  bool end() {
+    if (!m_file || !m_ring.sync()) {
+      return false;
+    }
+    m_bytesWritten = m_file->curPosition();
+    return m_file->truncate() && m_file->sync();
+  }
+  /** Enable protection of counts by noInterrupts()/interrupts(). */
+  void endISR() { m_ring.endISR(); }
+  /** \return true if the file has no space for buffered data. */
+  bool isFull() const {
+    return m_bytesWritten + m_ring.bytesUsed() >= m_maxSize;
+  }
+  /** \return Largest number of bytes in the ring buffer seen by task(). */
+  size_t maxBytesUsed() const { return m_maxBytesUsed; }
+  /** \return Longest time for a write in micros. */
+  uint32_t maxWriteMicros() const { return m_maxWriteMicros; }
+  /** \return Number of write() calls that dropped data. */
+  uint32_t overrunCount() const { return m_overrunCount; }
+  /** Clear latency, buffer use and overrun statistics. */
+  void resetStats() {
+    m_maxBytesUsed = 0;
+    m_maxWriteMicros = 0;
+    m_overrunCount = 0;
+    m_writeCount = 0;
+  }
+  /**
+   * Write whole sectors if the card is not busy.  Call often.
+   *
+   * \return false if a write failed or the file is full.
+   */
+  bool task() {
+    if (!m_file) {
+      return false;
+    }
+    size_t n = m_ring.bytesUsed();
+    if (n > m_maxBytesUsed) {
+      m_maxBytesUsed = n;
+    }
+    uint64_t room = m_maxSize - m_bytesWritten;
+    if (n > room) {
+      n = room;
+    }
+    n &= ~static_cast<size_t>(511);
+    if (n == 0) {
+      return room >= 512;
+    }
+    if (m_file->isBusy()) {
+      return true;
+    }
+    uint32_t m = micros();
+    size_t nw = m_ring.writeOut(n);
+    m = micros() - m;
+    if (m > m_maxWriteMicros) {
+      m_maxWriteMicros = m;
+    }
+    m_bytesWritten += nw;
+    m_writeCount++;
+    return nw == n;
+  }
+  /**
+   * Copy data to the ring buffer.  No data is copied if there is not
+   * space for count bytes.
+   *
+   * \param[in] buf Location of data to be written.
+   * \param[in] count Number of bytes to be written.
+   * \return Number of bytes actually written.
+   */
+  size_t write(const void* buf, size_t count) {
+    size_t n = m_ring.write(buf, count);
+    if (n != count) {
+      m_overrunCount++;
+    }
+    return n;
+  }
+  /**
+   * Override virtual function in Print for efficiency.
+   *
+   * \param[in] buf Location of data to be written.
+   * \param[in] count Number of bytes to be written.
+   * \return Number of bytes actually written.
+   */
+  size_t write(const uint8_t* buf, size_t count) override {
+    return write(static_cast<const void*>(buf), count);
+  }
+  /**
+   * Required function for Print.
+   * \param[in] data Byte to be written.
+   * \return Number of bytes actually written.
+   */
+  size_t write(uint8_t data) override { return write(&data, 1); }
+  /** \return Number of file writes by task(). */
+  uint32_t writeCount() const { return m_writeCount; }
+
+ private:
+  void begin(F* file) {
+    m_ring.begin(file);
+    m_file = file;
+    m_bytesWritten = 0;
+    m_maxSize = 0;
+    resetStats();
+  }
+  // FatFile::preAllocate() takes a uint32_t length.
+  static bool sizeOk(const FatFile*, uint64_t size) {
+    return size <= 0XFFFFFFFF;
+  }
+  static bool sizeOk(const void*, uint64_t) { return true; }
+  RingBuf<F, BUF_SIZE> m_ring;
+  F* m_file;
+  uint64_t m_bytesWritten;
+  uint64_t m_maxSize;
+  size_t m_maxBytesUsed;
+  uint32_t m_maxWriteMicros;
+  uint32_t m_overrunCount;
+  uint32_t m_writeCount;
+};
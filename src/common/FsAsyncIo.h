@@ -0,0 +1,133 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+/**
+ * \file
+ * \brief Asynchronous sector request and queue classes.
+ */
+#include "FsStructs.h"
+#include "SysCall.h"
+#if USE_ASYNC_IO
+//------------------------------------------------------------------------------
+/** Request reads sectors. */
+const uint8_t FS_IO_READ = 0;
+/** Request writes sectors. */
+const uint8_t FS_IO_WRITE = 1;
+
+/** Request is not queued. */
+const uint8_t FS_IO_IDLE = 0;
+/** Request is queued or in progress. */
+const uint8_t FS_IO_PENDING = 1;
+/** Request completed without error. */
+const uint8_t FS_IO_DONE = 2;
+/** Request failed. */
+const uint8_t FS_IO_ERROR = 3;
+//------------------------------------------------------------------------------
+/**
+ * \class FsIoRequest
+ * \brief A read or write of consecutive sectors.
+ *
+ * The request and its data buffer must not be changed until the request
+ * is complete.
+ */
+class FsIoRequest {
+ public:
+  /** Completion callback type. */
+  typedef void (*Callback)(FsIoRequest* req);
+  /** Mark the request complete and call the callback.
+   *
+   * \param[in] ok true for success or false for failure.
+   */
+  void complete(bool ok) {
+    status = ok ? FS_IO_DONE : FS_IO_ERROR;
+    if (callback) {
+      callback(this);
+    }
+  }
+  /** \return true if the request completed with or without error. */
+  bool isDone() const { return status >= FS_IO_DONE; }
+  /** \return true if the request failed. */
+  bool isError() const { return status == FS_IO_ERROR; }
+  /** \return true if the request is queued or in progress. */
+  bool isPending() const { return status == FS_IO_PENDING; }
+
+  /** First sector. */
+  Sector_t sector = 0;
+  /** Data buffer. */
+  uint8_t* data = nullptr;
+  /** Number of sectors. */
+  size_t count = 0;
+  /** Optional completion callback. */
+  Callback callback = nullptr;
+  /** Caller data for the callback. */
+  void* context = nullptr;
+  /** FS_IO_READ or FS_IO_WRITE. */
+  uint8_t op = FS_IO_READ;
+  /** FS_IO_IDLE, FS_IO_PENDING, FS_IO_DONE or FS_IO_ERROR. */
+  volatile uint8_t status = FS_IO_IDLE;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class FsIoQueue
+ * \brief Bounded FIFO of pending requests for block device drivers.
+ */
+class FsIoQueue {
+ public:
+  /** Queue size. */
+  static const uint8_t SIZE = ASYNC_IO_QUEUE_SIZE;
+  /** \return Number of queued requests. */
+  uint8_t count() const { return m_count; }
+  /** \return Oldest request or nullptr if empty. */
+  FsIoRequest* front() const { return m_count ? m_ring[m_head] : nullptr; }
+  /** \return true if no more requests can be queued. */
+  bool isFull() const { return m_count == SIZE; }
+  /** Remove the oldest request. */
+  void pop() {
+    if (m_count) {
+      m_head = m_head < (SIZE - 1) ? m_head + 1 : 0;
+      m_count--;
+    }
+  }
+  /** Append a request.
+   *
+   * \param[in] req Request to be queued.
+   * \return false if the queue is full.
+   */
+  bool push(FsIoRequest* req) {
+    if (isFull()) {
+      return false;
+    }
+    uint8_t i = m_head + m_count;
+    m_ring[i < SIZE ? i : i - SIZE] = req;
+    m_count++;
+    return true;
+  }
+
+ private:
+  FsIoRequest* m_ring[SIZE];
+  uint8_t m_head = 0;
+  uint8_t m_count = 0;
+};
+#endif  // USE_ASYNC_IO
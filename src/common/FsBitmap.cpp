@@ -0,0 +1,205 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "FsBitmap.h"
+#if USE_SIMD_BITMAP && defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_BITMAP_SSE2 1
+#elif USE_SIMD_BITMAP && defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SIMD_BITMAP_NEON 1
+#endif  // USE_SIMD_BITMAP
+//------------------------------------------------------------------------------
+static inline uint32_t bitCount(uint32_t w) { return __builtin_popcountl(w); }
+//------------------------------------------------------------------------------
+static inline uint32_t headMask(size_t bgn) { return 0XFFFFFFFF << (bgn & 31); }
+//------------------------------------------------------------------------------
+static inline uint32_t tailMask(size_t end) {
+  return 0XFFFFFFFF >> (31 - ((end - 1) & 31));
+}
+//------------------------------------------------------------------------------
+static inline uint32_t mapWord(const uint8_t* map, size_t i) {
+  return getLe32(map + 4 * i);
+}
+#if SIMD_BITMAP_SSE2
+//------------------------------------------------------------------------------
+// Set bits in 16 bytes.
+static inline uint32_t simdCount(const uint8_t* p) {
+  const __m128i m1 = _mm_set1_epi8(0X55);
+  const __m128i m2 = _mm_set1_epi8(0X33);
+  const __m128i m4 = _mm_set1_epi8(0X0F);
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  v = _mm_sub_epi8(v, _mm_and_si128(_mm_srli_epi64(v, 1), m1));
+  v = _mm_add_epi8(_mm_and_si128(v, m2),
+                   _mm_and_si128(_mm_srli_epi64(v, 2), m2));
+  v = _mm_and_si128(_mm_add_epi8(v, _mm_srli_epi64(v, 4)), m4);
+  v = _mm_sad_epu8(v, _mm_setzero_si128());
+  return _mm_cvtsi128_si32(v) + _mm_extract_epi16(v, 4);
+}
+//------------------------------------------------------------------------------
+// Zero 16-bit entries in 16 bytes.
+static inline uint32_t simdZero16(const uint8_t* p) {
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  v = _mm_cmpeq_epi16(v, _mm_setzero_si128());
+  return bitCount(_mm_movemask_epi8(v)) >> 1;
+}
+//------------------------------------------------------------------------------
+// Zero 32-bit entries in 16 bytes.
+static inline uint32_t simdZero32(const uint8_t* p) {
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  v = _mm_cmpeq_epi32(v, _mm_setzero_si128());
+  return bitCount(_mm_movemask_epi8(v)) >> 2;
+}
+//------------------------------------------------------------------------------
+// True if all 16 bytes equal fill.
+static inline bool simdEqual(const uint8_t* p, uint8_t fill) {
+  __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+  __m128i f = _mm_set1_epi8(static_cast<char>(fill));
+  return _mm_movemask_epi8(_mm_cmpeq_epi8(v, f)) == 0XFFFF;
+}
+#elif SIMD_BITMAP_NEON
+//------------------------------------------------------------------------------
+// Set bits in 16 bytes.
+static inline uint32_t simdCount(const uint8_t* p) {
+  return vaddlvq_u8(vcntq_u8(vld1q_u8(p)));
+}
+//------------------------------------------------------------------------------
+// Zero 16-bit entries in 16 bytes.
+static inline uint32_t simdZero16(const uint8_t* p) {
+  uint16x8_t v = vceqzq_u16(vld1q_u16(reinterpret_cast<const uint16_t*>(p)));
+  return vaddvq_u16(vshrq_n_u16(v, 15));
+}
+//------------------------------------------------------------------------------
+// Zero 32-bit entries in 16 bytes.
+static inline uint32_t simdZero32(const uint8_t* p) {
+  uint32x4_t v = vceqzq_u32(vld1q_u32(reinterpret_cast<const uint32_t*>(p)));
+  return vaddvq_u32(vshrq_n_u32(v, 31));
+}
+//------------------------------------------------------------------------------
+// True if all 16 bytes equal fill.
+static inline bool simdEqual(const uint8_t* p, uint8_t fill) {
+  return vminvq_u8(vceqq_u8(vld1q_u8(p), vdupq_n_u8(fill))) == 0XFF;
+}
+#endif  // SIMD_BITMAP_SSE2
+//------------------------------------------------------------------------------
+size_t fsBitmapCount(const uint8_t* map, size_t bgn, size_t end) {
+  if (bgn >= end) {
+    return 0;
+  }
+  size_t i = bgn >> 5;
+  size_t last = (end - 1) >> 5;
+  size_t n = 0;
+  uint32_t w = mapWord(map, i) & headMask(bgn);
+  if (i < last) {
+    n = bitCount(w);
+    i++;
+#if SIMD_BITMAP_SSE2 || SIMD_BITMAP_NEON
+    for (; (i + 4) <= last; i += 4) {
+      n += simdCount(map + 4 * i);
+    }
+#endif  // SIMD_BITMAP_SSE2 || SIMD_BITMAP_NEON
+    for (; i < last; i++) {
+      n += bitCount(mapWord(map, i));
+    }
+    w = mapWord(map, last);
+  }
+  return n + bitCount(w & tailMask(end));
+}
+//------------------------------------------------------------------------------
+void fsBitmapFill(uint8_t* map, size_t bgn, size_t end, bool value) {
+  if (bgn >= end) {
+    return;
+  }
+  size_t last = (end - 1) >> 5;
+  uint32_t mask = headMask(bgn);
+  for (size_t i = bgn >> 5; i <= last; i++) {
+    if (i == last) {
+      mask &= tailMask(end);
+    }
+    uint32_t w = mapWord(map, i);
+    setLe32(map + 4 * i, value ? w | mask : w & ~mask);
+    mask = 0XFFFFFFFF;
+  }
+}
+//------------------------------------------------------------------------------
+size_t fsBitmapFind(const uint8_t* map, size_t bgn, size_t end, bool value) {
+  if (bgn >= end) {
+    return end;
+  }
+  // Invert words so the bit to find is one.
+  uint32_t inv = value ? 0 : 0XFFFFFFFF;
+  size_t i = bgn >> 5;
+  size_t last = (end - 1) >> 5;
+  uint32_t w = (mapWord(map, i) ^ inv) & headMask(bgn);
+  while (!w) {
+    if (++i > last) {
+      return end;
+    }
+#if SIMD_BITMAP_SSE2 || SIMD_BITMAP_NEON
+    while ((i + 4) <= last &&
+           simdEqual(map + 4 * i, static_cast<uint8_t>(inv))) {
+      i += 4;
+    }
+#endif  // SIMD_BITMAP_SSE2 || SIMD_BITMAP_NEON
+    w = mapWord(map, i) ^ inv;
+  }
+  size_t r = (i << 5) + __builtin_ctzl(w);
+  return r < end ? r : end;
+}
+//------------------------------------------------------------------------------
+size_t fsCountZero16(const uint8_t* fat, size_t n) {
+  size_t i = 0;
+  size_t r = 0;
+#if SIMD_BITMAP_SSE2 || SIMD_BITMAP_NEON
+  for (; (i + 8) <= n; i += 8) {
+    r += simdZero16(fat + 2 * i);
+  }
+#endif  // SIMD_BITMAP_SSE2 || SIMD_BITMAP_NEON
+  // Two entries per word.  The high bit of each zero entry is set in z.
+  for (; (i + 2) <= n; i += 2) {
+    uint32_t w = getLe32(fat + 2 * i);
+    uint32_t z = ~(((w & 0X7FFF7FFF) + 0X7FFF7FFF) | w | 0X7FFF7FFF);
+    r += bitCount(z);
+  }
+  if (i < n && getLe16(fat + 2 * i) == 0) {
+    r++;
+  }
+  return r;
+}
+//------------------------------------------------------------------------------
+size_t fsCountZero32(const uint8_t* fat, size_t n) {
+  size_t i = 0;
+  size_t r = 0;
+#if SIMD_BITMAP_SSE2 || SIMD_BITMAP_NEON
+  for (; (i + 4) <= n; i += 4) {
+    r += simdZero32(fat + 4 * i);
+  }
+#endif  // SIMD_BITMAP_SSE2 || SIMD_BITMAP_NEON
+  for (; i < n; i++) {
+    if (getLe32(fat + 4 * i) == 0) {
+      r++;
+    }
+  }
+  return r;
+}
@@ -0,0 +1,70 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+/**
+ * \file
+ * \brief Word at a time bitmap and FAT scan functions.
+ */
+#include "FsStructs.h"
+#include "SysCall.h"
+//------------------------------------------------------------------------------
+// Bit n of a bitmap is bit (n & 7) of byte (n >> 3).  Bitmaps must be four
+// byte aligned.  Ranges are bit bgn through bit end - 1.
+//------------------------------------------------------------------------------
+/** Count set bits in a bitmap.
+ * \param[in] map Bitmap.
+ * \param[in] bgn First bit of range.
+ * \param[in] end Bit after range.
+ * \return Number of set bits.
+ */
+size_t fsBitmapCount(const uint8_t* map, size_t bgn, size_t end);
+/** Set or clear a range of bits in a bitmap.
+ * \param[in,out] map Bitmap.
+ * \param[in] bgn First bit of range.
+ * \param[in] end Bit after range.
+ * \param[in] value New value for bits.
+ */
+void fsBitmapFill(uint8_t* map, size_t bgn, size_t end, bool value);
+/** Find the first bit with a given value.
+ * \param[in] map Bitmap.
+ * \param[in] bgn First bit of range.
+ * \param[in] end Bit after range.
+ * \param[in] value Value to find.
+ * \return Index of first bit equal to value or end if none.
+ */
+size_t fsBitmapFind(const uint8_t* map, size_t bgn, size_t end, bool value);
+//------------------------------------------------------------------------------
+/** Count zero FAT16 entries.
+ * \param[in] fat Four byte aligned FAT entries.
+ * \param[in] n Number of entries.
+ * \return Number of zero entries.
+ */
+size_t fsCountZero16(const uint8_t* fat, size_t n);
+/** Count zero FAT32 entries.
+ * \param[in] fat Four byte aligned FAT entries.
+ * \param[in] n Number of entries.
+ * \return Number of zero entries.
+ */
+size_t fsCountZero32(const uint8_t* fat, size_t n);
@@ -29,6 +29,8 @@
 #pragma once
 #include <stddef.h>
 #include <stdint.h>
+
+#include "FsAsyncIo.h"
 /**
  * \class FsBlockDeviceInterface
  * \brief FsBlockDeviceInterface class.
@@ -39,12 +41,51 @@ class FsBlockDeviceInterface {
 
   /** end use of device */
   virtual void end() {}
+  /** Erase a range of sectors.
+   *
+   * The default is for devices without an erase command.
+   *
+   * \param[in] firstSector The address of the first sector in the range.
+   * \param[in] lastSector The address of the last sector in the range.
+   *
+   * \return true for success or false for failure.
+   */
+  virtual bool erase(Sector_t firstSector, Sector_t lastSector) {
+    (void)firstSector;
+    (void)lastSector;
+    return false;
+  }
+  /** Erase a range of sectors as a hint.
+   *
+   * A failed hint does not change the device error code.  The default is
+   * for devices without an error code.
+   *
+   * \param[in] firstSector The address of the first sector in the range.
+   * \param[in] lastSector The address of the last sector in the range.
+   *
+   * \return true if the range was erased.
+   */
+  virtual bool eraseHint(Sector_t firstSector, Sector_t lastSector) {
+    return erase(firstSector, lastSector);
+  }
   /**
    * Check for FsBlockDevice busy.
    *
    * \return true if busy else false.
    */
   virtual bool isBusy() = 0;
+
+#if USE_ASYNC_IO
+  /**
+   * Advance queued requests without waiting.
+   *
+   * The default is for devices that complete requests in submit().
+   *
+   * \return Number of requests not yet complete.
+   */
+  virtual uint8_t poll() { return 0; }
+#endif  // USE_ASYNC_IO
+
   /**
    * Read a sector.
    *
@@ -67,6 +108,28 @@ class FsBlockDeviceInterface {
   /** \return device size in sectors. */
   virtual Sector_t sectorCount() = 0;
 
+#if USE_ASYNC_IO
+  /**
+   * Queue a sector request.
+   *
+   * The default performs the transfer with readSectors() or writeSectors()
+   * and completes the request before returning.  Devices with a queue
+   * wait in poll() while the queue is full.  Blocking transfers and
+   * syncDevice() complete all queued requests first.
+   *
+   * \param[in,out] req Request to be queued.
+   * \return true for success or false for failure.
+   */
+  virtual bool submit(FsIoRequest* req) {
+    req->status = FS_IO_PENDING;
+    bool ok = req->op == FS_IO_WRITE
+                  ? writeSectors(req->sector, req->data, req->count)
+                  : readSectors(req->sector, req->data, req->count);
+    req->complete(ok);
+    return ok;
+  }
+#endif  // USE_ASYNC_IO
+
   /** End multi-sector transfer and go to idle state.
    * \return true for success or false for failure.
    */
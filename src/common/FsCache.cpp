@@ -27,46 +27,233 @@
 
 #include "DebugMacros.h"
 //------------------------------------------------------------------------------
+void FsCache::invalidateRange(Sector_t sector, size_t count) {
+  for (uint8_t i = 0; i < lineCount(); i++) {
+    if (sector <= m_sector[i] && m_sector[i] < (sector + count)) {
+      m_status[i] = 0;
+      m_sector[i] = 0XFFFFFFFF;
+    }
+  }
+}
+#if FS_CACHE_USER_SECTOR_COUNT
+//------------------------------------------------------------------------------
+bool FsCache::attach(uint8_t* buf, uint8_t count) {
+  if (count > USER_LINE_COUNT || (count && !buf)) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  if (!sync()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  m_userBuffer = count ? buf : nullptr;
+  m_userCount = count;
+  for (uint8_t i = 0; i < lineCount(); i++) {
+    m_lru[i] = i;
+  }
+  invalidate();
+  return true;
+
+fail:
+  return false;
+}
+#endif  // FS_CACHE_USER_SECTOR_COUNT
+#if USE_DEFERRED_FAT_MIRROR
+//------------------------------------------------------------------------------
+// Add a first FAT sector to the sorted list of ranges to mirror.
+void FsCache::mirrorAdd(Sector_t sector) {
+  uint8_t i = 0;
+  while (i < m_mirrorCount && m_mirrorEnd[i] < sector) {
+    i++;
+  }
+  if (i < m_mirrorCount && m_mirrorBgn[i] <= sector) {
+    if (m_mirrorEnd[i] == sector) {
+      m_mirrorEnd[i]++;
+      // Join the next range if the gap is closed.
+      if ((i + 1) < m_mirrorCount && m_mirrorBgn[i + 1] == m_mirrorEnd[i]) {
+        m_mirrorEnd[i] = m_mirrorEnd[i + 1];
+        m_mirrorCount--;
+        for (uint8_t j = i + 1; j < m_mirrorCount; j++) {
+          m_mirrorBgn[j] = m_mirrorBgn[j + 1];
+          m_mirrorEnd[j] = m_mirrorEnd[j + 1];
+        }
+      }
+    }
+    return;
+  }
+  if (i < m_mirrorCount && m_mirrorBgn[i] == (sector + 1)) {
+    m_mirrorBgn[i] = sector;
+    return;
+  }
+  if (m_mirrorCount == MIRROR_RANGE_COUNT) {
+    // Join the two closest ranges.  Sectors in the gap are copied too.
+    uint8_t k = 0;
+    for (uint8_t j = 1; (j + 1) < m_mirrorCount; j++) {
+      if ((m_mirrorBgn[j + 1] - m_mirrorEnd[j]) <
+          (m_mirrorBgn[k + 1] - m_mirrorEnd[k])) {
+        k = j;
+      }
+    }
+    m_mirrorEnd[k] = m_mirrorEnd[k + 1];
+    m_mirrorCount--;
+    for (uint8_t j = k + 1; j < m_mirrorCount; j++) {
+      m_mirrorBgn[j] = m_mirrorBgn[j + 1];
+      m_mirrorEnd[j] = m_mirrorEnd[j + 1];
+    }
+    if (i == (k + 1)) {
+      // Sector is in the gap that was joined.
+      return;
+    }
+    if (i > k) {
+      i--;
+    }
+  }
+  for (uint8_t j = m_mirrorCount; j > i; j--) {
+    m_mirrorBgn[j] = m_mirrorBgn[j - 1];
+    m_mirrorEnd[j] = m_mirrorEnd[j - 1];
+  }
+  m_mirrorBgn[i] = sector;
+  m_mirrorEnd[i] = sector + 1;
+  m_mirrorCount++;
+}
+#endif  // USE_DEFERRED_FAT_MIRROR
+//------------------------------------------------------------------------------
 uint8_t* FsCache::prepare(Sector_t sector, uint8_t option) {
+  int8_t line;
   if (!m_blockDev) {
     DBG_FAIL_MACRO;
     goto fail;
   }
-  if (m_sector != sector) {
-    if (!sync()) {
+  line = findLine(sector);
+  if (line < 0) {
+#if USE_FS_CACHE_STATS
+    m_missCount++;
+#endif  // USE_FS_CACHE_STATS
+    // Replace least recently used line.
+    line = m_lru[lineCount() - 1];
+    if (!syncLine(line)) {
       DBG_FAIL_MACRO;
       goto fail;
     }
+    m_status[line] = 0;
+    m_sector[line] = 0XFFFFFFFF;
     if (!(option & CACHE_OPTION_NO_READ)) {
-      if (!m_blockDev->readSector(sector, m_buffer)) {
+      if (!m_blockDev->readSector(sector, lineBuffer(line))) {
         DBG_FAIL_MACRO;
         goto fail;
       }
     }
-    m_status = 0;
-    m_sector = sector;
+    m_sector[line] = sector;
+#if USE_FS_CACHE_STATS
+  } else {
+    m_hitCount++;
+#endif  // USE_FS_CACHE_STATS
   }
-  m_status |= option & CACHE_STATUS_MASK;
-  return m_buffer;
+  setMostRecent(line);
+  m_status[line] |= option & CACHE_STATUS_MASK;
+  return lineBuffer(line);
 
 fail:
   return nullptr;
 }
 //------------------------------------------------------------------------------
+void FsCache::setMostRecent(uint8_t line) {
+  uint8_t i = 0;
+  while (m_lru[i] != line) {
+    i++;
+  }
+  for (; i > 0; i--) {
+    m_lru[i] = m_lru[i - 1];
+  }
+  m_lru[0] = line;
+}
+//------------------------------------------------------------------------------
 bool FsCache::sync() {
-  if (m_status & CACHE_STATUS_DIRTY) {
-    if (!m_blockDev->writeSector(m_sector, m_buffer)) {
+  for (uint8_t i = 0; i < lineCount(); i++) {
+    if (!syncLine(i)) {
+      DBG_FAIL_MACRO;
+      goto fail;
+    }
+  }
+  return true;
+
+fail:
+  return false;
+}
+#if USE_DEFERRED_FAT_MIRROR
+//------------------------------------------------------------------------------
+bool FsCache::syncMirror() {
+  uint8_t copy;
+  if (!sync()) {
+    DBG_FAIL_MACRO;
+    goto fail;
+  }
+  // Sectors that are not cached are read into the least recently used
+  // line.  Other lines are not replaced.
+  copy = m_lru[lineCount() - 1];
+  for (uint8_t i = 0; i < m_mirrorCount; i++) {
+    for (Sector_t sector = m_mirrorBgn[i]; sector < m_mirrorEnd[i];
+         sector++) {
+      int8_t line = findLine(sector);
+      if (line < 0) {
+        line = copy;
+        m_status[line] = 0;
+        m_sector[line] = 0XFFFFFFFF;
+        if (!m_blockDev->readSector(sector, lineBuffer(line))) {
+          DBG_FAIL_MACRO;
+          goto fail;
+        }
+        m_sector[line] = sector;
+      }
+      if (!m_blockDev->writeSector(sector + m_mirrorOffset,
+                                   lineBuffer(line))) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+    }
+  }
+  m_mirrorCount = 0;
+  return true;
+
+fail:
+  return false;
+}
+#endif  // USE_DEFERRED_FAT_MIRROR
+//------------------------------------------------------------------------------
+bool FsCache::syncLine(uint8_t line) {
+  if (m_status[line] & CACHE_STATUS_DIRTY) {
+    if (!m_blockDev->writeSector(m_sector[line], lineBuffer(line))) {
       DBG_FAIL_MACRO;
       goto fail;
     }
     // mirror second FAT
-    if (m_status & CACHE_STATUS_MIRROR_FAT) {
-      if (!m_blockDev->writeSector(m_sector + m_mirrorOffset, m_buffer)) {
+    if (m_status[line] & CACHE_STATUS_MIRROR_FAT) {
+#if USE_DEFERRED_FAT_MIRROR
+      mirrorAdd(m_sector[line]);
+#else   // USE_DEFERRED_FAT_MIRROR
+      if (!m_blockDev->writeSector(m_sector[line] + m_mirrorOffset,
+                                   lineBuffer(line))) {
+        DBG_FAIL_MACRO;
+        goto fail;
+      }
+#endif  // USE_DEFERRED_FAT_MIRROR
+    }
+    m_status[line] &= ~CACHE_STATUS_DIRTY;
+  }
+  return true;
+
+fail:
+  return false;
+}
+//------------------------------------------------------------------------------
+bool FsCache::syncRange(Sector_t sector, size_t count) {
+  for (uint8_t i = 0; i < lineCount(); i++) {
+    if (sector <= m_sector[i] && m_sector[i] < (sector + count)) {
+      if (!syncLine(i)) {
         DBG_FAIL_MACRO;
         goto fail;
       }
     }
-    m_status &= ~CACHE_STATUS_DIRTY;
   }
   return true;
 
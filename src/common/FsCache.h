@@ -32,6 +32,13 @@
 /**
  * \class FsCache
  * \brief Sector cache.
+ *
+ * The cache holds FS_CACHE_SECTOR_COUNT sectors plus up to
+ * FS_CACHE_USER_SECTOR_COUNT caller-owned sectors added with attach().
+ * Lines are replaced in least recently used order and dirty lines are
+ * written back when they are replaced or when sync() is called.  The most
+ * recently accessed line is the current line for cacheBuffer(), dirty()
+ * and sector().
  */
 class FsCache {
  public:
@@ -51,11 +58,36 @@ class FsCache {
   /** Reserve cache sector for write - do not read from sector device. */
   static const uint8_t CACHE_RESERVE_FOR_WRITE =
       CACHE_STATUS_DIRTY | CACHE_OPTION_NO_READ;
+  /** Number of sectors in the cache. */
+  static const uint8_t LINE_COUNT = FS_CACHE_SECTOR_COUNT;
+  /** Maximum number of caller-owned sectors. */
+  static const uint8_t USER_LINE_COUNT = FS_CACHE_USER_SECTOR_COUNT;
+  static_assert(FS_CACHE_SECTOR_COUNT >= 1 &&
+                    FS_CACHE_SECTOR_COUNT + FS_CACHE_USER_SECTOR_COUNT <= 127,
+                "FS_CACHE_SECTOR_COUNT must be 1 to 127 less the user count");
   //----------------------------------------------------------------------------
   /** Constructor. */
-  FsCache() { init(nullptr); }  // cppcheck-suppress uninitMemberVar
+  FsCache() {  // cppcheck-suppress uninitMemberVar
+#if FS_CACHE_USER_SECTOR_COUNT
+    m_userBuffer = nullptr;
+    m_userCount = 0;
+#endif  // FS_CACHE_USER_SECTOR_COUNT
+    init(nullptr);
+  }
+#if FS_CACHE_USER_SECTOR_COUNT
+  /** Add caller-owned sectors to the cache.
+   *
+   * The cache is written and emptied first.  The buffer must stay valid
+   * until it is removed by a call with a count of zero.
+   *
+   * \param[in] buf Buffer for count sectors, aligned to four bytes.
+   * \param[in] count Number of sectors in buf, at most USER_LINE_COUNT.
+   * \return true for success or false for failure.
+   */
+  bool attach(uint8_t* buf, uint8_t count);
+#endif  // FS_CACHE_USER_SECTOR_COUNT
   /** \return Cache buffer address. */
-  uint8_t* cacheBuffer() { return m_buffer; }
+  uint8_t* cacheBuffer() { return lineBuffer(m_lru[0]); }
   /**
    * Cache safe read of a sector.
    *
@@ -64,8 +96,9 @@ class FsCache {
    * \return true for success or false for failure.
    */
   bool cacheSafeRead(Sector_t sector, uint8_t* dst) {
-    if (isCached(sector)) {
-      memcpy(dst, m_buffer, 512);
+    int8_t line = findLine(sector);
+    if (line >= 0) {
+      memcpy(dst, lineBuffer(line), 512);
       return true;
     }
     return m_blockDev->readSector(sector, dst);
@@ -79,7 +112,7 @@ class FsCache {
    * \return true for success or false for failure.
    */
   bool cacheSafeRead(Sector_t sector, uint8_t* dst, size_t count) {
-    if (isCached(sector, count) && !sync()) {
+    if (!syncRange(sector, count)) {
       return false;
     }
     return m_blockDev->readSectors(sector, dst, count);
@@ -92,9 +125,7 @@ class FsCache {
    * \return true for success or false for failure.
    */
   bool cacheSafeWrite(Sector_t sector, const uint8_t* src) {
-    if (isCached(sector)) {
-      invalidate();
-    }
+    invalidateRange(sector, 1);
     return m_blockDev->writeSector(sector, src);
   }
   /**
@@ -106,48 +137,85 @@ class FsCache {
    * \return true for success or false for failure.
    */
   bool cacheSafeWrite(Sector_t sector, const uint8_t* src, size_t count) {
-    if (isCached(sector, count)) {
-      invalidate();
-    }
+    invalidateRange(sector, count);
     return m_blockDev->writeSectors(sector, src, count);
   }
+#if USE_ASYNC_IO
+  /**
+   * Cache safe submit of an asynchronous request.
+   *
+   * \param[in,out] req Request to be queued.
+   * \return true for success or false for failure.
+   */
+  bool cacheSafeSubmit(FsIoRequest* req) {
+    if (req->op == FS_IO_WRITE) {
+      invalidateRange(req->sector, req->count);
+    } else if (!syncRange(req->sector, req->count)) {
+      return false;
+    }
+    return m_blockDev->submit(req);
+  }
+#endif  // USE_ASYNC_IO
   /** \return Clear the cache and returns a pointer to the cache. */
   uint8_t* clear() {
-    if (isDirty() && !sync()) {
+    if (!sync()) {
       return nullptr;
     }
     invalidate();
-    return m_buffer;
+    return cacheBuffer();
   }
   /** Set current sector dirty. */
-  void dirty() { m_status |= CACHE_STATUS_DIRTY; }
+  void dirty() { m_status[m_lru[0]] |= CACHE_STATUS_DIRTY; }
   /** Initialize the cache.
    * \param[in] blockDev Block device for this cache.
    */
   void init(FsBlockDevice* blockDev) {
     m_blockDev = blockDev;
+#if USE_DEFERRED_FAT_MIRROR
+    m_mirrorCount = 0;
+#endif  // USE_DEFERRED_FAT_MIRROR
+    for (uint8_t i = 0; i < lineCount(); i++) {
+      m_lru[i] = i;
+    }
     invalidate();
+#if USE_FS_CACHE_STATS
+    resetStats();
+#endif  // USE_FS_CACHE_STATS
   }
-  /** Invalidate current cache sector. */
+  /** Invalidate all cached sectors. */
   void invalidate() {
-    m_status = 0;
-    m_sector = 0XFFFFFFFF;
+    for (uint8_t i = 0; i < lineCount(); i++) {
+      m_status[i] = 0;
+      m_sector[i] = 0XFFFFFFFF;
+    }
   }
   /** Check if a sector is in the cache.
    * \param[in] sector Sector to checked.
    * \return true if the sector is cached.
    */
-  bool isCached(Sector_t sector) const { return sector == m_sector; }
+  bool isCached(Sector_t sector) const { return findLine(sector) >= 0; }
   /** Check if the cache contains a sector from a range.
    * \param[in] sector Start sector of the range.
    * \param[in] count Number of sectors in the range.
    * \return true if a sector in the range is cached.
    */
-  bool isCached(Sector_t sector, size_t count) {
-    return sector <= m_sector && m_sector < (sector + count);
+  bool isCached(Sector_t sector, size_t count) const {
+    for (uint8_t i = 0; i < lineCount(); i++) {
+      if (sector <= m_sector[i] && m_sector[i] < (sector + count)) {
+        return true;
+      }
+    }
+    return false;
   }
   /** \return dirty status */
-  bool isDirty() { return m_status & CACHE_STATUS_DIRTY; }
+  bool isDirty() const {
+    for (uint8_t i = 0; i < lineCount(); i++) {
+      if (m_status[i] & CACHE_STATUS_DIRTY) {
+        return true;
+      }
+    }
+    return false;
+  }
   /** Prepare cache to access sector.
    * \param[in] sector Sector to read.
    * \param[in] option mode for cached sector.
@@ -155,20 +223,92 @@ class FsCache {
    */
   uint8_t* prepare(Sector_t sector, uint8_t option);
   /** \return Logical sector number for cached sector. */
-  Sector_t sector() { return m_sector; }
+  Sector_t sector() const { return m_sector[m_lru[0]]; }
   /** Set the offset to the second FAT for mirroring.
    * \param[in] offset Sector offset to second FAT.
    */
   void setMirrorOffset(uint32_t offset) { m_mirrorOffset = offset; }
-  /** Write current sector if dirty.
+  /** Write all dirty sectors.
    * \return true for success or false for failure.
    */
   bool sync();
+#if USE_DEFERRED_FAT_MIRROR
+  /** Write all dirty sectors then copy FAT sectors written since the
+   * last call to the second FAT.  Cached sectors are copied from the
+   * cache.  Others are read into the least recently used line, the only
+   * line the copy replaces.
+   * \return true for success or false for failure.
+   */
+  bool syncMirror();
+#else   // USE_DEFERRED_FAT_MIRROR
+  /** Write all dirty sectors.  The second FAT is written by sync().
+   * \return true for success or false for failure.
+   */
+  bool syncMirror() { return sync(); }
+#endif  // USE_DEFERRED_FAT_MIRROR
+#if USE_FS_CACHE_STATS
+  /** \return Number of prepare() calls satisfied by the cache. */
+  uint32_t hitCount() const { return m_hitCount; }
+  /** \return Number of prepare() calls that replaced a cache line. */
+  uint32_t missCount() const { return m_missCount; }
+  /** Reset hit and miss counts. */
+  void resetStats() {
+    m_hitCount = 0;
+    m_missCount = 0;
+  }
+#endif  // USE_FS_CACHE_STATS
 
  private:
-  uint8_t m_status;
+  static const uint8_t MAX_LINE_COUNT = LINE_COUNT + USER_LINE_COUNT;
+  int8_t findLine(Sector_t sector) const {
+    for (uint8_t i = 0; i < lineCount(); i++) {
+      if (m_sector[m_lru[i]] == sector) {
+        return m_lru[i];
+      }
+    }
+    return -1;
+  }
+  void invalidateRange(Sector_t sector, size_t count);
+  uint8_t* lineBuffer(uint8_t line) {
+#if FS_CACHE_USER_SECTOR_COUNT
+    if (line >= LINE_COUNT) {
+      return m_userBuffer + 512 * (line - LINE_COUNT);
+    }
+#endif  // FS_CACHE_USER_SECTOR_COUNT
+    return m_buffer[line];
+  }
+#if FS_CACHE_USER_SECTOR_COUNT
+  uint8_t lineCount() const { return LINE_COUNT + m_userCount; }
+#else   // FS_CACHE_USER_SECTOR_COUNT
+  uint8_t lineCount() const { return LINE_COUNT; }
+#endif  // FS_CACHE_USER_SECTOR_COUNT
+#if USE_DEFERRED_FAT_MIRROR
+  void mirrorAdd(Sector_t sector);
+#endif  // USE_DEFERRED_FAT_MIRROR
+  void setMostRecent(uint8_t line);
+  bool syncLine(uint8_t line);
+  bool syncRange(Sector_t sector, size_t count);
+
   FsBlockDevice* m_blockDev;
-  Sector_t m_sector;
   uint32_t m_mirrorOffset;
-  uint8_t m_buffer[512] __attribute__((aligned(4)));
+#if USE_DEFERRED_FAT_MIRROR
+  static const uint8_t MIRROR_RANGE_COUNT = 4;
+  // Sorted ranges [bgn, end) of first FAT sectors to copy.
+  uint8_t m_mirrorCount;
+  Sector_t m_mirrorBgn[MIRROR_RANGE_COUNT];
+  Sector_t m_mirrorEnd[MIRROR_RANGE_COUNT];
+#endif  // USE_DEFERRED_FAT_MIRROR
+#if USE_FS_CACHE_STATS
+  uint32_t m_hitCount;
+  uint32_t m_missCount;
+#endif  // USE_FS_CACHE_STATS
+#if FS_CACHE_USER_SECTOR_COUNT
+  uint8_t* m_userBuffer;
+  uint8_t m_userCount;
+#endif  // FS_CACHE_USER_SECTOR_COUNT
+  Sector_t m_sector[MAX_LINE_COUNT];
+  uint8_t m_status[MAX_LINE_COUNT];
+  // Line numbers ordered from most to least recently used.
+  uint8_t m_lru[MAX_LINE_COUNT];
+  uint8_t m_buffer[LINE_COUNT][512] __attribute__((aligned(4)));
 };
@@ -0,0 +1,124 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "FsDirIndex.h"
+#if USE_DIR_INDEX
+//------------------------------------------------------------------------------
+void FsDirIndex::add(uint32_t index, uint8_t count, uint16_t hash,
+                     uint16_t alias) {
+  if (!m_table) {
+    return;
+  }
+  if (m_count >= m_size || index > 0XFFFFFF) {
+    // Table too small for the directory.
+    end();
+    return;
+  }
+  FsDirIndexEntry* entry = &m_table[m_count++];
+  entry->index = index;
+  entry->count = count;
+  entry->hash = hash;
+  entry->alias = alias;
+}
+//------------------------------------------------------------------------------
+void FsDirIndex::addFree(uint32_t index, uint32_t count) {
+  if (index + count == m_endIndex) {
+    // Extend free space at end of directory.
+    m_endIndex = index;
+    for (uint8_t i = 0; i < m_freeCount; i++) {
+      if (m_free[i].index + m_free[i].count == m_endIndex) {
+        m_endIndex = m_free[i].index;
+        freeRemove(i);
+        // Restart the scan for a run that is now adjacent.
+        i = 0XFF;
+      }
+    }
+    return;
+  }
+  // Join adjacent runs.
+  for (uint8_t i = 0; i < m_freeCount; i++) {
+    if (m_free[i].index + m_free[i].count == index) {
+      index = m_free[i].index;
+    } else if (index + count != m_free[i].index) {
+      continue;
+    }
+    count += m_free[i].count;
+    freeRemove(i);
+    // Restart the scan for a run that is now adjacent.
+    i = 0XFF;
+  }
+  uint8_t i = m_freeCount;
+  if (i == FREE_RUN_COUNT) {
+    // Replace the smallest run.
+    uint8_t k = 0;
+    for (i = 1; i < FREE_RUN_COUNT; i++) {
+      if (m_free[i].count < m_free[k].count) {
+        k = i;
+      }
+    }
+    if (m_free[k].count >= count) {
+      return;
+    }
+    i = k;
+  } else {
+    m_freeCount++;
+  }
+  m_free[i].index = index;
+  m_free[i].count = count;
+}
+//------------------------------------------------------------------------------
+void FsDirIndex::remove(uint32_t index, uint8_t count) {
+  for (size_t i = 0; i < m_count; i++) {
+    if (m_table[i].index == index && m_table[i].count == count) {
+      m_table[i] = m_table[--m_count];
+      addFree(index, count);
+      return;
+    }
+  }
+  invalidate();
+}
+//------------------------------------------------------------------------------
+uint32_t FsDirIndex::takeFree(uint8_t count) {
+  uint32_t index;
+  uint8_t k = FREE_RUN_COUNT;
+  for (uint8_t i = 0; i < m_freeCount; i++) {
+    if (m_free[i].count >= count &&
+        (k == FREE_RUN_COUNT || m_free[i].count < m_free[k].count)) {
+      k = i;
+    }
+  }
+  if (k == FREE_RUN_COUNT) {
+    index = m_endIndex;
+    m_endIndex += count;
+    return index;
+  }
+  index = m_free[k].index;
+  m_free[k].index += count;
+  m_free[k].count -= count;
+  if (m_free[k].count == 0) {
+    freeRemove(k);
+  }
+  return index;
+}
+#endif  // USE_DIR_INDEX
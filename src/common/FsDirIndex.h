@@ -0,0 +1,173 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+/**
+ * \file
+ * \brief FsDirIndex class
+ */
+#include "FsStructs.h"
+#include "SysCall.h"
+#if USE_DIR_INDEX
+//------------------------------------------------------------------------------
+/**
+ * \struct FsDirIndexEntry
+ * \brief Index entry for a set of directory entries.
+ */
+struct FsDirIndexEntry {
+  /** First directory entry of the set. */
+  uint32_t index : 24;
+  /** Number of directory entries in the set. */
+  uint32_t count : 8;
+  /** Hash of the long name. */
+  uint16_t hash;
+  /** Hash of the FAT short name or the long name for exFAT. */
+  uint16_t alias;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class FsDirIndex
+ * \brief Internal RAM index of a directory - do not use in user apps.
+ *
+ * The table of entries is supplied by the caller and is scanned linearly.
+ * Free entries are kept as a short list of runs plus the index of the
+ * free space at the end of the directory.  Runs that don't fit in the
+ * list are not reused until the index is rebuilt.  The index is turned
+ * off if the table is too small for the directory.
+ */
+class FsDirIndex {
+ public:
+  /** Maximum number of free runs. */
+  static const uint8_t FREE_RUN_COUNT = 8;
+  /** Add a set of directory entries.
+   *
+   * \param[in] index First directory entry of the set.
+   * \param[in] count Number of directory entries in the set.
+   * \param[in] hash Hash of the long name.
+   * \param[in] alias Hash of the short name.
+   */
+  void add(uint32_t index, uint8_t count, uint16_t hash, uint16_t alias);
+  /** Add a run of free directory entries.
+   *
+   * \param[in] index First free directory entry.
+   * \param[in] count Number of free directory entries.
+   */
+  void addFree(uint32_t index, uint32_t count);
+  /** Use a table for the index of a directory.
+   *
+   * \param[in] table Array of \a size entries.
+   * \param[in] size Number of entries in \a table.
+   * \param[in] dir First cluster of the directory or zero for root.
+   */
+  void begin(FsDirIndexEntry* table, size_t size, uint32_t dir) {
+    m_table = table;
+    m_size = size;
+    m_dir = dir;
+    m_built = false;
+  }
+  /** Start a build of the index. */
+  void buildBegin() {
+    m_count = 0;
+    m_freeCount = 0;
+    m_endIndex = 0;
+  }
+  /** Finish a build of the index.
+   *
+   * \param[in] endIndex First entry of the free space at the end of the
+   *            directory.
+   */
+  void buildEnd(uint32_t endIndex) {
+    m_endIndex = endIndex;
+    m_built = m_table != nullptr;
+  }
+  /** \return Number of sets in the index. */
+  size_t count() const { return m_count; }
+  /** \param[in] dir First cluster of a directory or zero for root.
+   *  \return true if the index is for the directory.
+   */
+  bool covers(uint32_t dir) const { return m_table && m_dir == dir; }
+  /** \return First cluster of the directory or zero for root. */
+  uint32_t dir() const { return m_dir; }
+  /** Stop use of the table. */
+  void end() {
+    m_table = nullptr;
+    m_built = false;
+  }
+  /** \return First entry of the free space at the end of the directory. */
+  uint32_t endIndex() const { return m_endIndex; }
+  /** Find the next set with a matching hash.
+   *
+   * \param[in,out] iter Table position.  Set to zero for the first call.
+   * \param[in] hash Hash of the long name.
+   * \param[in] alias Hash of the short name.
+   * \return Set with a matching \a hash or \a alias or nullptr if none.
+   */
+  const FsDirIndexEntry* find(size_t* iter, uint16_t hash,
+                              uint16_t alias) const {
+    for (size_t i = *iter; i < m_count; i++) {
+      if (m_table[i].hash == hash || m_table[i].alias == alias) {
+        *iter = i + 1;
+        return &m_table[i];
+      }
+    }
+    *iter = m_count;
+    return nullptr;
+  }
+  /** Force a rebuild at the next use of the index. */
+  void invalidate() { m_built = false; }
+  /** \return true if the index matches the directory. */
+  bool isBuilt() const { return m_built; }
+  /** Remove a set of directory entries and add the entries to the free
+   *  runs.  The index is rebuilt at the next use if the set is not found.
+   *
+   * \param[in] index First directory entry of the set.
+   * \param[in] count Number of directory entries in the set.
+   */
+  void remove(uint32_t index, uint8_t count);
+  /** \return Size of the table. */
+  size_t size() const { return m_size; }
+  /** Take free directory entries for a new set.
+   *
+   * \param[in] count Number of directory entries needed.
+   * \return First entry of the smallest run that fits or the end index.
+   */
+  uint32_t takeFree(uint8_t count);
+
+ private:
+  struct FreeRun {
+    uint32_t index;
+    uint32_t count;
+  };
+  void freeRemove(uint8_t i) { m_free[i] = m_free[--m_freeCount]; }
+
+  FsDirIndexEntry* m_table = nullptr;
+  size_t m_size;
+  size_t m_count;
+  uint32_t m_dir;
+  uint32_t m_endIndex;
+  bool m_built = false;
+  uint8_t m_freeCount;
+  FreeRun m_free[FREE_RUN_COUNT];
+};
+#endif  // USE_DIR_INDEX
@@ -0,0 +1,207 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include "FsDirList.h"
+//------------------------------------------------------------------------------
+static char upper(char c) { return 'a' <= c && c <= 'z' ? c - 'a' + 'A' : c; }
+//------------------------------------------------------------------------------
+static int cmpName(const char* a, const char* b) {
+  while (*a && upper(*a) == upper(*b)) {
+    a++;
+    b++;
+  }
+  return (uint8_t)upper(*a) - (uint8_t)upper(*b);
+}
+//------------------------------------------------------------------------------
+// Skip a UTF-8 character.
+static const char* nextChar(const char* str) {
+  do {
+    str++;
+  } while ((*str & 0XC0) == 0X80);
+  return str;
+}
+//------------------------------------------------------------------------------
+void FsDirList::add(const FsDirStat* stat) {
+  uint16_t i;
+  char* name;
+  if ((stat->isHidden() && !(m_flags & LIST_HIDDEN)) ||
+      (m_flags & (stat->isDir() ? LIST_NO_DIRS : LIST_NO_FILES)) ||
+      (m_pattern && !match(m_pattern, m_scratch))) {
+    return;
+  }
+  m_total++;
+  if (m_hasCursor && compare(stat, m_scratch, &m_cursor) <= 0) {
+    return;
+  }
+  m_after++;
+  if (m_entryCount < m_capacity) {
+    name = m_names + m_entryCount * m_nameSize;
+  } else if (compare(stat, m_scratch, &m_entry[m_entryCount - 1]) < 0) {
+    // Replace the last entry.
+    name = m_entry[--m_entryCount].name;
+  } else {
+    return;
+  }
+  for (i = m_entryCount;
+       i > 0 && compare(stat, m_scratch, &m_entry[i - 1]) < 0; i--) {
+    m_entry[i] = m_entry[i - 1];
+  }
+  m_entry[i].stat = *stat;
+  m_entry[i].name = name;
+  strcpy(name, m_scratch);
+  m_entryCount++;
+}
+//------------------------------------------------------------------------------
+bool FsDirList::begin(void* arena, size_t arenaSize, size_t nameSize,
+                      uint8_t order, const char* pattern, uint8_t flags) {
+  size_t align = -reinterpret_cast<uintptr_t>(arena) &
+                 (alignof(FsDirListEntry) - 1);
+  size_t capacity = 0;
+  // Names must have room for a FAT short name.
+  if (nameSize >= 13 && arenaSize > align + 2 * nameSize) {
+    capacity = (arenaSize - align - 2 * nameSize) /
+               (sizeof(FsDirListEntry) + nameSize);
+  }
+  m_capacity = capacity < 0XFFFF ? capacity : 0XFFFF;
+  m_entry = reinterpret_cast<FsDirListEntry*>(
+      reinterpret_cast<uint8_t*>(arena) + align);
+  m_names = reinterpret_cast<char*>(m_entry + m_capacity);
+  m_scratch = m_names + m_capacity * nameSize;
+  m_cursor.name = m_scratch + nameSize;
+  m_pattern = pattern;
+  m_nameSize = nameSize;
+  m_order = order;
+  m_flags = flags;
+  m_base = 0;
+  m_position = 0;
+  m_total = 0;
+  m_entryCount = 0;
+  m_first = 0;
+  m_pageCount = 0;
+  m_valid = false;
+  m_hasCursor = false;
+  return m_capacity != 0;
+}
+//------------------------------------------------------------------------------
+int FsDirList::compare(const FsDirStat* stat, const char* name,
+                       const FsDirListEntry* entry) const {
+  int rtn = 0;
+  if ((m_order & ~SORT_DESCEND) == SORT_MTIME) {
+    uint32_t a = (uint32_t)stat->modifyDate << 16 | stat->modifyTime;
+    uint32_t b = (uint32_t)entry->stat.modifyDate << 16 |
+                 entry->stat.modifyTime;
+    rtn = a < b ? -1 : a > b;
+  } else if ((m_order & ~SORT_DESCEND) == SORT_SIZE) {
+    rtn = stat->size < entry->stat.size ? -1 : stat->size > entry->stat.size;
+  }
+  if (rtn == 0) {
+    rtn = cmpName(name, entry->name);
+  }
+  if (rtn == 0) {
+    // Unique order for the position of the next scan.
+    rtn = stat->dirIndex < entry->stat.dirIndex
+              ? -1
+              : stat->dirIndex > entry->stat.dirIndex;
+  }
+  return m_order & SORT_DESCEND ? -rtn : rtn;
+}
+//------------------------------------------------------------------------------
+bool FsDirList::match(const char* pattern, const char* name) {
+  const char* star = nullptr;
+  const char* back = nullptr;
+  while (*name) {
+    if (*pattern == '*') {
+      star = ++pattern;
+      back = name;
+    } else if (*pattern == '?') {
+      pattern++;
+      name = nextChar(name);
+    } else if (*pattern && upper(*pattern) == upper(*name)) {
+      pattern++;
+      name++;
+    } else if (star) {
+      // Let the last '*' match one more character.
+      pattern = star;
+      back = nextChar(back);
+      name = back;
+    } else {
+      return false;
+    }
+  }
+  while (*pattern == '*') {
+    pattern++;
+  }
+  return *pattern == '\0';
+}
+//------------------------------------------------------------------------------
+void FsDirList::pageBegin(uint16_t count) {
+  m_want = count < m_capacity ? count : m_capacity;
+  if (!m_valid || m_position < m_base) {
+    // Start over at the first entry.
+    m_valid = false;
+    m_hasCursor = false;
+    m_base = 0;
+  }
+}
+//------------------------------------------------------------------------------
+uint16_t FsDirList::pageEnd() {
+  uint32_t k = m_position - m_base;
+  m_first = k < m_entryCount ? k : m_entryCount;
+  m_pageCount = m_entryCount - m_first;
+  if (m_pageCount > m_want) {
+    m_pageCount = m_want;
+  }
+  m_position += m_pageCount;
+  return m_pageCount;
+}
+//------------------------------------------------------------------------------
+void FsDirList::scanBegin() {
+  m_entryCount = 0;
+  m_total = 0;
+  m_after = 0;
+}
+//------------------------------------------------------------------------------
+void FsDirList::scanEnd() {
+  m_valid = true;
+  m_complete = m_after == m_entryCount;
+}
+//------------------------------------------------------------------------------
+bool FsDirList::scanNeeded() {
+  if (!m_valid) {
+    return true;
+  }
+  uint32_t k = m_position - m_base;
+  if (m_complete || k + m_want <= m_entryCount) {
+    return false;
+  }
+  // The arena is full so k is not zero.  Continue after entry k - 1.
+  if (k > m_entryCount) {
+    k = m_entryCount;
+  }
+  m_cursor.stat = m_entry[k - 1].stat;
+  strcpy(m_cursor.name, m_entry[k - 1].name);
+  m_hasCursor = true;
+  m_base += k;
+  return true;
+}
@@ -0,0 +1,177 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+/**
+ * \file
+ * \brief FsDirList class
+ */
+#include "FsDirStat.h"
+//------------------------------------------------------------------------------
+/**
+ * \struct FsDirListEntry
+ * \brief Entry of a sorted directory list.
+ */
+struct FsDirListEntry {
+  /** Information from readDirPlus(). */
+  FsDirStat stat;
+  /** Name of the entry. */
+  char* name;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class FsDirList
+ * \brief State of a sorted and filtered directory listing.
+ *
+ * Used by listPage(FsDirList*, uint16_t) to return a directory one page
+ * at a time sorted by name, modify time or size.  Entries and names are
+ * kept in an arena supplied by the caller.  A scan of the directory keeps
+ * the first capacity() entries that follow the last entry returned, so
+ * the directory is only read again when the arena has been used.  If the
+ * remaining entries fit, later pages are returned without a scan.
+ *
+ * Call begin() again if the directory is changed between pages.
+ */
+class FsDirList {
+ public:
+  /** Sort by name ignoring ASCII case. */
+  static const uint8_t SORT_NAME = 0;
+  /** Sort by modify date and time. */
+  static const uint8_t SORT_MTIME = 1;
+  /** Sort by size. */
+  static const uint8_t SORT_SIZE = 2;
+  /** Or with the sort key for descending order. */
+  static const uint8_t SORT_DESCEND = 0X80;
+  /** List hidden entries. */
+  static const uint8_t LIST_HIDDEN = 1;
+  /** Don't list directories. */
+  static const uint8_t LIST_NO_DIRS = 2;
+  /** Don't list files. */
+  static const uint8_t LIST_NO_FILES = 4;
+  /** Start a new listing.
+   *
+   * \param[in] arena Memory for entries and names.
+   * \param[in] arenaSize Size of \a arena in bytes.
+   * \param[in] nameSize Space for each name including the zero byte.
+   *            A long name that does not fit is returned as the FAT short
+   *            name or truncated on exFAT.
+   * \param[in] order One of the SORT_* keys, optionally with SORT_DESCEND.
+   * \param[in] pattern Names to list, '*' matches any characters and '?'
+   *            one character, ASCII case is ignored.  nullptr for all.
+   * \param[in] flags LIST_* options.
+   *
+   * \return true for success or false if the arena is too small for one
+   *         entry.
+   */
+  bool begin(void* arena, size_t arenaSize, size_t nameSize, uint8_t order,
+             const char* pattern = nullptr, uint8_t flags = 0);
+  /** \return Maximum number of entries kept by one scan. */
+  uint16_t capacity() const { return m_capacity; }
+  /** \return Number of entries in the current page. */
+  uint16_t count() const { return m_pageCount; }
+  /** \param[in] i Index in the current page.
+   *  \return Entry \a i of the current page.
+   */
+  const FsDirListEntry* entry(uint16_t i) const {
+    return &m_entry[m_first + i];
+  }
+  /** Match a name with a pattern.
+   *
+   * \param[in] pattern '*' matches any characters and '?' one character.
+   * \param[in] name Name to test.
+   * \return true if \a name matches \a pattern ignoring ASCII case.
+   */
+  static bool match(const char* pattern, const char* name);
+  /** \param[in] i Index in the current page.
+   *  \return Name of entry \a i of the current page.
+   */
+  const char* name(uint16_t i) const { return m_entry[m_first + i].name; }
+  /** \return Index in the sorted list of the first entry of the next page. */
+  uint32_t position() const { return m_position; }
+  /** Set the first entry of the next page.
+   *
+   * \param[in] index Index in the sorted list.
+   */
+  void seek(uint32_t index) { m_position = index; }
+  /** \param[in] i Index in the current page.
+   *  \return Information for entry \a i of the current page.
+   */
+  const FsDirStat* stat(uint16_t i) const {
+    return &m_entry[m_first + i].stat;
+  }
+  /** \return Number of entries in the directory that pass the filters.
+   *          Valid after the first page.
+   */
+  uint32_t total() const { return m_total; }
+  //----------------------------------------------------------------------------
+  // Internal functions - do not use in user apps.
+  /** Add an entry found by a scan.
+   *
+   * \param[in] stat Information for the entry.  The name is in nameBuffer().
+   */
+  void add(const FsDirStat* stat);
+  /** \return Buffer for the name of the entry given to add(). */
+  char* nameBuffer() { return m_scratch; }
+  /** \return Size of nameBuffer(). */
+  size_t nameSize() const { return m_nameSize; }
+  /** Start a page.
+   *
+   * \param[in] count Maximum number of entries in the page.
+   */
+  void pageBegin(uint16_t count);
+  /** End a page.
+   * \return Number of entries in the page.
+   */
+  uint16_t pageEnd();
+  /** Start a scan of the directory. */
+  void scanBegin();
+  /** End a scan of the directory. */
+  void scanEnd();
+  /** \return true if the directory must be scanned for the next page. */
+  bool scanNeeded();
+
+ private:
+  int compare(const FsDirStat* stat, const char* name,
+              const FsDirListEntry* entry) const;
+  FsDirListEntry* m_entry;
+  char* m_names;
+  char* m_scratch;
+  const char* m_pattern;
+  size_t m_nameSize;
+  uint32_t m_base;
+  uint32_t m_position;
+  uint32_t m_total;
+  uint32_t m_after;
+  uint16_t m_capacity;
+  uint16_t m_entryCount;
+  uint16_t m_first;
+  uint16_t m_pageCount;
+  uint16_t m_want;
+  uint8_t m_order;
+  uint8_t m_flags;
+  bool m_valid;
+  bool m_complete;
+  bool m_hasCursor;
+  FsDirListEntry m_cursor;
+};
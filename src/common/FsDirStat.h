@@ -0,0 +1,71 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+/**
+ * \file
+ * \brief FsDirStat struct
+ */
+#include "FsStructs.h"
+#include "SysCall.h"
+//------------------------------------------------------------------------------
+/**
+ * \struct FsDirStat
+ * \brief Directory entry returned by readDirPlus().
+ *
+ * Filled from the directory entries of one file in a single pass.  Dates
+ * and times are in FAT format, see FsDateTime.h.
+ */
+struct FsDirStat {
+  /** File size in bytes.  Zero for a FAT directory. */
+  uint64_t size;
+  /** First cluster of the file or zero if none. */
+  uint32_t firstCluster;
+  /** Index of the entry for open(dirFile, index). */
+  uint32_t dirIndex;
+  /** Create date. */
+  uint16_t createDate;
+  /** Create time. */
+  uint16_t createTime;
+  /** Modify date. */
+  uint16_t modifyDate;
+  /** Modify time. */
+  uint16_t modifyTime;
+  /** Access date. */
+  uint16_t accessDate;
+  /** Access time.  Zero for FAT. */
+  uint16_t accessTime;
+  /** FS_ATTRIB_* bits. */
+  uint8_t attributes;
+  /** True if the name did not fit in the buffer passed to readDirPlus().
+   *  FAT returns the short name and exFAT returns the start of the name.
+   */
+  bool nameTruncated;
+  /** \return true if the entry is a directory. */
+  bool isDir() const { return attributes & FS_ATTRIB_DIRECTORY; }
+  /** \return true if the entry is hidden. */
+  bool isHidden() const { return attributes & FS_ATTRIB_HIDDEN; }
+  /** \return true if the entry is read only. */
+  bool isReadOnly() const { return attributes & FS_ATTRIB_READ_ONLY; }
+};
@@ -0,0 +1,121 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+/**
+ * \file
+ * \brief FsExtentMap class
+ */
+#include "FsStructs.h"
+#include "SysCall.h"
+#if FS_EXTENT_COUNT
+//------------------------------------------------------------------------------
+/**
+ * \class FsExtentMap
+ * \brief Map of the leading cluster runs of a file.
+ *
+ * The map covers file clusters zero through end() - 1.  Runs are only
+ * appended at the end of the map so no run is ever stale while the file's
+ * cluster chain is unchanged.  An all zero object is an empty map.
+ */
+class FsExtentMap {
+ public:
+  /** Record the cluster for a file cluster index.
+   *
+   * Ignored unless index is end().  Mapping stops when all runs are used.
+   *
+   * \param[in] index Cluster index in the file.
+   * \param[in] cluster Cluster number on the volume.
+   */
+  void add(uint32_t index, Cluster_t cluster) {
+    if (index != m_end || cluster < 2) {
+      return;
+    }
+    if (m_count) {
+      Extent* last = &m_extent[m_count - 1];
+      if (cluster == last->cluster + (index - last->index)) {
+        m_end++;
+        return;
+      }
+    }
+    if (m_count < FS_EXTENT_COUNT) {
+      m_extent[m_count].index = index;
+      m_extent[m_count].cluster = cluster;
+      m_count++;
+      m_end++;
+    }
+  }
+  /** Empty the map. */
+  void clear() {
+    m_count = 0;
+    m_end = 0;
+  }
+  /** \return Number of file clusters covered by the map. */
+  uint32_t end() const { return m_end; }
+  /** Find the cluster for a file cluster index.
+   *
+   * \param[in] index Cluster index in the file.
+   * \return Cluster number or zero if index is not mapped.
+   */
+  Cluster_t find(uint32_t index) const {
+    if (index >= m_end) {
+      return 0;
+    }
+    // Binary search for the last run starting at or before index.
+    uint8_t lo = 0;
+    uint8_t hi = m_count;
+    while (hi - lo > 1) {
+      uint8_t mid = (lo + hi) / 2;
+      if (m_extent[mid].index <= index) {
+        lo = mid;
+      } else {
+        hi = mid;
+      }
+    }
+    return m_extent[lo].cluster + (index - m_extent[lo].index);
+  }
+  /** Drop file clusters at or after an index.
+   *
+   * \param[in] index First cluster index to drop.
+   */
+  void truncate(uint32_t index) {
+    if (index >= m_end) {
+      return;
+    }
+    while (m_count && m_extent[m_count - 1].index >= index) {
+      m_count--;
+    }
+    m_end = m_count ? index : 0;
+  }
+
+ private:
+  struct Extent {
+    uint32_t index;
+    Cluster_t cluster;
+  };
+  uint32_t m_end;
+  uint8_t m_count;
+  Extent m_extent[FS_EXTENT_COUNT];
+};
+#endif  // FS_EXTENT_COUNT
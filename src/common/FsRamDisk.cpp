@@ -0,0 +1,123 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#define DBG_FILE "FsRamDisk.cpp"
+#include "FsRamDisk.h"
+
+#include "DebugMacros.h"
+//------------------------------------------------------------------------------
+bool FsRamDisk::begin(uint8_t* data, Sector_t count) {
+  end();
+  m_data = data;
+  m_sectorCount = count;
+  return data != nullptr;
+}
+//------------------------------------------------------------------------------
+void FsRamDisk::end() {
+  syncDevice();
+  m_data = nullptr;
+  m_sectorCount = 0;
+}
+//------------------------------------------------------------------------------
+bool FsRamDisk::erase(Sector_t firstSector, Sector_t lastSector) {
+  if (!syncDevice() || lastSector < firstSector ||
+      !inRange(firstSector, lastSector - firstSector + 1)) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  memset(m_data + 512 * firstSector, 0, 512 * (lastSector - firstSector + 1));
+  return true;
+}
+//------------------------------------------------------------------------------
+bool FsRamDisk::isBusy() {
+#if USE_ASYNC_IO
+  return m_queue.count() != 0;
+#else   // USE_ASYNC_IO
+  return false;
+#endif  // USE_ASYNC_IO
+}
+//------------------------------------------------------------------------------
+#if USE_ASYNC_IO
+uint8_t FsRamDisk::poll() {
+  FsIoRequest* req = m_queue.front();
+  if (!req) {
+    return 0;
+  }
+  uint8_t* mem = m_data + 512 * (req->sector + m_done);
+  uint8_t* buf = req->data + 512 * m_done;
+  if (req->op == FS_IO_WRITE) {
+    memcpy(mem, buf, 512);
+  } else {
+    memcpy(buf, mem, 512);
+  }
+  if (++m_done == req->count) {
+    m_done = 0;
+    m_queue.pop();
+    req->complete(true);
+  }
+  return m_queue.count();
+}
+#endif  // USE_ASYNC_IO
+//------------------------------------------------------------------------------
+bool FsRamDisk::readSectors(Sector_t sector, uint8_t* dst, size_t ns) {
+  if (!syncDevice() || !inRange(sector, ns)) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  memcpy(dst, m_data + 512 * sector, 512 * ns);
+  return true;
+}
+//------------------------------------------------------------------------------
+#if USE_ASYNC_IO
+bool FsRamDisk::submit(FsIoRequest* req) {
+  if (!req->count || !inRange(req->sector, req->count)) {
+    DBG_FAIL_MACRO;
+    req->complete(false);
+    return false;
+  }
+  while (m_queue.isFull()) {
+    poll();
+  }
+  req->status = FS_IO_PENDING;
+  m_queue.push(req);
+  return true;
+}
+#endif  // USE_ASYNC_IO
+//------------------------------------------------------------------------------
+bool FsRamDisk::syncDevice() {
+#if USE_ASYNC_IO
+  while (poll()) {
+  }
+#endif  // USE_ASYNC_IO
+  return true;
+}
+//------------------------------------------------------------------------------
+bool FsRamDisk::writeSectors(Sector_t sector, const uint8_t* src, size_t ns) {
+  if (!syncDevice() || !inRange(sector, ns)) {
+    DBG_FAIL_MACRO;
+    return false;
+  }
+  memcpy(m_data + 512 * sector, src, 512 * ns);
+  return true;
+}
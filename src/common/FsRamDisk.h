@@ -0,0 +1,134 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+/**
+ * \file
+ * \brief FsRamDisk class
+ */
+#include "FsBlockDeviceInterface.h"
+//------------------------------------------------------------------------------
+/**
+ * \class FsRamDisk
+ * \brief Block device in RAM.
+ *
+ * Useful for PSRAM on large boards and for testing on a host.  Queued
+ * requests advance one sector per call to poll() so the asynchronous
+ * state machine behaves like a slow device.  Not included by SdFat.h,
+ * include "common/FsRamDisk.h" to use it.
+ */
+class FsRamDisk : public FsBlockDeviceInterface {
+ public:
+  /** Initialize the disk.
+   *
+   * \param[in] data Storage for 512 * count bytes.
+   * \param[in] count Number of sectors.
+   * \return true for success or false for failure.
+   */
+  bool begin(uint8_t* data, Sector_t count);
+  /** End use of the disk. */
+  void end() override;
+  /** Erase a range of sectors to zero.
+   *
+   * \param[in] firstSector The address of the first sector in the range.
+   * \param[in] lastSector The address of the last sector in the range.
+   *
+   * \return true for success or false for failure.
+   */
+  bool erase(Sector_t firstSector, Sector_t lastSector) override;
+  /** \return true if requests are queued. */
+  bool isBusy() override;
+#if USE_ASYNC_IO
+  /**
+   * Transfer one sector of the oldest queued request.
+   *
+   * \return Number of requests not yet complete.
+   */
+  uint8_t poll() override;
+#endif  // USE_ASYNC_IO
+  /**
+   * Read a sector.
+   *
+   * \param[in] sector Logical sector to be read.
+   * \param[out] dst Pointer to the location that will receive the data.
+   * \return true for success or false for failure.
+   */
+  bool readSector(Sector_t sector, uint8_t* dst) override {
+    return readSectors(sector, dst, 1);
+  }
+  /**
+   * Read multiple sectors.
+   *
+   * \param[in] sector Logical sector to be read.
+   * \param[in] ns Number of sectors to be read.
+   * \param[out] dst Pointer to the location that will receive the data.
+   * \return true for success or false for failure.
+   */
+  bool readSectors(Sector_t sector, uint8_t* dst, size_t ns) override;
+  /** \return disk size in sectors. */
+  Sector_t sectorCount() override { return m_sectorCount; }
+#if USE_ASYNC_IO
+  /**
+   * Queue a sector request.  Waits in poll() while the queue is full.
+   *
+   * \param[in,out] req Request to be queued.
+   * \return true for success or false for failure.
+   */
+  bool submit(FsIoRequest* req) override;
+#endif  // USE_ASYNC_IO
+  /** Complete all queued requests.
+   * \return true for success or false for failure.
+   */
+  bool syncDevice() override;
+  /**
+   * Writes a sector.
+   *
+   * \param[in] sector Logical sector to be written.
+   * \param[in] src Pointer to the location of the data to be written.
+   * \return true for success or false for failure.
+   */
+  bool writeSector(Sector_t sector, const uint8_t* src) override {
+    return writeSectors(sector, src, 1);
+  }
+  /**
+   * Write multiple sectors.
+   *
+   * \param[in] sector Logical sector to be written.
+   * \param[in] ns Number of sectors to be written.
+   * \param[in] src Pointer to the location of the data to be written.
+   * \return true for success or false for failure.
+   */
+  bool writeSectors(Sector_t sector, const uint8_t* src, size_t ns) override;
+
+ private:
+  bool inRange(Sector_t sector, size_t ns) const {
+    return m_data && sector < m_sectorCount && ns <= (m_sectorCount - sector);
+  }
+  uint8_t* m_data = nullptr;
+  Sector_t m_sectorCount = 0;
+#if USE_ASYNC_IO
+  FsIoQueue m_queue;
+  size_t m_done = 0;  // sectors of oldest request transferred
+#endif  // USE_ASYNC_IO
+};
@@ -0,0 +1,196 @@
+/**
+ * Copyright (c) 2011-2025 Bill Greiman
+ * This file is part of the SdFat library for SD memory cards.
+ *
+ * MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included
+ * in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#pragma once
+/**
+ * \file
+ * \brief FsRmRf class
+ */
+#include "FsStructs.h"
+#include "SysCall.h"
+//------------------------------------------------------------------------------
+/**
+ * \class FsBaseRmRf
+ * \brief State of a bulk recursive delete without storage for the batch.
+ *
+ * See FsRmRf.  The batch and saved positions are arrays supplied by a
+ * derived class so rmRfStar() without an argument can use a small batch
+ * and no saved positions.
+ */
+class FsBaseRmRf {
+ public:
+  /** Start a new delete.
+   *
+   * \param[in] budget Maximum files and directories removed per call or
+   *            zero for no limit.
+   * \param[in] progress Called with removed() after each batch or nullptr.
+   */
+  void begin(uint32_t budget = 0, void (*progress)(uint32_t) = nullptr) {
+    m_budget = budget;
+    m_progress = progress;
+    m_removed = 0;
+    m_count = 0;
+    m_batchCount = 0;
+    memset(m_position, 0, m_maxDepth * sizeof(uint32_t));
+  }
+  /** \return Maximum files and directories removed per call. */
+  uint32_t budget() const { return m_budget; }
+  /** \return Number of files and directories removed since begin(). */
+  uint32_t removed() const { return m_removed; }
+  //----------------------------------------------------------------------------
+  // Internal functions - do not use in user apps.
+  /** Add a chain to the batch.
+   *
+   * \param[in] cluster First cluster of the chain.
+   * \param[in] count Number of contiguous clusters or zero for a FAT chain.
+   * \return true if the batch is full.
+   */
+  bool add(Cluster_t cluster, uint32_t count) {
+    m_cluster[m_batchCount] = cluster;
+    m_clusterCount[m_batchCount] = count;
+    return ++m_batchCount == m_batchSize;
+  }
+  /** \return Number of chains in the batch. */
+  uint8_t batchCount() const { return m_batchCount; }
+  /** Start a call.  Resets the count for the budget. */
+  void callBegin() { m_count = 0; }
+  /** \param[in] i Index in the batch.
+   *  \return First cluster of the chain.
+   */
+  Cluster_t cluster(uint8_t i) const { return m_cluster[i]; }
+  /** \param[in] i Index in the batch.
+   *  \return Number of contiguous clusters or zero for a FAT chain.
+   */
+  uint32_t clusterCount(uint8_t i) const { return m_clusterCount[i]; }
+  /** Empty the batch after the chains are freed. */
+  void clearBatch() {
+    m_batchCount = 0;
+    if (m_progress) {
+      m_progress(m_removed);
+    }
+  }
+  /** \param[in] depth Directory level.
+   *  \return Position to continue the scan of the directory.
+   */
+  uint32_t position(uint8_t depth) const {
+    return depth < m_maxDepth ? m_position[depth] : 0;
+  }
+  /** Count a removed file or directory. */
+  void remove() {
+    m_removed++;
+    m_count++;
+  }
+  /** Save the position to continue the scan of a directory.
+   *
+   * \param[in] depth Directory level.
+   * \param[in] position Position in the directory.
+   */
+  void setPosition(uint8_t depth, uint32_t position) {
+    if (depth < m_maxDepth) {
+      m_position[depth] = position;
+    }
+  }
+  /** \return true if the budget for this call is used. */
+  bool spent() const { return m_budget && m_count >= m_budget; }
+
+ protected:
+  /** Constructor.
+   *
+   * \param[in] cluster Array of batchSize first clusters.
+   * \param[in] clusterCount Array of batchSize cluster counts.
+   * \param[in] batchSize Number of chains freed in one batch.
+   * \param[in] position Array of maxDepth positions.
+   * \param[in] maxDepth Number of directory levels with a saved position.
+   */
+  FsBaseRmRf(Cluster_t* cluster, uint32_t* clusterCount, uint8_t batchSize,
+             uint32_t* position, uint8_t maxDepth)
+      : m_cluster(cluster),
+        m_clusterCount(clusterCount),
+        m_position(position),
+        m_batchSize(batchSize),
+        m_maxDepth(maxDepth) {}
+  /** Not copyable, the arrays belong to the derived object. */
+  FsBaseRmRf(const FsBaseRmRf&) = delete;
+  /** Not copyable, the arrays belong to the derived object. */
+  FsBaseRmRf& operator=(const FsBaseRmRf&) = delete;
+
+ private:
+  void (*m_progress)(uint32_t);
+  Cluster_t* m_cluster;
+  uint32_t* m_clusterCount;
+  uint32_t* m_position;
+  uint32_t m_budget;
+  uint32_t m_removed;
+  uint32_t m_count;
+  uint8_t m_batchCount;
+  uint8_t m_batchSize;
+  uint8_t m_maxDepth;
+};
+//------------------------------------------------------------------------------
+/**
+ * \class FsRmRfBuffer
+ * \brief FsBaseRmRf with a batch of BATCH chains and DEPTH saved positions.
+ *
+ * \tparam BATCH Number of chains freed in one batch.
+ * \tparam DEPTH Number of directory levels with a saved position.
+ */
+template <uint8_t BATCH, uint8_t DEPTH>
+class FsRmRfBuffer : public FsBaseRmRf {
+ public:
+  FsRmRfBuffer()
+      : FsBaseRmRf(m_clusterBuf, m_countBuf, BATCH, m_positionBuf, DEPTH) {}
+
+ private:
+  Cluster_t m_clusterBuf[BATCH];
+  uint32_t m_countBuf[BATCH];
+  uint32_t m_positionBuf[DEPTH ? DEPTH : 1];
+};
+//------------------------------------------------------------------------------
+/**
+ * \class FsRmRf
+ * \brief State of a bulk recursive delete.
+ *
+ * Used by rmRfStar(FsRmRf*) to remove a tree in steps from a main loop.
+ * Each call removes up to budget() files and directories and the next
+ * call continues where the last one stopped.  Positions are kept for the
+ * first MAX_DEPTH directory levels.  Deeper levels restart at their first
+ * entry which only costs a scan of deleted entries.
+ *
+ * Chains of removed files are collected in a small batch and freed after
+ * the directory sectors with the deleted entries have been written.  An
+ * interrupted delete may leave lost clusters but never an entry that
+ * points to free clusters.
+ */
+class FsRmRf : public FsRmRfBuffer<8, 8> {
+ public:
+  /** Number of chains freed in one batch. */
+  static const uint8_t BATCH_SIZE = 8;
+  /** Number of directory levels with a saved position. */
+  static const uint8_t MAX_DEPTH = 8;
+};
+/** State for rmRfStar() without an argument.  The tree is removed in one
+ * call so no positions are saved and a smaller batch keeps the stack use
+ * low.
+ */
+typedef FsRmRfBuffer<4, 0> FsRmRfOnce;
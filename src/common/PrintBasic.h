@@ -32,10 +32,10 @@
 #include <string.h>
 
 #include "../SdFatConfig.h"
+class __FlashStringHelper;
 #ifndef F
 #if defined(__AVR__)
 #include <avr/pgmspace.h>
-class __FlashStringHelper;
 #define F(string_literal) \
   (reinterpret_cast<const __FlashStringHelper *>(PSTR(string_literal)))
 #else  // defined(__AVR__)